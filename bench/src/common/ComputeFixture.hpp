@@ -0,0 +1,68 @@
+#pragma once
+#include "vktiny/vktiny.hpp"
+
+namespace bench
+{
+    inline const std::string incrementShader = R"(
+#version 460
+layout(local_size_x = 64) in;
+layout(binding = 0) buffer Data { uint values[]; };
+
+void main()
+{
+    values[gl_GlobalInvocationID.x] += 1;
+}
+)";
+
+    inline vk::DescriptorSetLayoutBinding getStorageBufferBinding()
+    {
+        vk::DescriptorSetLayoutBinding binding;
+        binding.setBinding(0);
+        binding.setDescriptorCount(1);
+        binding.setDescriptorType(vk::DescriptorType::eStorageBuffer);
+        binding.setStageFlags(vk::ShaderStageFlagBits::eCompute);
+        return binding;
+    }
+
+    // The increment shader bound to a storage buffer, and a command buffer to record into
+    struct ComputeFixture
+    {
+        ComputeFixture(vkt::Context& context, const vkt::Buffer& buffer)
+            : descPool(context, 1, { { vk::DescriptorType::eStorageBuffer, 1 } })
+            , descSetLayout(context, { bufferBinding })
+            , descSet(context, descPool, descSetLayout)
+            , shaderModule(context, incrementShader)
+            , pipeline(context, descSetLayout, shaderModule)
+            , commandBuffers(context.allocateGraphicsCommandBuffers(1))
+        {
+            descSet.update(buffer, bufferBinding);
+        }
+
+        vkt::CommandBuffer& getCommandBuffer() { return commandBuffers.front(); }
+
+        // One recording of count bind + dispatch + barrier sequences
+        void recordDispatches(uint32_t count)
+        {
+            using vkPS = vk::PipelineStageFlagBits;
+            using vkAF = vk::AccessFlagBits;
+            vkt::CommandBuffer& cmdBuf = getCommandBuffer();
+            cmdBuf.begin();
+            for (uint32_t i = 0; i < count; i++) {
+                cmdBuf.bindPipeline(pipeline);
+                cmdBuf.bindDescriptorSets(descSet, pipeline);
+                cmdBuf.dispatch(1, 1, 1);
+                cmdBuf.memoryBarrier(vkPS::eComputeShader, vkAF::eShaderWrite,
+                                     vkPS::eComputeShader, vkAF::eShaderRead);
+            }
+            cmdBuf.end();
+        }
+
+        vk::DescriptorSetLayoutBinding bufferBinding = getStorageBufferBinding();
+        vkt::DescriptorPool descPool;
+        vkt::DescriptorSetLayout descSetLayout;
+        vkt::DescriptorSet descSet;
+        vkt::ComputeShaderModule shaderModule;
+        vkt::ComputePipeline pipeline;
+        std::vector<vkt::CommandBuffer> commandBuffers;
+    };
+}
@@ -0,0 +1,48 @@
+#include "vktiny/vktiny.hpp"
+#include "ComputeFixture.hpp"
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+// Measures command recording throughput with device functions loaded through
+// vkGetDeviceProcAddr and through the loader trampolines.
+// Usage: bench_recording [commandsPerBuffer] [iterations]
+
+double measure(bool loadDeviceFunctions, uint32_t commandCount, uint32_t iterations)
+{
+    vkt::ContextCreateInfo contextInfo{ .loadDeviceFunctions = loadDeviceFunctions };
+    vkt::Context context{ contextInfo };
+
+    vkt::Buffer buffer{ context, 64 * sizeof(uint32_t), vk::BufferUsageFlagBits::eStorageBuffer,
+                        vk::MemoryPropertyFlagBits::eDeviceLocal };
+    bench::ComputeFixture fixture{ context, buffer };
+    auto record = [&]() { fixture.recordDispatches(commandCount); };
+
+    // Warm up
+    record();
+
+    std::vector<double> samples;
+    for (uint32_t i = 0; i < iterations; i++) {
+        auto begin = std::chrono::steady_clock::now();
+        record();
+        auto end = std::chrono::steady_clock::now();
+        double ns = std::chrono::duration<double, std::nano>(end - begin).count();
+        samples.push_back(ns / (commandCount * 4));
+    }
+    std::sort(samples.begin(), samples.end());
+    return samples[samples.size() / 2];
+}
+
+int main(int argc, char* argv[])
+{
+    uint32_t commandCount = argc > 1 ? std::stoul(argv[1]) : 10000;
+    uint32_t iterations = argc > 2 ? std::stoul(argv[2]) : 100;
+
+    double trampoline = measure(false, commandCount, iterations);
+    double direct = measure(true, commandCount, iterations);
+
+    std::cout << "commands per buffer: " << commandCount * 4 << ", iterations: " << iterations << '\n';
+    std::cout << "loader trampolines:  " << trampoline << " ns/command (median)\n";
+    std::cout << "device dispatch:     " << direct << " ns/command (median)\n";
+    std::cout << "speedup:             " << trampoline / direct << "x\n";
+}
@@ -0,0 +1,202 @@
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace bench
+{
+    struct Summary
+    {
+        double min = 0.0;
+        double median = 0.0;
+        double mean = 0.0;
+        double p90 = 0.0;
+        double p99 = 0.0;
+        double max = 0.0;
+        double stddev = 0.0;
+    };
+
+    struct Result
+    {
+        std::string name;
+        std::string group; // "micro" or "macro"
+        uint32_t batch = 1;
+        uint64_t bytesPerOp = 0;
+        std::vector<double> samples; // ns per op
+        Summary summary;
+        double callsPerOp = -1.0; // only with a call counter
+        std::vector<std::pair<std::string, double>> metrics; // other measurements, e.g. sizes
+    };
+
+    struct RunnerInfo
+    {
+        uint32_t samples = 30;
+        uint32_t warmup = 3;
+        std::string filter = "";
+    };
+
+    inline double percentile(const std::vector<double>& sorted, double p)
+    {
+        double rank = p * (sorted.size() - 1);
+        size_t lower = static_cast<size_t>(rank);
+        size_t upper = std::min(lower + 1, sorted.size() - 1);
+        return sorted[lower] + (sorted[upper] - sorted[lower]) * (rank - lower);
+    }
+
+    inline Summary summarize(std::vector<double> samples)
+    {
+        Summary summary;
+        if (samples.empty()) {
+            return summary;
+        }
+        std::sort(samples.begin(), samples.end());
+        summary.min = samples.front();
+        summary.max = samples.back();
+        summary.median = percentile(samples, 0.5);
+        summary.p90 = percentile(samples, 0.9);
+        summary.p99 = percentile(samples, 0.99);
+        summary.mean = std::accumulate(samples.begin(), samples.end(), 0.0) / samples.size();
+        double variance = 0.0;
+        for (double sample : samples) {
+            variance += (sample - summary.mean) * (sample - summary.mean);
+        }
+        summary.stddev = samples.size() > 1 ? std::sqrt(variance / (samples.size() - 1)) : 0.0;
+        return summary;
+    }
+
+    inline std::string escape(const std::string& str)
+    {
+        std::string escaped;
+        for (char c : str) {
+            if (c == '"' || c == '\\') {
+                escaped += '\\';
+            }
+            escaped += c;
+        }
+        return escaped;
+    }
+
+    class Runner
+    {
+    public:
+        Runner(const RunnerInfo& info)
+            : info(info)
+        {
+        }
+
+        // Report the driver calls per operation, e.g. the null backend's call counts
+        void setCallCounter(std::function<void()> reset, std::function<uint64_t()> count)
+        {
+            resetCalls = std::move(reset);
+            countCalls = std::move(count);
+        }
+
+        // Each sample calls func(batch), which performs batch operations.
+        // Samples are reported as ns per operation.
+        void run(const std::string& name, const std::string& group, uint32_t batch,
+                 const std::function<void(uint32_t)>& func, uint64_t bytesPerOp = 0)
+        {
+            if (!info.filter.empty() && name.find(info.filter) == std::string::npos) {
+                return;
+            }
+
+            for (uint32_t i = 0; i < info.warmup; i++) {
+                func(batch);
+            }
+
+            Result result{ name, group, batch, bytesPerOp };
+            if (resetCalls) {
+                resetCalls();
+            }
+            for (uint32_t i = 0; i < info.samples; i++) {
+                auto begin = std::chrono::steady_clock::now();
+                func(batch);
+                auto end = std::chrono::steady_clock::now();
+                result.samples.push_back(std::chrono::duration<double, std::nano>(end - begin).count() / batch);
+            }
+            result.summary = summarize(result.samples);
+            if (countCalls) {
+                result.callsPerOp = static_cast<double>(countCalls()) / (info.samples * batch);
+            }
+
+            std::cerr << std::left << std::setw(36) << name << std::right << std::fixed << std::setprecision(1)
+                      << std::setw(14) << result.summary.median << " ns (median)"
+                      << std::setw(12) << result.summary.stddev << " ns (stddev)\n";
+            results.push_back(std::move(result));
+        }
+
+        // Attach a measurement other than time to the named result, if it ran
+        void addMetric(const std::string& name, const std::string& metric, double value)
+        {
+            for (Result& result : results) {
+                if (result.name == name) {
+                    std::cerr << "  " << std::left << std::setw(34) << metric << std::right << std::fixed
+                              << std::setprecision(1) << std::setw(14) << value << '\n';
+                    result.metrics.emplace_back(metric, value);
+                    return;
+                }
+            }
+        }
+
+        // metadata entries are written as JSON strings
+        std::string toJson(const std::vector<std::pair<std::string, std::string>>& metadata) const
+        {
+            std::ostringstream out;
+            out << std::setprecision(6) << std::fixed;
+            out << "{\n  \"metadata\": {";
+            for (size_t i = 0; i < metadata.size(); i++) {
+                out << (i ? "," : "") << "\n    \"" << escape(metadata[i].first)
+                    << "\": \"" << escape(metadata[i].second) << "\"";
+            }
+            out << "\n  },\n  \"unit\": \"ns\",\n  \"results\": [";
+            for (size_t i = 0; i < results.size(); i++) {
+                const Result& result = results[i];
+                const Summary& summary = result.summary;
+                out << (i ? "," : "") << "\n    {"
+                    << "\n      \"name\": \"" << escape(result.name) << "\","
+                    << "\n      \"group\": \"" << result.group << "\","
+                    << "\n      \"batch\": " << result.batch << ","
+                    << "\n      \"bytesPerOp\": " << result.bytesPerOp << ","
+                    << "\n      \"min\": " << summary.min << ","
+                    << "\n      \"median\": " << summary.median << ","
+                    << "\n      \"mean\": " << summary.mean << ","
+                    << "\n      \"p90\": " << summary.p90 << ","
+                    << "\n      \"p99\": " << summary.p99 << ","
+                    << "\n      \"max\": " << summary.max << ","
+                    << "\n      \"stddev\": " << summary.stddev << ",";
+                if (result.callsPerOp >= 0.0) {
+                    out << "\n      \"callsPerOp\": " << result.callsPerOp << ",";
+                }
+                if (!result.metrics.empty()) {
+                    out << "\n      \"metrics\": {";
+                    for (size_t j = 0; j < result.metrics.size(); j++) {
+                        out << (j ? "," : "") << "\n        \"" << escape(result.metrics[j].first)
+                            << "\": " << result.metrics[j].second;
+                    }
+                    out << "\n      },";
+                }
+                out
+                    << "\n      \"samples\": [";
+                for (size_t j = 0; j < result.samples.size(); j++) {
+                    out << (j ? ", " : "") << result.samples[j];
+                }
+                out << "]\n    }";
+            }
+            out << "\n  ]\n}\n";
+            return out.str();
+        }
+
+    private:
+        RunnerInfo info;
+        std::vector<Result> results;
+        std::function<void()> resetCalls;
+        std::function<uint64_t()> countCalls;
+    };
+}
@@ -0,0 +1,338 @@
+#include "vktiny/vktiny.hpp"
+#include "Bench.hpp"
+#include "ComputeFixture.hpp"
+#include <fstream>
+#include <optional>
+
+// Benchmarks of the core API. Results are written as JSON so runs can be
+// compared across commits and devices.
+// Usage: vktiny_bench [--null] [--samples N] [--warmup N] [--filter name]
+//                     [--label text] [--out results.json] [--scene model.gltf]
+
+int main(int argc, char* argv[])
+{
+    bench::RunnerInfo runnerInfo;
+    bool useNullBackend = false;
+    std::string label = "";
+    std::string outPath = "";
+    std::string scenePath = "";
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--null") {
+            useNullBackend = true;
+        } else if (arg == "--samples" && hasValue) {
+            runnerInfo.samples = std::stoul(argv[++i]);
+        } else if (arg == "--warmup" && hasValue) {
+            runnerInfo.warmup = std::stoul(argv[++i]);
+        } else if (arg == "--filter" && hasValue) {
+            runnerInfo.filter = argv[++i];
+        } else if (arg == "--label" && hasValue) {
+            label = argv[++i];
+        } else if (arg == "--out" && hasValue) {
+            outPath = argv[++i];
+        } else if (arg == "--scene" && hasValue) {
+            scenePath = argv[++i];
+        } else {
+            std::cerr << "unknown argument: " << arg << '\n';
+            return 1;
+        }
+    }
+
+    vkt::ContextCreateInfo contextInfo;
+    if (useNullBackend) {
+        contextInfo.getInstanceProcAddr = vkt::null::getInstanceProcAddr;
+    }
+    vkt::Context context{ contextInfo };
+    vk::Device device = context.getDevice();
+
+    using vkBU = vk::BufferUsageFlagBits;
+    using vkIU = vk::ImageUsageFlagBits;
+    using vkMP = vk::MemoryPropertyFlagBits;
+
+    // Shared resources
+    constexpr vk::DeviceSize uploadSize = 1 << 20;
+    std::vector<char> uploadData(uploadSize, 1);
+    vkt::Buffer stagingBuffer{ context, uploadSize, vkBU::eTransferSrc,
+                               vkMP::eHostVisible | vkMP::eHostCoherent };
+    vkt::Buffer deviceBuffer{ context, uploadSize, vkBU::eStorageBuffer | vkBU::eTransferDst,
+                              vkMP::eDeviceLocal };
+
+    bench::ComputeFixture fixture{ context, deviceBuffer };
+    vkt::CommandBuffer& cmdBuf = fixture.getCommandBuffer();
+    vk::UniqueFence fence = device.createFenceUnique({});
+
+    auto submitAndWait = [&]() {
+        vk::CommandBuffer commandBuffer = cmdBuf.get();
+        vk::SubmitInfo submitInfo;
+        submitInfo.setCommandBuffers(commandBuffer);
+        context.getGraphicsQueue().submit(submitInfo, *fence);
+        device.waitForFences(*fence, true, UINT64_MAX);
+        device.resetFences(*fence);
+    };
+
+    bench::Runner runner{ runnerInfo };
+    if (useNullBackend) {
+        runner.setCallCounter(vkt::null::resetCallCounts, vkt::null::getTotalCallCount);
+    }
+
+    // Micro benchmarks
+    runner.run("buffer_create_1KiB", "micro", 100, [&](uint32_t batch) {
+        for (uint32_t i = 0; i < batch; i++) {
+            vkt::Buffer buffer{ context, 1024, vkBU::eStorageBuffer, vkMP::eDeviceLocal };
+        }
+    });
+
+    runner.run("buffer_create_host_visible_1MiB", "micro", 100, [&](uint32_t batch) {
+        for (uint32_t i = 0; i < batch; i++) {
+            vkt::Buffer buffer{ context, uploadSize, vkBU::eTransferSrc,
+                                vkMP::eHostVisible | vkMP::eHostCoherent };
+        }
+    });
+
+    runner.run("image_create_256x256", "micro", 100, [&](uint32_t batch) {
+        for (uint32_t i = 0; i < batch; i++) {
+            vkt::Image image{ context, { 256, 256 }, vk::Format::eR8G8B8A8Unorm, vkIU::eStorage };
+            image.createImageView();
+        }
+    });
+
+    runner.run("buffer_copy_host_1MiB", "micro", 10, [&](uint32_t batch) {
+        for (uint32_t i = 0; i < batch; i++) {
+            stagingBuffer.copy(uploadData.data());
+        }
+    }, uploadSize);
+
+    runner.run("descriptor_update", "micro", 1000, [&](uint32_t batch) {
+        for (uint32_t i = 0; i < batch; i++) {
+            fixture.descSet.update(deviceBuffer, fixture.bufferBinding);
+        }
+    });
+
+    runner.run("record_dispatch", "micro", 1, [&](uint32_t) {
+        fixture.recordDispatches(1000);
+    });
+
+    vkt::Image transitionImage{ context, { 256, 256 }, vk::Format::eR8G8B8A8Unorm, vkIU::eStorage };
+    runner.run("record_transition", "micro", 1, [&](uint32_t) {
+        cmdBuf.begin();
+        for (uint32_t i = 0; i < 1000; i++) {
+            cmdBuf.transitionImageLayout(transitionImage.get(), vk::ImageLayout::eGeneral, vk::ImageLayout::eGeneral);
+        }
+        cmdBuf.end();
+    });
+
+    runner.run("one_time_submit", "micro", 10, [&](uint32_t batch) {
+        for (uint32_t i = 0; i < batch; i++) {
+            context.OneTimeSubmitCompute([&](vkt::CommandBuffer& commandBuffer) {});
+        }
+    });
+
+    runner.run("shader_compile", "micro", 1, [&](uint32_t) {
+        vkt::compileToSPV(vk::ShaderStageFlagBits::eCompute, bench::incrementShader);
+    });
+
+    runner.run("compute_pipeline_create", "micro", 10, [&](uint32_t batch) {
+        for (uint32_t i = 0; i < batch; i++) {
+            vkt::ComputePipeline computePipeline{ context, fixture.descSetLayout, fixture.shaderModule };
+        }
+    });
+
+    // Macro benchmarks
+    runner.run("upload_staged_1MiB", "macro", 1, [&](uint32_t) {
+        stagingBuffer.copy(uploadData.data());
+        context.OneTimeSubmitCompute([&](vkt::CommandBuffer& commandBuffer) {
+            commandBuffer.copyBuffer(stagingBuffer.get(), deviceBuffer.get(), { 0, 0, uploadSize });
+        });
+    }, uploadSize);
+
+    runner.run("frame_256_dispatches", "macro", 1, [&](uint32_t) {
+        fixture.recordDispatches(256);
+        submitAndWait();
+    });
+
+    runner.run("shader_to_pipeline", "macro", 1, [&](uint32_t) {
+        vkt::ComputeShaderModule module{ context, bench::incrementShader };
+        vkt::ComputePipeline computePipeline{ context, fixture.descSetLayout, module };
+    });
+
+    vkt::ComputeKernel kernel{ context, bench::incrementShader };
+    vkt::ComputeBatch computeBatch{ context };
+    runner.run("compute_batch_1000_jobs", "macro", 1000, [&](uint32_t batch) {
+        for (uint32_t i = 0; i < batch; i++) {
+            computeBatch.add(vkt::ComputeJob{ kernel, 64 }.bind("Data", deviceBuffer));
+        }
+        computeBatch.run();
+    });
+
+    // Scene loading, only when a model is given
+    if (!scenePath.empty()) {
+        runner.run("gltf_parse_decode", "macro", 1, [&](uint32_t) {
+            vkt::ThreadPool pool;
+            vkt::GltfLoader loader{ scenePath };
+            std::vector<vkt::Vertex> vertices(loader.getVertexCount());
+            std::vector<uint32_t> indices(loader.getIndexCount());
+            loader.decode(pool, vertices.data(), indices.data());
+        });
+
+        runner.run("scene_load", "macro", 1, [&](uint32_t) {
+            vkt::Scene scene{ context, scenePath };
+        });
+
+        runner.run("scene_load_optimized", "macro", 1, [&](uint32_t) {
+            vkt::SceneCreateInfo sceneInfo;
+            sceneInfo.optimizeMeshes = true;
+            vkt::Scene scene{ context, scenePath, sceneInfo };
+        });
+
+        runner.run("scene_load_quantized", "macro", 1, [&](uint32_t) {
+            vkt::SceneCreateInfo sceneInfo;
+            sceneInfo.quantizeVertices = true;
+            vkt::Scene scene{ context, scenePath, sceneInfo };
+        });
+
+        vkt::SceneCreateInfo cachedInfo;
+        cachedInfo.cachePath = std::filesystem::temp_directory_path() / "vktiny_bench.vktscene";
+        vkt::SceneCache::write(cachedInfo.cachePath, scenePath, cachedInfo);
+        runner.run("scene_load_cached", "macro", 1, [&](uint32_t) {
+            vkt::Scene scene{ context, scenePath, cachedInfo };
+        });
+
+        // Geometry from the cache, textures only up to their mip tails
+        runner.run("scene_load_streamed", "macro", 1, [&](uint32_t) {
+            vkt::SceneCreateInfo streamedInfo = cachedInfo;
+            streamedInfo.loadTextures = false;
+            vkt::Scene scene{ context, scenePath, streamedInfo };
+            std::optional<vkt::SceneCache> cache = vkt::SceneCache::open(cachedInfo.cachePath, scenePath, cachedInfo);
+            if (!cache) {
+                throw std::runtime_error("failed to open the scene cache " + cachedInfo.cachePath.string());
+            }
+            vkt::TextureStreamer streamer{ context, vkt::getStreamedTextureSources(*cache) };
+        });
+        std::filesystem::remove(cachedInfo.cachePath);
+
+        // Acceleration structures need a device with the extensions enabled
+        std::optional<vkt::Context> rtContext;
+        if (!useNullBackend) {
+            vkt::ContextCreateInfo rtContextInfo;
+            rtContextInfo.apiMinorVersion = 2;
+            rtContextInfo.deviceExtensions = {
+                VK_KHR_DEFERRED_HOST_OPERATIONS_EXTENSION_NAME,
+                VK_KHR_BUFFER_DEVICE_ADDRESS_EXTENSION_NAME,
+                VK_KHR_ACCELERATION_STRUCTURE_EXTENSION_NAME,
+            };
+            rtContextInfo.features.shaderInt64 = true;
+            vk::PhysicalDeviceBufferDeviceAddressFeatures bufferDeviceAddressFeatures{ true };
+            vk::PhysicalDeviceAccelerationStructureFeaturesKHR accelStructFeatures{ true };
+            bufferDeviceAddressFeatures.setPNext(&accelStructFeatures);
+            rtContextInfo.deviceCreatePNext = &bufferDeviceAddressFeatures;
+            try {
+                rtContext.emplace(rtContextInfo);
+            } catch (const std::exception& e) {
+                std::cerr << "skipping acceleration structures: " << e.what() << '\n';
+            }
+        }
+
+        if (rtContext) {
+            vkt::SceneCreateInfo rtSceneInfo;
+            rtSceneInfo.meshUsage = vkBU::eAccelerationStructureBuildInputReadOnlyKHR |
+                                    vkBU::eStorageBuffer | vkBU::eShaderDeviceAddress;
+            vkt::Scene rtScene{ *rtContext, scenePath, rtSceneInfo };
+            std::vector<vkt::BlasGeometry> geometries = vkt::getBlasGeometries(rtScene);
+
+            // Every mesh of the scene with compaction, which reads back the compacted sizes
+            vk::DeviceSize blasSize = 0;
+            vk::DeviceSize blasUncompactedSize = 0;
+            runner.run("blas_build", "macro", 1, [&](uint32_t) {
+                vkt::BlasPool blasPool{ *rtContext, geometries };
+                blasSize = blasPool.getSize();
+                blasUncompactedSize = blasPool.getUncompactedSize();
+            });
+            runner.addMetric("blas_build", "sizeBytes", static_cast<double>(blasSize));
+            runner.addMetric("blas_build", "uncompactedSizeBytes", static_cast<double>(blasUncompactedSize));
+
+            runner.run("blas_build_uncompacted", "macro", 1, [&](uint32_t) {
+                vkt::BlasPoolCreateInfo blasInfo;
+                blasInfo.compact = false;
+                vkt::BlasPool blasPool{ *rtContext, geometries, blasInfo };
+            });
+
+            // Instances of the scene's meshes that all move every update
+            vkt::BlasPool blasPool{ *rtContext, geometries };
+            constexpr uint32_t tlasInstanceCount = 1024;
+            vkt::TlasManagerCreateInfo tlasInfo;
+            tlasInfo.stages = vk::PipelineStageFlagBits::eComputeShader;
+            vkt::TlasManager tlas{ *rtContext, tlasInfo };
+            std::vector<uint32_t> instanceIds;
+            for (uint32_t i = 0; i < tlasInstanceCount && blasPool.getCount() > 0; i++) {
+                vkt::TlasInstance instance;
+                instance.blasAddress = blasPool.getDeviceAddress(i % blasPool.getCount());
+                instance.customIndex = i;
+                instanceIds.push_back(tlas.addInstance(instance));
+            }
+            uint32_t tlasUpdates = 0;
+            auto updateTlas = [&]() {
+                vk::TransformMatrixKHR transform = vkt::identityTransform;
+                for (uint32_t i = 0; i < instanceIds.size(); i++) {
+                    transform.matrix[0][3] = static_cast<float>(i % 32) + 0.01f * (tlasUpdates % 100);
+                    transform.matrix[2][3] = static_cast<float>(i / 32);
+                    tlas.setTransform(instanceIds[i], transform);
+                }
+                uint32_t frame = tlasUpdates++ % tlasInfo.frameCount;
+                rtContext->OneTimeSubmitCompute([&](vkt::CommandBuffer& commandBuffer) {
+                    tlas.update(commandBuffer, frame);
+                });
+            };
+
+            // Refits until maxRefits forces a rebuild
+            runner.run("tlas_update_1024", "macro", 1, [&](uint32_t) {
+                updateTlas();
+            });
+
+            // Replacing an instance rebuilds every frame
+            runner.run("tlas_rebuild_1024", "macro", 1, [&](uint32_t) {
+                if (!instanceIds.empty()) {
+                    vkt::TlasInstance instance;
+                    instance.blasAddress = blasPool.getDeviceAddress(0);
+                    tlas.removeInstance(instanceIds.back());
+                    instanceIds.back() = tlas.addInstance(instance);
+                }
+                updateTlas();
+            });
+            rtContext->getDevice().waitIdle();
+        }
+    }
+
+    // Metadata identifying the run
+    vk::PhysicalDeviceProperties properties = context.getPhysicalDevice().getProperties();
+    auto toVersion = [](uint32_t version) {
+        return std::to_string(VK_API_VERSION_MAJOR(version)) + "." +
+               std::to_string(VK_API_VERSION_MINOR(version)) + "." +
+               std::to_string(VK_API_VERSION_PATCH(version));
+    };
+    std::vector<std::pair<std::string, std::string>> metadata = {
+        { "label", label },
+        { "device", properties.deviceName.data() },
+        { "deviceType", vk::to_string(properties.deviceType) },
+        { "apiVersion", toVersion(properties.apiVersion) },
+        { "driverVersion", std::to_string(properties.driverVersion) },
+        { "backend", useNullBackend ? "null" : "vulkan" },
+#ifdef NDEBUG
+        { "build", "release" },
+#else
+        { "build", "debug" },
+#endif
+        { "samples", std::to_string(runnerInfo.samples) },
+        { "warmup", std::to_string(runnerInfo.warmup) },
+        { "scene", scenePath },
+    };
+
+    device.waitIdle();
+    std::string json = runner.toJson(metadata);
+    if (outPath.empty()) {
+        std::cout << json;
+    } else {
+        std::ofstream file{ outPath };
+        file << json;
+    }
+}
@@ -49,21 +49,22 @@ void initContext()
 
 vkt::Scene loadScene()
 {
-    vkt::Scene scene;
-    scene.setMeshUsage(vkBU::eAccelerationStructureBuildInputReadOnlyKHR |
-                       vkBU::eStorageBuffer | vkBU::eShaderDeviceAddress);
-    scene.setMeshProperties(vkMP::eHostVisible | vkMP::eHostCoherent);
-    scene.loadFile(context, "asset/Duck/Duck.gltf");
+    vkt::SceneCreateInfo sceneInfo;
+    sceneInfo.meshUsage = vkBU::eAccelerationStructureBuildInputReadOnlyKHR |
+                          vkBU::eStorageBuffer | vkBU::eShaderDeviceAddress;
+    sceneInfo.meshProperties = vkMP::eHostVisible | vkMP::eHostCoherent;
+    vkt::Scene scene{ context, "asset/Duck/Duck.gltf", sceneInfo };
 
     // Output scene info
     for (auto&& mesh : scene.getMeshes()) {
         vkt::log::info("mesh");
-        vkt::log::info("  vertices: {}", mesh.getVertices().size());
-        vkt::log::info("  indices: {}", mesh.getIndices().size());
+        vkt::log::info("  vertices: {}", mesh.getVertexCount());
+        vkt::log::info("  indices: {}", mesh.getIndexCount());
     }
     for (auto&& mat : scene.getMaterials()) {
+        auto&& color = mat.baseColorFactor;
         vkt::log::info("material");
-        vkt::log::info("  baseColorFactor: {}", glm::to_string(mat.baseColorFactor));
+        vkt::log::info("  baseColorFactor: ({}, {}, {}, {})", color[0], color[1], color[2], color[3]);
         vkt::log::info("  baseColorTextureIndex: {}", mat.baseColorTextureIndex);
     }
 
@@ -83,22 +84,43 @@ vkt::Image createRenderImage()
 }
 
 vkt::Buffer createBufferReferences(const vkt::Context& context,
-                                   const std::vector<vkt::Mesh>& meshes)
+                                   const std::vector<vkt::BlasGeometry>& geometries)
 {
+    // Meshes share the scene's geometry pool, so the addresses point at each mesh's ranges
     std::vector<MeshBuffers> meshData;
-    for (const auto& mesh : meshes) {
+    for (const auto& geometry : geometries) {
         MeshBuffers data;
-        data.vertices = mesh.getVertexBuffer().getDeviceAddress();
-        data.indices = mesh.getIndexBuffer().getDeviceAddress();
+        data.vertices = geometry.vertexAddress;
+        data.indices = geometry.indexAddress;
         meshData.emplace_back(data);
     }
 
-    vkt::Buffer sceneDesc;
-    sceneDesc.initialize(context, sizeof(MeshBuffers) * static_cast<uint32_t>(meshes.size()),
-                         vkBU::eStorageBuffer | vkBU::eShaderDeviceAddress,
-                         vkMP::eHostVisible | vkMP::eHostCoherent,
-                         meshData.data());
-    return sceneDesc;
+    return vkt::Buffer{ context, sizeof(MeshBuffers) * meshData.size(),
+                        vkBU::eStorageBuffer | vkBU::eShaderDeviceAddress,
+                        vkMP::eHostVisible | vkMP::eHostCoherent,
+                        meshData.data() };
+}
+
+// One instance per mesh, so gl_InstanceID indexes the scene desc
+vkt::TlasManager createTopLevelAS(const vkt::BlasPool& blasPool, const glm::mat4& transform)
+{
+    vkt::TlasManagerCreateInfo tlasInfo;
+    tlasInfo.maxInstances = std::max(blasPool.getCount(), 1u);
+    tlasInfo.frameCount = 1;
+    vkt::TlasManager topLevelAS{ context, tlasInfo };
+
+    vkt::TlasInstance instance;
+    for (int row = 0; row < 3; row++) {
+        for (int col = 0; col < 4; col++) {
+            instance.transform.matrix[row][col] = transform[col][row];
+        }
+    }
+    for (uint32_t i = 0; i < blasPool.getCount(); i++) {
+        instance.blasAddress = blasPool.getDeviceAddress(i);
+        topLevelAS.addInstance(instance);
+    }
+    context.OneTimeSubmitGraphics([&](const vkt::CommandBuffer& cmdBuf) { topLevelAS.update(cmdBuf, 0); });
+    return topLevelAS;
 }
 
 void draw(std::vector<vk::UniqueCommandBuffer>& drawCommandBuffers)
@@ -150,13 +172,12 @@ int main()
 
     // Create accel structs(binding = 1)
     glm::mat4 transform = vkt::flipY(glm::translate(glm::mat4(1.0), { 0, -100, 0 }));
-    vkt::BottomLevelAccelStruct bottomLevelAS;
-    vkt::TopLevelAccelStruct topLevelAS;
-    bottomLevelAS.initialize(context, scene.getMeshes().front());
-    topLevelAS.initialize(context, bottomLevelAS, transform);
+    std::vector<vkt::BlasGeometry> geometries = vkt::getBlasGeometries(scene);
+    vkt::BlasPool blasPool{ context, geometries };
+    vkt::TlasManager topLevelAS = createTopLevelAS(blasPool, transform);
 
     // Create scene desc(binding = 3)
-    vkt::Buffer sceneDesc = createBufferReferences(context, scene.getMeshes());
+    vkt::Buffer sceneDesc = createBufferReferences(context, geometries);
 
     // Add descriptor bindings
     descManager.addStorageImage(renderImage, 0);
@@ -1,4 +1,6 @@
 #include "vktiny/vktiny.hpp"
+#include <optional>
+#include <utility>
 
 using vkIL = vk::ImageLayout;
 using vkIU = vk::ImageUsageFlagBits;
@@ -27,14 +29,22 @@ int main()
 
     vkt::Swapchain swapchain{ context, width, height };
 
+    // Write straight into the swapchain images if they support storage usage,
+    // otherwise render into an intermediate image and copy it
+    bool directWrite = swapchain.supportsStorage();
+
     // Create resources
-    vkt::Image renderImage{ context, swapchain.getExtent(), swapchain.getFormat(),
-                           vkIU::eStorage | vkIU::eTransferSrc };
-    renderImage.createImageView();
-    renderImage.transitionLayout(vk::ImageLayout::eGeneral);
+    auto createRenderImage = [&](vk::Extent2D extent) {
+        vkt::Image image{ context, extent, swapchain.getFormat(),
+                          vkIU::eStorage | vkIU::eTransferSrc };
+        image.createImageView();
+        image.transitionLayout(vk::ImageLayout::eGeneral);
+        return image;
+    };
+    std::optional<vkt::Image> renderImage;
 
     // Create descriptors
-    vkt::DescriptorPool descPool{ context, 1, { {vk::DescriptorType::eStorageImage, 10} } };
+    std::optional<vkt::DescriptorPool> descPool;
 
     vk::DescriptorSetLayoutBinding imageBinding;
     imageBinding.setBinding(0);
@@ -43,39 +53,103 @@ int main()
     imageBinding.setStageFlags(vk::ShaderStageFlagBits::eCompute);
 
     vkt::DescriptorSetLayout descSetLayout{ context, { imageBinding } };
-    vkt::DescriptorSet descSet{ context, descPool, descSetLayout };
-    descSet.update(renderImage, imageBinding);
+
+    std::vector<vkt::DescriptorSet> descSets;
+    auto createDescriptorSets = [&]() {
+        // One set per swapchain image, whose count may change on recreation
+        descSets.clear();
+        auto setCount = static_cast<uint32_t>(directWrite ? swapchain.getImagesSize() : 1);
+        descPool.emplace(context, setCount,
+                         std::vector<vk::DescriptorPoolSize>{ { vk::DescriptorType::eStorageImage, setCount } });
+        if (directWrite) {
+            for (uint32_t i = 0; i < swapchain.getImagesSize(); ++i) {
+                descSets.emplace_back(context, *descPool, descSetLayout);
+                descSets.back().update(swapchain.getImageView(i), vkIL::eGeneral, imageBinding);
+            }
+        } else {
+            renderImage = createRenderImage(swapchain.getExtent());
+            descSets.emplace_back(context, *descPool, descSetLayout);
+            descSets.back().update(*renderImage, imageBinding);
+        }
+    };
+    createDescriptorSets();
 
     // Create pipeline
     vkt::ComputeShaderModule shaderModule{ context, shader };
     vkt::ComputePipeline pipeline{ context, descSetLayout, shaderModule };
 
-    size_t bufferCount = swapchain.getImagesSize();
-    auto drawCommandBuffers = context.allocateGraphicsCommandBuffers(bufferCount);
-    for (int32_t i = 0; i < bufferCount; ++i) {
-        vkt::CommandBuffer& cmdBuf = drawCommandBuffers[i];
-        const auto& swapchainImage = swapchain.getImages()[i];
-        const auto& extent = swapchain.getExtent();
-
-        cmdBuf.begin();
-        cmdBuf.bindPipeline(pipeline);
-        cmdBuf.bindDescriptorSets(descSet, pipeline);
-        cmdBuf.dispatch(width, height, 1);
-
-        cmdBuf.transitionImageLayout(renderImage.get(), vkIL::eUndefined, vkIL::eTransferSrcOptimal);
-        cmdBuf.transitionImageLayout(swapchainImage, vkIL::eUndefined, vkIL::eTransferDstOptimal);
-        cmdBuf.copyImage(renderImage.get(), swapchainImage, extent);
-        cmdBuf.transitionImageLayout(renderImage.get(), vkIL::eTransferSrcOptimal, vkIL::eGeneral);
-        cmdBuf.transitionImageLayout(swapchainImage, vkIL::eTransferDstOptimal, vkIL::ePresentSrcKHR);
-
-        cmdBuf.end();
-    }
-
+    std::vector<vkt::CommandBuffer> drawCommandBuffers;
+    auto recordCommandBuffers = [&]() {
+        size_t bufferCount = swapchain.getImagesSize();
+        drawCommandBuffers = context.allocateGraphicsCommandBuffers(bufferCount);
+        for (int32_t i = 0; i < bufferCount; ++i) {
+            vkt::CommandBuffer& cmdBuf = drawCommandBuffers[i];
+            const auto& swapchainImage = swapchain.getImages()[i];
+            const auto& extent = swapchain.getExtent();
+
+            cmdBuf.begin();
+            if (directWrite) {
+                cmdBuf.transitionImageLayout(swapchainImage, vkIL::eUndefined, vkIL::eGeneral);
+                cmdBuf.bindPipeline(pipeline);
+                cmdBuf.bindDescriptorSets(descSets[i], pipeline);
+                cmdBuf.dispatch(extent.width, extent.height, 1);
+                cmdBuf.transitionImageLayout(swapchainImage, vkIL::eGeneral, vkIL::ePresentSrcKHR);
+            } else {
+                cmdBuf.bindPipeline(pipeline);
+                cmdBuf.bindDescriptorSets(descSets[0], pipeline);
+                cmdBuf.dispatch(extent.width, extent.height, 1);
+
+                cmdBuf.transitionImageLayout(renderImage->get(), vkIL::eUndefined, vkIL::eTransferSrcOptimal);
+                cmdBuf.transitionImageLayout(swapchainImage, vkIL::eUndefined, vkIL::eTransferDstOptimal);
+                cmdBuf.copyImage(renderImage->get(), swapchainImage, extent);
+                cmdBuf.transitionImageLayout(renderImage->get(), vkIL::eTransferSrcOptimal, vkIL::eGeneral);
+                cmdBuf.transitionImageLayout(swapchainImage, vkIL::eTransferDstOptimal, vkIL::ePresentSrcKHR);
+            }
+            cmdBuf.end();
+        }
+    };
+    recordCommandBuffers();
+
+    // Resources of a previous size, kept until the frames that use them have finished
+    struct Retired
+    {
+        uint64_t frame;
+        std::optional<vkt::DescriptorPool> descPool;
+        std::vector<vkt::DescriptorSet> descSets;
+        std::optional<vkt::Image> renderImage;
+        std::vector<vkt::CommandBuffer> commandBuffers;
+    };
+    std::vector<Retired> retired;
+    uint64_t frameCount = 0;
+
+    // Rebuild size-dependent resources when the window is resized. The frames in flight
+    // still use the old ones, the last of them finishing maxFramesInFlight - 1 frames later.
+    swapchain.setOnRecreate(
+        [&](vk::Extent2D extent) {
+            retired.push_back({ frameCount + swapchain.getMaxFramesInFlight() - 1,
+                                std::exchange(descPool, std::nullopt), std::move(descSets),
+                                std::exchange(renderImage, std::nullopt), std::move(drawCommandBuffers) });
+            descSets.clear();
+            drawCommandBuffers.clear();
+            createDescriptorSets();
+            recordCommandBuffers();
+        });
+
+    vk::Extent2D windowSize = window.getFramebufferSize();
     while (!window.shouldClose()) {
         window.pollEvents();
+        window.waitWhileMinimized();
+
+        // Surfaces that don't report their extent only learn about the new size here
+        vk::Extent2D size = window.getFramebufferSize();
+        if (size != windowSize) {
+            windowSize = size;
+            swapchain.resize(static_cast<int>(size.width), static_cast<int>(size.height));
+        }
 
         // Begin
         vkt::FrameInfo frameInfo = swapchain.beginFrame();
+        std::erase_if(retired, [&](const Retired& resources) { return resources.frame <= frameCount; });
         vk::CommandBuffer cmdBuf = drawCommandBuffers[frameInfo.imageIndex].get();
 
         // Render
@@ -89,6 +163,7 @@ int main()
 
         // End
         swapchain.endFrame(frameInfo.imageIndex);
+        frameCount++;
     }
     context.getDevice().waitIdle();
 }
@@ -63,11 +63,11 @@ void initContext()
 
 vkt::Scene loadScene()
 {
-    vkt::Scene scene;
-    scene.setMeshUsage(vkBU::eAccelerationStructureBuildInputReadOnlyKHR |
-                       vkBU::eStorageBuffer | vkBU::eShaderDeviceAddress);
-    scene.setMeshProperties(vkMP::eHostVisible | vkMP::eHostCoherent);
-    scene.loadFile(context, "asset/sponza.gltf");
+    vkt::SceneCreateInfo sceneInfo;
+    sceneInfo.meshUsage = vkBU::eAccelerationStructureBuildInputReadOnlyKHR |
+                          vkBU::eStorageBuffer | vkBU::eShaderDeviceAddress;
+    sceneInfo.meshProperties = vkMP::eHostVisible | vkMP::eHostCoherent;
+    vkt::Scene scene{ context, "asset/sponza.gltf", sceneInfo };
 
     // Output scene info
     vkt::log::info("mesh    : {}", scene.getMeshes().size());
@@ -90,25 +90,47 @@ vkt::Image createRenderImage()
 }
 
 vkt::Buffer createBufferReferences(const vkt::Context& context,
-                                   const vkt::Scene& scene)
+                                   const vkt::Scene& scene,
+                                   const std::vector<vkt::BlasGeometry>& geometries)
 {
+    // Meshes share the scene's geometry pool, so the addresses point at each mesh's ranges
     auto&& meshes = scene.getMeshes();
     std::vector<MeshBuffers> meshData;
-    for (const auto& mesh : meshes) {
+    for (size_t i = 0; i < meshes.size(); i++) {
         MeshBuffers data;
-        data.vertices = mesh.getVertexBuffer().getDeviceAddress();
-        data.indices = mesh.getIndexBuffer().getDeviceAddress();
-        auto&& mat = scene.getMaterials()[mesh.getMaterialIndex()];
-        data.baseColorTexture = mat.baseColorTextureIndex;
+        data.vertices = geometries[i].vertexAddress;
+        data.indices = geometries[i].indexAddress;
+        int32_t materialIndex = meshes[i].getMaterialIndex();
+        data.baseColorTexture = materialIndex < 0 ? -1 : scene.getMaterials()[materialIndex].baseColorTextureIndex;
         meshData.emplace_back(data);
     }
 
-    vkt::Buffer sceneDesc;
-    sceneDesc.initialize(context, sizeof(MeshBuffers) * meshes.size(),
-                         vkBU::eStorageBuffer | vkBU::eShaderDeviceAddress,
-                         vkMP::eHostVisible | vkMP::eHostCoherent,
-                         meshData.data());
-    return sceneDesc;
+    return vkt::Buffer{ context, sizeof(MeshBuffers) * meshData.size(),
+                        vkBU::eStorageBuffer | vkBU::eShaderDeviceAddress,
+                        vkMP::eHostVisible | vkMP::eHostCoherent,
+                        meshData.data() };
+}
+
+// One instance per mesh, so gl_InstanceID indexes the scene desc
+vkt::TlasManager createTopLevelAS(const vkt::BlasPool& blasPool, const glm::mat4& transform)
+{
+    vkt::TlasManagerCreateInfo tlasInfo;
+    tlasInfo.maxInstances = std::max(blasPool.getCount(), 1u);
+    tlasInfo.frameCount = 1;
+    vkt::TlasManager topLevelAS{ context, tlasInfo };
+
+    vkt::TlasInstance instance;
+    for (int row = 0; row < 3; row++) {
+        for (int col = 0; col < 4; col++) {
+            instance.transform.matrix[row][col] = transform[col][row];
+        }
+    }
+    for (uint32_t i = 0; i < blasPool.getCount(); i++) {
+        instance.blasAddress = blasPool.getDeviceAddress(i);
+        topLevelAS.addInstance(instance);
+    }
+    context.OneTimeSubmitGraphics([&](const vkt::CommandBuffer& cmdBuf) { topLevelAS.update(cmdBuf, 0); });
+    return topLevelAS;
 }
 
 void draw(std::vector<vk::UniqueCommandBuffer>& drawCommandBuffers)
@@ -169,17 +191,12 @@ int main()
 
         vkt::Image renderImage = createRenderImage();
 
-        std::vector<vkt::BottomLevelAccelStruct> bottomLevelASs;
-        bottomLevelASs.reserve(scene.getMeshes().size());
-        for (auto& mesh : scene.getMeshes()) {
-            bottomLevelASs.push_back(vkt::BottomLevelAccelStruct{});
-            bottomLevelASs.back().initialize(context, mesh);
-        }
+        std::vector<vkt::BlasGeometry> geometries = vkt::getBlasGeometries(scene);
+        vkt::BlasPool blasPool{ context, geometries };
         glm::mat4 transform = vkt::flipY(glm::translate(glm::mat4(1.0), { 0, -2, 0 }));
-        vkt::TopLevelAccelStruct topLevelAS;
-        topLevelAS.initialize(context, bottomLevelASs, transform);
+        vkt::TlasManager topLevelAS = createTopLevelAS(blasPool, transform);
 
-        vkt::Buffer sceneDesc = createBufferReferences(context, scene);
+        vkt::Buffer sceneDesc = createBufferReferences(context, scene, geometries);
 
         vkt::OrbitalCamera camera(width, height, 8);
         camera.theta = 9.0;
@@ -0,0 +1,202 @@
+#pragma once
+#include "Context.hpp"
+#include "Buffer.hpp"
+#include "GltfLoader.hpp"
+#include <array>
+#include <optional>
+#include <span>
+
+namespace vkt
+{
+    class Scene;
+
+    // Triangles of one bottom-level acceleration structure, read through device addresses
+    struct BlasGeometry
+    {
+        vk::DeviceAddress vertexAddress = 0;
+        vk::DeviceSize vertexStride = sizeof(Vertex);
+        vk::Format vertexFormat = vk::Format::eR32G32B32Sfloat;
+        uint32_t maxVertex = 0;
+
+        vk::DeviceAddress indexAddress = 0;
+        vk::IndexType indexType = vk::IndexType::eUint32;
+        uint32_t triangleCount = 0;
+
+        // Optional vk::TransformMatrixKHR applied to the vertices
+        vk::DeviceAddress transformAddress = 0;
+
+        // Skips any-hit shaders
+        bool opaque = true;
+    };
+
+    // One geometry per mesh with its full-detail indices. The scene's meshUsage needs
+    // eShaderDeviceAddress and eAccelerationStructureBuildInputReadOnlyKHR. Pass
+    // VertexLayout::getPositionFormat() for quantized scenes, whose BLASes are then in
+    // the quantized space and instances have to apply Mesh::getQuantization().
+    std::vector<BlasGeometry> getBlasGeometries(const Scene& scene,
+                                                vk::Format positionFormat = vk::Format::eR32G32B32Sfloat);
+
+    struct BlasPoolCreateInfo
+    {
+        // Scratch memory shared by the builds of one batch. Builds are batched until it is
+        // full and the next batch waits for the previous one. Grows for a single larger build.
+        vk::DeviceSize scratchSize = 64 * 1024 * 1024;
+
+        // Query the compacted sizes after building and copy into compacted structures
+        bool compact = true;
+
+        vk::BuildAccelerationStructureFlagsKHR flags = vk::BuildAccelerationStructureFlagBitsKHR::ePreferFastTrace;
+    };
+
+    // Bottom-level acceleration structures of many geometries, built with a few batched
+    // commands and stored in one buffer
+    class BlasPool
+    {
+    public:
+        // Builds every geometry into its own BLAS and waits for the builds
+        BlasPool(const Context& context, std::span<const BlasGeometry> geometries, const BlasPoolCreateInfo& info = {});
+        BlasPool(const BlasPool&) = delete;
+        BlasPool(BlasPool&&) = default;
+        BlasPool& operator=(const BlasPool&) = delete;
+        BlasPool& operator=(BlasPool&&) = default;
+
+        uint32_t getCount() const { return static_cast<uint32_t>(accelStructs.size()); }
+        vk::AccelerationStructureKHR get(uint32_t index) const { return *accelStructs[index]; }
+        vk::DeviceAddress getDeviceAddress(uint32_t index) const { return addresses[index]; }
+
+        // Memory of all structures, and what it was before compaction
+        vk::DeviceSize getSize() const { return size; }
+        vk::DeviceSize getUncompactedSize() const { return uncompactedSize; }
+
+    private:
+        // Structures of the given sizes placed in one buffer
+        void allocate(const std::vector<vk::DeviceSize>& sizes);
+
+        const Context* context;
+        std::optional<Buffer> buffer;
+        std::vector<vk::UniqueAccelerationStructureKHR> accelStructs;
+        std::vector<vk::DeviceAddress> addresses;
+        vk::DeviceSize size = 0;
+        vk::DeviceSize uncompactedSize = 0;
+    };
+
+    inline const vk::TransformMatrixKHR identityTransform{ std::array<std::array<float, 4>, 3>{
+        { { 1.0f, 0.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 1.0f, 0.0f } } } };
+
+    struct TlasInstance
+    {
+        vk::DeviceAddress blasAddress = 0;
+        vk::TransformMatrixKHR transform = identityTransform;
+
+        // Object space bounds of the BLAS, which drive the rebuild heuristic. While every
+        // instance leaves them empty, rebuilds only happen after maxRefits refits.
+        vk::AabbPositionsKHR bounds;
+
+        uint32_t customIndex = 0;
+        uint8_t mask = 0xFF;
+        uint32_t sbtRecordOffset = 0;
+        vk::GeometryInstanceFlagsKHR flags = {};
+    };
+
+    struct TlasManagerCreateInfo
+    {
+        // Capacity of the instance buffers and the structures, which are sized up front
+        uint32_t maxInstances = 4096;
+
+        // Structures and instance buffers, one per frame in flight
+        uint32_t frameCount = 2;
+
+        // Rebuild after this many refits, or once the instances have moved so far that the
+        // summed areas of their bounds, each merged with its bounds at the last rebuild,
+        // exceed maxBoundsGrowth times the areas at the last rebuild
+        uint32_t maxRefits = 64;
+        float maxBoundsGrowth = 1.5f;
+
+        vk::BuildAccelerationStructureFlagsKHR flags = vk::BuildAccelerationStructureFlagBitsKHR::ePreferFastTrace;
+
+        // Stages that read the structure after update()
+        vk::PipelineStageFlags stages = vk::PipelineStageFlagBits::eRayTracingShaderKHR;
+    };
+
+    // Top-level acceleration structure over instances that may move every frame. Instances are
+    // written into persistently mapped buffers, and only changed ones are copied. Frames refit
+    // their structure in place unless instances were added or removed or the refits have
+    // degraded it too much, in which case the structure is rebuilt.
+    //
+    // Per frame, after waiting for the frame's fence:
+    //   tlas.setTransform(id, transform);   // any number of changes
+    //   tlas.update(cmdBuf, frame);
+    //   ... trace against get(frame) ...
+    class TlasManager
+    {
+    public:
+        TlasManager(const Context& context, const TlasManagerCreateInfo& info = {});
+        TlasManager(const TlasManager&) = delete;
+        TlasManager(TlasManager&&) = default;
+        TlasManager& operator=(const TlasManager&) = delete;
+        TlasManager& operator=(TlasManager&&) = default;
+
+        // Returns an id that stays valid until the instance is removed. Throws when full, and
+        // the other functions throw for ids that were removed or never returned.
+        uint32_t addInstance(const TlasInstance& instance);
+        void removeInstance(uint32_t id);
+        void setInstance(uint32_t id, const TlasInstance& instance);
+        void setTransform(uint32_t id, const vk::TransformMatrixKHR& transform);
+
+        // Record the frame's rebuild or refit, if anything changed since its last update. Frames
+        // are updated in turn, and the frame's previous command buffer must have finished executing.
+        void update(const CommandBuffer& cmdBuf, uint32_t frame);
+
+        vk::AccelerationStructureKHR get(uint32_t frame) const { return *frames[frame].accelStruct; }
+        vk::DeviceAddress getDeviceAddress(uint32_t frame) const { return frames[frame].address; }
+        uint32_t getInstanceCount() const { return static_cast<uint32_t>(instances.size()); }
+
+        // Refits of the frame's structure since it was last rebuilt
+        uint32_t getRefitCount(uint32_t frame) const { return frames[frame].refitCount; }
+
+    private:
+        struct Frame
+        {
+            Buffer instanceBuffer;
+            Buffer accelStructBuffer;
+            Buffer scratchBuffer;
+            vk::UniqueAccelerationStructureKHR accelStruct;
+            vk::DeviceAddress address = 0;
+            uint64_t builtVersion = 0;
+            uint32_t refitCount = 0;
+        };
+
+        static constexpr uint32_t removedSlot = UINT32_MAX;
+
+        uint32_t getSlot(uint32_t id) const;
+        void markDirty(uint32_t slot);
+        void updateBounds(uint32_t slot);
+        void beginRebuild();
+
+        const Context* context;
+        TlasManagerCreateInfo info;
+        vk::DeviceSize scratchAlignment = 0;
+        std::vector<Frame> frames;
+
+        // Instances in buffer order, and the mapping between ids and positions
+        std::vector<vk::AccelerationStructureInstanceKHR> instances;
+        std::vector<uint32_t> slotOfId;
+        std::vector<uint32_t> idOfSlot;
+        std::vector<uint32_t> freeIds;
+
+        // Changed slots and how many frame buffers have yet to receive them
+        std::vector<uint32_t> dirtySlots;
+        std::vector<uint32_t> pendingFrames;
+
+        // World bounds now and at the last rebuild, and their summed areas
+        std::vector<vk::AabbPositionsKHR> localBounds;
+        std::vector<vk::AabbPositionsKHR> worldBounds;
+        std::vector<vk::AabbPositionsKHR> rebuildBounds;
+        double rebuildArea = 0.0;
+        double driftArea = 0.0;
+
+        // Incremented by each rebuild, which every frame then performs once
+        uint64_t version = 1;
+        bool rebuildRequested = false;
+    };
+}
@@ -3,6 +3,9 @@
 
 namespace vkt
 {
+    class ReadbackRing;
+    class ReadbackFuture;
+
     class Buffer
     {
     public:
@@ -17,10 +20,24 @@ namespace vkt
 
         void copy(void* data);
 
+        // Copy the contents into a readback ring. The buffer needs eTransferSrc usage.
+        // Either record into the given command buffer, which will be submitted with the fence,
+        // or submit on a one-time command buffer without waiting.
+        ReadbackFuture readback(ReadbackRing& ring, const CommandBuffer& cmdBuf, vk::Fence fence) const;
+        ReadbackFuture readback(ReadbackRing& ring) const;
+
+        void* map()
+        {
+            if (!mapped) {
+                mapped = context->getDevice().mapMemory(*memory, 0, size, {}, context->getDispatcher());
+            }
+            return mapped;
+        }
+
         void copyOnHost(void* data)
         {
             if (!mapped) {
-                mapped = context->getDevice().mapMemory(*memory, 0, size);
+                mapped = context->getDevice().mapMemory(*memory, 0, size, {}, context->getDispatcher());
             }
             memcpy(mapped, data, static_cast<size_t>(size));
         }
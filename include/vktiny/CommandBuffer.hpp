@@ -2,9 +2,11 @@
 
 #define VULKAN_HPP_DISPATCH_LOADER_DYNAMIC 1
 #include <vulkan/vulkan.hpp>
+#include <source_location>
 #include "Pipeline.hpp"
 #include "DescriptorSet.hpp"
 #include "Image.hpp"
+#include "GpuProfiler.hpp"
 
 namespace vkt
 {
@@ -13,12 +15,17 @@ namespace vkt
     class CommandBuffer
     {
     public:
-        CommandBuffer(vk::UniqueCommandBuffer commandBuffer)
+        // Commands are recorded through dispatcher, usually Context::getDispatcher(),
+        // which has to outlive the command buffer
+        CommandBuffer(vk::UniqueCommandBuffer commandBuffer,
+                      const vk::DispatchLoaderDynamic& dispatcher = VULKAN_HPP_DEFAULT_DISPATCHER)
             : commandBuffer(std::move(commandBuffer))
+            , dispatcher(&dispatcher)
         {
         }
 
-        CommandBuffer(vk::Device device, vk::CommandPool commandPool, vk::Queue queue);
+        CommandBuffer(vk::Device device, vk::CommandPool commandPool, vk::Queue queue,
+                      const vk::DispatchLoaderDynamic& dispatcher = VULKAN_HPP_DEFAULT_DISPATCHER);
 
         CommandBuffer(const CommandBuffer&) = delete;
         CommandBuffer(CommandBuffer&&) = default;
@@ -27,25 +34,48 @@ namespace vkt
 
         void begin(vk::CommandBufferBeginInfo beginInfo = {}) const;
         void end() const;
-        void submit() const;
+        // Submit and wait for the queue to become idle. location is reported with the wait.
+        void submit(std::source_location location = std::source_location::current()) const;
+        void submit(vk::Fence fence) const;
+
+        // Zones recorded with profile() are reported by this profiler
+        void setProfiler(GpuProfiler* profiler) { this->profiler = profiler; }
+
+        // Usage: auto zone = cmdBuf.profile("trace");
+        [[nodiscard]] ProfileZone profile(const std::string& name) const
+        {
+            if (!profiler) {
+                return {};
+            }
+            return ProfileZone{ *profiler, *commandBuffer, name };
+        }
+
+        // Same as profile(), and also collects pipeline statistics such as shader invocations
+        [[nodiscard]] ProfileZone profileStatistics(const std::string& name) const
+        {
+            if (!profiler) {
+                return {};
+            }
+            return ProfileZone{ *profiler, *commandBuffer, name, true };
+        }
 
         // TODO: add vk::CommandBuffer's functions
 
         void dispatch(uint32_t groupCountX, uint32_t groupCountY, uint32_t groupCountZ)
         {
-            commandBuffer->dispatch(groupCountX, groupCountY, groupCountZ);
+            commandBuffer->dispatch(groupCountX, groupCountY, groupCountZ, *dispatcher);
         }
 
         void bindPipeline(const Pipeline& pipeline)
         {
-            commandBuffer->bindPipeline(pipeline.getBindPoint(), pipeline.get());
+            commandBuffer->bindPipeline(pipeline.getBindPoint(), pipeline.get(), *dispatcher);
         }
 
         void bindDescriptorSets(const DescriptorSet& descSet, const Pipeline& pipeline)
         {
             vk::PipelineBindPoint bindPoint = pipeline.getBindPoint();
             vk::PipelineLayout layout = pipeline.getLayout();
-            commandBuffer->bindDescriptorSets(bindPoint, layout, 0, descSet.get(), nullptr);
+            commandBuffer->bindDescriptorSets(bindPoint, layout, 0, descSet.get(), nullptr, *dispatcher);
         }
 
         void copyImage(vk::Image srcImage, vk::Image dstImage, vk::Extent2D extent)
@@ -57,12 +87,62 @@ namespace vkt
 
             auto srcLayout = vk::ImageLayout::eTransferSrcOptimal;
             auto dstLayout = vk::ImageLayout::eTransferDstOptimal;
-            commandBuffer->copyImage(srcImage, srcLayout, dstImage, dstLayout, copyRegion);
+            commandBuffer->copyImage(srcImage, srcLayout, dstImage, dstLayout, copyRegion, *dispatcher);
+        }
+
+        void copyBuffer(vk::Buffer srcBuffer, vk::Buffer dstBuffer, vk::BufferCopy region) const
+        {
+            commandBuffer->copyBuffer(srcBuffer, dstBuffer, region, *dispatcher);
+        }
+
+        void fillBuffer(vk::Buffer dstBuffer, vk::DeviceSize offset, vk::DeviceSize size, uint32_t data) const
+        {
+            commandBuffer->fillBuffer(dstBuffer, offset, size, data, *dispatcher);
+        }
+
+        void copyBufferToImage(vk::Buffer srcBuffer, vk::Image dstImage, vk::Extent2D extent,
+                               vk::DeviceSize srcOffset = 0, uint32_t mipLevel = 0) const
+        {
+            vk::BufferImageCopy copyRegion{};
+            copyRegion.setBufferOffset(srcOffset);
+            copyRegion.setImageSubresource({ vk::ImageAspectFlagBits::eColor, mipLevel, 0, 1 });
+            copyRegion.setImageExtent({ extent.width, extent.height, 1 });
+
+            auto dstLayout = vk::ImageLayout::eTransferDstOptimal;
+            commandBuffer->copyBufferToImage(srcBuffer, dstImage, dstLayout, copyRegion, *dispatcher);
+        }
+
+        void copyBufferToImage(vk::Buffer srcBuffer, vk::Image dstImage,
+                               vk::ArrayProxy<const vk::BufferImageCopy> regions) const
+        {
+            commandBuffer->copyBufferToImage(srcBuffer, dstImage, vk::ImageLayout::eTransferDstOptimal, regions,
+                                             *dispatcher);
+        }
+
+        void copyImageToBuffer(vk::Image srcImage, vk::Buffer dstBuffer, vk::Extent2D extent,
+                               vk::DeviceSize dstOffset = 0) const
+        {
+            vk::BufferImageCopy copyRegion{};
+            copyRegion.setBufferOffset(dstOffset);
+            copyRegion.setImageSubresource({ vk::ImageAspectFlagBits::eColor, 0, 0, 1 });
+            copyRegion.setImageExtent({ extent.width, extent.height, 1 });
+
+            auto srcLayout = vk::ImageLayout::eTransferSrcOptimal;
+            commandBuffer->copyImageToBuffer(srcImage, srcLayout, dstBuffer, copyRegion, *dispatcher);
+        }
+
+        void memoryBarrier(vk::PipelineStageFlags srcStageMask, vk::AccessFlags srcAccessMask,
+                           vk::PipelineStageFlags dstStageMask, vk::AccessFlags dstAccessMask) const
+        {
+            vk::MemoryBarrier barrier{ srcAccessMask, dstAccessMask };
+            commandBuffer->pipelineBarrier(srcStageMask, dstStageMask, {}, barrier, {}, {}, *dispatcher);
         }
 
         void transitionImageLayout(vk::Image image,
                                    vk::ImageLayout oldLayout,
-                                   vk::ImageLayout newLayout) const
+                                   vk::ImageLayout newLayout,
+                                   uint32_t baseMipLevel = 0,
+                                   uint32_t levelCount = 1) const
         {
             vk::PipelineStageFlags srcStageMask = vk::PipelineStageFlagBits::eAllCommands;
             vk::PipelineStageFlags dstStageMask = vk::PipelineStageFlagBits::eAllCommands;
@@ -73,7 +153,7 @@ namespace vkt
             barrier.setImage(image);
             barrier.setOldLayout(oldLayout);
             barrier.setNewLayout(newLayout);
-            barrier.setSubresourceRange({ vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1 });
+            barrier.setSubresourceRange({ vk::ImageAspectFlagBits::eColor, baseMipLevel, levelCount, 0, 1 });
 
             using vkAF = vk::AccessFlagBits;
             switch (oldLayout) {
@@ -86,6 +166,9 @@ namespace vkt
                 case vk::ImageLayout::eShaderReadOnlyOptimal:
                     barrier.srcAccessMask = vkAF::eShaderRead;
                     break;
+                case vk::ImageLayout::eGeneral:
+                    barrier.srcAccessMask = vkAF::eShaderWrite;
+                    break;
                 default:
                     break;
             }
@@ -103,16 +186,24 @@ namespace vkt
                     }
                     barrier.dstAccessMask = vkAF::eShaderRead;
                     break;
+                case vk::ImageLayout::eGeneral:
+                    barrier.dstAccessMask = vkAF::eShaderRead | vkAF::eShaderWrite;
+                    break;
                 default:
                     break;
             }
-            commandBuffer->pipelineBarrier(srcStageMask, dstStageMask, {}, {}, {}, barrier);
+            commandBuffer->pipelineBarrier(srcStageMask, dstStageMask, {}, {}, {}, barrier, *dispatcher);
         }
 
         vk::CommandBuffer get() const { return *commandBuffer; }
 
+        // Pass to calls made on get() directly
+        const vk::DispatchLoaderDynamic& getDispatcher() const { return *dispatcher; }
+
     protected:
         vk::UniqueCommandBuffer commandBuffer;
+        const vk::DispatchLoaderDynamic* dispatcher = &VULKAN_HPP_DEFAULT_DISPATCHER;
         vk::Queue queue;
+        GpuProfiler* profiler = nullptr;
     };
 }
@@ -0,0 +1,141 @@
+#pragma once
+#define VULKAN_HPP_DISPATCH_LOADER_DYNAMIC 1
+#include <vulkan/vulkan.hpp>
+#include <array>
+#include <source_location>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "ShaderModule.hpp"
+#include "DescriptorSetLayout.hpp"
+#include "Pipeline.hpp"
+#include "CommandBuffer.hpp"
+
+namespace vkt
+{
+    class Context;
+    class Buffer;
+    class Image;
+
+    // Compute shader whose descriptor set layout is built from reflection,
+    // so resources can be bound by name
+    class ComputeKernel
+    {
+    public:
+        ComputeKernel(const Context& context, const std::string& shaderText);
+
+        ComputeKernel(const ComputeKernel&) = delete;
+        ComputeKernel(ComputeKernel&&) = default;
+        ComputeKernel& operator=(const ComputeKernel&) = delete;
+        ComputeKernel& operator=(ComputeKernel&&) = default;
+
+        // Throws if the shader has no resource with this name
+        const ShaderBinding& getBinding(const std::string& name) const;
+        const std::vector<ShaderBinding>& getBindings() const { return reflection.bindings; }
+        std::array<uint32_t, 3> getLocalSize() const { return reflection.localSize; }
+
+        const ComputePipeline& getPipeline() const { return pipeline; }
+        vk::DescriptorSetLayout getDescriptorSetLayout() const { return descSetLayout.get(); }
+
+    private:
+        static ShaderReflection compile(const std::string& shaderText, std::vector<unsigned int>& shaderSPV);
+
+        std::vector<unsigned int> shaderSPV;
+        ShaderReflection reflection;
+        ComputeShaderModule shaderModule;
+        DescriptorSetLayout descSetLayout;
+        ComputePipeline pipeline;
+        std::unordered_map<std::string, uint32_t> bindingIndices;
+    };
+
+    // A single dispatch over a 1D/2D/3D problem size. Group counts are derived
+    // from the kernel's local size.
+    // Usage: batch.add(vkt::ComputeJob{ kernel, width, height }.bind("Input", input).bind("outImage", image));
+    class ComputeJob
+    {
+    public:
+        ComputeJob(const ComputeKernel& kernel, uint32_t sizeX, uint32_t sizeY = 1, uint32_t sizeZ = 1);
+
+        ComputeJob& bind(const std::string& name, const Buffer& buffer);
+        ComputeJob& bind(const std::string& name, const Image& image);
+
+        std::array<uint32_t, 3> getGroupCount() const;
+
+    private:
+        friend class ComputeBatch;
+
+        struct Resource
+        {
+            const ShaderBinding* binding;
+            uint64_t handle; // vk::Buffer or vk::Image, used for dependency tracking
+            vk::DescriptorBufferInfo bufferInfo;
+            vk::DescriptorImageInfo imageInfo;
+        };
+
+        const ComputeKernel* kernel;
+        std::array<uint32_t, 3> size;
+        std::vector<Resource> resources;
+    };
+
+    struct ComputeBatchCreateInfo
+    {
+        // Jobs per submission; add() submits early when this is exceeded
+        uint32_t maxJobs = 1024;
+
+        // Descriptors of each type available to a submission; add() submits early when a
+        // type would run out and throws for a job that needs more than this on its own
+        uint32_t maxDescriptorsPerType = 4096;
+    };
+
+    // Records many jobs into one command buffer. A memory barrier is only inserted
+    // when a job accesses a resource written by a previous job, or writes a
+    // resource read by one, since the last barrier.
+    class ComputeBatch
+    {
+    public:
+        ComputeBatch(const Context& context, const ComputeBatchCreateInfo& info = {});
+
+        ComputeBatch(const ComputeBatch&) = delete;
+        ComputeBatch(ComputeBatch&&) = default;
+        ComputeBatch& operator=(const ComputeBatch&) = delete;
+        ComputeBatch& operator=(ComputeBatch&&) = default;
+
+        ~ComputeBatch();
+
+        void add(ComputeJob job, std::source_location location = std::source_location::current());
+
+        // Record and submit the queued jobs. Only waits for the previous submission.
+        void submit(std::source_location location = std::source_location::current());
+
+        // Wait for the last submission. Its descriptor sets and command buffer are then reused.
+        void wait(std::source_location location = std::source_location::current());
+
+        void run(std::source_location location = std::source_location::current())
+        {
+            submit(location);
+            wait(location);
+        }
+
+        size_t getPendingJobCount() const { return jobs.size(); }
+        uint64_t getBarrierCount() const { return barrierCount; }
+
+    private:
+        void record();
+
+        const Context* context;
+        ComputeBatchCreateInfo info;
+        vk::UniqueDescriptorPool descPool;
+        CommandBuffer commandBuffer;
+        vk::UniqueFence fence;
+        bool inFlight = false;
+
+        std::vector<ComputeJob> jobs;
+        std::unordered_map<vk::DescriptorType, uint32_t> descriptorCounts; // used by the queued jobs
+        uint64_t barrierCount = 0;
+
+        // Reused between submissions
+        std::vector<vk::DescriptorSetLayout> setLayouts;
+        std::vector<vk::WriteDescriptorSet> writes;
+        std::unordered_map<uint64_t, bool> accessed; // handle -> written since the last barrier
+    };
+}
@@ -2,7 +2,10 @@
 #define VULKAN_HPP_DISPATCH_LOADER_DYNAMIC 1
 #include <vulkan/vulkan.hpp>
 #include <iostream>
+#include <memory>
 #include <set>
+#include <source_location>
+#include <string_view>
 #include "Window.hpp"
 #include "CommandBuffer.hpp"
 
@@ -24,6 +27,23 @@ namespace vkt
         std::vector<const char*> deviceExtensions = { VK_KHR_SWAPCHAIN_EXTENSION_NAME };
         vk::PhysicalDeviceFeatures features = {};
         void* deviceCreatePNext = nullptr; // TODO: managing this
+
+        // Overrides the automatic device selection. Accepts a device index written as "#N",
+        // a UUID (needs apiMinorVersion 1 or higher) or a case-insensitive substring of the
+        // device name, so "3090" matches by name. The VKT_DEVICE environment variable takes
+        // precedence over this.
+        std::string physicalDevice = "";
+
+        // Also load the device functions into VULKAN_HPP_DEFAULT_DISPATCHER, so that the
+        // application's own vulkan.hpp calls skip the loader trampolines too. vktiny's wrappers
+        // always call through getDispatcher(). The default dispatcher is process-global: the last
+        // context to load it redirects the calls of all other contexts to its device's driver.
+        // Only enable this when the process uses a single device at a time.
+        bool loadDeviceFunctions = false;
+
+        // Custom loader entry point, e.g. vkt::null::getInstanceProcAddr.
+        // By default the Vulkan loader library is used.
+        PFN_vkGetInstanceProcAddr getInstanceProcAddr = nullptr;
     };
 
     class Context
@@ -31,24 +51,13 @@ namespace vkt
     public:
         Context(const ContextCreateInfo& info, const Window& window)
         {
-            std::vector<const char*> layers = {};
-            std::vector<const char*> instanceExtensions = window.getInstanceExtensions();
-            if (info.enableValidationLayer) {
-                layers.push_back("VK_LAYER_KHRONOS_validation");
-                instanceExtensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
-            }
+            init(info, window.getInstanceExtensions(), &window);
+        }
 
-            initInstance(info.apiMajorVersion, info.apiMinorVersion,
-                         info.appName, layers, instanceExtensions);
-            if (info.enableValidationLayer) {
-                initMessenger();
-            }
-            surface = window.createSurface(*instance);
-            pickPhysicalDevice();
-            findQueueFamilies();
-            initDevice(info.deviceExtensions, info.features, info.deviceCreatePNext);
-            getQueues();
-            createCommandPools();
+        // Headless context without a surface, e.g. for batch rendering or CI
+        explicit Context(const ContextCreateInfo& info)
+        {
+            init(info, {}, nullptr);
         }
 
         Context(const Context&) = delete;
@@ -61,33 +70,34 @@ namespace vkt
             vk::CommandBufferAllocateInfo allocInfo;
             allocInfo.setCommandPool(*graphicsCommandPool);
             allocInfo.setCommandBufferCount(count);
-            auto vkCommandBuffers = device->allocateCommandBuffersUnique(allocInfo);
+            auto vkCommandBuffers = device->allocateCommandBuffersUnique(allocInfo, *dispatcher);
 
             std::vector<CommandBuffer> commandBuffers;
             for (int i = 0; i < count; ++i) {
-                commandBuffers.emplace_back(std::move(vkCommandBuffers[i]));
+                commandBuffers.emplace_back(std::move(vkCommandBuffers[i]), *dispatcher);
             }
             return commandBuffers;
         }
 
+        // Record with func, submit and wait. The wait is reported at the caller's location.
         template <typename Func>
-        void OneTimeSubmitGraphics(const Func& func) const
+        void OneTimeSubmitGraphics(const Func& func, std::source_location location = std::source_location::current()) const
         {
-            CommandBuffer commandBuffer(*device, *graphicsCommandPool, graphicsQueue);
+            CommandBuffer commandBuffer(*device, *graphicsCommandPool, graphicsQueue, *dispatcher);
             commandBuffer.begin();
             func(commandBuffer);
             commandBuffer.end();
-            commandBuffer.submit();
+            commandBuffer.submit(location);
         }
 
         template <typename Func>
-        void OneTimeSubmitCompute(const Func& func) const
+        void OneTimeSubmitCompute(const Func& func, std::source_location location = std::source_location::current()) const
         {
-            CommandBuffer commandBuffer(*device, *computeCommandPool, computeQueue);
+            CommandBuffer commandBuffer(*device, *computeCommandPool, computeQueue, *dispatcher);
             commandBuffer.begin();
             func(commandBuffer);
             commandBuffer.end();
-            commandBuffer.submit();
+            commandBuffer.submit(location);
         }
 
         uint32_t findMemoryType(uint32_t typeFilter, vk::MemoryPropertyFlags properties) const
@@ -102,9 +112,44 @@ namespace vkt
             throw std::runtime_error("failed to find suitable memory type");
         }
 
+        // Host-visible memory preferring cached memory for fast CPU reads
+        vk::MemoryPropertyFlags getHostReadbackMemoryProperties() const
+        {
+            using vkMP = vk::MemoryPropertyFlagBits;
+            vk::MemoryPropertyFlags cached = vkMP::eHostVisible | vkMP::eHostCoherent | vkMP::eHostCached;
+            vk::PhysicalDeviceMemoryProperties memProperties = physicalDevice.getMemoryProperties();
+            for (uint32_t i = 0; i != memProperties.memoryTypeCount; ++i) {
+                if ((memProperties.memoryTypes[i].propertyFlags & cached) == cached) {
+                    return cached;
+                }
+            }
+            return vkMP::eHostVisible | vkMP::eHostCoherent;
+        }
+
+        // Nanoseconds per timestamp tick
+        float getTimestampPeriod() const
+        {
+            return physicalDevice.getProperties().limits.timestampPeriod;
+        }
+
+        const vk::PhysicalDeviceFeatures& getEnabledFeatures() const { return enabledFeatures; }
+
+        bool isDeviceExtensionEnabled(const std::string& name) const
+        {
+            return std::find(enabledDeviceExtensions.begin(),
+                             enabledDeviceExtensions.end(), name) != enabledDeviceExtensions.end();
+        }
+
         vk::Device getDevice() const { return *device; }
+
+        // Functions of this context's device resolved with vkGetDeviceProcAddr. vktiny's wrappers
+        // call through it, which skips the loader trampolines without touching the global
+        // dispatcher. Pass it to direct vulkan.hpp calls, e.g. cmdBuf.dispatch(x, y, z, context.getDispatcher()).
+        // It stays at the same address when the context is moved.
+        const vk::DispatchLoaderDynamic& getDispatcher() const { return *dispatcher; }
         vk::PhysicalDevice getPhysicalDevice() const { return physicalDevice; }
         vk::SurfaceKHR getSurface() const { return *surface; }
+        bool isHeadless() const { return !surface; }
 
         uint32_t getGraphicsFamily() const { return graphicsFamily; }
         uint32_t getComputeFamily() const { return computeFamily; }
@@ -118,19 +163,59 @@ namespace vkt
         vk::CommandPool getComputeCommandPool() const { return *computeCommandPool; }
 
     private:
+        void init(const ContextCreateInfo& info,
+                  std::vector<const char*> instanceExtensions,
+                  const Window* window)
+        {
+            std::vector<const char*> layers = {};
+            if (info.enableValidationLayer) {
+                layers.push_back("VK_LAYER_KHRONOS_validation");
+                instanceExtensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
+            }
+
+            initInstance(info.apiMajorVersion, info.apiMinorVersion,
+                         info.appName, layers, instanceExtensions, info.getInstanceProcAddr);
+            if (info.enableValidationLayer) {
+                initMessenger();
+            }
+
+            std::vector<const char*> deviceExtensions = info.deviceExtensions;
+            if (window) {
+                surface = window->createSurface(*instance);
+            } else {
+                // Headless devices may not expose the swapchain extension at all
+                std::erase_if(deviceExtensions,
+                              [](const char* extension) {
+                                  return std::string_view(extension) == VK_KHR_SWAPCHAIN_EXTENSION_NAME;
+                              });
+            }
+            pickPhysicalDevice(info, deviceExtensions);
+            findQueueFamilies();
+            initDevice(deviceExtensions, info.features, info.deviceCreatePNext);
+            initDispatcher(info.loadDeviceFunctions);
+            enabledFeatures = info.features;
+            enabledDeviceExtensions = { deviceExtensions.begin(), deviceExtensions.end() };
+            getQueues();
+            createCommandPools();
+        }
+
         void initInstance(uint32_t majorVersion,
                           uint32_t minorVersion,
                           const std::string& appName,
                           const std::vector<const char*>& layers,
-                          const std::vector<const char*>& extensions)
+                          const std::vector<const char*>& extensions,
+                          PFN_vkGetInstanceProcAddr getInstanceProcAddr)
         {
             vk::ApplicationInfo appInfo;
             appInfo.setApiVersion(VK_MAKE_API_VERSION(0, majorVersion, minorVersion, 0));
             appInfo.setPApplicationName(appName.c_str());
 
-            static vk::DynamicLoader dl;
-            auto vkGetInstanceProcAddr = dl.getProcAddress<PFN_vkGetInstanceProcAddr>("vkGetInstanceProcAddr");
-            VULKAN_HPP_DEFAULT_DISPATCHER.init(vkGetInstanceProcAddr);
+            if (!getInstanceProcAddr) {
+                static vk::DynamicLoader dl;
+                getInstanceProcAddr = dl.getProcAddress<PFN_vkGetInstanceProcAddr>("vkGetInstanceProcAddr");
+            }
+            this->getInstanceProcAddr = getInstanceProcAddr;
+            VULKAN_HPP_DEFAULT_DISPATCHER.init(getInstanceProcAddr);
 
             vk::InstanceCreateInfo instInfo;
             instInfo.setPApplicationInfo(&appInfo);
@@ -152,10 +237,14 @@ namespace vkt
             messenger = instance->createDebugUtilsMessengerEXTUnique(messengerInfo);
         }
 
-        void pickPhysicalDevice()
-        {
-            physicalDevice = instance->enumeratePhysicalDevices().front();
-        }
+        // Resolves this device's functions into the context's own dispatcher and, if requested,
+        // into the global default dispatcher
+        void initDispatcher(bool loadGlobal);
+
+        // Scores every device that supports the required extensions, features and queues,
+        // preferring discrete GPUs with more device-local memory
+        void pickPhysicalDevice(const ContextCreateInfo& info,
+                                const std::vector<const char*>& extensions);
 
         void findQueueFamilies()
         {
@@ -168,11 +257,17 @@ namespace vkt
                 if (queueFamily.queueFlags & vk::QueueFlagBits::eCompute) {
                     computeFamily = i;
                 }
+                if (!surface) {
+                    continue;
+                }
                 vk::Bool32 presentSupport = physicalDevice.getSurfaceSupportKHR(i, *surface);
                 if (presentSupport) {
                     presentFamily = i;
                 }
             }
+            if (!surface) {
+                presentFamily = graphicsFamily;
+            }
         }
 
         void initDevice(const std::vector<const char*>& extensions,
@@ -214,6 +309,10 @@ namespace vkt
         vk::PhysicalDevice physicalDevice;
         vk::UniqueSurfaceKHR surface;
         vk::UniqueDevice device;
+        PFN_vkGetInstanceProcAddr getInstanceProcAddr = nullptr;
+        std::unique_ptr<vk::DispatchLoaderDynamic> dispatcher = std::make_unique<vk::DispatchLoaderDynamic>();
+        std::vector<std::string> enabledDeviceExtensions;
+        vk::PhysicalDeviceFeatures enabledFeatures;
 
         uint32_t graphicsFamily = {};
         uint32_t presentFamily = {};
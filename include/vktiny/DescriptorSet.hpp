@@ -24,6 +24,8 @@ namespace vkt
 
         void update(const Buffer& buffer, vk::DescriptorSetLayoutBinding binding);
         void update(const Image& image, vk::DescriptorSetLayoutBinding binding);
+        void update(vk::ImageView imageView, vk::ImageLayout imageLayout,
+                    vk::DescriptorSetLayoutBinding binding);
 
         vk::DescriptorSet get() const { return *descSet; }
 
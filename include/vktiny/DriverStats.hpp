@@ -0,0 +1,82 @@
+#pragma once
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <source_location>
+#include <vector>
+
+namespace vkt::stats
+{
+    enum class Counter : uint32_t
+    {
+        AllocateMemory,
+        UpdateDescriptorSets,
+        QueueSubmit,
+        WaitForFences,
+        WaitIdle,
+        Count,
+    };
+
+    constexpr size_t counterCount = static_cast<size_t>(Counter::Count);
+
+    const char* toString(Counter counter);
+
+    struct Stall
+    {
+        Counter counter;
+        const char* file;
+        uint32_t line;
+        const char* function;
+        int64_t durationNs;
+    };
+
+    struct FrameReport
+    {
+        uint64_t frame = 0;
+        std::array<uint64_t, counterCount> calls{};
+        std::array<int64_t, counterCount> blockedNs{};
+        std::vector<Stall> stalls;
+    };
+
+    // Counters are thread-local atomics, so counting is an uncontended relaxed add
+    void increment(Counter counter, uint64_t count = 1);
+    void addBlockedTime(Counter counter, int64_t durationNs,
+                        std::source_location location = std::source_location::current());
+
+    // Blocking waits longer than this are reported as stalls
+    void setStallThreshold(std::chrono::nanoseconds threshold);
+
+    // Aggregate and reset the counters of all threads. Called by Swapchain::endFrame
+    // and OffscreenSwapchain::endFrame.
+    FrameReport endFrame();
+    FrameReport getLastFrameReport();
+
+    // Counts a blocking call and measures how long it blocked. Public functions that block
+    // take the caller's location as a defaulted argument and pass it here, so that stalls
+    // point at application code rather than at vktiny's wrappers.
+    class WaitScope
+    {
+    public:
+        WaitScope(Counter counter, std::source_location location = std::source_location::current())
+            : counter(counter)
+            , location(location)
+            , begin(std::chrono::steady_clock::now())
+        {
+        }
+
+        WaitScope(const WaitScope&) = delete;
+        WaitScope& operator=(const WaitScope&) = delete;
+
+        ~WaitScope()
+        {
+            auto duration = std::chrono::steady_clock::now() - begin;
+            increment(counter);
+            addBlockedTime(counter, std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count(), location);
+        }
+
+    private:
+        Counter counter;
+        std::source_location location;
+        std::chrono::steady_clock::time_point begin;
+    };
+}
@@ -0,0 +1,147 @@
+#pragma once
+#include "Context.hpp"
+#include "Buffer.hpp"
+#include "GltfLoader.hpp"
+#include <deque>
+#include <map>
+#include <optional>
+
+namespace vkt
+{
+    // First-fit suballocator of element ranges. Adjacent free ranges are merged.
+    class RangeAllocator
+    {
+    public:
+        explicit RangeAllocator(uint32_t capacity = 0);
+
+        // Returns nothing if no free range is large enough
+        std::optional<uint32_t> allocate(uint32_t size);
+        void free(uint32_t offset, uint32_t size);
+
+        // Adds [oldCapacity, capacity) to the free ranges
+        void grow(uint32_t capacity);
+
+        // Marks [0, usedSize) as allocated and the rest as free
+        void reset(uint32_t capacity, uint32_t usedSize);
+
+        uint32_t getCapacity() const { return capacity; }
+        uint32_t getFreeSize() const { return freeSize; }
+        uint32_t getLargestFreeRange() const;
+
+    private:
+        std::map<uint32_t, uint32_t> freeRanges; // offset -> size
+        uint32_t capacity = 0;
+        uint32_t freeSize = 0;
+    };
+
+    using GeometryId = uint32_t;
+
+    // Element offsets into the pool's buffers. Indices are relative to vertexOffset,
+    // so draws pass it as the vertex offset of drawIndexed.
+    struct GeometryRange
+    {
+        uint32_t vertexOffset = 0;
+        uint32_t vertexCount = 0;
+        uint32_t indexOffset = 0;
+        uint32_t indexCount = 0;
+    };
+
+    struct GeometryPoolCreateInfo
+    {
+        // Initial capacity in elements. The pool grows when full, and compact() shrinks it
+        // to the live geometry plus some headroom.
+        uint32_t vertexCapacity = 1 << 20;
+        uint32_t indexCapacity = 1 << 22;
+
+        // Added to both buffers, e.g. eStorageBuffer or eShaderDeviceAddress
+        vk::BufferUsageFlags usage = {};
+        vk::MemoryPropertyFlags properties = vk::MemoryPropertyFlagBits::eDeviceLocal;
+
+        // Format of all geometry in the pool, vkt::Vertex by default or a quantized VertexLayout
+        uint32_t vertexStride = sizeof(Vertex);
+        // With eUint16, every mesh added must have at most 65536 vertices, as indices are
+        // relative to each mesh's first vertex
+        vk::IndexType indexType = vk::IndexType::eUint32;
+
+        // Frames in flight, which may still read buffers replaced by growing or compaction
+        uint32_t frameCount = 2;
+    };
+
+    // All vertices and indices in one vertex and one index buffer. Geometry is
+    // referenced by stable ids whose ranges change when the pool grows or is compacted.
+    class GeometryPool
+    {
+    public:
+        GeometryPool(const Context& context, const GeometryPoolCreateInfo& info = {});
+        GeometryPool(const GeometryPool&) = delete;
+        GeometryPool(GeometryPool&&) = default;
+        GeometryPool& operator=(const GeometryPool&) = delete;
+        GeometryPool& operator=(GeometryPool&&) = default;
+
+        // Reserve ranges without writing them. Grows the buffers if needed.
+        GeometryId allocate(uint32_t vertexCount, uint32_t indexCount);
+
+        // Allocate and upload, through a staging buffer unless the pool is host-visible.
+        // The data has to be in the pool's vertex stride and index type.
+        GeometryId add(const void* vertices, uint32_t vertexCount, const void* indices, uint32_t indexCount);
+
+        // Record copies of tightly packed vertices and indices into the geometry's ranges
+        void upload(const CommandBuffer& cmdBuf, GeometryId id, vk::Buffer srcBuffer,
+                    vk::DeviceSize vertexSrcOffset, vk::DeviceSize indexSrcOffset) const;
+
+        void free(GeometryId id);
+
+        // Move the live geometry to the front of new buffers sized to fit it with some
+        // headroom, releasing the memory of freed geometry. Waits for the copies.
+        void compact();
+
+        // Destroys the buffers replaced frameCount frames ago. Call once per frame, after
+        // waiting for the fence of the frame that is about to be recorded.
+        void beginFrame();
+
+        const GeometryRange& getRange(GeometryId id) const { return ranges[id]; }
+
+        // Null unless the pool is host-visible and coherent
+        void* getMappedVertices();
+        void* getMappedIndices();
+
+        // Incremented whenever the buffers are replaced by growing or compaction,
+        // after which descriptors, device addresses and BLASes have to be updated
+        uint32_t getGeneration() const { return generation; }
+
+        const Buffer& getVertexBuffer() const { return vertexBuffer; }
+        const Buffer& getIndexBuffer() const { return indexBuffer; }
+        uint32_t getVertexStride() const { return info.vertexStride; }
+        vk::IndexType getIndexType() const { return info.indexType; }
+        uint32_t getIndexSize() const { return info.indexType == vk::IndexType::eUint16 ? 2 : 4; }
+        uint32_t getLiveVertexCount() const { return vertexAllocator.getCapacity() - vertexAllocator.getFreeSize(); }
+        uint32_t getLiveIndexCount() const { return indexAllocator.getCapacity() - indexAllocator.getFreeSize(); }
+
+    private:
+        struct Retired
+        {
+            uint64_t frame;
+            std::optional<Buffer> vertexBuffer;
+            std::optional<Buffer> indexBuffer;
+        };
+
+        bool isHostVisible() const;
+        void reallocate(uint32_t vertexCapacity, uint32_t indexCapacity, bool pack);
+
+        const Context* context;
+        GeometryPoolCreateInfo info;
+        Buffer vertexBuffer;
+        Buffer indexBuffer;
+        RangeAllocator vertexAllocator;
+        RangeAllocator indexAllocator;
+
+        std::vector<GeometryRange> ranges;
+        std::vector<bool> live;
+        std::vector<GeometryId> freeIds;
+        uint32_t generation = 0;
+
+        // Replaced buffers, kept until the frames that may use them have finished
+        std::deque<Retired> retired;
+        uint64_t frameCounter = 0;
+    };
+}
@@ -0,0 +1,178 @@
+#pragma once
+#include "MappedFile.hpp"
+#include <array>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+// CPU side of the scene loader. Doesn't touch Vulkan so it can be used and tested without a device.
+namespace vkt
+{
+    class ThreadPool;
+
+    namespace json
+    {
+        class Value;
+    }
+
+    struct Vertex
+    {
+        std::array<float, 3> position{};
+        std::array<float, 3> normal{};
+        std::array<float, 2> texCoord{};
+    };
+
+    enum class AlphaMode : uint32_t
+    {
+        Opaque,
+        Mask,
+        Blend,
+    };
+
+    // Texture indices are -1 when unused
+    struct Material
+    {
+        std::array<float, 4> baseColorFactor{ 1.0f, 1.0f, 1.0f, 1.0f };
+        std::array<float, 3> emissiveFactor{ 0.0f, 0.0f, 0.0f };
+        float metallicFactor = 1.0f;
+        float roughnessFactor = 1.0f;
+        float alphaCutoff = 0.5f;
+        AlphaMode alphaMode = AlphaMode::Opaque;
+        bool doubleSided = false;
+
+        int32_t baseColorTextureIndex = -1;
+        int32_t metallicRoughnessTextureIndex = -1;
+        int32_t normalTextureIndex = -1;
+        int32_t occlusionTextureIndex = -1;
+        int32_t emissiveTextureIndex = -1;
+    };
+
+    // One per triangle primitive. Offsets index the loader's flat vertex and index arrays,
+    // indices are relative to the mesh's first vertex.
+    struct MeshInfo
+    {
+        std::string name;
+        uint32_t vertexOffset = 0;
+        uint32_t vertexCount = 0;
+        uint32_t indexOffset = 0;
+        uint32_t indexCount = 0;
+        int32_t materialIndex = -1;
+    };
+
+    // Encoded image bytes, either inside a mapped file or decoded from a data URI.
+    // data is null if an external image file is missing.
+    struct ImageSource
+    {
+        std::string name;
+        std::string mimeType;
+        std::filesystem::path path;
+        const uint8_t* data = nullptr;
+        size_t size = 0;
+    };
+
+    // Sampler values use the glTF (OpenGL) enums, 0 means unspecified
+    struct TextureInfo
+    {
+        int32_t imageIndex = -1;
+        int32_t basisImageIndex = -1; // KTX2 image of KHR_texture_basisu
+        uint32_t magFilter = 0;
+        uint32_t minFilter = 0;
+        uint32_t wrapS = 10497;
+        uint32_t wrapT = 10497;
+    };
+
+    // Column-major world transform of a mesh placed by the node hierarchy
+    struct MeshInstance
+    {
+        uint32_t meshIndex = 0;
+        std::array<float, 16> transform{ 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 };
+    };
+
+    class GltfLoader
+    {
+    public:
+        // Maps the .gltf or .glb file and its buffers and parses the document.
+        // Geometry isn't decoded until decode() is called. Materials and images are
+        // parsed on the pool if one is given.
+        explicit GltfLoader(const std::filesystem::path& path, ThreadPool* pool = nullptr);
+
+        GltfLoader(const GltfLoader&) = delete;
+        GltfLoader(GltfLoader&&) = default;
+        GltfLoader& operator=(const GltfLoader&) = delete;
+        GltfLoader& operator=(GltfLoader&&) = default;
+
+        // Decode every mesh in parallel. The arrays need getVertexCount() and getIndexCount() elements.
+        void decode(ThreadPool& pool, Vertex* vertices, uint32_t* indices) const;
+
+        // Decode one mesh into arrays of its own vertexCount and indexCount. Thread-safe.
+        void decodeMesh(uint32_t meshIndex, Vertex* vertices, uint32_t* indices) const;
+
+        const std::vector<MeshInfo>& getMeshes() const { return meshes; }
+        const std::vector<Material>& getMaterials() const { return materials; }
+        const std::vector<TextureInfo>& getTextures() const { return textures; }
+        const std::vector<ImageSource>& getImages() const { return images; }
+        const std::vector<MeshInstance>& getInstances() const { return instances; }
+        uint32_t getVertexCount() const { return vertexCount; }
+        uint32_t getIndexCount() const { return indexCount; }
+
+        // Buffers and images referenced by URI, including images that failed to map
+        const std::vector<std::filesystem::path>& getExternalFiles() const { return externalFiles; }
+
+    private:
+        struct BufferView
+        {
+            const uint8_t* data = nullptr;
+            size_t size = 0;
+            uint32_t stride = 0;
+        };
+
+        // A view of -1 reads as zeros
+        struct Accessor
+        {
+            int32_t view = -1;
+            size_t offset = 0;
+            uint32_t stride = 0;
+            uint32_t componentType = 0;
+            uint32_t componentCount = 0;
+            uint32_t count = 0;
+            bool normalized = false;
+        };
+
+        struct Primitive
+        {
+            int32_t position = -1;
+            int32_t normal = -1;
+            int32_t texCoord = -1;
+            int32_t indices = -1;
+        };
+
+        void parseBuffers(const json::Value& document, const uint8_t* binChunk, size_t binSize);
+        void parseAccessors(const json::Value& document);
+        void parseMeshes(const json::Value& document, std::vector<std::vector<uint32_t>>& primitivesByMesh);
+        void parseMaterials(const json::Value& document, ThreadPool* pool);
+        void parseImages(const json::Value& document, ThreadPool* pool);
+        void parseNodes(const json::Value& document, const std::vector<std::vector<uint32_t>>& primitivesByMesh);
+
+        void readFloats(const Accessor& accessor, uint32_t elementCount, uint32_t componentCount,
+                        float* dst, size_t dstStride) const;
+
+        std::filesystem::path directory;
+        MappedFile file;
+        std::vector<MappedFile> bufferFiles;
+        std::vector<std::vector<uint8_t>> ownedBuffers;
+        std::vector<std::filesystem::path> externalFiles;
+
+        std::vector<BufferView> bufferViews;
+        std::vector<Accessor> accessors;
+        std::vector<Primitive> primitives;
+
+        std::vector<MeshInfo> meshes;
+        std::vector<Material> materials;
+        std::vector<TextureInfo> textures;
+        std::vector<ImageSource> images;
+        std::vector<MeshInstance> instances;
+        uint32_t vertexCount = 0;
+        uint32_t indexCount = 0;
+    };
+}
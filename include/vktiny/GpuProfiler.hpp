@@ -0,0 +1,145 @@
+#pragma once
+#define VULKAN_HPP_DISPATCH_LOADER_DYNAMIC 1
+#include <vulkan/vulkan.hpp>
+#include <deque>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+namespace vkt
+{
+    class Context;
+    class GpuProfiler;
+
+    struct GpuProfilerCreateInfo
+    {
+        // Results are read back this many frames later, so it should be
+        // larger than the number of frames in flight
+        uint32_t frameCount = 3;
+        uint32_t maxZonesPerFrame = 256;
+
+        // Number of samples kept per zone for the rolling statistics
+        uint32_t historySize = 256;
+
+        // Counters for zones opened with profileStatistics().
+        // Requires the pipelineStatisticsQuery device feature.
+        bool enablePipelineStatistics = false;
+        vk::QueryPipelineStatisticFlags pipelineStatistics =
+            vk::QueryPipelineStatisticFlagBits::eVertexShaderInvocations |
+            vk::QueryPipelineStatisticFlagBits::eClippingPrimitives |
+            vk::QueryPipelineStatisticFlagBits::eFragmentShaderInvocations |
+            vk::QueryPipelineStatisticFlagBits::eComputeShaderInvocations;
+    };
+
+    struct CounterStats
+    {
+        std::string name;
+        uint64_t last = 0;
+        uint64_t min = 0;
+        uint64_t max = 0;
+        double avg = 0.0;
+    };
+
+    struct ZoneStats
+    {
+        std::string name;
+        uint32_t sampleCount = 0;
+        double last = 0.0; // ms
+        double min = 0.0;
+        double avg = 0.0;
+        double p99 = 0.0;
+
+        // Pipeline statistics, empty unless the zone collected them
+        std::vector<CounterStats> counters;
+    };
+
+    // Writes begin/end timestamps on construction/destruction
+    class ProfileZone
+    {
+    public:
+        ProfileZone() = default;
+        ProfileZone(GpuProfiler& profiler, vk::CommandBuffer commandBuffer,
+                    const std::string& name, bool statistics = false);
+
+        ProfileZone(const ProfileZone&) = delete;
+        ProfileZone(ProfileZone&& other) noexcept;
+        ProfileZone& operator=(const ProfileZone&) = delete;
+        ProfileZone& operator=(ProfileZone&& other) noexcept;
+
+        ~ProfileZone();
+
+    private:
+        void end();
+
+        GpuProfiler* profiler = nullptr;
+        vk::CommandBuffer commandBuffer;
+        uint32_t zone = UINT32_MAX;
+    };
+
+    class GpuProfiler
+    {
+    public:
+        GpuProfiler(const Context& context, const GpuProfilerCreateInfo& info = {});
+
+        GpuProfiler(const GpuProfiler&) = delete;
+        GpuProfiler(GpuProfiler&&) = default;
+        GpuProfiler& operator=(const GpuProfiler&) = delete;
+        GpuProfiler& operator=(GpuProfiler&&) = default;
+
+        // Collect the results of the frame that last used the next query pool,
+        // then record its reset. Call at the start of each frame's command buffer.
+        void beginFrame(vk::CommandBuffer commandBuffer);
+
+        // Returns UINT32_MAX if the frame is out of queries.
+        // Pipeline statistics queries can't be nested, so they are skipped for inner zones.
+        uint32_t beginZone(vk::CommandBuffer commandBuffer, const std::string& name,
+                           bool statistics = false);
+        void endZone(vk::CommandBuffer commandBuffer, uint32_t zone);
+
+        std::vector<ZoneStats> getStats() const;
+        std::optional<ZoneStats> getStats(const std::string& name) const;
+
+        // Frames whose results were not available yet when their pool was reused
+        uint64_t getDroppedFrameCount() const { return droppedFrameCount; }
+
+        // Map GPU timestamps onto the CPU steady clock so zones line up in trace exports.
+        // Uses VK_EXT_calibrated_timestamps when enabled, otherwise a one-time submit.
+        void calibrate();
+
+    private:
+        struct Frame
+        {
+            vk::UniqueQueryPool queryPool;
+            vk::UniqueQueryPool statisticsPool;
+            std::vector<std::string> zoneNames;
+            std::vector<uint32_t> statisticsQueries; // UINT32_MAX if none
+            uint32_t statisticsCount = 0;
+            bool statisticsActive = false;
+            bool submitted = false;
+        };
+
+        void collect(Frame& frame);
+        int64_t toCpuTime(uint64_t timestamp) const;
+        void addSample(const std::string& name, double milliseconds);
+        void addCounterSample(const std::string& name, const uint64_t* counters);
+
+        const Context* context;
+        uint32_t maxZonesPerFrame;
+        uint32_t historySize;
+        double timestampPeriod;
+        uint64_t timestampMask;
+
+        bool useCalibratedTimestamps = false;
+        uint32_t framesSinceCalibration = 0;
+        uint64_t calibrationTimestamp = 0;
+        int64_t calibrationCpuTime = 0;
+
+        std::vector<Frame> frames;
+        uint32_t currentFrame = 0;
+        uint64_t droppedFrameCount = 0;
+        std::unordered_map<std::string, std::deque<double>> history;
+
+        std::vector<vk::QueryPipelineStatisticFlagBits> statisticBits;
+        std::unordered_map<std::string, std::deque<std::vector<uint64_t>>> counterHistory;
+    };
+}
@@ -4,6 +4,23 @@
 namespace vkt
 {
     class Buffer;
+    class CommandBuffer;
+    class ReadbackRing;
+    class ReadbackFuture;
+
+    // Size in bytes of a texel block, a single texel for uncompressed formats
+    uint32_t getFormatSize(vk::Format format);
+
+    // Texels covered by one block: 4x4 for BCn formats, otherwise 1x1
+    vk::Extent2D getFormatBlockExtent(vk::Format format);
+
+    bool isBlockCompressed(vk::Format format);
+
+    // Number of levels in a full mip chain down to 1x1
+    uint32_t getMipLevelCount(vk::Extent2D extent);
+
+    // Size in bytes of the tightly packed levels, rounded up to whole blocks
+    vk::DeviceSize getImageSize(vk::Extent2D extent, vk::Format format, uint32_t mipLevels = 1);
 
     class Image
     {
@@ -11,7 +28,8 @@ namespace vkt
         Image(const Context& context,
               vk::Extent2D extent,
               vk::Format format,
-              vk::ImageUsageFlags usage);
+              vk::ImageUsageFlags usage,
+              uint32_t mipLevels = 1);
         Image(const Image&) = delete;
         Image(Image&&) = default;
         Image& operator=(const Image&) = delete;
@@ -19,14 +37,34 @@ namespace vkt
 
         void createImageView();
         void createSampler();
+        void createSampler(const vk::SamplerCreateInfo& samplerInfo);
 
         //void copyBuffer(const Buffer& buffer);
 
         void transitionLayout(vk::ImageLayout newLayout);
 
+        // Record a copy of tightly packed texels of all mip levels, largest first, from
+        // the buffer, leaving the image in eShaderReadOnlyOptimal once the command buffer has executed.
+        // Block-compressed levels are packed in whole blocks and srcOffset must be a multiple of the block size.
+        void upload(const CommandBuffer& cmdBuf, vk::Buffer srcBuffer, vk::DeviceSize srcOffset = 0);
+
+        // Copy the texels into a readback ring. The image needs eTransferSrc usage and a layout
+        // other than eUndefined, and is returned to that layout after the copy.
+        ReadbackFuture readback(ReadbackRing& ring, const CommandBuffer& cmdBuf, vk::Fence fence) const;
+        ReadbackFuture readback(ReadbackRing& ring) const;
+
         vk::Image get() const { return *image; }
         vk::ImageView getView() const { return *view; }
+        vk::Sampler getSampler() const { return sampler.get(); }
         vk::ImageLayout getLayout() const { return imageLayout; }
+        vk::Extent2D getExtent() const { return extent; }
+        vk::Format getFormat() const { return format; }
+        uint32_t getMipLevels() const { return mipLevels; }
+
+        // Extent in texels and size in bytes of one mip level, and the size of all levels together
+        vk::Extent2D getMipExtent(uint32_t level) const;
+        vk::DeviceSize getMipSize(uint32_t level) const;
+        vk::DeviceSize getSize() const;
 
     private:
         void create(vk::ImageUsageFlags usage);
@@ -40,6 +78,7 @@ namespace vkt
         vk::UniqueDeviceMemory memory;
         vk::Extent2D extent;
         vk::Format format;
+        uint32_t mipLevels;
         vk::ImageLayout imageLayout;
         vk::DescriptorImageInfo imageInfo;
     };
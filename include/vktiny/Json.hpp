@@ -0,0 +1,64 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Minimal JSON DOM, enough for glTF
+namespace vkt::json
+{
+    class Value
+    {
+    public:
+        enum class Type
+        {
+            Null,
+            Bool,
+            Number,
+            String,
+            Array,
+            Object,
+        };
+
+        Value() = default;
+
+        Type getType() const { return type; }
+        bool isNull() const { return type == Type::Null; }
+        bool isNumber() const { return type == Type::Number; }
+        bool isString() const { return type == Type::String; }
+        bool isArray() const { return type == Type::Array; }
+        bool isObject() const { return type == Type::Object; }
+
+        // Return the fallback if the value has another type
+        bool asBool(bool fallback = false) const { return type == Type::Bool ? boolean : fallback; }
+        double asNumber(double fallback = 0.0) const { return type == Type::Number ? number : fallback; }
+        int64_t asInt(int64_t fallback = 0) const { return type == Type::Number ? static_cast<int64_t>(number) : fallback; }
+        float asFloat(float fallback = 0.0f) const { return type == Type::Number ? static_cast<float>(number) : fallback; }
+        const std::string& asString() const { return string; }
+
+        // Number of array elements or object members
+        size_t size() const { return type == Type::Array ? array.size() : object.size(); }
+
+        // Missing elements and members return a null value
+        const Value& operator[](size_t index) const;
+        const Value& operator[](std::string_view key) const;
+        bool contains(std::string_view key) const;
+
+        const std::vector<Value>& getArray() const { return array; }
+        const std::vector<std::pair<std::string, Value>>& getObject() const { return object; }
+
+    private:
+        friend class Parser;
+
+        Type type = Type::Null;
+        bool boolean = false;
+        double number = 0.0;
+        std::string string;
+        std::vector<Value> array;
+        std::vector<std::pair<std::string, Value>> object;
+    };
+
+    // Throws std::runtime_error with the byte offset of the first error
+    Value parse(std::string_view text);
+}
@@ -0,0 +1,84 @@
+#pragma once
+#include "Context.hpp"
+#include <functional>
+#include <span>
+#include <vector>
+
+namespace vkt
+{
+    enum class Ktx2Supercompression : uint32_t
+    {
+        None = 0,
+        BasisLZ = 1,
+        Zstd = 2,
+        Zlib = 3,
+    };
+
+    // Byte range of one mip level inside the file
+    struct Ktx2Level
+    {
+        uint64_t offset = 0;
+        uint64_t size = 0;
+        uint64_t uncompressedSize = 0;
+    };
+
+    // Header, data format descriptor and level index of a 2D KTX2 file with one layer and face.
+    // Doesn't copy the data, which must outlive the object.
+    class Ktx2File
+    {
+    public:
+        // Throws if the data isn't a KTX2 file or describes an array, cube map or 3D texture
+        Ktx2File(const uint8_t* data, size_t size);
+
+        static bool isKtx2(const uint8_t* data, size_t size);
+
+        // eUndefined for Basis Universal data
+        vk::Format getFormat() const { return format; }
+        vk::Extent2D getExtent() const { return extent; }
+        uint32_t getMipLevels() const { return static_cast<uint32_t>(levels.size()); }
+        Ktx2Supercompression getSupercompression() const { return supercompression; }
+
+        // BasisLZ/ETC1S or UASTC, which need to be transcoded before uploading
+        bool isBasis() const;
+
+        // From the data format descriptor, meaningful for Basis data
+        bool isUastc() const;
+        bool hasAlpha() const { return alpha; }
+        bool isSrgb() const { return srgb; }
+
+        // Level 0 is the largest
+        const Ktx2Level& getLevel(uint32_t level) const { return levels[level]; }
+        std::span<const uint8_t> getLevelData(uint32_t level) const;
+
+        const uint8_t* getData() const { return data; }
+        size_t getSize() const { return size; }
+
+        // Append all levels, largest first, as Image::upload() expects them.
+        // Throws unless the file holds block-compressed or plain texels without supercompression.
+        void copyLevels(std::vector<uint8_t>& texels) const;
+
+    private:
+        const uint8_t* data;
+        size_t size;
+        vk::Format format = vk::Format::eUndefined;
+        vk::Extent2D extent;
+        Ktx2Supercompression supercompression = Ktx2Supercompression::None;
+        uint32_t colorModel = 0;
+        bool alpha = false;
+        bool srgb = false;
+        std::vector<Ktx2Level> levels;
+    };
+
+    // Transcodes the Basis Universal data of a KTX2 file to the target format. Resizes
+    // texels to all levels, largest first. Returns false if the data can't be transcoded.
+    // Called from several decoding threads at once.
+    using BasisTranscoder = std::function<bool(const Ktx2File& file, vk::Format target, std::vector<uint8_t>& texels)>;
+
+    // The Basis Universal transcoder if vktiny was built with VKTINY_BASISU or found <basisu_transcoder.h>, otherwise empty
+    BasisTranscoder getDefaultBasisTranscoder();
+
+    // Smallest block format the device samples without losing quality: BC7 for UASTC, BC1
+    // or with alpha BC3 for ETC1S, trying the others before falling back to RGBA8.
+    // BCn formats need the textureCompressionBC feature to be enabled.
+    vk::Format selectTranscodeFormat(const Context& context, const Ktx2File& file, bool srgb);
+}
@@ -0,0 +1,120 @@
+#pragma once
+#include <version>
+#include <cstdint>
+#include <functional>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#ifdef __cpp_lib_format
+#include <format>
+#endif
+
+namespace vkt::log
+{
+    enum class Level : uint32_t
+    {
+        Trace,
+        Info,
+        Warn,
+        Error,
+    };
+
+#ifdef __cpp_lib_format
+    // Format strings are checked at compile time
+    template <typename... Args>
+    using FormatString = std::format_string<Args...>;
+
+    template <typename... Args>
+    std::string format(FormatString<Args...> fmt, Args&&... args)
+    {
+        return std::format(fmt, std::forward<Args>(args)...);
+    }
+#else
+    // Fallback for standard libraries without <format>: "{}" placeholders are
+    // replaced at runtime and format specs are ignored
+    template <typename... Args>
+    using FormatString = std::type_identity_t<std::string_view>;
+
+    template <typename... Args>
+    std::string format(std::string_view fmt, Args&&... args)
+    {
+        std::ostringstream out;
+        auto writeNext = [&](auto&& arg) {
+            while (!fmt.empty()) {
+                size_t pos = fmt.find_first_of("{}");
+                if (pos == std::string_view::npos) {
+                    break;
+                }
+                out << fmt.substr(0, pos);
+                if (pos + 1 < fmt.size() && fmt[pos + 1] == fmt[pos]) {
+                    out << fmt[pos];
+                    fmt.remove_prefix(pos + 2);
+                    continue;
+                }
+                size_t close = fmt.find('}', pos);
+                fmt.remove_prefix(close == std::string_view::npos ? fmt.size() : close + 1);
+                out << arg;
+                return;
+            }
+        };
+        (writeNext(std::forward<Args>(args)), ...);
+        out << fmt;
+        return out.str();
+    }
+#endif
+
+    // Messages are pushed to a lock-free queue and written by a background thread,
+    // so logging never blocks on console I/O
+    void write(Level level, std::string message);
+
+    // Block until every queued message has been written
+    void flush();
+
+    void setLevel(Level level);
+    bool isEnabled(Level level);
+
+    // Replaces the default stdout/stderr output. The sink is called from the logging thread;
+    // set it before other threads start logging.
+    void setSink(std::function<void(Level, std::string_view)> sink);
+
+    // Vulkan debug messages. Repeated message IDs are only written on their
+    // first occurrence and then at powers of two with a repeat count.
+    void vulkanMessage(Level level, bool performance, int32_t messageId,
+                       const char* messageIdName, const char* message);
+
+    uint64_t getPerformanceMessageCount();
+
+    template <typename... Args>
+    void trace(FormatString<Args...> fmt, Args&&... args)
+    {
+        if (isEnabled(Level::Trace)) {
+            write(Level::Trace, format(fmt, std::forward<Args>(args)...));
+        }
+    }
+
+    template <typename... Args>
+    void info(FormatString<Args...> fmt, Args&&... args)
+    {
+        if (isEnabled(Level::Info)) {
+            write(Level::Info, format(fmt, std::forward<Args>(args)...));
+        }
+    }
+
+    template <typename... Args>
+    void warn(FormatString<Args...> fmt, Args&&... args)
+    {
+        if (isEnabled(Level::Warn)) {
+            write(Level::Warn, format(fmt, std::forward<Args>(args)...));
+        }
+    }
+
+    template <typename... Args>
+    void error(FormatString<Args...> fmt, Args&&... args)
+    {
+        if (isEnabled(Level::Error)) {
+            write(Level::Error, format(fmt, std::forward<Args>(args)...));
+        }
+    }
+}
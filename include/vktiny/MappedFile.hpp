@@ -0,0 +1,35 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+
+namespace vkt
+{
+    // Read-only memory mapping of a whole file
+    class MappedFile
+    {
+    public:
+        MappedFile() = default;
+
+        // Throws std::runtime_error if the file can't be opened or mapped
+        explicit MappedFile(const std::filesystem::path& path);
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile(MappedFile&& other) noexcept;
+        MappedFile& operator=(const MappedFile&) = delete;
+        MappedFile& operator=(MappedFile&& other) noexcept;
+        ~MappedFile();
+
+        const uint8_t* data() const { return mapped; }
+        size_t size() const { return fileSize; }
+
+    private:
+        void close();
+
+        const uint8_t* mapped = nullptr;
+        size_t fileSize = 0;
+#ifdef _WIN32
+        void* mapping = nullptr;
+#endif
+    };
+}
@@ -0,0 +1,70 @@
+#pragma once
+#include "GltfLoader.hpp"
+#include <vector>
+
+// Import-time mesh optimization. CPU only, so meshes of a scene can be processed in parallel.
+namespace vkt::meshopt
+{
+    // Post-transform cache efficiency of an index buffer, simulated with a FIFO cache
+    struct VertexCacheStats
+    {
+        uint32_t verticesTransformed = 0;
+        float acmr = 0.0f; // average cache miss ratio, transformed vertices per triangle
+        float atvr = 0.0f; // average transform to vertex ratio, 1.0 is optimal
+    };
+
+    VertexCacheStats analyzeVertexCache(const std::vector<uint32_t>& indices, uint32_t vertexCount,
+                                        uint32_t cacheSize = 16);
+
+    // Merge bitwise identical vertices and remap the indices
+    void deduplicateVertices(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
+
+    // Reorder triangles for post-transform cache hits (Forsyth's linear-speed algorithm)
+    void optimizeVertexCache(std::vector<uint32_t>& indices, uint32_t vertexCount);
+
+    // Reorder clusters of triangles so outward-facing ones are drawn first, reducing overdraw.
+    // Keeps the input order if the ACMR would grow by more than the threshold factor.
+    void optimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<Vertex>& vertices,
+                          float threshold = 1.05f);
+
+    // Reorder vertices by first use in the index buffer and drop unreferenced ones
+    void optimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
+
+    // Coarser index buffer over the same vertices with at most targetIndexCount indices,
+    // built by clustering vertices on a uniform grid
+    std::vector<uint32_t> simplify(const std::vector<uint32_t>& indices, const std::vector<Vertex>& vertices,
+                                   uint32_t targetIndexCount);
+
+    struct OptimizeInfo
+    {
+        bool deduplicate = true;
+        bool vertexCache = true;
+        bool overdraw = true;
+        float overdrawThreshold = 1.05f;
+        bool vertexFetch = true;
+
+        // Extra levels of detail, each with lodRatio times the indices of the previous one
+        uint32_t lodCount = 0;
+        float lodRatio = 0.5f;
+    };
+
+    // Index range of one level of detail, relative to the start of the mesh's indices
+    struct Lod
+    {
+        uint32_t indexOffset = 0;
+        uint32_t indexCount = 0;
+    };
+
+    struct OptimizeStats
+    {
+        uint32_t vertexCountBefore = 0;
+        uint32_t vertexCountAfter = 0;
+        VertexCacheStats before;
+        VertexCacheStats after;
+    };
+
+    // Run the enabled stages in order. The indices of the LODs are appended after
+    // the full-detail indices; lods receives one entry per level, starting with the full mesh.
+    OptimizeStats optimizeMesh(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices,
+                               std::vector<Lod>& lods, const OptimizeInfo& info = {});
+}
@@ -0,0 +1,32 @@
+#pragma once
+#define VULKAN_HPP_DISPATCH_LOADER_DYNAMIC 1
+#include <vulkan/vulkan.hpp>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Vulkan implementation that does no work. Handles are fake, memory is only
+// backed on the host once it is mapped, and every call is counted. Used to
+// measure the CPU overhead of vktiny itself without a GPU.
+//
+// Usage:
+//   vkt::ContextCreateInfo info{ .getInstanceProcAddr = vkt::null::getInstanceProcAddr };
+//   vkt::Context context{ info };
+//
+// Only headless contexts are supported, and only the functions vktiny calls are
+// implemented. getInstanceProcAddr returns nullptr for any other function.
+namespace vkt::null
+{
+    VKAPI_ATTR PFN_vkVoidFunction VKAPI_CALL getInstanceProcAddr(VkInstance instance, const char* name);
+
+    struct CallCount
+    {
+        std::string name;
+        uint64_t count = 0;
+    };
+
+    // Functions that have been called at least once since the last reset
+    std::vector<CallCount> getCallCounts();
+    uint64_t getTotalCallCount();
+    void resetCallCounts();
+}
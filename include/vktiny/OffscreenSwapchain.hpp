@@ -0,0 +1,99 @@
+#pragma once
+#define VULKAN_HPP_DISPATCH_LOADER_DYNAMIC 1
+#include <vulkan/vulkan.hpp>
+#include <functional>
+#include <optional>
+#include <source_location>
+#include "Context.hpp"
+#include "Swapchain.hpp"
+#include "Buffer.hpp"
+#include "Image.hpp"
+
+namespace vkt
+{
+    struct OffscreenSwapchainCreateInfo
+    {
+        int width = 0;
+        int height = 0;
+        vk::Format format = vk::Format::eR8G8B8A8Unorm;
+        vk::ImageUsageFlags usage = vk::ImageUsageFlagBits::eStorage |
+                                    vk::ImageUsageFlagBits::eColorAttachment;
+
+        // Number of render targets, which is also the number of frames in flight
+        uint32_t imageCount = 3;
+
+        // Copy every finished frame into a host buffer and pass it to the consumer
+        bool enableReadback = true;
+    };
+
+    struct ReadbackFrame
+    {
+        uint64_t frameNumber;
+        uint32_t imageIndex;
+        vk::Extent2D extent;
+        vk::Format format;
+        const void* data;
+        vk::DeviceSize size;
+    };
+
+    // Rotates device-local render targets with the same beginFrame/endFrame contract as Swapchain.
+    // The images are kept in eGeneral layout outside of the readback.
+    class OffscreenSwapchain
+    {
+    public:
+        OffscreenSwapchain(const Context& context, const OffscreenSwapchainCreateInfo& info);
+
+        OffscreenSwapchain(const OffscreenSwapchain&) = delete;
+        OffscreenSwapchain(OffscreenSwapchain&&) = default;
+        OffscreenSwapchain& operator=(const OffscreenSwapchain&) = delete;
+        OffscreenSwapchain& operator=(OffscreenSwapchain&&) = default;
+
+        FrameInfo beginFrame(std::source_location location = std::source_location::current());
+
+        void endFrame(uint32_t imageIndex);
+
+        // Wait for all submitted frames and hand them to the consumer
+        void flush(std::source_location location = std::source_location::current());
+
+        // Called from beginFrame or flush, in submission order.
+        // The data is only valid during the call.
+        void setOnFrameReady(std::function<void(const ReadbackFrame&)> callback)
+        {
+            onFrameReady = std::move(callback);
+        }
+
+        auto getExtent() const { return extent; }
+        auto getFormat() const { return format; }
+        auto getImagesSize() const { return targets.size(); }
+        const Image& getImage(uint32_t index) const { return targets[index].image; }
+        vk::ImageView getImageView(uint32_t index) const { return targets[index].image.getView(); }
+
+    private:
+        struct Target
+        {
+            Image image;
+            std::optional<Buffer> readbackBuffer;
+            std::optional<CommandBuffer> readbackCommandBuffer;
+            vk::UniqueSemaphore imageAvailableSemaphore;
+            vk::UniqueSemaphore renderFinishedSemaphore;
+            vk::UniqueFence inFlightFence;
+            vk::UniqueFence readbackFence;
+            uint64_t frameNumber = 0;
+            bool pending = false;
+        };
+
+        void recordReadback(Target& target);
+        void collectFinishedFrames(bool wait, std::source_location location);
+        void deliver(Target& target);
+
+        const Context* context;
+
+        vk::Extent2D extent;
+        vk::Format format;
+        std::vector<Target> targets;
+
+        uint32_t nextIndex = 0;
+        uint64_t frameCount = 0;
+        std::function<void(const ReadbackFrame&)> onFrameReady;
+    };
+}
@@ -0,0 +1,98 @@
+#pragma once
+#define VULKAN_HPP_DISPATCH_LOADER_DYNAMIC 1
+#include <vulkan/vulkan.hpp>
+#include <deque>
+#include <memory>
+#include <optional>
+#include <source_location>
+#include "Context.hpp"
+#include "Buffer.hpp"
+
+namespace vkt
+{
+    class ReadbackRing;
+
+    // Handle to data being copied into a ReadbackRing.
+    // The ring space is reused once the GPU has finished and every copy of the handle is gone.
+    class ReadbackFuture
+    {
+    public:
+        ReadbackFuture() = default;
+
+        bool valid() const { return static_cast<bool>(state); }
+        bool isReady() const;
+        void wait(std::source_location location = std::source_location::current()) const;
+
+        // Blocks until the GPU has finished the copy
+        const void* get(std::source_location location = std::source_location::current()) const;
+
+        vk::DeviceSize getOffset() const { return state->offset; }
+        vk::DeviceSize getSize() const { return state->size; }
+
+    private:
+        friend class ReadbackRing;
+
+        struct State
+        {
+            vk::Device device;
+            const vk::DispatchLoaderDynamic* dispatcher;
+            const void* data;
+            vk::DeviceSize offset;
+            vk::DeviceSize size;
+            vk::Fence fence;
+
+            // Only used by the one-time submit path
+            vk::UniqueFence ownedFence;
+            std::optional<CommandBuffer> commandBuffer;
+        };
+
+        std::shared_ptr<State> state;
+    };
+
+    // Host-cached staging ring for device-to-host copies.
+    // Buffer::readback and Image::readback record into it.
+    class ReadbackRing
+    {
+    public:
+        ReadbackRing(const Context& context, vk::DeviceSize capacity);
+
+        ReadbackRing(const ReadbackRing&) = delete;
+        ReadbackRing(ReadbackRing&&) = default;
+        ReadbackRing& operator=(const ReadbackRing&) = delete;
+        ReadbackRing& operator=(ReadbackRing&&) = default;
+
+        // Reserve space for a copy that completes when the given fence is signaled.
+        // The fence must not be reset while the returned future is in use.
+        ReadbackFuture allocate(vk::DeviceSize size, vk::Fence fence);
+
+        // Record the copies on a one-time command buffer and submit it without waiting
+        template <typename Func>
+        ReadbackFuture submit(const Func& func)
+        {
+            vk::Device device = context->getDevice();
+            vk::UniqueFence fence = device.createFenceUnique({}, nullptr, context->getDispatcher());
+            CommandBuffer commandBuffer(device, context->getGraphicsCommandPool(),
+                                        context->getGraphicsQueue(), context->getDispatcher());
+            commandBuffer.begin({ vk::CommandBufferUsageFlagBits::eOneTimeSubmit });
+            ReadbackFuture future = func(commandBuffer, *fence);
+            commandBuffer.end();
+            commandBuffer.submit(*fence);
+
+            future.state->ownedFence = std::move(fence);
+            future.state->commandBuffer = std::move(commandBuffer);
+            return future;
+        }
+
+        vk::Buffer getBuffer() const { return buffer.get(); }
+        vk::DeviceSize getCapacity() const { return capacity; }
+
+    private:
+        void reclaim();
+
+        const Context* context;
+        Buffer buffer;
+        vk::DeviceSize capacity;
+        vk::DeviceSize head = 0;
+        std::deque<std::shared_ptr<ReadbackFuture::State>> entries;
+    };
+}
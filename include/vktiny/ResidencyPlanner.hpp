@@ -0,0 +1,58 @@
+#pragma once
+#include "TextureStreamer.hpp"
+#include <span>
+#include <vector>
+
+namespace vkt
+{
+    // Size of the levels from baseMip down to 1x1
+    vk::DeviceSize getMipChainSize(const StreamedTextureSource& source, uint32_t baseMip);
+
+    // New finest resident level of a texture, finer for loads and coarser for evictions
+    struct ResidencyJob
+    {
+        uint32_t texture;
+        uint32_t baseMip;
+    };
+
+    // Decides which levels are resident. Loads go to the textures missing the most levels,
+    // evicting textures that weren't used for the longest time, or levels finer than the
+    // last request of used textures, until the new levels fit into the budget. Used by the
+    // planning thread of TextureStreamer and doesn't touch the device.
+    class ResidencyPlanner
+    {
+    public:
+        // Feedback of textures that weren't sampled
+        static constexpr uint32_t notRequested = UINT32_MAX;
+
+        // Starts with the levels up to info.tailExtent resident
+        ResidencyPlanner(std::span<const StreamedTextureSource> sources, const TextureStreamerCreateInfo& info);
+
+        uint32_t getTailMip(uint32_t texture) const { return states[texture].tailMip; }
+        uint32_t getBaseMip(uint32_t texture) const { return states[texture].baseMip; }
+        vk::DeviceSize getResidentSize() const { return residentSize; }
+
+        // Requested levels per texture, notRequested for unused textures
+        std::vector<ResidencyJob> plan(const std::vector<uint32_t>& requested);
+
+    private:
+        struct State
+        {
+            uint32_t tailMip = 0;
+            uint32_t baseMip = 0;
+            uint32_t requestedMip = 0;
+            uint64_t lastUsed = 0;
+        };
+
+        // Coarsest level a texture may drop to
+        uint32_t getEvictionMip(const State& state) const;
+        vk::DeviceSize getEvictableSize(uint32_t exclude) const;
+        void evict(uint32_t exclude, vk::DeviceSize growth, std::vector<ResidencyJob>& jobs);
+
+        std::span<const StreamedTextureSource> sources;
+        TextureStreamerCreateInfo info;
+        std::vector<State> states;
+        vk::DeviceSize residentSize = 0;
+        uint64_t serial = 0;
+    };
+}
@@ -0,0 +1,136 @@
+#pragma once
+#include "Context.hpp"
+#include "GeometryPool.hpp"
+#include "GltfLoader.hpp"
+#include "MeshOptimizer.hpp"
+#include "TextureLoader.hpp"
+#include "VertexFormat.hpp"
+#include <filesystem>
+
+namespace vkt
+{
+    struct SceneCreateInfo
+    {
+        // Added to the geometry pool's vertex and index buffers
+        vk::BufferUsageFlags meshUsage = {};
+
+        // Host-visible coherent memory is written directly by the decoding threads,
+        // otherwise the geometry is uploaded through one staging buffer
+        vk::MemoryPropertyFlags meshProperties = vk::MemoryPropertyFlagBits::eDeviceLocal;
+
+        // Decoding threads, 0 uses one per hardware thread
+        uint32_t threadCount = 0;
+
+        // Optimize the meshes for the vertex cache, overdraw and vertex fetch before uploading.
+        // Costs a decode copy per mesh, so it is off by default.
+        bool optimizeMeshes = false;
+        meshopt::OptimizeInfo optimizeInfo;
+
+        // Store vertices in vertexLayout instead of vkt::Vertex. Positions of each mesh are
+        // quantized to its bounds, see Mesh::getQuantization().
+        bool quantizeVertices = false;
+        VertexLayout vertexLayout;
+
+        // With quantizeVertices, use 16-bit indices if every mesh has at most 65536 vertices.
+        // The geometry pool has a single index type, so this is decided for the whole scene:
+        // one larger mesh makes every mesh use 32-bit indices.
+        bool smallIndices = true;
+
+        // Textures are skipped with a warning if an image isn't KTX2 and there is no image decoder
+        bool loadTextures = true;
+        TextureLoaderCreateInfo textureInfo;
+
+        // Load this scene cache if it's valid for the glTF file, otherwise the glTF file
+        std::filesystem::path cachePath;
+    };
+
+    // Vulkan sampler for the glTF sampler parameters, with maxLod 0. Texture loading raises
+    // maxLod to the mip levels, which both the glTF and the cached path generate down to 1x1.
+    vk::SamplerCreateInfo getSamplerInfo(const TextureInfo& texture);
+
+    // RGBA8 format of each glTF texture: sRGB if a material samples it as base or emissive
+    // color, UNORM for the linear data of the other slots
+    std::vector<vk::Format> getTextureFormats(const GltfLoader& loader);
+
+    // One glTF primitive, stored in the scene's geometry pool
+    class Mesh
+    {
+    public:
+        Mesh(GeometryId geometryId, const MeshInfo& info, std::vector<meshopt::Lod> lods = {},
+             const VertexQuantization& quantization = {})
+            : geometryId(geometryId)
+            , vertexCount(info.vertexCount)
+            , indexCount(lods.empty() ? info.indexCount : lods[0].indexCount)
+            , materialIndex(info.materialIndex)
+            , lods(std::move(lods))
+            , quantization(quantization)
+        {
+        }
+
+        GeometryId getGeometryId() const { return geometryId; }
+        uint32_t getVertexCount() const { return vertexCount; }
+
+        // Indices of the full-detail mesh
+        uint32_t getIndexCount() const { return indexCount; }
+        int32_t getMaterialIndex() const { return materialIndex; }
+
+        // Index ranges relative to the geometry's indices, starting with the full mesh.
+        // Empty unless the scene was loaded with optimizeMeshes.
+        const std::vector<meshopt::Lod>& getLods() const { return lods; }
+
+        // Identity unless the scene was loaded with quantizeVertices
+        const VertexQuantization& getQuantization() const { return quantization; }
+
+    private:
+        GeometryId geometryId;
+        uint32_t vertexCount;
+        uint32_t indexCount;
+        int32_t materialIndex;
+        std::vector<meshopt::Lod> lods;
+        VertexQuantization quantization;
+    };
+
+    class SceneCache;
+
+    // Loads a .gltf or .glb file. Buffers are memory-mapped and the accessors are
+    // decoded on a thread pool straight into the mapped geometry pool or staging memory.
+    class Scene
+    {
+    public:
+        Scene(const Context& context, const std::filesystem::path& path, const SceneCreateInfo& info = {});
+        Scene(const Scene&) = delete;
+        Scene(Scene&&) = default;
+        Scene& operator=(const Scene&) = delete;
+        Scene& operator=(Scene&&) = default;
+
+        const std::vector<Mesh>& getMeshes() const { return meshes; }
+        const GeometryPool& getGeometryPool() const { return geometryPool; }
+        GeometryPool& getGeometryPool() { return geometryPool; }
+        const std::vector<Material>& getMaterials() const { return materials; }
+        const std::vector<MeshInstance>& getInstances() const { return instances; }
+
+        // Indexed by the texture indices of the materials
+        const std::vector<Image>& getTextures() const { return textures; }
+
+        // Totals over all meshes, zero unless the scene was loaded with optimizeMeshes
+        const meshopt::OptimizeStats& getOptimizeStats() const { return optimizeStats; }
+
+    private:
+        struct Source;
+        Scene(const Context& context, Source&& source, const SceneCreateInfo& info);
+
+        void loadCache(const SceneCache& cache, const SceneCreateInfo& info);
+        void uploadDirect(ThreadPool& pool, const GltfLoader& loader);
+        void uploadStaged(ThreadPool& pool, const GltfLoader& loader);
+        void uploadProcessed(ThreadPool& pool, const GltfLoader& loader, const SceneCreateInfo& info);
+        void loadTextures(const GltfLoader& loader, const TextureLoaderCreateInfo& textureInfo);
+
+        const Context* context;
+        GeometryPool geometryPool;
+        std::vector<Mesh> meshes;
+        std::vector<Material> materials;
+        std::vector<MeshInstance> instances;
+        std::vector<Image> textures;
+        meshopt::OptimizeStats optimizeStats;
+    };
+}
@@ -0,0 +1,99 @@
+#pragma once
+#include "Scene.hpp"
+#include "MappedFile.hpp"
+#include "ThreadPool.hpp"
+#include <optional>
+#include <span>
+
+namespace vkt
+{
+    // Decoded geometry of one glTF mesh, optimized and quantized as the scene info asks
+    struct ProcessedMesh
+    {
+        std::vector<Vertex> vertices;
+        std::vector<uint32_t> indices;
+        QuantizedMesh quantized;
+        bool isQuantized = false;
+        std::vector<meshopt::Lod> lods;
+        meshopt::OptimizeStats stats;
+        uint32_t vertexCount = 0;
+        uint32_t indexCount = 0;
+
+        // In the geometry pool's vertex stride and index type
+        const void* getVertexData() const;
+        const void* getIndexData() const;
+    };
+
+    // Vertex stride and index type of the scene's geometry pool
+    GeometryPoolCreateInfo getGeometryPoolInfo(const GltfLoader& loader, const SceneCreateInfo& info);
+
+    std::vector<ProcessedMesh> processMeshes(ThreadPool& pool, const GltfLoader& loader,
+                                             const SceneCreateInfo& info, vk::IndexType indexType);
+
+    // Totals over all meshes, with the ACMR relative to the full-detail triangles
+    meshopt::OptimizeStats sumOptimizeStats(const std::vector<ProcessedMesh>& meshes);
+
+    struct SceneCacheMesh
+    {
+        uint32_t vertexOffset = 0; // elements of the vertex and index sections
+        uint32_t vertexCount = 0;
+        uint32_t indexOffset = 0;
+        uint32_t indexCount = 0; // including all LODs
+        uint32_t lodOffset = 0;  // entries of the LOD section
+        uint32_t lodCount = 0;
+        int32_t materialIndex = -1;
+        VertexQuantization quantization;
+    };
+
+    struct SceneCacheTexture
+    {
+        uint32_t width = 0;
+        uint32_t height = 0;
+        uint32_t mipLevels = 1;
+        vk::Format format = vk::Format::eR8G8B8A8Unorm;
+        uint64_t dataOffset = 0; // in the texture data section, all levels largest first
+        uint64_t dataSize = 0;
+        TextureInfo sampler; // glTF sampler parameters
+    };
+
+    // Preprocessed scene in one file: geometry in the pool's final format, RGBA8 textures
+    // with full mip chains, materials and instances. Sections are aligned so the mapped file
+    // is copied to the GPU as is. Written by vktiny_scene_convert or SceneCache::write().
+    // Textures are not block-compressed; scenes whose textures only have KTX2 images keep
+    // their compressed formats by loading the glTF file instead.
+    class SceneCache
+    {
+    public:
+        // Decode, process and write a glTF file with the settings of the info
+        static void write(const std::filesystem::path& cachePath, const std::filesystem::path& gltfPath,
+                          const SceneCreateInfo& info = {});
+
+        // Nothing if the file is missing, invalid, or was written from a different version of
+        // the glTF file or the buffers and images it references, with different geometry
+        // settings, or with a different answer to whether an image decoder was available
+        static std::optional<SceneCache> open(const std::filesystem::path& cachePath,
+                                              const std::filesystem::path& gltfPath,
+                                              const SceneCreateInfo& info = {});
+
+        std::span<const SceneCacheMesh> getMeshes() const;
+        std::span<const meshopt::Lod> getLods() const;
+        std::span<const Material> getMaterials() const;
+        std::span<const MeshInstance> getInstances() const;
+        std::span<const SceneCacheTexture> getTextures() const;
+
+        std::span<const uint8_t> getVertexData() const;
+        std::span<const uint8_t> getIndexData() const;
+        std::span<const uint8_t> getTextureData(const SceneCacheTexture& texture) const;
+
+        uint32_t getVertexStride() const;
+        vk::IndexType getIndexType() const;
+        const meshopt::OptimizeStats& getOptimizeStats() const;
+
+    private:
+        explicit SceneCache(MappedFile&& file);
+
+        std::span<const uint8_t> getSection(uint32_t section) const;
+
+        MappedFile file;
+    };
+}
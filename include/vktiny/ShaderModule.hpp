@@ -1,14 +1,33 @@
 #pragma once
 
 #include <vulkan/vulkan.hpp>
+#include <array>
 
 namespace vkt
 {
     class Context;
 
+    struct ShaderBinding
+    {
+        std::string name; // block name for buffers, variable name otherwise
+        uint32_t binding = 0;
+        vk::DescriptorType type = vk::DescriptorType::eStorageBuffer;
+        uint32_t count = 1;
+        bool readonly = false;
+        bool writeonly = false;
+    };
+
+    // Resources of descriptor set 0 and the workgroup size
+    struct ShaderReflection
+    {
+        std::vector<ShaderBinding> bindings;
+        std::array<uint32_t, 3> localSize = { 1, 1, 1 };
+    };
+
     std::vector<char> readFile(const std::string& filename);
     std::vector<unsigned int> compileToSPV(const vk::ShaderStageFlagBits shaderType,
-                                           std::string const& glslShader);
+                                           std::string const& glslShader,
+                                           ShaderReflection* reflection = nullptr);
 
     class ShaderModule
     {
@@ -17,6 +36,10 @@ namespace vkt
                      const std::string& shaderText,
                      vk::ShaderStageFlagBits shaderStage);
 
+        ShaderModule(const Context& context,
+                     const std::vector<unsigned int>& shaderSPV,
+                     vk::ShaderStageFlagBits shaderStage);
+
         ShaderModule(const ShaderModule&) = delete;
         ShaderModule(ShaderModule&&) = default;
         ShaderModule& operator=(const ShaderModule&) = delete;
@@ -39,5 +62,11 @@ namespace vkt
             : ShaderModule(context, shaderText, vk::ShaderStageFlagBits::eCompute)
         {
         }
+
+        ComputeShaderModule(const Context& context,
+                            const std::vector<unsigned int>& shaderSPV)
+            : ShaderModule(context, shaderSPV, vk::ShaderStageFlagBits::eCompute)
+        {
+        }
     };
 }
@@ -3,6 +3,10 @@
 #include <vulkan/vulkan.hpp>
 #include <GLFW/glfw3.h>
 #include <utility>
+#include <chrono>
+#include <functional>
+#include <optional>
+#include <source_location>
 #include "Context.hpp"
 
 namespace vkt
@@ -11,15 +15,34 @@ namespace vkt
     {
         uint32_t imageIndex;
         uint32_t currentFrame;
+        vk::Image image;
+        vk::ImageView imageView;
         vk::Semaphore imageAvailableSemaphore;
         vk::Semaphore renderFinishedSemaphore;
         vk::Fence inFlightFence;
     };
 
+    struct SwapchainCreateInfo
+    {
+        int width = 0;
+        int height = 0;
+
+        // Present modes in order of preference. eFifo is always used as the last resort
+        // because it is the only mode guaranteed to be supported.
+        std::vector<vk::PresentModeKHR> presentModes = { vk::PresentModeKHR::eFifoRelaxed };
+
+        uint32_t maxFramesInFlight = 2;
+        uint32_t imageCount = 0; // 0: minImageCount + 1
+
+        // Sleep until the predicted fence signal time instead of blocking in waitForFences
+        bool enableFramePacing = false;
+    };
+
     class Swapchain
     {
     public:
         Swapchain(const Context& context, int width, int height);
+        Swapchain(const Context& context, const SwapchainCreateInfo& info);
 
         Swapchain(const Swapchain&) = delete;
         Swapchain(Swapchain&&) = default;
@@ -30,37 +53,83 @@ namespace vkt
 
         std::vector<vk::UniqueCommandBuffer> allocateDrawComamndBuffers() const;
 
-        uint32_t acquireNextImageIndex() const;
+        // Returns std::nullopt if the swapchain is out of date
+        std::optional<uint32_t> acquireNextImageIndex();
 
-        FrameInfo beginFrame();
+        // Waits for the frame. location is reported with the wait.
+        FrameInfo beginFrame(std::source_location location = std::source_location::current());
 
         void endFrame(uint32_t imageIndex);
 
+        // Request recreation with a new size. Only needed on platforms where the
+        // surface doesn't report its current extent; otherwise it's picked up automatically.
+        void resize(int width, int height);
+
+        // Called after the swapchain has been recreated. Size-dependent resources
+        // (e.g. storage render images) and per-image command buffers should be rebuilt here.
+        // It's called from beginFrame() without draining the other frames in flight, so the
+        // previous resources have to stay alive for getMaxFramesInFlight() - 1 more frames.
+        void setOnRecreate(std::function<void(vk::Extent2D)> callback)
+        {
+            onRecreate = std::move(callback);
+        }
+
         vk::SwapchainKHR get() const { return swapchain.get(); }
 
         auto getExtent() const { return imageExtent; }
+        auto getPresentMode() const { return presentMode; }
+        auto getMaxFramesInFlight() const { return maxFramesInFlight; }
         auto getFormat() const { return imageFormat; }
         auto getImagesSize() const { return images.size(); }
         const auto& getImages() const { return images; }
+        vk::ImageView getImageView(uint32_t index) const { return *imageViews[index]; }
+
+        // True if the images can be written directly from compute or ray-gen shaders
+        bool supportsStorage() const { return static_cast<bool>(imageUsage & vk::ImageUsageFlagBits::eStorage); }
 
     private:
+        struct RetiredSwapchain
+        {
+            vk::UniqueSwapchainKHR swapchain;
+            std::vector<vk::UniqueImageView> imageViews;
+            uint64_t retireFrame;
+        };
+
+        void createSwapchain(vk::SwapchainKHR oldSwapchain);
+        void recreate();
+        void releaseRetiredSwapchains();
         void createViews();
         void createSyncObjects();
+        void waitForFrame(std::source_location location);
 
         const Context* context;
+        SwapchainCreateInfo info;
 
         vk::UniqueSwapchainKHR swapchain;
         std::vector<vk::Image> images;
         vk::Format imageFormat;
         vk::Extent2D imageExtent;
+        vk::PresentModeKHR presentMode;
+        vk::ImageUsageFlags imageUsage;
         std::vector<vk::UniqueImageView> imageViews;
         std::vector<vk::UniqueFramebuffer> framebuffers;
 
+        bool needsRecreate = false;
+        uint64_t frameCount = 0;
+        std::vector<RetiredSwapchain> retiredSwapchains;
+        std::function<void(vk::Extent2D)> onRecreate;
+
         size_t currentFrame = 0;
-        const int maxFramesInFlight = 2;
+        uint32_t maxFramesInFlight = 2;
         std::vector<vk::UniqueSemaphore> imageAvailableSemaphores;
         std::vector<vk::UniqueSemaphore> renderFinishedSemaphores;
         std::vector<vk::Fence> inFlightFences;
         std::vector<vk::Fence> imagesInFlight;
+
+        // Frame pacing
+        using Clock = std::chrono::steady_clock;
+        bool enableFramePacing = false;
+        Clock::time_point lastFrameTime;
+        Clock::duration frameInterval{};
     };
 }
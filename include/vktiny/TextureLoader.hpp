@@ -0,0 +1,112 @@
+#pragma once
+#include "Context.hpp"
+#include "Buffer.hpp"
+#include "Image.hpp"
+#include "CommandBuffer.hpp"
+#include "Ktx2.hpp"
+#include <filesystem>
+#include <functional>
+
+namespace vkt
+{
+    // Tightly packed texels of all mip levels, largest first. Decoders only
+    // need to fill in RGBA8 texels of one level and may leave the rest.
+    struct DecodedImage
+    {
+        uint32_t width = 0;
+        uint32_t height = 0;
+        std::vector<uint8_t> pixels;
+
+        // eUndefined for the format of the texture source
+        vk::Format format = vk::Format::eUndefined;
+        uint32_t mipLevels = 1;
+    };
+
+    // Decodes an encoded image such as PNG or JPEG. Returns false if the data can't be decoded.
+    // Called from several decoding threads at once.
+    using ImageDecoder = std::function<bool(const uint8_t* data, size_t size, DecodedImage& image)>;
+
+    // stb_image if vktiny was built with VKTINY_STB_IMAGE or found <stb_image.h>, otherwise empty
+    ImageDecoder getDefaultImageDecoder();
+
+    // Appends 2x2 box-filtered levels down to 1x1 to an RGBA8 image of one level, averaging
+    // sRGB color in linear space. Decoded images get these unless the decoder returned levels.
+    void generateMipLevels(DecodedImage& image);
+
+    struct TextureSource
+    {
+        // Encoded bytes, usually inside a mapped file. The file at path is read if data is null.
+        const uint8_t* data = nullptr;
+        size_t size = 0;
+        std::filesystem::path path;
+
+        // Format of decoded RGBA8 texels. KTX2 files keep their own format, and Basis
+        // Universal data is transcoded to an sRGB format if this is eR8G8B8A8Srgb.
+        vk::Format format = vk::Format::eR8G8B8A8Unorm;
+        vk::SamplerCreateInfo samplerInfo;
+    };
+
+    struct TextureLoaderCreateInfo
+    {
+        ImageDecoder decoder = getDefaultImageDecoder();
+
+        // KTX2 files are recognized by their identifier and don't go through the decoder.
+        // Basis Universal data is transcoded to the block format chosen by selectTranscodeFormat().
+        BasisTranscoder transcoder = getDefaultBasisTranscoder();
+
+        // Decoding threads, 0 uses one per hardware thread
+        uint32_t threadCount = 0;
+
+        // Images waiting between two stages. Together with the staging size
+        // this bounds host memory regardless of the number of textures.
+        uint32_t queueCapacity = 4;
+
+        // Size of each of the two staging buffers; larger images grow the buffer
+        vk::DeviceSize stagingSize = 32 * 1024 * 1024;
+    };
+
+    // Loads textures in three stages connected by bounded queues: a reader thread,
+    // decoding threads, and the calling thread, which copies decoded texels into
+    // one staging buffer while the GPU executes the copies from the other.
+    class TextureLoader
+    {
+    public:
+        TextureLoader(const Context& context, const TextureLoaderCreateInfo& info = {});
+        TextureLoader(const TextureLoader&) = delete;
+        TextureLoader(TextureLoader&&) = default;
+        TextureLoader& operator=(const TextureLoader&) = delete;
+        TextureLoader& operator=(TextureLoader&&) = default;
+        ~TextureLoader();
+
+        // Returns one sampled image per source, in order. Sources that fail to
+        // decode get a 1x1 white image. Throws if a source that isn't KTX2 needs
+        // the decoder and there is none.
+        std::vector<Image> load(const std::vector<TextureSource>& sources);
+
+        // Largest amount of decoded texels held on the host at once during the last load()
+        size_t getPeakDecodedBytes() const { return peakDecodedBytes; }
+
+    private:
+        struct Staging
+        {
+            Buffer buffer;
+            CommandBuffer commandBuffer;
+            vk::UniqueFence fence;
+            vk::DeviceSize used = 0;
+            bool recording = false;
+            bool inFlight = false;
+        };
+
+        bool decode(size_t index, const uint8_t* data, size_t size, vk::Format format, DecodedImage& image) const;
+        bool decodeKtx2(size_t index, const uint8_t* data, size_t size, vk::Format format, DecodedImage& image) const;
+        Staging createStaging(vk::DeviceSize size) const;
+        void flush(Staging& staging);
+        void wait(Staging& staging);
+
+        const Context* context;
+        TextureLoaderCreateInfo info;
+        std::vector<Staging> stagings;
+        size_t current = 0;
+        size_t peakDecodedBytes = 0;
+    };
+}
@@ -0,0 +1,139 @@
+#pragma once
+#include "Context.hpp"
+#include "Buffer.hpp"
+#include "Image.hpp"
+#include "DescriptorPool.hpp"
+#include "DescriptorSetLayout.hpp"
+#include "DescriptorSet.hpp"
+#include <deque>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+
+namespace vkt
+{
+    class SceneCache;
+
+    // Texels of all mip levels, largest first and tightly packed, that stay valid while
+    // the streamer exists, usually inside a mapped scene cache
+    struct StreamedTextureSource
+    {
+        const uint8_t* data = nullptr;
+        vk::Extent2D extent;
+        vk::Format format = vk::Format::eR8G8B8A8Unorm;
+        uint32_t mipLevels = 1;
+        vk::SamplerCreateInfo samplerInfo;
+    };
+
+    // Sources pointing into the cache's mapping, in the order of the scene's textures
+    std::vector<StreamedTextureSource> getStreamedTextureSources(const SceneCache& cache);
+
+    struct TextureStreamerCreateInfo
+    {
+        // Device memory for the resident levels of all textures. The smallest levels are
+        // always resident and may exceed it.
+        vk::DeviceSize budget = 256 * 1024 * 1024;
+
+        // Levels up to this size are loaded up front and never evicted
+        uint32_t tailExtent = 64;
+
+        // Texels copied into staging memory per feedback readback
+        vk::DeviceSize maxUploadSize = 16 * 1024 * 1024;
+
+        // Descriptor sets and feedback buffers, one per frame in flight
+        uint32_t frameCount = 2;
+
+        vk::ShaderStageFlags stages = vk::ShaderStageFlagBits::eFragment;
+    };
+
+    // Keeps the mip levels of many textures resident on demand. Shaders sample the textures
+    // through the descriptor set of the frame (see getGlsl()) and record the finest level they
+    // needed in a feedback buffer. The buffer is copied to host memory and picked up once the
+    // frame has finished, without waiting, and a planning thread schedules loads of missing
+    // levels, evicting the least recently used ones to stay within the budget. Loaded textures
+    // replace the previous image in their array slot.
+    //
+    // Per frame, after waiting for the frame's fence:
+    //   streamer.update(cmdBuf, frame);       // uploads, descriptor writes
+    //   ... draws using getDescriptorSet(frame) ...
+    //   streamer.recordFeedback(cmdBuf, frame);
+    class TextureStreamer
+    {
+    public:
+        // Uploads the mip tails of all textures and waits for the upload
+        TextureStreamer(const Context& context, std::vector<StreamedTextureSource> sources,
+                        const TextureStreamerCreateInfo& info = {});
+        TextureStreamer(const TextureStreamer&) = delete;
+        TextureStreamer(TextureStreamer&&);
+        TextureStreamer& operator=(const TextureStreamer&) = delete;
+        TextureStreamer& operator=(TextureStreamer&&) = delete;
+        ~TextureStreamer();
+
+        // Record the uploads of finished loads and bring the frame's descriptor set up to date.
+        // The frame's previous command buffer must have finished executing.
+        void update(const CommandBuffer& cmdBuf, uint32_t frame);
+
+        // Record the readback and reset of the frame's feedback buffer after the draws
+        void recordFeedback(const CommandBuffer& cmdBuf, uint32_t frame);
+
+        const DescriptorSetLayout& getDescriptorSetLayout() const { return descSetLayout; }
+        const DescriptorSet& getDescriptorSet(uint32_t frame) const { return frames[frame].descSet; }
+
+        // Declarations of the set's bindings and vktSampleStreamed(index, uv), which samples
+        // a texture and records its feedback. Fragment shaders only, and the index must be
+        // dynamically uniform unless it is wrapped in nonuniformEXT.
+        std::string getGlsl(uint32_t set) const;
+
+        uint32_t getTextureCount() const { return static_cast<uint32_t>(textures.size()); }
+
+        // Finest level currently bound for the texture
+        uint32_t getResidentMip(uint32_t texture) const { return textures[texture].baseMip; }
+
+        // Size of the levels the planner decided to keep resident
+        vk::DeviceSize getResidentSize() const;
+
+    private:
+        struct Worker;
+
+        struct Frame
+        {
+            DescriptorSet descSet;
+            Buffer feedbackBuffer;
+            Buffer readbackBuffer;
+            Buffer baseMipBuffer;
+            std::vector<uint32_t> pendingWrites;
+            bool feedbackPending = false;
+        };
+
+        struct ResidentTexture
+        {
+            std::optional<Image> image;
+            uint32_t baseMip = 0;
+        };
+
+        // Kept alive until the frames that may use it have finished
+        struct Retired
+        {
+            uint64_t frame;
+            std::optional<Image> image;
+            std::optional<Buffer> staging;
+        };
+
+        Image createImage(uint32_t texture, uint32_t baseMip) const;
+        void writeDescriptors(Frame& frame);
+
+        const Context* context;
+        TextureStreamerCreateInfo info;
+        std::vector<StreamedTextureSource> sources;
+        std::vector<ResidentTexture> textures;
+
+        DescriptorSetLayout descSetLayout;
+        DescriptorPool descPool;
+        std::vector<Frame> frames;
+        std::deque<Retired> retired;
+        uint64_t frameCounter = 0;
+
+        std::unique_ptr<Worker> worker;
+    };
+}
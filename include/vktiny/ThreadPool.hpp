@@ -0,0 +1,120 @@
+#pragma once
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace vkt
+{
+    class ThreadPool
+    {
+    public:
+        // 0 uses one thread per hardware thread
+        explicit ThreadPool(uint32_t threadCount = 0);
+
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        // Finishes the queued tasks before joining
+        ~ThreadPool();
+
+        template <typename Func>
+        auto submit(Func&& func) -> std::future<std::invoke_result_t<Func>>
+        {
+            using Result = std::invoke_result_t<Func>;
+            auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<Func>(func));
+            std::future<Result> future = task->get_future();
+            push([task]() { (*task)(); });
+            return future;
+        }
+
+        // Calls func(i) for i in [0, count) on the workers and the calling thread.
+        // Blocks until every call returned and rethrows the first exception.
+        void parallelFor(size_t count, const std::function<void(size_t)>& func);
+
+        uint32_t getThreadCount() const { return static_cast<uint32_t>(threads.size()); }
+
+    private:
+        void push(std::function<void()> task);
+        void run();
+
+        std::vector<std::thread> threads;
+        std::mutex mutex;
+        std::condition_variable condition;
+        std::deque<std::function<void()>> tasks;
+        bool stopping = false;
+    };
+
+    // Blocking FIFO between pipeline stages. push() waits while the queue is full,
+    // pop() waits while it is empty and returns nothing once it is closed and drained.
+    template <typename T>
+    class BoundedQueue
+    {
+    public:
+        explicit BoundedQueue(size_t capacity)
+            : capacity(std::max<size_t>(capacity, 1))
+        {
+        }
+
+        // Returns false if the queue was closed
+        bool push(T value)
+        {
+            std::unique_lock lock{ mutex };
+            notFull.wait(lock, [this] { return closed || items.size() < capacity; });
+            if (closed) {
+                return false;
+            }
+            items.push_back(std::move(value));
+            notEmpty.notify_one();
+            return true;
+        }
+
+        std::optional<T> pop()
+        {
+            std::unique_lock lock{ mutex };
+            notEmpty.wait(lock, [this] { return closed || !items.empty(); });
+            if (items.empty()) {
+                return std::nullopt;
+            }
+            T value = std::move(items.front());
+            items.pop_front();
+            notFull.notify_one();
+            return value;
+        }
+
+        // No more pushes; pop() returns the remaining items
+        void close()
+        {
+            std::lock_guard lock{ mutex };
+            closed = true;
+            notEmpty.notify_all();
+            notFull.notify_all();
+        }
+
+        // Close and drop the remaining items
+        void cancel()
+        {
+            std::lock_guard lock{ mutex };
+            closed = true;
+            items.clear();
+            notEmpty.notify_all();
+            notFull.notify_all();
+        }
+
+    private:
+        size_t capacity;
+        std::mutex mutex;
+        std::condition_variable notEmpty;
+        std::condition_variable notFull;
+        std::deque<T> items;
+        bool closed = false;
+    };
+}
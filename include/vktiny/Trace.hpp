@@ -0,0 +1,67 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+// Records a CPU span for the rest of the enclosing scope. name must be a string literal.
+#define VKT_TRACE_CONCAT_INNER(a, b) a##b
+#define VKT_TRACE_CONCAT(a, b) VKT_TRACE_CONCAT_INNER(a, b)
+#define VKT_TRACE_SCOPE(name) ::vkt::trace::Scope VKT_TRACE_CONCAT(vktTraceScope, __LINE__){ name }
+
+namespace vkt::trace
+{
+    enum class Track : uint32_t
+    {
+        Cpu,
+        Gpu,
+    };
+
+    // Every thread writes spans into its own fixed-size ring without locking.
+    // Old spans are overwritten when a ring is full.
+    void setEnabled(bool enabled);
+
+    inline std::atomic<bool> enabledFlag{ false };
+    inline bool isEnabled() { return enabledFlag.load(std::memory_order_relaxed); }
+
+    // Nanoseconds on the steady clock, the timebase of all spans
+    inline int64_t now()
+    {
+        using namespace std::chrono;
+        return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+    }
+
+    // name must outlive the trace; use intern() for dynamic names
+    void record(const char* name, int64_t beginNs, int64_t endNs, Track track = Track::Cpu);
+    const char* intern(const std::string& name);
+
+    // Chrome trace event JSON, which can also be opened in the Perfetto UI
+    std::string exportChromeTrace();
+    void exportChromeTrace(const std::string& filepath);
+
+    void clear();
+
+    class Scope
+    {
+    public:
+        explicit Scope(const char* name)
+            : name(name)
+            , begin(isEnabled() ? now() : 0)
+        {
+        }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+        ~Scope()
+        {
+            if (begin != 0) {
+                record(name, begin, now());
+            }
+        }
+
+    private:
+        const char* name;
+        int64_t begin;
+    };
+}
@@ -0,0 +1,74 @@
+#pragma once
+#include "GltfLoader.hpp"
+#include <vulkan/vulkan.hpp>
+#include <string>
+
+namespace vkt
+{
+    enum class PositionFormat : uint32_t
+    {
+        Float32, // 12 bytes
+        Snorm16, // 8 bytes, xyz relative to the mesh bounds plus padding
+    };
+
+    enum class NormalFormat : uint32_t
+    {
+        Float32,      // 12 bytes
+        Octahedral16, // 4 bytes, two snorm16 components
+    };
+
+    enum class TexCoordFormat : uint32_t
+    {
+        Float32, // 8 bytes
+        Float16, // 4 bytes
+    };
+
+    // Attributes are tightly packed in the order position, normal, texCoord.
+    // The default layout is 16 bytes per vertex, half of vkt::Vertex.
+    struct VertexLayout
+    {
+        PositionFormat position = PositionFormat::Snorm16;
+        NormalFormat normal = NormalFormat::Octahedral16;
+        TexCoordFormat texCoord = TexCoordFormat::Float16;
+
+        uint32_t getStride() const;
+        uint32_t getNormalOffset() const;
+        uint32_t getTexCoordOffset() const;
+
+        // Also the vertex format of acceleration structure geometry
+        vk::Format getPositionFormat() const;
+
+        std::vector<vk::VertexInputAttributeDescription> getAttributes(uint32_t binding = 0) const;
+    };
+
+    // Quantized positions decode to offset + scale * p with p in [-1, 1]
+    struct VertexQuantization
+    {
+        std::array<float, 3> offset{};
+        std::array<float, 3> scale{ 1.0f, 1.0f, 1.0f };
+    };
+
+    struct QuantizedMesh
+    {
+        std::vector<uint8_t> vertexData;
+        std::vector<uint8_t> indexData;
+        VertexQuantization quantization;
+    };
+
+    // Scalar reference encoders, round to nearest even like the SIMD paths
+    uint16_t encodeHalf(float value);
+    std::array<int16_t, 2> encodeOctahedral(const std::array<float, 3>& normal);
+
+    // Convert vertices to the layout and indices to the index type, which may only be
+    // eUint16 if vertexCount <= 65536. Uses SSE2 or NEON where available.
+    QuantizedMesh quantizeMesh(const Vertex* vertices, uint32_t vertexCount,
+                               const uint32_t* indices, uint32_t indexCount,
+                               const VertexLayout& layout, vk::IndexType indexType = vk::IndexType::eUint32);
+
+    // GLSL declarations for reading the layout from a buffer:
+    //   struct VktPackedVertex { uint words[stride / 4]; };
+    //   vec3 vktDecodePosition(VktPackedVertex v, vec3 offset, vec3 scale);
+    //   vec3 vktDecodeNormal(VktPackedVertex v);
+    //   vec2 vktDecodeTexCoord(VktPackedVertex v);
+    std::string getVertexDecodeGlsl(const VertexLayout& layout);
+}
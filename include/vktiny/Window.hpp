@@ -9,11 +9,11 @@ namespace vkt
     class Window
     {
     public:
-        Window(int width, int height, const std::string& title = {})
+        Window(int width, int height, const std::string& title = {}, bool resizable = true)
         {
             glfwInit();
             glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
-            glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
+            glfwWindowHint(GLFW_RESIZABLE, resizable ? GLFW_TRUE : GLFW_FALSE);
             window = glfwCreateWindow(width, height, title.c_str(), nullptr, nullptr);
         }
 
@@ -49,6 +49,23 @@ namespace vkt
             glfwPollEvents();
         }
 
+        vk::Extent2D getFramebufferSize() const
+        {
+            int width, height;
+            glfwGetFramebufferSize(window, &width, &height);
+            return { static_cast<uint32_t>(width), static_cast<uint32_t>(height) };
+        }
+
+        // A swapchain can't be created with a zero extent, so block while minimized
+        void waitWhileMinimized() const
+        {
+            vk::Extent2D size = getFramebufferSize();
+            while ((size.width == 0 || size.height == 0) && !shouldClose()) {
+                glfwWaitEvents();
+                size = getFramebufferSize();
+            }
+        }
+
     private:
         GLFWwindow* window;
     };
@@ -4,7 +4,25 @@
 
 #include "vktiny/Context.hpp"
 #include "vktiny/Image.hpp"
+#include "vktiny/Ktx2.hpp"
 #include "vktiny/Pipeline.hpp"
+#include "vktiny/ComputeJob.hpp"
+#include "vktiny/GeometryPool.hpp"
+#include "vktiny/MeshOptimizer.hpp"
+#include "vktiny/Scene.hpp"
+#include "vktiny/SceneCache.hpp"
+#include "vktiny/AccelStruct.hpp"
+#include "vktiny/TextureLoader.hpp"
+#include "vktiny/TextureStreamer.hpp"
+#include "vktiny/VertexFormat.hpp"
+#include "vktiny/ThreadPool.hpp"
 #include "vktiny/Swapchain.hpp"
+#include "vktiny/OffscreenSwapchain.hpp"
+#include "vktiny/Readback.hpp"
+#include "vktiny/GpuProfiler.hpp"
+#include "vktiny/Trace.hpp"
+#include "vktiny/DriverStats.hpp"
+#include "vktiny/Log.hpp"
+#include "vktiny/NullBackend.hpp"
 #include "vktiny/DescriptorPool.hpp"
 #include "vktiny/DescriptorSetLayout.hpp"
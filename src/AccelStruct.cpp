@@ -0,0 +1,476 @@
+#include "vktiny/AccelStruct.hpp"
+#include "vktiny/Scene.hpp"
+#include "vktiny/CommandBuffer.hpp"
+#include "vktiny/Trace.hpp"
+#include "vktiny/Log.hpp"
+#include <algorithm>
+
+namespace vkt
+{
+    namespace
+    {
+        // Acceleration structure offsets in their buffer must be multiples of 256
+        constexpr vk::DeviceSize accelStructAlignment = 256;
+
+        vk::DeviceSize alignUp(vk::DeviceSize value, vk::DeviceSize alignment)
+        {
+            return (value + alignment - 1) / alignment * alignment;
+        }
+
+        vk::DeviceSize getScratchAlignment(const Context& context)
+        {
+            auto properties = context.getPhysicalDevice().getProperties2<
+                vk::PhysicalDeviceProperties2, vk::PhysicalDeviceAccelerationStructurePropertiesKHR>();
+            return properties.get<vk::PhysicalDeviceAccelerationStructurePropertiesKHR>()
+                .minAccelerationStructureScratchOffsetAlignment;
+        }
+
+        // Builds have finished writing before structures are read or scratch memory is reused
+        void buildBarrier(const CommandBuffer& cmdBuf)
+        {
+            using vkPS = vk::PipelineStageFlagBits;
+            using vkAF = vk::AccessFlagBits;
+            cmdBuf.memoryBarrier(vkPS::eAccelerationStructureBuildKHR, vkAF::eAccelerationStructureWriteKHR,
+                                 vkPS::eAccelerationStructureBuildKHR,
+                                 vkAF::eAccelerationStructureReadKHR | vkAF::eAccelerationStructureWriteKHR);
+        }
+
+        vk::AabbPositionsKHR transformBounds(const vk::AabbPositionsKHR& bounds, const vk::TransformMatrixKHR& transform)
+        {
+            const float lower[3] = { bounds.minX, bounds.minY, bounds.minZ };
+            const float upper[3] = { bounds.maxX, bounds.maxY, bounds.maxZ };
+            float min[3];
+            float max[3];
+            for (int row = 0; row < 3; row++) {
+                min[row] = max[row] = transform.matrix[row][3];
+                for (int column = 0; column < 3; column++) {
+                    float a = transform.matrix[row][column] * lower[column];
+                    float b = transform.matrix[row][column] * upper[column];
+                    min[row] += std::min(a, b);
+                    max[row] += std::max(a, b);
+                }
+            }
+            return { min[0], min[1], min[2], max[0], max[1], max[2] };
+        }
+
+        vk::AabbPositionsKHR merge(const vk::AabbPositionsKHR& a, const vk::AabbPositionsKHR& b)
+        {
+            return { std::min(a.minX, b.minX), std::min(a.minY, b.minY), std::min(a.minZ, b.minZ),
+                     std::max(a.maxX, b.maxX), std::max(a.maxY, b.maxY), std::max(a.maxZ, b.maxZ) };
+        }
+
+        // Half the surface area, which is proportional to the cost of traversing the box
+        double getArea(const vk::AabbPositionsKHR& bounds)
+        {
+            double x = std::max(bounds.maxX - bounds.minX, 0.0f);
+            double y = std::max(bounds.maxY - bounds.minY, 0.0f);
+            double z = std::max(bounds.maxZ - bounds.minZ, 0.0f);
+            return x * y + y * z + z * x;
+        }
+
+        vk::AccelerationStructureGeometryKHR getInstancesGeometry(vk::DeviceAddress address)
+        {
+            vk::AccelerationStructureGeometryInstancesDataKHR instancesData;
+            instancesData.setArrayOfPointers(false);
+            instancesData.setData(address);
+
+            vk::AccelerationStructureGeometryKHR geometry;
+            geometry.setGeometryType(vk::GeometryTypeKHR::eInstances);
+            geometry.setGeometry({ instancesData });
+            return geometry;
+        }
+    }
+
+    std::vector<BlasGeometry> getBlasGeometries(const Scene& scene, vk::Format positionFormat)
+    {
+        const GeometryPool& pool = scene.getGeometryPool();
+        vk::DeviceAddress vertexBase = pool.getVertexBuffer().getDeviceAddress();
+        vk::DeviceAddress indexBase = pool.getIndexBuffer().getDeviceAddress();
+        const std::vector<Material>& materials = scene.getMaterials();
+
+        std::vector<BlasGeometry> geometries;
+        for (const Mesh& mesh : scene.getMeshes()) {
+            const GeometryRange& range = pool.getRange(mesh.getGeometryId());
+            BlasGeometry& geometry = geometries.emplace_back();
+            geometry.vertexAddress = vertexBase + vk::DeviceSize{ pool.getVertexStride() } * range.vertexOffset;
+            geometry.vertexStride = pool.getVertexStride();
+            geometry.vertexFormat = positionFormat;
+            geometry.maxVertex = std::max(range.vertexCount, 1u) - 1;
+            geometry.indexAddress = indexBase + vk::DeviceSize{ pool.getIndexSize() } * range.indexOffset;
+            geometry.indexType = pool.getIndexType();
+            geometry.triangleCount = mesh.getIndexCount() / 3;
+
+            int32_t material = mesh.getMaterialIndex();
+            geometry.opaque = material < 0 || material >= static_cast<int32_t>(materials.size()) ||
+                              materials[material].alphaMode == AlphaMode::Opaque;
+        }
+        return geometries;
+    }
+
+    BlasPool::BlasPool(const Context& context, std::span<const BlasGeometry> geometries, const BlasPoolCreateInfo& info)
+        : context(&context)
+    {
+        VKT_TRACE_SCOPE("BlasPool");
+        if (geometries.empty()) {
+            return;
+        }
+        using vkBF = vk::BuildAccelerationStructureFlagBitsKHR;
+        vk::Device device = context.getDevice();
+        const vk::DispatchLoaderDynamic& dispatcher = context.getDispatcher();
+        size_t count = geometries.size();
+
+        // The build infos point into the geometry array, so it is sized up front
+        std::vector<vk::AccelerationStructureGeometryKHR> asGeometries(count);
+        std::vector<vk::AccelerationStructureBuildGeometryInfoKHR> buildInfos(count);
+        std::vector<vk::AccelerationStructureBuildRangeInfoKHR> ranges(count);
+        std::vector<vk::DeviceSize> buildSizes(count);
+        std::vector<vk::DeviceSize> scratchSizes(count);
+        vk::DeviceSize scratchAlignment = getScratchAlignment(context);
+        for (size_t i = 0; i < count; i++) {
+            const BlasGeometry& geometry = geometries[i];
+            vk::AccelerationStructureGeometryTrianglesDataKHR triangles;
+            triangles.setVertexFormat(geometry.vertexFormat);
+            triangles.setVertexData(geometry.vertexAddress);
+            triangles.setVertexStride(geometry.vertexStride);
+            triangles.setMaxVertex(geometry.maxVertex);
+            triangles.setIndexType(geometry.indexType);
+            triangles.setIndexData(geometry.indexAddress);
+            triangles.setTransformData(geometry.transformAddress);
+
+            asGeometries[i].setGeometryType(vk::GeometryTypeKHR::eTriangles);
+            asGeometries[i].setGeometry({ triangles });
+            if (geometry.opaque) {
+                asGeometries[i].setFlags(vk::GeometryFlagBitsKHR::eOpaque);
+            }
+
+            buildInfos[i].setType(vk::AccelerationStructureTypeKHR::eBottomLevel);
+            buildInfos[i].setFlags(info.compact ? info.flags | vkBF::eAllowCompaction : info.flags);
+            buildInfos[i].setMode(vk::BuildAccelerationStructureModeKHR::eBuild);
+            buildInfos[i].setGeometries(asGeometries[i]);
+            ranges[i].setPrimitiveCount(geometry.triangleCount);
+
+            auto sizes = device.getAccelerationStructureBuildSizesKHR(
+                vk::AccelerationStructureBuildTypeKHR::eDevice, buildInfos[i], geometry.triangleCount, dispatcher);
+            buildSizes[i] = sizes.accelerationStructureSize;
+            scratchSizes[i] = alignUp(sizes.buildScratchSize, scratchAlignment);
+        }
+        allocate(buildSizes);
+        uncompactedSize = size;
+        for (size_t i = 0; i < count; i++) {
+            buildInfos[i].setDstAccelerationStructure(*accelStructs[i]);
+        }
+
+        // Batches of builds that fit the scratch buffer together
+        vk::DeviceSize scratchCapacity = std::max(info.scratchSize, *std::max_element(scratchSizes.begin(),
+                                                                                       scratchSizes.end()));
+        using vkBU = vk::BufferUsageFlagBits;
+        Buffer scratchBuffer{ context, scratchCapacity + scratchAlignment,
+                              vkBU::eStorageBuffer | vkBU::eShaderDeviceAddress,
+                              vk::MemoryPropertyFlagBits::eDeviceLocal };
+        vk::DeviceAddress scratchBase = alignUp(scratchBuffer.getDeviceAddress(), scratchAlignment);
+        std::vector<size_t> batchStarts;
+        vk::DeviceSize scratchOffset = scratchCapacity;
+        for (size_t i = 0; i < count; i++) {
+            if (scratchOffset + scratchSizes[i] > scratchCapacity) {
+                batchStarts.push_back(i);
+                scratchOffset = 0;
+            }
+            buildInfos[i].setScratchData(scratchBase + scratchOffset);
+            scratchOffset += scratchSizes[i];
+        }
+        batchStarts.push_back(count);
+
+        vk::UniqueQueryPool queryPool;
+        if (info.compact) {
+            queryPool = device.createQueryPoolUnique(
+                { {}, vk::QueryType::eAccelerationStructureCompactedSizeKHR, static_cast<uint32_t>(count) }, nullptr,
+                dispatcher);
+        }
+        std::vector<const vk::AccelerationStructureBuildRangeInfoKHR*> rangePointers;
+        for (const vk::AccelerationStructureBuildRangeInfoKHR& range : ranges) {
+            rangePointers.push_back(&range);
+        }
+        std::vector<vk::AccelerationStructureKHR> handles;
+        for (const vk::UniqueAccelerationStructureKHR& accelStruct : accelStructs) {
+            handles.push_back(*accelStruct);
+        }
+        context.OneTimeSubmitGraphics([&](const CommandBuffer& cmdBuf) {
+            vk::CommandBuffer commandBuffer = cmdBuf.get();
+            for (size_t batch = 0; batch + 1 < batchStarts.size(); batch++) {
+                size_t first = batchStarts[batch];
+                auto batchSize = static_cast<uint32_t>(batchStarts[batch + 1] - first);
+                if (batch > 0) {
+                    buildBarrier(cmdBuf);
+                }
+                commandBuffer.buildAccelerationStructuresKHR(
+                    vk::ArrayProxy<const vk::AccelerationStructureBuildGeometryInfoKHR>{ batchSize, &buildInfos[first] },
+                    vk::ArrayProxy<const vk::AccelerationStructureBuildRangeInfoKHR* const>{ batchSize,
+                                                                                             &rangePointers[first] },
+                    dispatcher);
+            }
+            if (info.compact) {
+                buildBarrier(cmdBuf);
+                commandBuffer.resetQueryPool(*queryPool, 0, static_cast<uint32_t>(count), dispatcher);
+                commandBuffer.writeAccelerationStructuresPropertiesKHR(
+                    handles, vk::QueryType::eAccelerationStructureCompactedSizeKHR, *queryPool, 0, dispatcher);
+            }
+        });
+        if (!info.compact) {
+            log::info("built {} BLASes in {} batches, {} KiB", count, batchStarts.size() - 1, size / 1024);
+            return;
+        }
+
+        // Copy into structures of the compacted sizes, then release the build buffer
+        std::vector<vk::DeviceSize> compactedSizes =
+            device.getQueryPoolResults<vk::DeviceSize>(*queryPool, 0, static_cast<uint32_t>(count),
+                                                       count * sizeof(vk::DeviceSize), sizeof(vk::DeviceSize),
+                                                       vk::QueryResultFlagBits::e64 | vk::QueryResultFlagBits::eWait,
+                                                       dispatcher)
+                .value;
+        std::optional<Buffer> buildBuffer = std::move(buffer);
+        std::vector<vk::UniqueAccelerationStructureKHR> built = std::move(accelStructs);
+        allocate(compactedSizes);
+        context.OneTimeSubmitGraphics([&](const CommandBuffer& cmdBuf) {
+            for (size_t i = 0; i < count; i++) {
+                cmdBuf.get().copyAccelerationStructureKHR(
+                    { *built[i], *accelStructs[i], vk::CopyAccelerationStructureModeKHR::eCompact }, dispatcher);
+            }
+        });
+        log::info("built {} BLASes in {} batches, compacted {} KiB to {} KiB", count, batchStarts.size() - 1,
+                  uncompactedSize / 1024, size / 1024);
+    }
+
+    void BlasPool::allocate(const std::vector<vk::DeviceSize>& sizes)
+    {
+        std::vector<vk::DeviceSize> offsets;
+        size = 0;
+        for (vk::DeviceSize structSize : sizes) {
+            offsets.push_back(size);
+            size += alignUp(structSize, accelStructAlignment);
+        }
+        using vkBU = vk::BufferUsageFlagBits;
+        buffer.emplace(*context, size, vkBU::eAccelerationStructureStorageKHR | vkBU::eShaderDeviceAddress,
+                       vk::MemoryPropertyFlagBits::eDeviceLocal);
+
+        vk::Device device = context->getDevice();
+        const vk::DispatchLoaderDynamic& dispatcher = context->getDispatcher();
+        accelStructs.clear();
+        addresses.clear();
+        for (size_t i = 0; i < sizes.size(); i++) {
+            accelStructs.push_back(device.createAccelerationStructureKHRUnique(
+                { {}, buffer->get(), offsets[i], sizes[i], vk::AccelerationStructureTypeKHR::eBottomLevel }, nullptr,
+                dispatcher));
+            addresses.push_back(device.getAccelerationStructureAddressKHR({ *accelStructs.back() }, dispatcher));
+        }
+    }
+
+    TlasManager::TlasManager(const Context& context, const TlasManagerCreateInfo& info)
+        : context(&context)
+        , info(info)
+        , scratchAlignment(getScratchAlignment(context))
+        , pendingFrames(info.maxInstances)
+    {
+        // Sizes for the full capacity also hold any smaller instance count
+        vk::AccelerationStructureGeometryKHR geometry = getInstancesGeometry(0);
+        vk::AccelerationStructureBuildGeometryInfoKHR buildInfo;
+        buildInfo.setType(vk::AccelerationStructureTypeKHR::eTopLevel);
+        buildInfo.setFlags(info.flags | vk::BuildAccelerationStructureFlagBitsKHR::eAllowUpdate);
+        buildInfo.setGeometries(geometry);
+        vk::Device device = context.getDevice();
+        const vk::DispatchLoaderDynamic& dispatcher = context.getDispatcher();
+        auto sizes = device.getAccelerationStructureBuildSizesKHR(vk::AccelerationStructureBuildTypeKHR::eDevice,
+                                                                  buildInfo, info.maxInstances, dispatcher);
+        vk::DeviceSize scratchSize = std::max(sizes.buildScratchSize, sizes.updateScratchSize);
+
+        using vkBU = vk::BufferUsageFlagBits;
+        using vkMP = vk::MemoryPropertyFlagBits;
+        for (uint32_t i = 0; i < info.frameCount; i++) {
+            Frame frame{
+                Buffer{ context, sizeof(vk::AccelerationStructureInstanceKHR) * std::max(info.maxInstances, 1u),
+                        vkBU::eAccelerationStructureBuildInputReadOnlyKHR | vkBU::eShaderDeviceAddress,
+                        vkMP::eHostVisible | vkMP::eHostCoherent },
+                Buffer{ context, sizes.accelerationStructureSize,
+                        vkBU::eAccelerationStructureStorageKHR | vkBU::eShaderDeviceAddress, vkMP::eDeviceLocal },
+                Buffer{ context, scratchSize + scratchAlignment, vkBU::eStorageBuffer | vkBU::eShaderDeviceAddress,
+                        vkMP::eDeviceLocal },
+            };
+            frame.instanceBuffer.map();
+            frame.accelStruct = device.createAccelerationStructureKHRUnique(
+                { {}, frame.accelStructBuffer.get(), 0, sizes.accelerationStructureSize,
+                  vk::AccelerationStructureTypeKHR::eTopLevel }, nullptr, dispatcher);
+            frame.address = device.getAccelerationStructureAddressKHR({ *frame.accelStruct }, dispatcher);
+            frames.push_back(std::move(frame));
+        }
+    }
+
+    uint32_t TlasManager::addInstance(const TlasInstance& instance)
+    {
+        if (instances.size() >= info.maxInstances) {
+            throw std::runtime_error("TlasManager: more than " + std::to_string(info.maxInstances) + " instances");
+        }
+        uint32_t id;
+        if (freeIds.empty()) {
+            id = static_cast<uint32_t>(slotOfId.size());
+            slotOfId.push_back(0);
+        } else {
+            id = freeIds.back();
+            freeIds.pop_back();
+        }
+        auto slot = static_cast<uint32_t>(instances.size());
+        slotOfId[id] = slot;
+        idOfSlot.push_back(id);
+        instances.emplace_back();
+        localBounds.emplace_back();
+        worldBounds.emplace_back();
+        rebuildBounds.emplace_back();
+        setInstance(id, instance);
+        rebuildRequested = true;
+        return id;
+    }
+
+    void TlasManager::removeInstance(uint32_t id)
+    {
+        // The last instance fills the gap so that the buffers stay dense
+        uint32_t slot = getSlot(id);
+        auto last = static_cast<uint32_t>(instances.size() - 1);
+        if (slot != last) {
+            instances[slot] = instances[last];
+            localBounds[slot] = localBounds[last];
+            worldBounds[slot] = worldBounds[last];
+            rebuildBounds[slot] = rebuildBounds[last];
+            idOfSlot[slot] = idOfSlot[last];
+            slotOfId[idOfSlot[slot]] = slot;
+            markDirty(slot);
+        }
+        instances.pop_back();
+        localBounds.pop_back();
+        worldBounds.pop_back();
+        rebuildBounds.pop_back();
+        idOfSlot.pop_back();
+        slotOfId[id] = removedSlot;
+        freeIds.push_back(id);
+        rebuildRequested = true;
+    }
+
+    void TlasManager::setInstance(uint32_t id, const TlasInstance& instance)
+    {
+        uint32_t slot = getSlot(id);
+        vk::AccelerationStructureInstanceKHR& target = instances[slot];
+        bool blasChanged = target.accelerationStructureReference != instance.blasAddress;
+        target.setTransform(instance.transform);
+        target.setInstanceCustomIndex(instance.customIndex);
+        target.setMask(instance.mask);
+        target.setInstanceShaderBindingTableRecordOffset(instance.sbtRecordOffset);
+        target.setFlags(instance.flags);
+        target.setAccelerationStructureReference(instance.blasAddress);
+        localBounds[slot] = instance.bounds;
+        updateBounds(slot);
+        markDirty(slot);
+
+        // A refit only moves the existing instances' boxes
+        if (blasChanged) {
+            rebuildRequested = true;
+        }
+    }
+
+    void TlasManager::setTransform(uint32_t id, const vk::TransformMatrixKHR& transform)
+    {
+        uint32_t slot = getSlot(id);
+        instances[slot].setTransform(transform);
+        updateBounds(slot);
+        markDirty(slot);
+    }
+
+    void TlasManager::update(const CommandBuffer& cmdBuf, uint32_t frame)
+    {
+        VKT_TRACE_SCOPE("TlasManager::update");
+        Frame& target = frames[frame];
+
+        // Copy the changes this frame's buffer has not seen yet
+        auto* mapped = static_cast<vk::AccelerationStructureInstanceKHR*>(target.instanceBuffer.map());
+        bool changed = false;
+        size_t kept = 0;
+        for (uint32_t slot : dirtySlots) {
+            if (slot < instances.size()) {
+                mapped[slot] = instances[slot];
+                changed = true;
+            }
+            if (--pendingFrames[slot] > 0) {
+                dirtySlots[kept++] = slot;
+            }
+        }
+        dirtySlots.resize(kept);
+
+        // Without bounds the instances' boxes have no area to compare, so only maxRefits applies
+        bool drifted = rebuildArea > 0.0 && driftArea > info.maxBoundsGrowth * rebuildArea;
+        if (rebuildRequested || drifted) {
+            beginRebuild();
+        }
+        bool rebuild = target.builtVersion != version || (changed && target.refitCount >= info.maxRefits);
+        if (!rebuild && !changed) {
+            return;
+        }
+
+        vk::AccelerationStructureGeometryKHR geometry = getInstancesGeometry(target.instanceBuffer.getDeviceAddress());
+        vk::AccelerationStructureBuildGeometryInfoKHR buildInfo;
+        buildInfo.setType(vk::AccelerationStructureTypeKHR::eTopLevel);
+        buildInfo.setFlags(info.flags | vk::BuildAccelerationStructureFlagBitsKHR::eAllowUpdate);
+        buildInfo.setMode(rebuild ? vk::BuildAccelerationStructureModeKHR::eBuild
+                                  : vk::BuildAccelerationStructureModeKHR::eUpdate);
+        buildInfo.setSrcAccelerationStructure(rebuild ? vk::AccelerationStructureKHR{} : *target.accelStruct);
+        buildInfo.setDstAccelerationStructure(*target.accelStruct);
+        buildInfo.setGeometries(geometry);
+        buildInfo.setScratchData(alignUp(target.scratchBuffer.getDeviceAddress(), scratchAlignment));
+
+        vk::AccelerationStructureBuildRangeInfoKHR range;
+        range.setPrimitiveCount(getInstanceCount());
+        const vk::AccelerationStructureBuildRangeInfoKHR* rangePointer = &range;
+        cmdBuf.get().buildAccelerationStructuresKHR(buildInfo, rangePointer, cmdBuf.getDispatcher());
+        cmdBuf.memoryBarrier(vk::PipelineStageFlagBits::eAccelerationStructureBuildKHR,
+                             vk::AccessFlagBits::eAccelerationStructureWriteKHR, info.stages,
+                             vk::AccessFlagBits::eAccelerationStructureReadKHR);
+
+        if (rebuild) {
+            target.builtVersion = version;
+            target.refitCount = 0;
+        } else {
+            target.refitCount++;
+        }
+    }
+
+    uint32_t TlasManager::getSlot(uint32_t id) const
+    {
+        if (id >= slotOfId.size() || slotOfId[id] == removedSlot) {
+            throw std::runtime_error("TlasManager: no instance with id " + std::to_string(id));
+        }
+        return slotOfId[id];
+    }
+
+    void TlasManager::markDirty(uint32_t slot)
+    {
+        if (pendingFrames[slot] == 0) {
+            dirtySlots.push_back(slot);
+        }
+        pendingFrames[slot] = info.frameCount;
+    }
+
+    void TlasManager::updateBounds(uint32_t slot)
+    {
+        driftArea -= getArea(merge(worldBounds[slot], rebuildBounds[slot]));
+        worldBounds[slot] = transformBounds(localBounds[slot], instances[slot].transform);
+        driftArea += getArea(merge(worldBounds[slot], rebuildBounds[slot]));
+    }
+
+    void TlasManager::beginRebuild()
+    {
+        // Every frame rebuilds on its next update. Drift is measured from the bounds as they are now.
+        version++;
+        rebuildRequested = false;
+        rebuildBounds = worldBounds;
+        rebuildArea = 0.0;
+        for (const vk::AabbPositionsKHR& bounds : worldBounds) {
+            rebuildArea += getArea(bounds);
+        }
+        driftArea = rebuildArea;
+    }
+}
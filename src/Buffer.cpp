@@ -1,4 +1,6 @@
 #include "vktiny/Buffer.hpp"
+#include "vktiny/Readback.hpp"
+#include "vktiny/DriverStats.hpp"
 
 namespace vkt
 {
@@ -20,19 +22,37 @@ namespace vkt
     void Buffer::copy(void* data)
     {
         if (!mapped) {
-            mapped = context->getDevice().mapMemory(*memory, 0, size);
+            mapped = context->getDevice().mapMemory(*memory, 0, size, {}, context->getDispatcher());
         }
         memcpy(mapped, data, static_cast<size_t>(size));
     }
 
+    ReadbackFuture Buffer::readback(ReadbackRing& ring, const CommandBuffer& cmdBuf, vk::Fence fence) const
+    {
+        using vkPS = vk::PipelineStageFlagBits;
+        using vkAF = vk::AccessFlagBits;
+        ReadbackFuture future = ring.allocate(size, fence);
+        cmdBuf.copyBuffer(*buffer, ring.getBuffer(), { 0, future.getOffset(), size });
+        cmdBuf.memoryBarrier(vkPS::eTransfer, vkAF::eTransferWrite, vkPS::eHost, vkAF::eHostRead);
+        return future;
+    }
+
+    ReadbackFuture Buffer::readback(ReadbackRing& ring) const
+    {
+        return ring.submit(
+            [&](const CommandBuffer& cmdBuf, vk::Fence fence) {
+                return readback(ring, cmdBuf, fence);
+            });
+    }
+
     void Buffer::create(vk::DeviceSize size, vk::BufferUsageFlags usage)
     {
-        buffer = context->getDevice().createBufferUnique({ {}, size, usage });
+        buffer = context->getDevice().createBufferUnique({ {}, size, usage }, nullptr, context->getDispatcher());
     }
 
     void Buffer::allocate(vk::BufferUsageFlags usage, vk::MemoryPropertyFlags properties)
     {
-        auto requirements = context->getDevice().getBufferMemoryRequirements(*buffer);
+        auto requirements = context->getDevice().getBufferMemoryRequirements(*buffer, context->getDispatcher());
         auto memoryTypeIndex = context->findMemoryType(
             requirements.memoryTypeBits, properties);
         vk::MemoryAllocateInfo allocInfo{ requirements.size, memoryTypeIndex };
@@ -41,14 +61,17 @@ namespace vkt
             vk::MemoryAllocateFlagsInfo flagsInfo{ vk::MemoryAllocateFlagBits::eDeviceAddress };
             allocInfo.pNext = &flagsInfo;
 
-            memory = context->getDevice().allocateMemoryUnique(allocInfo);
-            context->getDevice().bindBufferMemory(*buffer, *memory, 0);
+            memory = context->getDevice().allocateMemoryUnique(allocInfo, nullptr, context->getDispatcher());
+            stats::increment(stats::Counter::AllocateMemory);
+            context->getDevice().bindBufferMemory(*buffer, *memory, 0, context->getDispatcher());
 
             vk::BufferDeviceAddressInfoKHR bufferDeviceAddressInfo{ *buffer };
-            deviceAddress = context->getDevice().getBufferAddressKHR(&bufferDeviceAddressInfo);
+            deviceAddress = context->getDevice().getBufferAddressKHR(&bufferDeviceAddressInfo,
+                                                                     context->getDispatcher());
         } else {
-            memory = context->getDevice().allocateMemoryUnique(allocInfo);
-            context->getDevice().bindBufferMemory(*buffer, *memory, 0);
+            memory = context->getDevice().allocateMemoryUnique(allocInfo, nullptr, context->getDispatcher());
+            stats::increment(stats::Counter::AllocateMemory);
+            context->getDevice().bindBufferMemory(*buffer, *memory, 0, context->getDispatcher());
         }
     }
 
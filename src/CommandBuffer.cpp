@@ -1,31 +1,47 @@
 #include "vktiny/Context.hpp"
 #include "vktiny/CommandBuffer.hpp"
+#include "vktiny/Trace.hpp"
+#include "vktiny/DriverStats.hpp"
 
 namespace vkt
 {
-    CommandBuffer::CommandBuffer(vk::Device device, vk::CommandPool commandPool, vk::Queue queue)
+    CommandBuffer::CommandBuffer(vk::Device device, vk::CommandPool commandPool, vk::Queue queue,
+                                 const vk::DispatchLoaderDynamic& dispatcher)
+        : dispatcher(&dispatcher)
     {
         this->queue = queue;
         vk::CommandBufferAllocateInfo allocInfo;
         allocInfo.setCommandPool(commandPool);
         allocInfo.setCommandBufferCount(1);
-        commandBuffer = std::move(device.allocateCommandBuffersUnique(allocInfo).front());
+        commandBuffer = std::move(device.allocateCommandBuffersUnique(allocInfo, dispatcher).front());
     }
 
     void CommandBuffer::begin(vk::CommandBufferBeginInfo beginInfo) const
     {
-        commandBuffer->begin(beginInfo);
+        commandBuffer->begin(beginInfo, *dispatcher);
     }
 
     void CommandBuffer::end() const
     {
-        commandBuffer->end();
+        commandBuffer->end(*dispatcher);
     }
 
-    void CommandBuffer::submit() const
+    void CommandBuffer::submit(std::source_location location) const
     {
+        VKT_TRACE_SCOPE("OneTimeSubmit");
         vk::SubmitInfo submitInfo{ nullptr, nullptr, *commandBuffer };
-        queue.submit(submitInfo, nullptr);
-        queue.waitIdle();
+        queue.submit(submitInfo, nullptr, *dispatcher);
+        stats::increment(stats::Counter::QueueSubmit);
+
+        stats::WaitScope waitScope{ stats::Counter::WaitIdle, location };
+        queue.waitIdle(*dispatcher);
+    }
+
+    void CommandBuffer::submit(vk::Fence fence) const
+    {
+        VKT_TRACE_SCOPE("Submit");
+        vk::SubmitInfo submitInfo{ nullptr, nullptr, *commandBuffer };
+        queue.submit(submitInfo, fence, *dispatcher);
+        stats::increment(stats::Counter::QueueSubmit);
     }
 }
@@ -0,0 +1,282 @@
+#include "vktiny/ComputeJob.hpp"
+#include "vktiny/Context.hpp"
+#include "vktiny/Buffer.hpp"
+#include "vktiny/Image.hpp"
+#include "vktiny/Trace.hpp"
+#include "vktiny/DriverStats.hpp"
+
+namespace vkt
+{
+    namespace
+    {
+        std::vector<vk::DescriptorSetLayoutBinding> getLayoutBindings(const ShaderReflection& reflection)
+        {
+            std::vector<vk::DescriptorSetLayoutBinding> layoutBindings;
+            for (const ShaderBinding& binding : reflection.bindings) {
+                layoutBindings.push_back({ binding.binding, binding.type, binding.count,
+                                           vk::ShaderStageFlagBits::eCompute });
+            }
+            return layoutBindings;
+        }
+
+        template <typename Handle>
+        uint64_t toKey(Handle handle)
+        {
+            return reinterpret_cast<uint64_t>(static_cast<typename Handle::CType>(handle));
+        }
+
+        // Uniform buffers and sampled images are read only whatever the shader declares
+        bool isWrite(const ShaderBinding& binding)
+        {
+            switch (binding.type) {
+            case vk::DescriptorType::eStorageBuffer:
+            case vk::DescriptorType::eStorageBufferDynamic:
+            case vk::DescriptorType::eStorageImage:
+            case vk::DescriptorType::eStorageTexelBuffer:
+                return !binding.readonly;
+            default:
+                return false;
+            }
+        }
+    }
+
+    ComputeKernel::ComputeKernel(const Context& context, const std::string& shaderText)
+        : reflection(compile(shaderText, shaderSPV))
+        , shaderModule(context, shaderSPV)
+        , descSetLayout(context, getLayoutBindings(reflection))
+        , pipeline(context, descSetLayout, shaderModule)
+    {
+        for (uint32_t i = 0; i < reflection.bindings.size(); i++) {
+            bindingIndices[reflection.bindings[i].name] = i;
+        }
+    }
+
+    ShaderReflection ComputeKernel::compile(const std::string& shaderText, std::vector<unsigned int>& shaderSPV)
+    {
+        ShaderReflection reflection;
+        shaderSPV = compileToSPV(vk::ShaderStageFlagBits::eCompute, shaderText, &reflection);
+        return reflection;
+    }
+
+    const ShaderBinding& ComputeKernel::getBinding(const std::string& name) const
+    {
+        auto it = bindingIndices.find(name);
+        if (it == bindingIndices.end()) {
+            throw std::runtime_error("compute kernel has no resource named " + name);
+        }
+        return reflection.bindings[it->second];
+    }
+
+    ComputeJob::ComputeJob(const ComputeKernel& kernel, uint32_t sizeX, uint32_t sizeY, uint32_t sizeZ)
+        : kernel(&kernel)
+        , size{ sizeX, sizeY, sizeZ }
+    {
+        resources.reserve(kernel.getBindings().size());
+    }
+
+    ComputeJob& ComputeJob::bind(const std::string& name, const Buffer& buffer)
+    {
+        const ShaderBinding& binding = kernel->getBinding(name);
+        Resource resource{ &binding, toKey(buffer.get()) };
+        resource.bufferInfo = vk::DescriptorBufferInfo{ buffer.get(), 0, buffer.getSize() };
+        resources.push_back(resource);
+        return *this;
+    }
+
+    ComputeJob& ComputeJob::bind(const std::string& name, const Image& image)
+    {
+        const ShaderBinding& binding = kernel->getBinding(name);
+        Resource resource{ &binding, toKey(image.get()) };
+        resource.imageInfo = vk::DescriptorImageInfo{ image.getSampler(), image.getView(), image.getLayout() };
+        resources.push_back(resource);
+        return *this;
+    }
+
+    std::array<uint32_t, 3> ComputeJob::getGroupCount() const
+    {
+        std::array<uint32_t, 3> localSize = kernel->getLocalSize();
+        std::array<uint32_t, 3> groupCount;
+        for (int i = 0; i < 3; i++) {
+            groupCount[i] = (size[i] + localSize[i] - 1) / localSize[i];
+        }
+        return groupCount;
+    }
+
+    ComputeBatch::ComputeBatch(const Context& context, const ComputeBatchCreateInfo& info)
+        : context(&context)
+        , info(info)
+        , commandBuffer(context.getDevice(), context.getComputeCommandPool(), context.getComputeQueue(),
+                        context.getDispatcher())
+    {
+        std::vector<vk::DescriptorPoolSize> poolSizes;
+        for (vk::DescriptorType type : { vk::DescriptorType::eStorageBuffer,
+                                         vk::DescriptorType::eUniformBuffer,
+                                         vk::DescriptorType::eStorageImage,
+                                         vk::DescriptorType::eSampledImage,
+                                         vk::DescriptorType::eCombinedImageSampler,
+                                         vk::DescriptorType::eSampler,
+                                         vk::DescriptorType::eStorageTexelBuffer,
+                                         vk::DescriptorType::eUniformTexelBuffer }) {
+            poolSizes.push_back({ type, info.maxDescriptorsPerType });
+        }
+
+        // Sets are never freed individually, the whole pool is reset after each submission
+        vk::DescriptorPoolCreateInfo poolInfo;
+        poolInfo.setMaxSets(info.maxJobs);
+        poolInfo.setPoolSizes(poolSizes);
+        descPool = context.getDevice().createDescriptorPoolUnique(poolInfo, nullptr, context.getDispatcher());
+        fence = context.getDevice().createFenceUnique({}, nullptr, context.getDispatcher());
+
+        jobs.reserve(info.maxJobs);
+        setLayouts.reserve(info.maxJobs);
+    }
+
+    ComputeBatch::~ComputeBatch()
+    {
+        if (fence && inFlight) {
+            wait();
+        }
+    }
+
+    void ComputeBatch::add(ComputeJob job, std::source_location location)
+    {
+        if (job.resources.size() != job.kernel->getBindings().size()) {
+            throw std::runtime_error("compute job doesn't bind every resource of its kernel");
+        }
+
+        // The pool is reset per submission, so submit early when a type would run out
+        std::unordered_map<vk::DescriptorType, uint32_t> needed;
+        for (const ShaderBinding& binding : job.kernel->getBindings()) {
+            needed[binding.type] += binding.count;
+        }
+        bool fits = jobs.size() < info.maxJobs;
+        for (const auto& [type, count] : needed) {
+            if (count > info.maxDescriptorsPerType) {
+                throw std::runtime_error("compute job needs " + std::to_string(count) + " descriptors of type " +
+                                         vk::to_string(type) + " but a batch only has " +
+                                         std::to_string(info.maxDescriptorsPerType));
+            }
+            fits = fits && descriptorCounts[type] + count <= info.maxDescriptorsPerType;
+        }
+        if (!fits) {
+            submit(location);
+        }
+        for (const auto& [type, count] : needed) {
+            descriptorCounts[type] += count;
+        }
+        jobs.push_back(std::move(job));
+    }
+
+    void ComputeBatch::submit(std::source_location location)
+    {
+        if (jobs.empty()) {
+            return;
+        }
+        VKT_TRACE_SCOPE("ComputeBatch::submit");
+        if (inFlight) {
+            wait(location);
+        }
+        record();
+        commandBuffer.submit(*fence);
+        inFlight = true;
+        jobs.clear();
+        descriptorCounts.clear();
+    }
+
+    void ComputeBatch::wait(std::source_location location)
+    {
+        if (!inFlight) {
+            return;
+        }
+        VKT_TRACE_SCOPE("ComputeBatch::wait");
+        vk::Device device = context->getDevice();
+        const vk::DispatchLoaderDynamic& dispatcher = context->getDispatcher();
+        {
+            stats::WaitScope waitScope{ stats::Counter::WaitForFences, location };
+            device.waitForFences(*fence, true, UINT64_MAX, dispatcher);
+        }
+        device.resetFences(*fence, dispatcher);
+        device.resetDescriptorPool(*descPool, {}, dispatcher);
+        inFlight = false;
+    }
+
+    void ComputeBatch::record()
+    {
+        vk::Device device = context->getDevice();
+        const vk::DispatchLoaderDynamic& dispatcher = context->getDispatcher();
+
+        // Allocate and write every descriptor set with a single call each
+        setLayouts.clear();
+        for (const ComputeJob& job : jobs) {
+            setLayouts.push_back(job.kernel->getDescriptorSetLayout());
+        }
+        std::vector<vk::DescriptorSet> descSets = device.allocateDescriptorSets({ *descPool, setLayouts }, dispatcher);
+
+        writes.clear();
+        for (size_t i = 0; i < jobs.size(); i++) {
+            for (const ComputeJob::Resource& resource : jobs[i].resources) {
+                vk::WriteDescriptorSet write;
+                write.setDstSet(descSets[i]);
+                write.setDstBinding(resource.binding->binding);
+                write.setDescriptorCount(1);
+                write.setDescriptorType(resource.binding->type);
+                if (resource.bufferInfo.buffer) {
+                    write.setPBufferInfo(&resource.bufferInfo);
+                } else {
+                    write.setPImageInfo(&resource.imageInfo);
+                }
+                writes.push_back(write);
+            }
+        }
+        device.updateDescriptorSets(writes, nullptr, dispatcher);
+        stats::increment(stats::Counter::UpdateDescriptorSets);
+
+        using vkPS = vk::PipelineStageFlagBits;
+        using vkAF = vk::AccessFlagBits;
+        commandBuffer.begin({ vk::CommandBufferUsageFlagBits::eOneTimeSubmit });
+
+        // Make earlier transfers and host writes visible to the first jobs
+        commandBuffer.memoryBarrier(vkPS::eTransfer | vkPS::eHost, vkAF::eTransferWrite | vkAF::eHostWrite,
+                                    vkPS::eComputeShader, vkAF::eShaderRead | vkAF::eShaderWrite);
+
+        accessed.clear();
+        const ComputePipeline* boundPipeline = nullptr;
+        for (size_t i = 0; i < jobs.size(); i++) {
+            const ComputeJob& job = jobs[i];
+
+            bool needsBarrier = false;
+            for (const ComputeJob::Resource& resource : job.resources) {
+                auto it = accessed.find(resource.handle);
+                if (it != accessed.end() && (it->second || isWrite(*resource.binding))) {
+                    needsBarrier = true;
+                    break;
+                }
+            }
+            if (needsBarrier) {
+                commandBuffer.memoryBarrier(vkPS::eComputeShader, vkAF::eShaderWrite,
+                                            vkPS::eComputeShader, vkAF::eShaderRead | vkAF::eShaderWrite);
+                barrierCount++;
+                accessed.clear();
+            }
+            for (const ComputeJob::Resource& resource : job.resources) {
+                accessed[resource.handle] |= isWrite(*resource.binding);
+            }
+
+            const ComputePipeline& pipeline = job.kernel->getPipeline();
+            vk::CommandBuffer cmdBuf = commandBuffer.get();
+            if (boundPipeline != &pipeline) {
+                commandBuffer.bindPipeline(pipeline);
+                boundPipeline = &pipeline;
+            }
+            cmdBuf.bindDescriptorSets(vk::PipelineBindPoint::eCompute, pipeline.getLayout(), 0, descSets[i], nullptr,
+                                      commandBuffer.getDispatcher());
+            std::array<uint32_t, 3> groupCount = job.getGroupCount();
+            commandBuffer.dispatch(groupCount[0], groupCount[1], groupCount[2]);
+        }
+
+        // Make the results visible to later transfers and host reads
+        commandBuffer.memoryBarrier(vkPS::eComputeShader, vkAF::eShaderWrite,
+                                    vkPS::eTransfer | vkPS::eHost, vkAF::eTransferRead | vkAF::eHostRead);
+        commandBuffer.end();
+    }
+}
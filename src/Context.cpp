@@ -1,5 +1,11 @@
 #include "vktiny/Context.hpp"
 #include "vktiny/CommandBuffer.hpp"
+#include "vktiny/Log.hpp"
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cstdlib>
+#include <stdexcept>
 
 VULKAN_HPP_DEFAULT_DISPATCH_LOADER_DYNAMIC_STORAGE
 
@@ -11,51 +17,274 @@ namespace vkt
         VkDebugUtilsMessengerCallbackDataEXT const* pCallbackData,
         void* /*pUserData*/)
     {
-        std::ostringstream message;
-
-        message << vk::to_string(static_cast<vk::DebugUtilsMessageSeverityFlagBitsEXT>(messageSeverity)) << ": "
-            << vk::to_string(static_cast<vk::DebugUtilsMessageTypeFlagsEXT>(messageTypes)) << ":\n";
-        message << "\t"
-            << "messageIDName   = <" << pCallbackData->pMessageIdName << ">\n";
-        message << "\t"
-            << "messageIdNumber = " << pCallbackData->messageIdNumber << "\n";
-        message << "\t"
-            << "message         = <" << pCallbackData->pMessage << ">\n";
-        if (0 < pCallbackData->queueLabelCount) {
-            message << "\t"
-                << "Queue Labels:\n";
-            for (uint8_t i = 0; i < pCallbackData->queueLabelCount; i++) {
-                message << "\t\t"
-                    << "labelName = <" << pCallbackData->pQueueLabels[i].pLabelName << ">\n";
-            }
-        }
-        if (0 < pCallbackData->cmdBufLabelCount) {
-            message << "\t"
-                << "CommandBuffer Labels:\n";
-            for (uint8_t i = 0; i < pCallbackData->cmdBufLabelCount; i++) {
-                message << "\t\t"
-                    << "labelName = <" << pCallbackData->pCmdBufLabels[i].pLabelName << ">\n";
-            }
-        }
-        if (0 < pCallbackData->objectCount) {
-            message << "\t"
-                << "Objects:\n";
-            for (uint8_t i = 0; i < pCallbackData->objectCount; i++) {
-                message << "\t\t"
-                    << "Object " << i << "\n";
-                message << "\t\t\t"
-                    << "objectType   = "
-                    << vk::to_string(static_cast<vk::ObjectType>(pCallbackData->pObjects[i].objectType)) << "\n";
-                message << "\t\t\t"
-                    << "objectHandle = " << pCallbackData->pObjects[i].objectHandle << "\n";
-                if (pCallbackData->pObjects[i].pObjectName) {
-                    message << "\t\t\t"
-                        << "objectName   = <" << pCallbackData->pObjects[i].pObjectName << ">\n";
+        // Called from arbitrary driver threads, so only enqueue the message here
+        using vkMS = vk::DebugUtilsMessageSeverityFlagBitsEXT;
+        auto severity = static_cast<vkMS>(messageSeverity);
+        log::Level level = log::Level::Trace;
+        if (severity == vkMS::eError) {
+            level = log::Level::Error;
+        } else if (severity == vkMS::eWarning) {
+            level = log::Level::Warn;
+        } else if (severity == vkMS::eInfo) {
+            level = log::Level::Info;
+        }
+
+        bool performance = messageTypes & VK_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT;
+        log::vulkanMessage(level, performance, pCallbackData->messageIdNumber,
+                           pCallbackData->pMessageIdName, pCallbackData->pMessage);
+        return VK_FALSE;
+    }
+
+    namespace
+    {
+        struct DeviceCandidate
+        {
+            vk::PhysicalDevice device;
+            vk::PhysicalDeviceProperties properties;
+            std::string uuid;      // lowercase hex, empty if unavailable
+            std::string rejection; // empty if suitable
+            uint64_t score = 0;
+            uint64_t localMemoryMiB = 0;
+            bool dedicatedCompute = false;
+        };
+
+        std::string toLower(std::string_view str)
+        {
+            std::string lower{ str };
+            std::transform(lower.begin(), lower.end(), lower.begin(),
+                           [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+            return lower;
+        }
+
+        std::string toHex(const std::array<uint8_t, VK_UUID_SIZE>& uuid)
+        {
+            constexpr const char* digits = "0123456789abcdef";
+            std::string hex;
+            for (uint8_t byte : uuid) {
+                hex += digits[byte >> 4];
+                hex += digits[byte & 0xF];
+            }
+            return hex;
+        }
+
+        uint32_t getTypeWeight(vk::PhysicalDeviceType type)
+        {
+            switch (type) {
+                case vk::PhysicalDeviceType::eDiscreteGpu:
+                    return 4;
+                case vk::PhysicalDeviceType::eIntegratedGpu:
+                    return 3;
+                case vk::PhysicalDeviceType::eVirtualGpu:
+                    return 2;
+                case vk::PhysicalDeviceType::eCpu:
+                    return 1;
+                default:
+                    return 0;
+            }
+        }
+
+        // Returns the name of the first requested feature the device doesn't support
+        std::string findMissingFeature(const vk::PhysicalDeviceFeatures& requested,
+                                       const vk::PhysicalDeviceFeatures& supported)
+        {
+            // PhysicalDeviceFeatures is a plain array of VkBool32
+            constexpr size_t count = sizeof(vk::PhysicalDeviceFeatures) / sizeof(vk::Bool32);
+            auto requestedBits = reinterpret_cast<const vk::Bool32*>(&requested);
+            auto supportedBits = reinterpret_cast<const vk::Bool32*>(&supported);
+            for (size_t i = 0; i < count; i++) {
+                if (requestedBits[i] && !supportedBits[i]) {
+                    return "feature #" + std::to_string(i);
                 }
             }
+            return {};
         }
 
-        std::cout << message.str() << std::endl;
-        return VK_FALSE;
+        DeviceCandidate evaluate(vk::PhysicalDevice device,
+                                 const std::vector<const char*>& extensions,
+                                 const vk::PhysicalDeviceFeatures& features,
+                                 vk::SurfaceKHR surface)
+        {
+            DeviceCandidate candidate;
+            candidate.device = device;
+            candidate.properties = device.getProperties();
+
+            auto available = device.enumerateDeviceExtensionProperties();
+            for (const char* extension : extensions) {
+                bool found = std::any_of(available.begin(), available.end(),
+                                         [&](const vk::ExtensionProperties& properties) {
+                                             return std::string_view(properties.extensionName) == extension;
+                                         });
+                if (!found) {
+                    candidate.rejection = std::string("missing extension ") + extension;
+                    return candidate;
+                }
+            }
+
+            std::string missingFeature = findMissingFeature(features, device.getFeatures());
+            if (!missingFeature.empty()) {
+                candidate.rejection = "missing " + missingFeature;
+                return candidate;
+            }
+
+            bool hasGraphics = false;
+            bool hasCompute = false;
+            bool hasPresent = !surface;
+            auto queueFamilies = device.getQueueFamilyProperties();
+            for (uint32_t i = 0; i < queueFamilies.size(); i++) {
+                auto flags = queueFamilies[i].queueFlags;
+                hasGraphics |= static_cast<bool>(flags & vk::QueueFlagBits::eGraphics);
+                hasCompute |= static_cast<bool>(flags & vk::QueueFlagBits::eCompute);
+                if ((flags & vk::QueueFlagBits::eCompute) && !(flags & vk::QueueFlagBits::eGraphics)) {
+                    candidate.dedicatedCompute = true;
+                }
+                if (surface && !hasPresent) {
+                    hasPresent = device.getSurfaceSupportKHR(i, surface);
+                }
+            }
+            if (!hasGraphics || !hasCompute) {
+                candidate.rejection = "no graphics and compute queues";
+                return candidate;
+            }
+            if (!hasPresent) {
+                candidate.rejection = "can't present to the surface";
+                return candidate;
+            }
+
+            auto memoryProperties = device.getMemoryProperties();
+            for (uint32_t i = 0; i < memoryProperties.memoryHeapCount; i++) {
+                const auto& heap = memoryProperties.memoryHeaps[i];
+                if (heap.flags & vk::MemoryHeapFlagBits::eDeviceLocal) {
+                    candidate.localMemoryMiB += heap.size >> 20;
+                }
+            }
+
+            // Device type dominates, then memory size; a dedicated compute queue breaks ties
+            candidate.score = (uint64_t(getTypeWeight(candidate.properties.deviceType)) << 40) +
+                              (candidate.localMemoryMiB << 1) +
+                              (candidate.dedicatedCompute ? 1 : 0);
+            return candidate;
+        }
+
+        // Lowercase hex without dashes if the selector is a UUID, otherwise empty
+        std::string getSelectorUUID(const std::string& selector)
+        {
+            std::string uuid = toLower(selector);
+            std::erase(uuid, '-');
+            bool isHex = std::all_of(uuid.begin(), uuid.end(), [](unsigned char c) { return std::isxdigit(c); });
+            return uuid.size() == 2 * VK_UUID_SIZE && isHex ? uuid : std::string{};
+        }
+
+        bool matchesOverride(const DeviceCandidate& candidate, size_t index, const std::string& selector)
+        {
+            if (selector.starts_with('#')) {
+                // Indices that don't parse or are too large match no device
+                uint64_t value = 0;
+                const char* begin = selector.data() + 1;
+                const char* end = selector.data() + selector.size();
+                auto [parsed, error] = std::from_chars(begin, end, value);
+                return error == std::errc{} && parsed == end && begin != end && value == index;
+            }
+
+            std::string uuid = getSelectorUUID(selector);
+            if (!uuid.empty() && uuid == candidate.uuid) {
+                return true;
+            }
+            return toLower(candidate.properties.deviceName.data()).find(toLower(selector)) != std::string::npos;
+        }
+
+        std::string describe(const DeviceCandidate& candidate)
+        {
+            return log::format("{} ({}, {} MiB device-local{})",
+                               candidate.properties.deviceName.data(),
+                               vk::to_string(candidate.properties.deviceType),
+                               candidate.localMemoryMiB,
+                               candidate.dedicatedCompute ? ", dedicated compute queue" : "");
+        }
+    }
+
+    void Context::initDispatcher(bool loadGlobal)
+    {
+        dispatcher->init(*instance, getInstanceProcAddr, *device);
+        if (!loadGlobal) {
+            return;
+        }
+
+        // Only one device can own the global dispatcher
+        static vk::Device globalDevice;
+        if (globalDevice && globalDevice != *device) {
+            log::warn("Loading device functions into the global dispatcher again; contexts of "
+                      "the previously loaded device now call into this device's driver");
+        }
+        globalDevice = *device;
+        VULKAN_HPP_DEFAULT_DISPATCHER.init(*device);
+    }
+
+    void Context::pickPhysicalDevice(const ContextCreateInfo& info,
+                                     const std::vector<const char*>& extensions)
+    {
+        // Device UUIDs need Vulkan 1.1
+        bool queryUUID = VK_MAKE_API_VERSION(0, info.apiMajorVersion, info.apiMinorVersion, 0) >= VK_API_VERSION_1_1;
+
+        std::vector<DeviceCandidate> candidates;
+        for (vk::PhysicalDevice device : instance->enumeratePhysicalDevices()) {
+            DeviceCandidate candidate = evaluate(device, extensions, info.features, surface.get());
+            if (queryUUID && candidate.properties.apiVersion >= VK_API_VERSION_1_1) {
+                auto chain = device.getProperties2<vk::PhysicalDeviceProperties2, vk::PhysicalDeviceIDProperties>();
+                candidate.uuid = toHex(chain.get<vk::PhysicalDeviceIDProperties>().deviceUUID);
+            }
+            candidates.push_back(std::move(candidate));
+        }
+        if (candidates.empty()) {
+            throw std::runtime_error("failed to find a Vulkan device");
+        }
+
+        std::string selector = info.physicalDevice;
+        if (const char* env = std::getenv("VKT_DEVICE"); env && *env) {
+            selector = env;
+        }
+
+        if (!selector.empty()) {
+            if (!queryUUID && !getSelectorUUID(selector).empty()) {
+                throw std::runtime_error("selecting a device by UUID (\"" + selector + "\") needs Vulkan 1.1, "
+                                         "set ContextCreateInfo::apiMinorVersion to 1 or higher");
+            }
+            for (size_t i = 0; i < candidates.size(); i++) {
+                const DeviceCandidate& candidate = candidates[i];
+                if (!matchesOverride(candidate, i, selector)) {
+                    continue;
+                }
+                if (!candidate.rejection.empty()) {
+                    throw std::runtime_error("requested device " + describe(candidate) +
+                                             " is unsuitable: " + candidate.rejection);
+                }
+                log::info("Using device {}: {} (selected by \"{}\")", i, describe(candidate), selector);
+                physicalDevice = candidate.device;
+                return;
+            }
+            throw std::runtime_error("no Vulkan device matches \"" + selector + "\"");
+        }
+
+        const DeviceCandidate* best = nullptr;
+        size_t bestIndex = 0;
+        size_t suitableCount = 0;
+        for (size_t i = 0; i < candidates.size(); i++) {
+            const DeviceCandidate& candidate = candidates[i];
+            if (!candidate.rejection.empty()) {
+                log::info("Skipping device {}: {}: {}", i, candidate.properties.deviceName.data(), candidate.rejection);
+                continue;
+            }
+            suitableCount++;
+            if (!best || candidate.score > best->score) {
+                best = &candidate;
+                bestIndex = i;
+            }
+        }
+        if (!best) {
+            throw std::runtime_error("no Vulkan device supports the required extensions, features and queues");
+        }
+
+        std::string reason = suitableCount == 1 ? "only suitable device" : "highest score";
+        log::info("Using device {}: {} ({} of {} devices)", bestIndex, describe(*best), reason, candidates.size());
+        physicalDevice = best->device;
     }
 }
@@ -12,6 +12,6 @@ namespace vkt
         poolInfo.setFlags(vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet);
         poolInfo.setMaxSets(maxSets);
         poolInfo.setPoolSizes(poolSizes);
-        descPool = context.getDevice().createDescriptorPoolUnique(poolInfo);
+        descPool = context.getDevice().createDescriptorPoolUnique(poolInfo, nullptr, context.getDispatcher());
     }
 }
@@ -4,6 +4,7 @@
 #include "vktiny/Pipeline.hpp"
 #include "vktiny/DescriptorPool.hpp"
 #include "vktiny/DescriptorSetLayout.hpp"
+#include "vktiny/DriverStats.hpp"
 
 namespace vkt
 {
@@ -14,7 +15,8 @@ namespace vkt
     {
         vk::DescriptorSetLayout setLayout = layout.get();
         vk::DescriptorSetAllocateInfo allocInfo{ descPool.get(), setLayout };
-        descSet = std::move(context.getDevice().allocateDescriptorSetsUnique(allocInfo).front());
+        auto descSets = context.getDevice().allocateDescriptorSetsUnique(allocInfo, context.getDispatcher());
+        descSet = std::move(descSets.front());
     }
 
     void DescriptorSet::update(const Buffer& buffer, vk::DescriptorSetLayoutBinding binding)
@@ -26,18 +28,26 @@ namespace vkt
         writeDescSet.setDescriptorCount(binding.descriptorCount);
         writeDescSet.setDescriptorType(binding.descriptorType);
         writeDescSet.setBufferInfo(bufferInfo);
-        context->getDevice().updateDescriptorSets(writeDescSet, nullptr);
+        context->getDevice().updateDescriptorSets(writeDescSet, nullptr, context->getDispatcher());
+        stats::increment(stats::Counter::UpdateDescriptorSets);
     }
 
     void DescriptorSet::update(const Image& image, vk::DescriptorSetLayoutBinding binding)
     {
-        vk::DescriptorImageInfo imageInfo({}, image.getView(), image.getLayout());
+        update(image.getView(), image.getLayout(), binding);
+    }
+
+    void DescriptorSet::update(vk::ImageView imageView, vk::ImageLayout imageLayout,
+                               vk::DescriptorSetLayoutBinding binding)
+    {
+        vk::DescriptorImageInfo imageInfo({}, imageView, imageLayout);
         vk::WriteDescriptorSet writeDescSet;
         writeDescSet.setDstSet(*descSet);
         writeDescSet.setDstBinding(binding.binding);
         writeDescSet.setDescriptorCount(binding.descriptorCount);
         writeDescSet.setDescriptorType(binding.descriptorType);
         writeDescSet.setImageInfo(imageInfo);
-        context->getDevice().updateDescriptorSets(writeDescSet, nullptr);
+        context->getDevice().updateDescriptorSets(writeDescSet, nullptr, context->getDispatcher());
+        stats::increment(stats::Counter::UpdateDescriptorSets);
     }
 }
@@ -7,6 +7,7 @@ namespace vkt
         const Context& context,
         const std::vector<vk::DescriptorSetLayoutBinding>& bindings)
     {
-        descSetLayout = context.getDevice().createDescriptorSetLayoutUnique({ {}, bindings });
+        descSetLayout = context.getDevice().createDescriptorSetLayoutUnique(
+            { {}, bindings }, nullptr, context.getDispatcher());
     }
 }
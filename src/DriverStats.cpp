@@ -0,0 +1,140 @@
+#include "vktiny/DriverStats.hpp"
+#include <atomic>
+#include <mutex>
+#include <utility>
+
+namespace vkt::stats
+{
+    namespace
+    {
+        struct ThreadCounters
+        {
+            std::array<std::atomic<uint64_t>, counterCount> calls{};
+            std::array<std::atomic<int64_t>, counterCount> blockedNs{};
+        };
+
+        struct Registry
+        {
+            std::mutex mutex;
+            std::vector<ThreadCounters*> threads;
+
+            // Counts of threads that exited since the last endFrame()
+            std::array<uint64_t, counterCount> exitedCalls{};
+            std::array<int64_t, counterCount> exitedBlockedNs{};
+
+            std::vector<Stall> stalls;
+            FrameReport lastReport;
+            uint64_t frame = 0;
+        };
+
+        std::atomic<int64_t> stallThresholdNs{ 4'000'000 };
+
+        Registry& getRegistry()
+        {
+            static Registry registry;
+            return registry;
+        }
+
+        // Registers the thread's counters and, when the thread exits, folds them into the
+        // registry's totals so that short-lived threads such as thread pool workers don't
+        // accumulate in the registry
+        struct ThreadRegistration
+        {
+            ThreadCounters counters;
+
+            ThreadRegistration()
+            {
+                Registry& registry = getRegistry();
+                std::lock_guard lock{ registry.mutex };
+                registry.threads.push_back(&counters);
+            }
+
+            ~ThreadRegistration()
+            {
+                Registry& registry = getRegistry();
+                std::lock_guard lock{ registry.mutex };
+                for (size_t i = 0; i < counterCount; i++) {
+                    registry.exitedCalls[i] += counters.calls[i].load(std::memory_order_relaxed);
+                    registry.exitedBlockedNs[i] += counters.blockedNs[i].load(std::memory_order_relaxed);
+                }
+                std::erase(registry.threads, &counters);
+            }
+        };
+
+        ThreadCounters& getThreadCounters()
+        {
+            thread_local ThreadRegistration registration;
+            return registration.counters;
+        }
+    }
+
+    const char* toString(Counter counter)
+    {
+        switch (counter) {
+            case Counter::AllocateMemory:
+                return "vkAllocateMemory";
+            case Counter::UpdateDescriptorSets:
+                return "vkUpdateDescriptorSets";
+            case Counter::QueueSubmit:
+                return "vkQueueSubmit";
+            case Counter::WaitForFences:
+                return "vkWaitForFences";
+            case Counter::WaitIdle:
+                return "vkQueueWaitIdle";
+            default:
+                return "Unknown";
+        }
+    }
+
+    void increment(Counter counter, uint64_t count)
+    {
+        auto index = static_cast<size_t>(counter);
+        getThreadCounters().calls[index].fetch_add(count, std::memory_order_relaxed);
+    }
+
+    void addBlockedTime(Counter counter, int64_t durationNs, std::source_location location)
+    {
+        auto index = static_cast<size_t>(counter);
+        getThreadCounters().blockedNs[index].fetch_add(durationNs, std::memory_order_relaxed);
+
+        if (durationNs > stallThresholdNs.load(std::memory_order_relaxed)) {
+            Registry& registry = getRegistry();
+            std::lock_guard lock{ registry.mutex };
+            registry.stalls.push_back({ counter, location.file_name(), location.line(),
+                                        location.function_name(), durationNs });
+        }
+    }
+
+    void setStallThreshold(std::chrono::nanoseconds threshold)
+    {
+        stallThresholdNs.store(threshold.count(), std::memory_order_relaxed);
+    }
+
+    FrameReport endFrame()
+    {
+        Registry& registry = getRegistry();
+        std::lock_guard lock{ registry.mutex };
+
+        FrameReport report;
+        report.frame = registry.frame++;
+        report.calls = std::exchange(registry.exitedCalls, {});
+        report.blockedNs = std::exchange(registry.exitedBlockedNs, {});
+        for (const auto& thread : registry.threads) {
+            for (size_t i = 0; i < counterCount; i++) {
+                report.calls[i] += thread->calls[i].exchange(0, std::memory_order_relaxed);
+                report.blockedNs[i] += thread->blockedNs[i].exchange(0, std::memory_order_relaxed);
+            }
+        }
+        report.stalls = std::move(registry.stalls);
+        registry.stalls.clear();
+        registry.lastReport = report;
+        return report;
+    }
+
+    FrameReport getLastFrameReport()
+    {
+        Registry& registry = getRegistry();
+        std::lock_guard lock{ registry.mutex };
+        return registry.lastReport;
+    }
+}
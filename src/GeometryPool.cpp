@@ -0,0 +1,346 @@
+#include "vktiny/GeometryPool.hpp"
+#include "vktiny/CommandBuffer.hpp"
+#include "vktiny/Trace.hpp"
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+
+namespace vkt
+{
+    namespace
+    {
+        // Capacity for count more elements, doubled so growing stays amortized
+        uint32_t getGrownCapacity(uint32_t capacity, uint32_t count)
+        {
+            uint64_t needed = uint64_t{ capacity } + count;
+            if (needed > UINT32_MAX) {
+                throw std::runtime_error("geometry pool can't hold more than 2^32 elements");
+            }
+            uint64_t doubled = std::max<uint64_t>(uint64_t{ capacity } * 2, needed);
+            return static_cast<uint32_t>(std::min<uint64_t>(doubled, UINT32_MAX));
+        }
+
+        // Compaction leaves an eighth free so the next allocations don't grow the pool right away
+        uint32_t getCompactCapacity(uint32_t liveCount)
+        {
+            return static_cast<uint32_t>(std::min<uint64_t>(uint64_t{ liveCount } + liveCount / 8, UINT32_MAX));
+        }
+    }
+
+    RangeAllocator::RangeAllocator(uint32_t capacity)
+    {
+        reset(capacity, 0);
+    }
+
+    std::optional<uint32_t> RangeAllocator::allocate(uint32_t size)
+    {
+        if (size == 0) {
+            return 0;
+        }
+        for (auto it = freeRanges.begin(); it != freeRanges.end(); ++it) {
+            auto [offset, rangeSize] = *it;
+            if (rangeSize < size) {
+                continue;
+            }
+            freeRanges.erase(it);
+            if (rangeSize > size) {
+                freeRanges.emplace(offset + size, rangeSize - size);
+            }
+            freeSize -= size;
+            return offset;
+        }
+        return std::nullopt;
+    }
+
+    void RangeAllocator::free(uint32_t offset, uint32_t size)
+    {
+        if (size == 0) {
+            return;
+        }
+        freeSize += size;
+        auto next = freeRanges.lower_bound(offset);
+        if (next != freeRanges.end() && offset + size == next->first) {
+            size += next->second;
+            next = freeRanges.erase(next);
+        }
+        if (next != freeRanges.begin()) {
+            auto prev = std::prev(next);
+            if (prev->first + prev->second == offset) {
+                prev->second += size;
+                return;
+            }
+        }
+        freeRanges.emplace(offset, size);
+    }
+
+    void RangeAllocator::grow(uint32_t newCapacity)
+    {
+        if (newCapacity > capacity) {
+            uint32_t oldCapacity = capacity;
+            capacity = newCapacity;
+            free(oldCapacity, newCapacity - oldCapacity);
+        }
+    }
+
+    void RangeAllocator::reset(uint32_t newCapacity, uint32_t usedSize)
+    {
+        freeRanges.clear();
+        capacity = newCapacity;
+        freeSize = newCapacity - usedSize;
+        if (freeSize > 0) {
+            freeRanges.emplace(usedSize, freeSize);
+        }
+    }
+
+    uint32_t RangeAllocator::getLargestFreeRange() const
+    {
+        uint32_t largest = 0;
+        for (const auto& [offset, size] : freeRanges) {
+            largest = std::max(largest, size);
+        }
+        return largest;
+    }
+
+    GeometryPool::GeometryPool(const Context& context, const GeometryPoolCreateInfo& info)
+        : context(&context)
+        , info(info)
+        , vertexBuffer(context, vk::DeviceSize{ info.vertexStride } * std::max(info.vertexCapacity, 1u),
+                       info.usage | vk::BufferUsageFlagBits::eVertexBuffer |
+                       vk::BufferUsageFlagBits::eTransferSrc | vk::BufferUsageFlagBits::eTransferDst,
+                       info.properties)
+        , indexBuffer(context, vk::DeviceSize{ getIndexSize() } * std::max(info.indexCapacity, 1u),
+                      info.usage | vk::BufferUsageFlagBits::eIndexBuffer |
+                      vk::BufferUsageFlagBits::eTransferSrc | vk::BufferUsageFlagBits::eTransferDst,
+                      info.properties)
+        , vertexAllocator(info.vertexCapacity)
+        , indexAllocator(info.indexCapacity)
+    {
+    }
+
+    GeometryId GeometryPool::allocate(uint32_t vertexCount, uint32_t indexCount)
+    {
+        std::optional<uint32_t> vertexOffset = vertexAllocator.allocate(vertexCount);
+        std::optional<uint32_t> indexOffset = indexAllocator.allocate(indexCount);
+        if (!vertexOffset || !indexOffset) {
+            if (vertexOffset) {
+                vertexAllocator.free(*vertexOffset, vertexCount);
+            }
+            if (indexOffset) {
+                indexAllocator.free(*indexOffset, indexCount);
+            }
+
+            // Only the buffer that is out of space grows
+            uint32_t vertexCapacity = vertexAllocator.getCapacity();
+            uint32_t indexCapacity = indexAllocator.getCapacity();
+            if (vertexAllocator.getLargestFreeRange() < vertexCount) {
+                vertexCapacity = getGrownCapacity(vertexCapacity, vertexCount);
+            }
+            if (indexAllocator.getLargestFreeRange() < indexCount) {
+                indexCapacity = getGrownCapacity(indexCapacity, indexCount);
+            }
+            reallocate(vertexCapacity, indexCapacity, false);
+            vertexOffset = vertexAllocator.allocate(vertexCount);
+            indexOffset = indexAllocator.allocate(indexCount);
+        }
+
+        GeometryId id;
+        if (freeIds.empty()) {
+            id = static_cast<GeometryId>(ranges.size());
+            ranges.emplace_back();
+            live.push_back(true);
+        } else {
+            id = freeIds.back();
+            freeIds.pop_back();
+            live[id] = true;
+        }
+        ranges[id] = { *vertexOffset, vertexCount, *indexOffset, indexCount };
+        return id;
+    }
+
+    GeometryId GeometryPool::add(const void* vertices, uint32_t vertexCount,
+                                 const void* indices, uint32_t indexCount)
+    {
+        if (info.indexType == vk::IndexType::eUint16 && vertexCount > 65536) {
+            throw std::runtime_error("16-bit index pool needs meshes of at most 65536 vertices, got " +
+                                     std::to_string(vertexCount));
+        }
+        GeometryId id = allocate(vertexCount, indexCount);
+        const GeometryRange& range = ranges[id];
+        vk::DeviceSize vertexSize = vk::DeviceSize{ info.vertexStride } * vertexCount;
+        vk::DeviceSize indexSize = vk::DeviceSize{ getIndexSize() } * indexCount;
+        if (isHostVisible()) {
+            auto* mappedVertices = static_cast<uint8_t*>(getMappedVertices());
+            auto* mappedIndices = static_cast<uint8_t*>(getMappedIndices());
+            std::memcpy(mappedVertices + vk::DeviceSize{ info.vertexStride } * range.vertexOffset, vertices, vertexSize);
+            std::memcpy(mappedIndices + vk::DeviceSize{ getIndexSize() } * range.indexOffset, indices, indexSize);
+            return id;
+        }
+
+        using vkMP = vk::MemoryPropertyFlagBits;
+        Buffer stagingBuffer{ *context, vertexSize + indexSize, vk::BufferUsageFlagBits::eTransferSrc,
+                              vkMP::eHostVisible | vkMP::eHostCoherent };
+        auto* mapped = static_cast<uint8_t*>(stagingBuffer.map());
+        std::memcpy(mapped, vertices, vertexSize);
+        std::memcpy(mapped + vertexSize, indices, indexSize);
+        context->OneTimeSubmitGraphics([&](const CommandBuffer& commandBuffer) {
+            upload(commandBuffer, id, stagingBuffer.get(), 0, vertexSize);
+        });
+        return id;
+    }
+
+    void GeometryPool::upload(const CommandBuffer& cmdBuf, GeometryId id, vk::Buffer srcBuffer,
+                              vk::DeviceSize vertexSrcOffset, vk::DeviceSize indexSrcOffset) const
+    {
+        const GeometryRange& range = ranges[id];
+        vk::DeviceSize stride = info.vertexStride;
+        vk::DeviceSize indexSize = getIndexSize();
+        if (range.vertexCount > 0) {
+            cmdBuf.copyBuffer(srcBuffer, vertexBuffer.get(),
+                              { vertexSrcOffset, stride * range.vertexOffset, stride * range.vertexCount });
+        }
+        if (range.indexCount > 0) {
+            cmdBuf.copyBuffer(srcBuffer, indexBuffer.get(),
+                              { indexSrcOffset, indexSize * range.indexOffset, indexSize * range.indexCount });
+        }
+    }
+
+    void GeometryPool::free(GeometryId id)
+    {
+        if (id >= ranges.size() || !live[id]) {
+            throw std::runtime_error("geometry " + std::to_string(id) + " is not allocated");
+        }
+        const GeometryRange& range = ranges[id];
+        vertexAllocator.free(range.vertexOffset, range.vertexCount);
+        indexAllocator.free(range.indexOffset, range.indexCount);
+        ranges[id] = {};
+        live[id] = false;
+        freeIds.push_back(id);
+    }
+
+    void GeometryPool::compact()
+    {
+        reallocate(getCompactCapacity(getLiveVertexCount()), getCompactCapacity(getLiveIndexCount()), true);
+    }
+
+    void GeometryPool::beginFrame()
+    {
+        frameCounter++;
+        while (!retired.empty() && retired.front().frame <= frameCounter) {
+            retired.pop_front();
+        }
+    }
+
+    bool GeometryPool::isHostVisible() const
+    {
+        using vkMP = vk::MemoryPropertyFlagBits;
+        return (info.properties & vkMP::eHostVisible) && (info.properties & vkMP::eHostCoherent);
+    }
+
+    void* GeometryPool::getMappedVertices()
+    {
+        return isHostVisible() ? vertexBuffer.map() : nullptr;
+    }
+
+    void* GeometryPool::getMappedIndices()
+    {
+        return isHostVisible() ? indexBuffer.map() : nullptr;
+    }
+
+    void GeometryPool::reallocate(uint32_t vertexCapacity, uint32_t indexCapacity, bool pack)
+    {
+        VKT_TRACE_SCOPE("GeometryPool::reallocate");
+        vk::BufferUsageFlags usage = info.usage | vk::BufferUsageFlagBits::eTransferSrc |
+                                     vk::BufferUsageFlagBits::eTransferDst;
+        vk::DeviceSize stride = info.vertexStride;
+        vk::DeviceSize indexSize = getIndexSize();
+
+        // Growing replaces only the buffers whose capacity changes, packing replaces both
+        std::optional<Buffer> newVertexBuffer;
+        std::optional<Buffer> newIndexBuffer;
+        if (pack || vertexCapacity != vertexAllocator.getCapacity()) {
+            newVertexBuffer.emplace(*context, stride * std::max(vertexCapacity, 1u),
+                                    usage | vk::BufferUsageFlagBits::eVertexBuffer, info.properties);
+        }
+        if (pack || indexCapacity != indexAllocator.getCapacity()) {
+            newIndexBuffer.emplace(*context, indexSize * std::max(indexCapacity, 1u),
+                                   usage | vk::BufferUsageFlagBits::eIndexBuffer, info.properties);
+        }
+        if (!newVertexBuffer && !newIndexBuffer) {
+            return;
+        }
+
+        // Packing keeps the previous order of the ranges for locality
+        std::vector<GeometryRange> newRanges = ranges;
+        uint32_t vertexEnd = 0;
+        uint32_t indexEnd = 0;
+        if (pack) {
+            std::vector<GeometryId> order(ranges.size());
+            std::iota(order.begin(), order.end(), 0);
+            std::sort(order.begin(), order.end(), [&](GeometryId a, GeometryId b) {
+                return ranges[a].vertexOffset < ranges[b].vertexOffset;
+            });
+            for (GeometryId id : order) {
+                if (live[id]) {
+                    newRanges[id].vertexOffset = vertexEnd;
+                    vertexEnd += ranges[id].vertexCount;
+                }
+            }
+            std::sort(order.begin(), order.end(), [&](GeometryId a, GeometryId b) {
+                return ranges[a].indexOffset < ranges[b].indexOffset;
+            });
+            for (GeometryId id : order) {
+                if (live[id]) {
+                    newRanges[id].indexOffset = indexEnd;
+                    indexEnd += ranges[id].indexCount;
+                }
+            }
+        }
+
+        context->OneTimeSubmitGraphics([&](const CommandBuffer& commandBuffer) {
+            if (!pack) {
+                if (newVertexBuffer) {
+                    commandBuffer.copyBuffer(vertexBuffer.get(), newVertexBuffer->get(), { 0, 0, vertexBuffer.getSize() });
+                }
+                if (newIndexBuffer) {
+                    commandBuffer.copyBuffer(indexBuffer.get(), newIndexBuffer->get(), { 0, 0, indexBuffer.getSize() });
+                }
+                return;
+            }
+            for (GeometryId id = 0; id < ranges.size(); id++) {
+                const GeometryRange& src = ranges[id];
+                const GeometryRange& dst = newRanges[id];
+                if (live[id] && src.vertexCount > 0) {
+                    commandBuffer.copyBuffer(vertexBuffer.get(), newVertexBuffer->get(),
+                                             { stride * src.vertexOffset, stride * dst.vertexOffset,
+                                               stride * src.vertexCount });
+                }
+                if (live[id] && src.indexCount > 0) {
+                    commandBuffer.copyBuffer(indexBuffer.get(), newIndexBuffer->get(),
+                                             { indexSize * src.indexOffset, indexSize * dst.indexOffset,
+                                               indexSize * src.indexCount });
+                }
+            }
+        });
+
+        // Frames recorded before may still read the old buffers
+        Retired& old = retired.emplace_back();
+        old.frame = frameCounter + info.frameCount;
+        if (newVertexBuffer) {
+            old.vertexBuffer.emplace(std::move(vertexBuffer));
+            vertexBuffer = std::move(*newVertexBuffer);
+        }
+        if (newIndexBuffer) {
+            old.indexBuffer.emplace(std::move(indexBuffer));
+            indexBuffer = std::move(*newIndexBuffer);
+        }
+        if (pack) {
+            ranges = std::move(newRanges);
+            vertexAllocator.reset(vertexCapacity, vertexEnd);
+            indexAllocator.reset(indexCapacity, indexEnd);
+        } else {
+            vertexAllocator.grow(vertexCapacity);
+            indexAllocator.grow(indexCapacity);
+        }
+        generation++;
+    }
+}
@@ -0,0 +1,687 @@
+#include "vktiny/GltfLoader.hpp"
+#include "vktiny/Json.hpp"
+#include "vktiny/Log.hpp"
+#include "vktiny/ThreadPool.hpp"
+#include "vktiny/Trace.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <stdexcept>
+
+namespace vkt
+{
+    namespace
+    {
+        constexpr uint32_t glbMagic = 0x46546C67;     // "glTF"
+        constexpr uint32_t glbJsonChunk = 0x4E4F534A; // "JSON"
+        constexpr uint32_t glbBinChunk = 0x004E4942;  // "BIN\0"
+
+        constexpr uint32_t modeTriangles = 4;
+
+        [[noreturn]] void fail(const std::string& message)
+        {
+            throw std::runtime_error("gltf: " + message);
+        }
+
+        uint32_t readU32(const uint8_t* data)
+        {
+            uint32_t value;
+            std::memcpy(&value, data, sizeof(value));
+            return value;
+        }
+
+        uint32_t getComponentSize(uint32_t componentType)
+        {
+            switch (componentType) {
+                case 5120: // BYTE
+                case 5121: // UNSIGNED_BYTE
+                    return 1;
+                case 5122: // SHORT
+                case 5123: // UNSIGNED_SHORT
+                    return 2;
+                case 5125: // UNSIGNED_INT
+                case 5126: // FLOAT
+                    return 4;
+                default:
+                    fail("unknown component type " + std::to_string(componentType));
+            }
+        }
+
+        uint32_t getComponentCount(const std::string& type)
+        {
+            if (type == "SCALAR") return 1;
+            if (type == "VEC2") return 2;
+            if (type == "VEC3") return 3;
+            if (type == "VEC4") return 4;
+            if (type == "MAT2") return 4;
+            if (type == "MAT3") return 9;
+            if (type == "MAT4") return 16;
+            fail("unknown accessor type " + type);
+        }
+
+        template <typename T>
+        T load(const uint8_t* data)
+        {
+            T value;
+            std::memcpy(&value, data, sizeof(T));
+            return value;
+        }
+
+        float readComponent(const uint8_t* data, uint32_t componentType, bool normalized)
+        {
+            switch (componentType) {
+                case 5120: {
+                    float value = load<int8_t>(data);
+                    return normalized ? std::max(value / 127.0f, -1.0f) : value;
+                }
+                case 5121: {
+                    float value = load<uint8_t>(data);
+                    return normalized ? value / 255.0f : value;
+                }
+                case 5122: {
+                    float value = load<int16_t>(data);
+                    return normalized ? std::max(value / 32767.0f, -1.0f) : value;
+                }
+                case 5123: {
+                    float value = load<uint16_t>(data);
+                    return normalized ? value / 65535.0f : value;
+                }
+                case 5125:
+                    return static_cast<float>(load<uint32_t>(data));
+                default:
+                    return load<float>(data);
+            }
+        }
+
+        int base64Value(char c)
+        {
+            if (c >= 'A' && c <= 'Z') return c - 'A';
+            if (c >= 'a' && c <= 'z') return c - 'a' + 26;
+            if (c >= '0' && c <= '9') return c - '0' + 52;
+            if (c == '+' || c == '-') return 62;
+            if (c == '/' || c == '_') return 63;
+            return -1;
+        }
+
+        std::vector<uint8_t> decodeBase64(std::string_view text)
+        {
+            std::vector<uint8_t> bytes;
+            bytes.reserve(text.size() / 4 * 3);
+            uint32_t bits = 0;
+            int bitCount = 0;
+            for (char c : text) {
+                if (c == '=') {
+                    break;
+                }
+                int value = base64Value(c);
+                if (value < 0) {
+                    fail("invalid base64 data");
+                }
+                bits = (bits << 6) | static_cast<uint32_t>(value);
+                bitCount += 6;
+                if (bitCount >= 8) {
+                    bitCount -= 8;
+                    bytes.push_back(static_cast<uint8_t>(bits >> bitCount));
+                }
+            }
+            return bytes;
+        }
+
+        // "data:[<mime>][;base64],<data>"
+        bool isDataUri(const std::string& uri)
+        {
+            return uri.rfind("data:", 0) == 0;
+        }
+
+        std::vector<uint8_t> decodeDataUri(const std::string& uri, std::string* mimeType)
+        {
+            size_t comma = uri.find(',');
+            if (comma == std::string::npos) {
+                fail("invalid data uri");
+            }
+            std::string_view header = std::string_view{ uri }.substr(5, comma - 5);
+            if (header.size() < 7 || header.substr(header.size() - 7) != ";base64") {
+                fail("only base64 data uris are supported");
+            }
+            if (mimeType) {
+                *mimeType = std::string{ header.substr(0, header.size() - 7) };
+            }
+            return decodeBase64(std::string_view{ uri }.substr(comma + 1));
+        }
+
+        std::filesystem::path decodeUri(const std::string& uri)
+        {
+            std::string path;
+            path.reserve(uri.size());
+            for (size_t i = 0; i < uri.size(); i++) {
+                if (uri[i] == '%' && i + 2 < uri.size()) {
+                    path += static_cast<char>(std::stoi(uri.substr(i + 1, 2), nullptr, 16));
+                    i += 2;
+                } else {
+                    path += uri[i];
+                }
+            }
+            return std::filesystem::path{ std::u8string{ path.begin(), path.end() } };
+        }
+
+        int32_t getIndex(const json::Value& value)
+        {
+            return value.isNumber() ? static_cast<int32_t>(value.asInt()) : -1;
+        }
+
+        template <size_t N>
+        void readArray(const json::Value& value, std::array<float, N>& dst)
+        {
+            if (value.size() == N) {
+                for (size_t i = 0; i < N; i++) {
+                    dst[i] = value[i].asFloat(dst[i]);
+                }
+            }
+        }
+
+        // Run on the pool if there is one
+        void forEach(ThreadPool* pool, size_t count, const std::function<void(size_t)>& func)
+        {
+            if (pool) {
+                pool->parallelFor(count, func);
+                return;
+            }
+            for (size_t i = 0; i < count; i++) {
+                func(i);
+            }
+        }
+
+        Material parseMaterial(const json::Value& value)
+        {
+            Material material;
+            const json::Value& pbr = value["pbrMetallicRoughness"];
+            readArray(pbr["baseColorFactor"], material.baseColorFactor);
+            material.metallicFactor = pbr["metallicFactor"].asFloat(material.metallicFactor);
+            material.roughnessFactor = pbr["roughnessFactor"].asFloat(material.roughnessFactor);
+            material.baseColorTextureIndex = getIndex(pbr["baseColorTexture"]["index"]);
+            material.metallicRoughnessTextureIndex = getIndex(pbr["metallicRoughnessTexture"]["index"]);
+            material.normalTextureIndex = getIndex(value["normalTexture"]["index"]);
+            material.occlusionTextureIndex = getIndex(value["occlusionTexture"]["index"]);
+            material.emissiveTextureIndex = getIndex(value["emissiveTexture"]["index"]);
+            readArray(value["emissiveFactor"], material.emissiveFactor);
+            material.alphaCutoff = value["alphaCutoff"].asFloat(material.alphaCutoff);
+            material.doubleSided = value["doubleSided"].asBool();
+
+            const std::string& alphaMode = value["alphaMode"].asString();
+            if (alphaMode == "MASK") {
+                material.alphaMode = AlphaMode::Mask;
+            } else if (alphaMode == "BLEND") {
+                material.alphaMode = AlphaMode::Blend;
+            }
+            return material;
+        }
+
+        TextureInfo parseTexture(const json::Value& value, const json::Value& samplers)
+        {
+            TextureInfo texture;
+            texture.imageIndex = getIndex(value["source"]);
+            texture.basisImageIndex = getIndex(value["extensions"]["KHR_texture_basisu"]["source"]);
+            const json::Value& sampler = samplers[static_cast<size_t>(getIndex(value["sampler"]))];
+            texture.magFilter = static_cast<uint32_t>(sampler["magFilter"].asInt(texture.magFilter));
+            texture.minFilter = static_cast<uint32_t>(sampler["minFilter"].asInt(texture.minFilter));
+            texture.wrapS = static_cast<uint32_t>(sampler["wrapS"].asInt(texture.wrapS));
+            texture.wrapT = static_cast<uint32_t>(sampler["wrapT"].asInt(texture.wrapT));
+            return texture;
+        }
+
+        using Matrix = std::array<float, 16>;
+
+        Matrix multiply(const Matrix& a, const Matrix& b)
+        {
+            Matrix result{};
+            for (int col = 0; col < 4; col++) {
+                for (int row = 0; row < 4; row++) {
+                    float sum = 0.0f;
+                    for (int k = 0; k < 4; k++) {
+                        sum += a[k * 4 + row] * b[col * 4 + k];
+                    }
+                    result[col * 4 + row] = sum;
+                }
+            }
+            return result;
+        }
+
+        // T * R * S, or the node's matrix if it has one
+        Matrix getLocalTransform(const json::Value& node)
+        {
+            Matrix matrix{ 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 };
+            if (node.contains("matrix")) {
+                readArray(node["matrix"], matrix);
+                return matrix;
+            }
+
+            std::array<float, 3> t{ 0.0f, 0.0f, 0.0f };
+            std::array<float, 4> r{ 0.0f, 0.0f, 0.0f, 1.0f };
+            std::array<float, 3> s{ 1.0f, 1.0f, 1.0f };
+            readArray(node["translation"], t);
+            readArray(node["rotation"], r);
+            readArray(node["scale"], s);
+
+            float x = r[0], y = r[1], z = r[2], w = r[3];
+            matrix[0] = (1 - 2 * (y * y + z * z)) * s[0];
+            matrix[1] = (2 * (x * y + z * w)) * s[0];
+            matrix[2] = (2 * (x * z - y * w)) * s[0];
+            matrix[4] = (2 * (x * y - z * w)) * s[1];
+            matrix[5] = (1 - 2 * (x * x + z * z)) * s[1];
+            matrix[6] = (2 * (y * z + x * w)) * s[1];
+            matrix[8] = (2 * (x * z + y * w)) * s[2];
+            matrix[9] = (2 * (y * z - x * w)) * s[2];
+            matrix[10] = (1 - 2 * (x * x + y * y)) * s[2];
+            matrix[12] = t[0];
+            matrix[13] = t[1];
+            matrix[14] = t[2];
+            return matrix;
+        }
+    }
+
+    GltfLoader::GltfLoader(const std::filesystem::path& path, ThreadPool* pool)
+        : directory(path.parent_path())
+        , file(path)
+    {
+        VKT_TRACE_SCOPE("GltfLoader");
+
+        // GLB is a header followed by a JSON chunk and an optional binary chunk
+        std::string_view text{ reinterpret_cast<const char*>(file.data()), file.size() };
+        const uint8_t* binChunk = nullptr;
+        size_t binSize = 0;
+        if (file.size() >= 12 && readU32(file.data()) == glbMagic) {
+            size_t offset = 12;
+            bool hasJson = false;
+            while (offset + 8 <= file.size()) {
+                uint32_t chunkSize = readU32(file.data() + offset);
+                uint32_t chunkType = readU32(file.data() + offset + 4);
+                offset += 8;
+                if (chunkSize > file.size() - offset) {
+                    fail("truncated chunk in " + path.string());
+                }
+                if (chunkType == glbJsonChunk && !hasJson) {
+                    text = { reinterpret_cast<const char*>(file.data() + offset), chunkSize };
+                    hasJson = true;
+                } else if (chunkType == glbBinChunk && !binChunk) {
+                    binChunk = file.data() + offset;
+                    binSize = chunkSize;
+                }
+                offset += chunkSize;
+            }
+            if (!hasJson) {
+                fail("no JSON chunk in " + path.string());
+            }
+        }
+
+        json::Value document;
+        {
+            VKT_TRACE_SCOPE("GltfLoader::parse");
+            document = json::parse(text);
+        }
+
+        std::vector<std::vector<uint32_t>> primitivesByMesh;
+        parseBuffers(document, binChunk, binSize);
+        parseAccessors(document);
+        parseMeshes(document, primitivesByMesh);
+        parseMaterials(document, pool);
+        parseImages(document, pool);
+        parseNodes(document, primitivesByMesh);
+
+        log::info("loaded {}: {} meshes, {} vertices, {} indices, {} materials, {} images",
+                  path.filename().string(), meshes.size(), vertexCount, indexCount,
+                  materials.size(), images.size());
+    }
+
+    void GltfLoader::parseBuffers(const json::Value& document, const uint8_t* binChunk, size_t binSize)
+    {
+        // Pointer and size of every buffer. External buffers stay mapped,
+        // only data URIs have to be decoded into memory.
+        std::vector<std::pair<const uint8_t*, size_t>> buffers;
+        for (const json::Value& buffer : document["buffers"].getArray()) {
+            size_t byteLength = static_cast<size_t>(buffer["byteLength"].asInt());
+            const uint8_t* data = nullptr;
+            size_t size = 0;
+            if (!buffer.contains("uri")) {
+                data = binChunk;
+                size = binSize;
+            } else if (const std::string& uri = buffer["uri"].asString(); isDataUri(uri)) {
+                ownedBuffers.push_back(decodeDataUri(uri, nullptr));
+                data = ownedBuffers.back().data();
+                size = ownedBuffers.back().size();
+            } else {
+                externalFiles.push_back(directory / decodeUri(uri));
+                bufferFiles.emplace_back(externalFiles.back());
+                data = bufferFiles.back().data();
+                size = bufferFiles.back().size();
+            }
+            if (size < byteLength) {
+                fail("buffer is smaller than its byteLength");
+            }
+            buffers.emplace_back(data, size);
+        }
+
+        for (const json::Value& view : document["bufferViews"].getArray()) {
+            int32_t buffer = getIndex(view["buffer"]);
+            size_t offset = static_cast<size_t>(view["byteOffset"].asInt());
+            size_t length = static_cast<size_t>(view["byteLength"].asInt());
+            if (buffer < 0 || buffer >= static_cast<int32_t>(buffers.size()) ||
+                offset > buffers[buffer].second || length > buffers[buffer].second - offset) {
+                fail("buffer view out of range");
+            }
+            BufferView& bufferView = bufferViews.emplace_back();
+            bufferView.data = buffers[buffer].first + offset;
+            bufferView.size = length;
+            bufferView.stride = static_cast<uint32_t>(view["byteStride"].asInt());
+        }
+    }
+
+    void GltfLoader::parseAccessors(const json::Value& document)
+    {
+        for (const json::Value& value : document["accessors"].getArray()) {
+            if (value.contains("sparse")) {
+                fail("sparse accessors are not supported");
+            }
+            Accessor& accessor = accessors.emplace_back();
+            accessor.view = getIndex(value["bufferView"]);
+            accessor.offset = static_cast<size_t>(value["byteOffset"].asInt());
+            accessor.componentType = static_cast<uint32_t>(value["componentType"].asInt());
+            accessor.componentCount = getComponentCount(value["type"].asString());
+            accessor.count = static_cast<uint32_t>(value["count"].asInt());
+            accessor.normalized = value["normalized"].asBool();
+
+            // Validate once so decoding can read without checks
+            if (accessor.view < 0 || accessor.count == 0) {
+                continue;
+            }
+            if (accessor.view >= static_cast<int32_t>(bufferViews.size())) {
+                fail("accessor references a missing buffer view");
+            }
+            const BufferView& view = bufferViews[accessor.view];
+            size_t elementSize = size_t{ getComponentSize(accessor.componentType) } * accessor.componentCount;
+            accessor.stride = view.stride ? view.stride : static_cast<uint32_t>(elementSize);
+            size_t end = accessor.offset + size_t{ accessor.stride } * (accessor.count - 1) + elementSize;
+            if (end > view.size) {
+                fail("accessor out of range");
+            }
+        }
+    }
+
+    void GltfLoader::parseMeshes(const json::Value& document, std::vector<std::vector<uint32_t>>& primitivesByMesh)
+    {
+        auto getAccessor = [&](const json::Value& value) {
+            int32_t index = getIndex(value);
+            if (index >= static_cast<int32_t>(accessors.size())) {
+                fail("primitive references a missing accessor");
+            }
+            return index;
+        };
+
+        uint64_t totalVertices = 0;
+        uint64_t totalIndices = 0;
+        for (const json::Value& mesh : document["meshes"].getArray()) {
+            std::vector<uint32_t>& meshPrimitives = primitivesByMesh.emplace_back();
+            for (const json::Value& value : mesh["primitives"].getArray()) {
+                int64_t mode = value["mode"].asInt(modeTriangles);
+                if (mode != modeTriangles) {
+                    log::warn("gltf: skipped a primitive of {} with mode {}", mesh["name"].asString(), mode);
+                    continue;
+                }
+
+                const json::Value& attributes = value["attributes"];
+                Primitive primitive;
+                primitive.position = getAccessor(attributes["POSITION"]);
+                primitive.normal = getAccessor(attributes["NORMAL"]);
+                primitive.texCoord = getAccessor(attributes["TEXCOORD_0"]);
+                primitive.indices = getAccessor(value["indices"]);
+                if (primitive.position < 0 || accessors[primitive.position].count == 0) {
+                    log::warn("gltf: skipped a primitive of {} without positions", mesh["name"].asString());
+                    continue;
+                }
+                if (primitive.indices >= 0) {
+                    uint32_t type = accessors[primitive.indices].componentType;
+                    if (type != 5121 && type != 5123 && type != 5125) {
+                        fail("invalid index component type");
+                    }
+                    if (accessors[primitive.indices].count == 0) {
+                        continue;
+                    }
+                }
+
+                MeshInfo& info = meshes.emplace_back();
+                info.name = mesh["name"].asString();
+                info.vertexCount = accessors[primitive.position].count;
+                info.indexCount = primitive.indices >= 0 ? accessors[primitive.indices].count : info.vertexCount;
+                info.vertexOffset = static_cast<uint32_t>(totalVertices);
+                info.indexOffset = static_cast<uint32_t>(totalIndices);
+                info.materialIndex = getIndex(value["material"]);
+                totalVertices += info.vertexCount;
+                totalIndices += info.indexCount;
+                if (totalVertices > UINT32_MAX || totalIndices > UINT32_MAX) {
+                    fail("too many vertices");
+                }
+
+                meshPrimitives.push_back(static_cast<uint32_t>(primitives.size()));
+                primitives.push_back(primitive);
+            }
+        }
+        vertexCount = static_cast<uint32_t>(totalVertices);
+        indexCount = static_cast<uint32_t>(totalIndices);
+    }
+
+    void GltfLoader::parseMaterials(const json::Value& document, ThreadPool* pool)
+    {
+        const std::vector<json::Value>& materialValues = document["materials"].getArray();
+        materials.resize(materialValues.size());
+        forEach(pool, materialValues.size(), [&](size_t i) { materials[i] = parseMaterial(materialValues[i]); });
+
+        const json::Value& samplers = document["samplers"];
+        const std::vector<json::Value>& textureValues = document["textures"].getArray();
+        textures.resize(textureValues.size());
+        forEach(pool, textureValues.size(), [&](size_t i) { textures[i] = parseTexture(textureValues[i], samplers); });
+    }
+
+    void GltfLoader::parseImages(const json::Value& document, ThreadPool* pool)
+    {
+        // Decoding data URIs and mapping files dominate, so each image is read on its own
+        // and the memory is kept alive in order afterwards
+        const std::vector<json::Value>& values = document["images"].getArray();
+        images.resize(values.size());
+        std::vector<std::vector<uint8_t>> decoded(values.size());
+        std::vector<MappedFile> mapped(values.size());
+        forEach(pool, values.size(), [&](size_t i) {
+            const json::Value& value = values[i];
+            ImageSource& image = images[i];
+            image.name = value["name"].asString();
+            image.mimeType = value["mimeType"].asString();
+
+            if (int32_t view = getIndex(value["bufferView"]); view >= 0) {
+                if (view >= static_cast<int32_t>(bufferViews.size())) {
+                    fail("image references a missing buffer view");
+                }
+                image.data = bufferViews[view].data;
+                image.size = bufferViews[view].size;
+                return;
+            }
+
+            const std::string& uri = value["uri"].asString();
+            if (isDataUri(uri)) {
+                decoded[i] = decodeDataUri(uri, &image.mimeType);
+                image.data = decoded[i].data();
+                image.size = decoded[i].size();
+                return;
+            }
+
+            // Missing textures shouldn't prevent loading the geometry
+            image.path = directory / decodeUri(uri);
+            try {
+                mapped[i] = MappedFile{ image.path };
+                image.data = mapped[i].data();
+                image.size = mapped[i].size();
+            } catch (const std::runtime_error& error) {
+                log::warn("gltf: {}", error.what());
+            }
+        });
+
+        // Moving keeps the data pointers valid
+        for (size_t i = 0; i < values.size(); i++) {
+            if (!images[i].path.empty()) {
+                externalFiles.push_back(images[i].path);
+            }
+            if (!decoded[i].empty()) {
+                ownedBuffers.push_back(std::move(decoded[i]));
+            }
+            if (mapped[i].data()) {
+                bufferFiles.push_back(std::move(mapped[i]));
+            }
+        }
+    }
+
+    void GltfLoader::parseNodes(const json::Value& document, const std::vector<std::vector<uint32_t>>& primitivesByMesh)
+    {
+        // Without scenes every mesh is placed once at the origin
+        if (!document.contains("scenes")) {
+            for (uint32_t i = 0; i < meshes.size(); i++) {
+                instances.push_back({ i });
+            }
+            return;
+        }
+
+        const json::Value& nodes = document["nodes"];
+        const json::Value& scene = document["scenes"][static_cast<size_t>(document["scene"].asInt(0))];
+        std::vector<int32_t> roots;
+        for (const json::Value& node : scene["nodes"].getArray()) {
+            roots.push_back(getIndex(node));
+        }
+
+        // Iterative traversal, the depth check guards against cycles
+        struct Item
+        {
+            int32_t node;
+            Matrix parent;
+            size_t depth;
+        };
+        std::vector<Item> stack;
+        for (auto it = roots.rbegin(); it != roots.rend(); ++it) {
+            stack.push_back({ *it, Matrix{ 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 }, 0 });
+        }
+        while (!stack.empty()) {
+            Item item = stack.back();
+            stack.pop_back();
+            if (item.node < 0 || item.node >= static_cast<int32_t>(nodes.size()) || item.depth > nodes.size()) {
+                fail("invalid node hierarchy");
+            }
+            const json::Value& node = nodes[static_cast<size_t>(item.node)];
+            Matrix world = multiply(item.parent, getLocalTransform(node));
+
+            int32_t mesh = getIndex(node["mesh"]);
+            if (mesh >= 0 && mesh < static_cast<int32_t>(primitivesByMesh.size())) {
+                for (uint32_t primitive : primitivesByMesh[mesh]) {
+                    instances.push_back({ primitive, world });
+                }
+            }
+            const auto& children = node["children"].getArray();
+            for (auto it = children.rbegin(); it != children.rend(); ++it) {
+                stack.push_back({ getIndex(*it), world, item.depth + 1 });
+            }
+        }
+    }
+
+    void GltfLoader::readFloats(const Accessor& accessor, uint32_t elementCount, uint32_t componentCount,
+                                float* dst, size_t dstStride) const
+    {
+        if (accessor.view < 0) {
+            return;
+        }
+        const uint8_t* src = bufferViews[accessor.view].data + accessor.offset;
+        uint32_t count = std::min(componentCount, accessor.componentCount);
+        elementCount = std::min(elementCount, accessor.count);
+
+        // Floats are copied, everything else is converted per component
+        if (accessor.componentType == 5126) {
+            for (uint32_t i = 0; i < elementCount; i++) {
+                std::memcpy(dst, src, count * sizeof(float));
+                src += accessor.stride;
+                dst = reinterpret_cast<float*>(reinterpret_cast<uint8_t*>(dst) + dstStride);
+            }
+            return;
+        }
+        uint32_t componentSize = getComponentSize(accessor.componentType);
+        for (uint32_t i = 0; i < elementCount; i++) {
+            for (uint32_t c = 0; c < count; c++) {
+                dst[c] = readComponent(src + c * componentSize, accessor.componentType, accessor.normalized);
+            }
+            src += accessor.stride;
+            dst = reinterpret_cast<float*>(reinterpret_cast<uint8_t*>(dst) + dstStride);
+        }
+    }
+
+    void GltfLoader::decodeMesh(uint32_t meshIndex, Vertex* vertices, uint32_t* indices) const
+    {
+        const MeshInfo& mesh = meshes[meshIndex];
+        const Primitive& primitive = primitives[meshIndex];
+        uint32_t count = mesh.vertexCount;
+
+        // Attributes the accessor doesn't cover stay zero
+        std::memset(static_cast<void*>(vertices), 0, sizeof(Vertex) * count);
+        readFloats(accessors[primitive.position], count, 3, vertices->position.data(), sizeof(Vertex));
+        if (primitive.normal >= 0) {
+            readFloats(accessors[primitive.normal], count, 3, vertices->normal.data(), sizeof(Vertex));
+        }
+        if (primitive.texCoord >= 0) {
+            readFloats(accessors[primitive.texCoord], count, 2, vertices->texCoord.data(), sizeof(Vertex));
+        }
+
+        if (primitive.indices < 0) {
+            for (uint32_t i = 0; i < mesh.indexCount; i++) {
+                indices[i] = i;
+            }
+            return;
+        }
+
+        const Accessor& accessor = accessors[primitive.indices];
+        if (accessor.view < 0) {
+            std::memset(indices, 0, sizeof(uint32_t) * mesh.indexCount);
+            return;
+        }
+        const uint8_t* src = bufferViews[accessor.view].data + accessor.offset;
+        size_t stride = accessor.stride;
+        switch (accessor.componentType) {
+            case 5121:
+                for (uint32_t i = 0; i < mesh.indexCount; i++) {
+                    indices[i] = src[stride * i];
+                }
+                break;
+            case 5123:
+                for (uint32_t i = 0; i < mesh.indexCount; i++) {
+                    indices[i] = load<uint16_t>(src + stride * i);
+                }
+                break;
+            default:
+                if (stride == sizeof(uint32_t)) {
+                    std::memcpy(indices, src, sizeof(uint32_t) * mesh.indexCount);
+                } else {
+                    for (uint32_t i = 0; i < mesh.indexCount; i++) {
+                        indices[i] = load<uint32_t>(src + stride * i);
+                    }
+                }
+                break;
+        }
+
+        // Out-of-range indices would read past the vertex buffer on the GPU
+        for (uint32_t i = 0; i < mesh.indexCount; i++) {
+            if (indices[i] >= count) {
+                fail("index out of range in " + mesh.name);
+            }
+        }
+    }
+
+    void GltfLoader::decode(ThreadPool& pool, Vertex* vertices, uint32_t* indices) const
+    {
+        VKT_TRACE_SCOPE("GltfLoader::decode");
+        pool.parallelFor(meshes.size(), [&](size_t i) {
+            const MeshInfo& mesh = meshes[i];
+            decodeMesh(static_cast<uint32_t>(i), vertices + mesh.vertexOffset, indices + mesh.indexOffset);
+        });
+    }
+}
@@ -0,0 +1,330 @@
+#include "vktiny/GpuProfiler.hpp"
+#include "vktiny/Context.hpp"
+#include "vktiny/Trace.hpp"
+#include <algorithm>
+#include <array>
+#include <numeric>
+#include <utility>
+
+namespace vkt
+{
+    ProfileZone::ProfileZone(GpuProfiler& profiler, vk::CommandBuffer commandBuffer,
+                             const std::string& name, bool statistics)
+        : profiler(&profiler)
+        , commandBuffer(commandBuffer)
+        , zone(profiler.beginZone(commandBuffer, name, statistics))
+    {
+    }
+
+    ProfileZone::ProfileZone(ProfileZone&& other) noexcept
+        : profiler(std::exchange(other.profiler, nullptr))
+        , commandBuffer(other.commandBuffer)
+        , zone(std::exchange(other.zone, UINT32_MAX))
+    {
+    }
+
+    ProfileZone& ProfileZone::operator=(ProfileZone&& other) noexcept
+    {
+        if (this != &other) {
+            end();
+            profiler = std::exchange(other.profiler, nullptr);
+            commandBuffer = other.commandBuffer;
+            zone = std::exchange(other.zone, UINT32_MAX);
+        }
+        return *this;
+    }
+
+    ProfileZone::~ProfileZone()
+    {
+        end();
+    }
+
+    void ProfileZone::end()
+    {
+        if (profiler && zone != UINT32_MAX) {
+            profiler->endZone(commandBuffer, zone);
+        }
+        profiler = nullptr;
+    }
+
+    GpuProfiler::GpuProfiler(const Context& context, const GpuProfilerCreateInfo& info)
+        : context(&context)
+        , maxZonesPerFrame(info.maxZonesPerFrame)
+        , historySize(std::max(info.historySize, 1u))
+        , timestampPeriod(context.getTimestampPeriod())
+    {
+        auto queueFamilies = context.getPhysicalDevice().getQueueFamilyProperties();
+        uint32_t validBits = queueFamilies[context.getGraphicsFamily()].timestampValidBits;
+        if (validBits == 0) {
+            throw std::runtime_error("graphics queue doesn't support timestamps");
+        }
+        timestampMask = validBits >= 64 ? ~0ull : (1ull << validBits) - 1;
+
+        if (info.enablePipelineStatistics) {
+            if (!context.getEnabledFeatures().pipelineStatisticsQuery) {
+                throw std::runtime_error("pipelineStatisticsQuery feature is not enabled");
+            }
+            // Results are written in bit order
+            for (uint32_t bit = 0; bit < 32; bit++) {
+                auto flag = static_cast<vk::QueryPipelineStatisticFlagBits>(1u << bit);
+                if (info.pipelineStatistics & flag) {
+                    statisticBits.push_back(flag);
+                }
+            }
+        }
+
+        frames.resize(std::max(info.frameCount, 1u));
+        for (auto& frame : frames) {
+            vk::QueryPoolCreateInfo poolInfo;
+            poolInfo.setQueryType(vk::QueryType::eTimestamp);
+            poolInfo.setQueryCount(maxZonesPerFrame * 2);
+            frame.queryPool = context.getDevice().createQueryPoolUnique(poolInfo, nullptr, context.getDispatcher());
+
+            if (!statisticBits.empty()) {
+                vk::QueryPoolCreateInfo statisticsPoolInfo;
+                statisticsPoolInfo.setQueryType(vk::QueryType::ePipelineStatistics);
+                statisticsPoolInfo.setQueryCount(maxZonesPerFrame);
+                statisticsPoolInfo.setPipelineStatistics(info.pipelineStatistics);
+                frame.statisticsPool =
+                    context.getDevice().createQueryPoolUnique(statisticsPoolInfo, nullptr, context.getDispatcher());
+            }
+        }
+
+#ifndef _WIN32
+        // The monotonic clock is the steady clock's timebase on Linux and Android
+        if (context.isDeviceExtensionEnabled(VK_EXT_CALIBRATED_TIMESTAMPS_EXTENSION_NAME)) {
+            auto domains = context.getPhysicalDevice().getCalibrateableTimeDomainsEXT(context.getDispatcher());
+            auto hasDomain = [&](vk::TimeDomainEXT domain) {
+                return std::find(domains.begin(), domains.end(), domain) != domains.end();
+            };
+            useCalibratedTimestamps = hasDomain(vk::TimeDomainEXT::eDevice) &&
+                hasDomain(vk::TimeDomainEXT::eClockMonotonic);
+        }
+#endif
+        calibrate();
+    }
+
+    void GpuProfiler::calibrate()
+    {
+        framesSinceCalibration = 0;
+        if (useCalibratedTimestamps) {
+            std::array<vk::CalibratedTimestampInfoEXT, 2> infos{
+                vk::CalibratedTimestampInfoEXT{ vk::TimeDomainEXT::eDevice },
+                vk::CalibratedTimestampInfoEXT{ vk::TimeDomainEXT::eClockMonotonic } };
+            std::array<uint64_t, 2> timestamps;
+            uint64_t maxDeviation;
+            vk::Result result = context->getDevice().getCalibratedTimestampsEXT(
+                static_cast<uint32_t>(infos.size()), infos.data(), timestamps.data(), &maxDeviation,
+                context->getDispatcher());
+            if (result == vk::Result::eSuccess) {
+                calibrationTimestamp = timestamps[0];
+                calibrationCpuTime = static_cast<int64_t>(timestamps[1]);
+                return;
+            }
+        }
+
+        // Fallback: take the midpoint of the CPU times around a GPU timestamp
+        vk::QueryPoolCreateInfo poolInfo;
+        poolInfo.setQueryType(vk::QueryType::eTimestamp);
+        poolInfo.setQueryCount(1);
+        vk::UniqueQueryPool queryPool =
+            context->getDevice().createQueryPoolUnique(poolInfo, nullptr, context->getDispatcher());
+
+        int64_t before = trace::now();
+        context->OneTimeSubmitGraphics(
+            [&](const CommandBuffer& cmdBuf) {
+                cmdBuf.get().resetQueryPool(*queryPool, 0, 1, cmdBuf.getDispatcher());
+                cmdBuf.get().writeTimestamp(vk::PipelineStageFlagBits::eBottomOfPipe, *queryPool, 0,
+                                            cmdBuf.getDispatcher());
+            });
+        int64_t after = trace::now();
+
+        auto result = context->getDevice().getQueryPoolResults<uint64_t>(
+            *queryPool, 0, 1, sizeof(uint64_t), sizeof(uint64_t),
+            vk::QueryResultFlagBits::e64 | vk::QueryResultFlagBits::eWait, context->getDispatcher());
+        calibrationTimestamp = result.value[0];
+        calibrationCpuTime = before + (after - before) / 2;
+    }
+
+    int64_t GpuProfiler::toCpuTime(uint64_t timestamp) const
+    {
+        int64_t ticks = static_cast<int64_t>((timestamp - calibrationTimestamp) & timestampMask);
+        if (ticks > static_cast<int64_t>(timestampMask >> 1)) {
+            ticks -= static_cast<int64_t>(timestampMask) + 1;
+        }
+        return calibrationCpuTime + static_cast<int64_t>(ticks * timestampPeriod);
+    }
+
+    void GpuProfiler::beginFrame(vk::CommandBuffer commandBuffer)
+    {
+        // Calibrated timestamps are cheap, so correct for clock drift regularly
+        if (useCalibratedTimestamps && ++framesSinceCalibration >= 120) {
+            calibrate();
+        }
+
+        currentFrame = (currentFrame + 1) % frames.size();
+        Frame& frame = frames[currentFrame];
+        if (frame.submitted) {
+            collect(frame);
+        }
+        frame.zoneNames.clear();
+        frame.statisticsQueries.clear();
+        frame.statisticsCount = 0;
+        frame.statisticsActive = false;
+        frame.submitted = true;
+        commandBuffer.resetQueryPool(*frame.queryPool, 0, maxZonesPerFrame * 2, context->getDispatcher());
+        if (frame.statisticsPool) {
+            commandBuffer.resetQueryPool(*frame.statisticsPool, 0, maxZonesPerFrame, context->getDispatcher());
+        }
+    }
+
+    uint32_t GpuProfiler::beginZone(vk::CommandBuffer commandBuffer, const std::string& name,
+                                    bool statistics)
+    {
+        Frame& frame = frames[currentFrame];
+        if (frame.zoneNames.size() >= maxZonesPerFrame) {
+            return UINT32_MAX;
+        }
+        uint32_t zone = static_cast<uint32_t>(frame.zoneNames.size());
+        frame.zoneNames.push_back(name);
+        commandBuffer.writeTimestamp(vk::PipelineStageFlagBits::eTopOfPipe, *frame.queryPool, zone * 2,
+                                     context->getDispatcher());
+
+        uint32_t statisticsQuery = UINT32_MAX;
+        if (statistics && frame.statisticsPool && !frame.statisticsActive) {
+            statisticsQuery = frame.statisticsCount++;
+            frame.statisticsActive = true;
+            commandBuffer.beginQuery(*frame.statisticsPool, statisticsQuery, {}, context->getDispatcher());
+        }
+        frame.statisticsQueries.push_back(statisticsQuery);
+        return zone;
+    }
+
+    void GpuProfiler::endZone(vk::CommandBuffer commandBuffer, uint32_t zone)
+    {
+        Frame& frame = frames[currentFrame];
+        if (uint32_t statisticsQuery = frame.statisticsQueries[zone]; statisticsQuery != UINT32_MAX) {
+            commandBuffer.endQuery(*frame.statisticsPool, statisticsQuery, context->getDispatcher());
+            frame.statisticsActive = false;
+        }
+        commandBuffer.writeTimestamp(vk::PipelineStageFlagBits::eBottomOfPipe, *frame.queryPool, zone * 2 + 1,
+                                     context->getDispatcher());
+    }
+
+    void GpuProfiler::collect(Frame& frame)
+    {
+        uint32_t queryCount = static_cast<uint32_t>(frame.zoneNames.size()) * 2;
+        if (queryCount == 0) {
+            return;
+        }
+
+        // Don't wait; if the frame hasn't finished yet its results are dropped
+        auto result = context->getDevice().getQueryPoolResults<uint64_t>(
+            *frame.queryPool, 0, queryCount,
+            queryCount * sizeof(uint64_t), sizeof(uint64_t),
+            vk::QueryResultFlagBits::e64, context->getDispatcher());
+        if (result.result != vk::Result::eSuccess) {
+            droppedFrameCount++;
+            return;
+        }
+
+        const auto& timestamps = result.value;
+        for (size_t i = 0; i < frame.zoneNames.size(); i++) {
+            uint64_t ticks = (timestamps[i * 2 + 1] - timestamps[i * 2]) & timestampMask;
+            addSample(frame.zoneNames[i], ticks * timestampPeriod / 1000000.0);
+            if (trace::isEnabled()) {
+                trace::record(trace::intern(frame.zoneNames[i]),
+                              toCpuTime(timestamps[i * 2]), toCpuTime(timestamps[i * 2 + 1]),
+                              trace::Track::Gpu);
+            }
+        }
+
+        if (frame.statisticsCount == 0) {
+            return;
+        }
+        size_t counterCount = statisticBits.size();
+        auto statistics = context->getDevice().getQueryPoolResults<uint64_t>(
+            *frame.statisticsPool, 0, frame.statisticsCount,
+            frame.statisticsCount * counterCount * sizeof(uint64_t),
+            counterCount * sizeof(uint64_t),
+            vk::QueryResultFlagBits::e64, context->getDispatcher());
+        if (statistics.result != vk::Result::eSuccess) {
+            return;
+        }
+        for (size_t i = 0; i < frame.zoneNames.size(); i++) {
+            if (uint32_t query = frame.statisticsQueries[i]; query != UINT32_MAX) {
+                addCounterSample(frame.zoneNames[i], &statistics.value[query * counterCount]);
+            }
+        }
+    }
+
+    void GpuProfiler::addSample(const std::string& name, double milliseconds)
+    {
+        auto& samples = history[name];
+        samples.push_back(milliseconds);
+        if (samples.size() > historySize) {
+            samples.pop_front();
+        }
+    }
+
+    void GpuProfiler::addCounterSample(const std::string& name, const uint64_t* counters)
+    {
+        auto& samples = counterHistory[name];
+        samples.emplace_back(counters, counters + statisticBits.size());
+        if (samples.size() > historySize) {
+            samples.pop_front();
+        }
+    }
+
+    std::vector<ZoneStats> GpuProfiler::getStats() const
+    {
+        std::vector<ZoneStats> stats;
+        for (const auto& [name, samples] : history) {
+            stats.push_back(*getStats(name));
+        }
+        std::sort(stats.begin(), stats.end(),
+                  [](const ZoneStats& a, const ZoneStats& b) { return a.name < b.name; });
+        return stats;
+    }
+
+    std::optional<ZoneStats> GpuProfiler::getStats(const std::string& name) const
+    {
+        auto it = history.find(name);
+        if (it == history.end() || it->second.empty()) {
+            return std::nullopt;
+        }
+
+        std::vector<double> sorted{ it->second.begin(), it->second.end() };
+        std::sort(sorted.begin(), sorted.end());
+        size_t p99Index = (sorted.size() * 99 + 99) / 100 - 1;
+
+        ZoneStats stats;
+        stats.name = name;
+        stats.sampleCount = static_cast<uint32_t>(sorted.size());
+        stats.last = it->second.back();
+        stats.min = sorted.front();
+        stats.avg = std::accumulate(sorted.begin(), sorted.end(), 0.0) / sorted.size();
+        stats.p99 = sorted[std::min(p99Index, sorted.size() - 1)];
+
+        auto counterIt = counterHistory.find(name);
+        if (counterIt == counterHistory.end() || counterIt->second.empty()) {
+            return stats;
+        }
+        const auto& counterSamples = counterIt->second;
+        for (size_t c = 0; c < statisticBits.size(); c++) {
+            CounterStats counter;
+            counter.name = vk::to_string(statisticBits[c]);
+            counter.last = counterSamples.back()[c];
+            counter.min = UINT64_MAX;
+            double sum = 0.0;
+            for (const auto& sample : counterSamples) {
+                counter.min = std::min(counter.min, sample[c]);
+                counter.max = std::max(counter.max, sample[c]);
+                sum += static_cast<double>(sample[c]);
+            }
+            counter.avg = sum / counterSamples.size();
+            stats.counters.push_back(counter);
+        }
+        return stats;
+    }
+}
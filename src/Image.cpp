@@ -1,14 +1,93 @@
 #include "vktiny/Image.hpp"
 #include "vktiny/Buffer.hpp"
 #include "vktiny/CommandBuffer.hpp"
+#include "vktiny/Readback.hpp"
+#include "vktiny/DriverStats.hpp"
+#include <algorithm>
 
 namespace vkt
 {
+    uint32_t getFormatSize(vk::Format format)
+    {
+        switch (format) {
+            case vk::Format::eR8Unorm:
+            case vk::Format::eR8Snorm:
+            case vk::Format::eR8Uint:
+                return 1;
+            case vk::Format::eR8G8Unorm:
+            case vk::Format::eR16Sfloat:
+            case vk::Format::eR16Uint:
+                return 2;
+            case vk::Format::eR8G8B8A8Unorm:
+            case vk::Format::eR8G8B8A8Srgb:
+            case vk::Format::eB8G8R8A8Unorm:
+            case vk::Format::eB8G8R8A8Srgb:
+            case vk::Format::eA2B10G10R10UnormPack32:
+            case vk::Format::eR16G16Sfloat:
+            case vk::Format::eR32Sfloat:
+            case vk::Format::eR32Uint:
+                return 4;
+            case vk::Format::eR16G16B16A16Sfloat:
+            case vk::Format::eR32G32Sfloat:
+                return 8;
+            case vk::Format::eR32G32B32A32Sfloat:
+                return 16;
+            case vk::Format::eBc1RgbUnormBlock:
+            case vk::Format::eBc1RgbSrgbBlock:
+            case vk::Format::eBc1RgbaUnormBlock:
+            case vk::Format::eBc1RgbaSrgbBlock:
+            case vk::Format::eBc4UnormBlock:
+            case vk::Format::eBc4SnormBlock:
+                return 8;
+            case vk::Format::eBc3UnormBlock:
+            case vk::Format::eBc3SrgbBlock:
+            case vk::Format::eBc5UnormBlock:
+            case vk::Format::eBc5SnormBlock:
+            case vk::Format::eBc7UnormBlock:
+            case vk::Format::eBc7SrgbBlock:
+                return 16;
+            default:
+                throw std::runtime_error("unsupported format: " + vk::to_string(format));
+        }
+    }
+
+    vk::Extent2D getFormatBlockExtent(vk::Format format)
+    {
+        return isBlockCompressed(format) ? vk::Extent2D{ 4, 4 } : vk::Extent2D{ 1, 1 };
+    }
+
+    bool isBlockCompressed(vk::Format format)
+    {
+        return format >= vk::Format::eBc1RgbUnormBlock && format <= vk::Format::eBc7SrgbBlock;
+    }
+
+    uint32_t getMipLevelCount(vk::Extent2D extent)
+    {
+        uint32_t levels = 1;
+        while ((extent.width >> levels) > 0 || (extent.height >> levels) > 0) {
+            levels++;
+        }
+        return levels;
+    }
+
+    vk::DeviceSize getImageSize(vk::Extent2D extent, vk::Format format, uint32_t mipLevels)
+    {
+        vk::Extent2D block = getFormatBlockExtent(format);
+        vk::DeviceSize size = 0;
+        for (uint32_t level = 0; level < mipLevels; level++) {
+            vk::DeviceSize blocksX = (std::max(extent.width >> level, 1u) + block.width - 1) / block.width;
+            vk::DeviceSize blocksY = (std::max(extent.height >> level, 1u) + block.height - 1) / block.height;
+            size += blocksX * blocksY * getFormatSize(format);
+        }
+        return size;
+    }
+
     Image::Image(const Context& context,
-                 vk::Extent2D extent, vk::Format format, vk::ImageUsageFlags usage)
+                 vk::Extent2D extent, vk::Format format, vk::ImageUsageFlags usage, uint32_t mipLevels)
         : context(&context)
         , extent(extent)
         , format(format)
+        , mipLevels(mipLevels)
         , imageLayout(vk::ImageLayout::eUndefined)
     {
         create(usage);
@@ -20,22 +99,24 @@ namespace vkt
         vk::ImageCreateInfo createInfo;
         createInfo.setImageType(vk::ImageType::e2D);
         createInfo.setExtent({ extent.width, extent.height, 1 });
-        createInfo.setMipLevels(1);
+        createInfo.setMipLevels(mipLevels);
         createInfo.setArrayLayers(1);
         createInfo.setFormat(format);
         createInfo.setTiling(vk::ImageTiling::eOptimal);
         createInfo.setUsage(usage);
-        image = context->getDevice().createImageUnique(createInfo);
+        image = context->getDevice().createImageUnique(createInfo, nullptr, context->getDispatcher());
     }
 
     void Image::allocate()
     {
-        auto requirements = context->getDevice().getImageMemoryRequirements(*image);
+        auto requirements = context->getDevice().getImageMemoryRequirements(*image, context->getDispatcher());
         auto memoryType = context->findMemoryType(
             requirements.memoryTypeBits,
             vk::MemoryPropertyFlagBits::eDeviceLocal);
-        memory = context->getDevice().allocateMemoryUnique({ requirements.size, memoryType });
-        context->getDevice().bindImageMemory(*image, *memory, 0);
+        memory = context->getDevice().allocateMemoryUnique({ requirements.size, memoryType }, nullptr,
+                                                           context->getDispatcher());
+        stats::increment(stats::Counter::AllocateMemory);
+        context->getDevice().bindImageMemory(*image, *memory, 0, context->getDispatcher());
     }
 
     void Image::createImageView()
@@ -44,8 +125,8 @@ namespace vkt
         createInfo.setImage(*image);
         createInfo.setViewType(vk::ImageViewType::e2D);
         createInfo.setFormat(format);
-        createInfo.setSubresourceRange({ vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1 });
-        view = context->getDevice().createImageViewUnique(createInfo);
+        createInfo.setSubresourceRange({ vk::ImageAspectFlagBits::eColor, 0, mipLevels, 0, 1 });
+        view = context->getDevice().createImageViewUnique(createInfo, nullptr, context->getDispatcher());
     }
 
     void Image::createSampler()
@@ -62,7 +143,12 @@ namespace vkt
         samplerInfo.maxAnisotropy = 1.0;
         samplerInfo.anisotropyEnable = false;
         samplerInfo.maxLod = 1.0f;
-        sampler = context->getDevice().createSamplerUnique(samplerInfo);
+        sampler = context->getDevice().createSamplerUnique(samplerInfo, nullptr, context->getDispatcher());
+    }
+
+    void Image::createSampler(const vk::SamplerCreateInfo& samplerInfo)
+    {
+        sampler = context->getDevice().createSamplerUnique(samplerInfo, nullptr, context->getDispatcher());
     }
 
     //void Image::copyBuffer(const Buffer& buffer)
@@ -83,8 +169,69 @@ namespace vkt
     {
         context->OneTimeSubmitGraphics(
             [&](const CommandBuffer& cmdBuf) {
-                cmdBuf.transitionImageLayout(*image, imageLayout, newLayout);
+                cmdBuf.transitionImageLayout(*image, imageLayout, newLayout, 0, mipLevels);
             });
         imageLayout = newLayout;
     }
+
+    void Image::upload(const CommandBuffer& cmdBuf, vk::Buffer srcBuffer, vk::DeviceSize srcOffset)
+    {
+        // One region per level. The extent of a compressed level may be smaller than a
+        // block, which is valid since it spans the whole subresource.
+        std::vector<vk::BufferImageCopy> regions(mipLevels);
+        for (uint32_t level = 0; level < mipLevels; level++) {
+            vk::Extent2D mipExtent = getMipExtent(level);
+            regions[level].setBufferOffset(srcOffset);
+            regions[level].setImageSubresource({ vk::ImageAspectFlagBits::eColor, level, 0, 1 });
+            regions[level].setImageExtent({ mipExtent.width, mipExtent.height, 1 });
+            srcOffset += getMipSize(level);
+        }
+        cmdBuf.transitionImageLayout(*image, imageLayout, vk::ImageLayout::eTransferDstOptimal, 0, mipLevels);
+        cmdBuf.copyBufferToImage(srcBuffer, *image, regions);
+        cmdBuf.transitionImageLayout(*image, vk::ImageLayout::eTransferDstOptimal,
+                                     vk::ImageLayout::eShaderReadOnlyOptimal, 0, mipLevels);
+        imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
+    }
+
+    vk::Extent2D Image::getMipExtent(uint32_t level) const
+    {
+        return { std::max(extent.width >> level, 1u), std::max(extent.height >> level, 1u) };
+    }
+
+    vk::DeviceSize Image::getMipSize(uint32_t level) const
+    {
+        return getImageSize(getMipExtent(level), format);
+    }
+
+    vk::DeviceSize Image::getSize() const
+    {
+        return getImageSize(extent, format, mipLevels);
+    }
+
+    ReadbackFuture Image::readback(ReadbackRing& ring, const CommandBuffer& cmdBuf, vk::Fence fence) const
+    {
+        using vkIL = vk::ImageLayout;
+        using vkPS = vk::PipelineStageFlagBits;
+        using vkAF = vk::AccessFlagBits;
+        // Transitioning out of eUndefined would discard the contents
+        if (imageLayout == vkIL::eUndefined) {
+            throw std::runtime_error("Image::readback: the image has no defined contents");
+        }
+        ReadbackFuture future = ring.allocate(getMipSize(0), fence);
+
+        // Return to the tracked layout so that it stays valid for the next transition
+        cmdBuf.transitionImageLayout(*image, imageLayout, vkIL::eTransferSrcOptimal, 0, mipLevels);
+        cmdBuf.copyImageToBuffer(*image, ring.getBuffer(), extent, future.getOffset());
+        cmdBuf.transitionImageLayout(*image, vkIL::eTransferSrcOptimal, imageLayout, 0, mipLevels);
+        cmdBuf.memoryBarrier(vkPS::eTransfer, vkAF::eTransferWrite, vkPS::eHost, vkAF::eHostRead);
+        return future;
+    }
+
+    ReadbackFuture Image::readback(ReadbackRing& ring) const
+    {
+        return ring.submit(
+            [&](const CommandBuffer& cmdBuf, vk::Fence fence) {
+                return readback(ring, cmdBuf, fence);
+            });
+    }
 }
@@ -0,0 +1,294 @@
+#include "vktiny/Json.hpp"
+#include <cctype>
+#include <charconv>
+#include <stdexcept>
+
+namespace vkt::json
+{
+    namespace
+    {
+        const Value nullValue;
+    }
+
+    const Value& Value::operator[](size_t index) const
+    {
+        if (type != Type::Array || index >= array.size()) {
+            return nullValue;
+        }
+        return array[index];
+    }
+
+    const Value& Value::operator[](std::string_view key) const
+    {
+        if (type == Type::Object) {
+            for (const auto& [name, value] : object) {
+                if (name == key) {
+                    return value;
+                }
+            }
+        }
+        return nullValue;
+    }
+
+    bool Value::contains(std::string_view key) const
+    {
+        return !(*this)[key].isNull();
+    }
+
+    class Parser
+    {
+    public:
+        Parser(std::string_view text)
+            : text(text)
+        {
+        }
+
+        Value parseDocument()
+        {
+            Value value = parseValue(0);
+            skipWhitespace();
+            if (pos != text.size()) {
+                fail("unexpected trailing characters");
+            }
+            return value;
+        }
+
+    private:
+        // Guards against stack overflow on malicious input
+        static constexpr int maxDepth = 256;
+
+        [[noreturn]] void fail(const char* message) const
+        {
+            throw std::runtime_error("json: " + std::string(message) + " at offset " + std::to_string(pos));
+        }
+
+        void skipWhitespace()
+        {
+            while (pos < text.size() &&
+                   (text[pos] == ' ' || text[pos] == '\n' || text[pos] == '\r' || text[pos] == '\t')) {
+                pos++;
+            }
+        }
+
+        bool consume(std::string_view token)
+        {
+            if (text.substr(pos, token.size()) == token) {
+                pos += token.size();
+                return true;
+            }
+            return false;
+        }
+
+        void expect(char c)
+        {
+            skipWhitespace();
+            if (pos >= text.size() || text[pos] != c) {
+                fail((std::string("expected '") + c + "'").c_str());
+            }
+            pos++;
+        }
+
+        Value parseValue(int depth)
+        {
+            if (depth > maxDepth) {
+                fail("nesting too deep");
+            }
+            skipWhitespace();
+            if (pos >= text.size()) {
+                fail("unexpected end of input");
+            }
+
+            Value value;
+            char c = text[pos];
+            if (c == '{') {
+                pos++;
+                value.type = Value::Type::Object;
+                skipWhitespace();
+                if (pos < text.size() && text[pos] == '}') {
+                    pos++;
+                    return value;
+                }
+                while (true) {
+                    skipWhitespace();
+                    if (pos >= text.size() || text[pos] != '"') {
+                        fail("expected member name");
+                    }
+                    std::string key = parseString();
+                    expect(':');
+                    value.object.emplace_back(std::move(key), parseValue(depth + 1));
+                    skipWhitespace();
+                    if (consume(",")) {
+                        continue;
+                    }
+                    expect('}');
+                    return value;
+                }
+            }
+            if (c == '[') {
+                pos++;
+                value.type = Value::Type::Array;
+                skipWhitespace();
+                if (pos < text.size() && text[pos] == ']') {
+                    pos++;
+                    return value;
+                }
+                while (true) {
+                    value.array.push_back(parseValue(depth + 1));
+                    skipWhitespace();
+                    if (consume(",")) {
+                        continue;
+                    }
+                    expect(']');
+                    return value;
+                }
+            }
+            if (c == '"') {
+                value.type = Value::Type::String;
+                value.string = parseString();
+                return value;
+            }
+            if (consume("true")) {
+                value.type = Value::Type::Bool;
+                value.boolean = true;
+                return value;
+            }
+            if (consume("false")) {
+                value.type = Value::Type::Bool;
+                return value;
+            }
+            if (consume("null")) {
+                return value;
+            }
+            value.type = Value::Type::Number;
+            value.number = parseNumber();
+            return value;
+        }
+
+        double parseNumber()
+        {
+            size_t begin = pos;
+            while (pos < text.size() && (std::isdigit(static_cast<unsigned char>(text[pos])) ||
+                                         text[pos] == '-' || text[pos] == '+' ||
+                                         text[pos] == '.' || text[pos] == 'e' || text[pos] == 'E')) {
+                pos++;
+            }
+            if (begin == pos) {
+                fail("unexpected character");
+            }
+            // from_chars ignores the locale, unlike strtod
+            double result = 0.0;
+            auto [end, error] = std::from_chars(text.data() + begin, text.data() + pos, result);
+            if (error == std::errc::result_out_of_range) {
+                fail("number out of range");
+            }
+            if (error != std::errc{} || end != text.data() + pos) {
+                fail("invalid number");
+            }
+            return result;
+        }
+
+        uint32_t parseHex4()
+        {
+            if (pos + 4 > text.size()) {
+                fail("invalid unicode escape");
+            }
+            uint32_t code = 0;
+            auto result = std::from_chars(text.data() + pos, text.data() + pos + 4, code, 16);
+            if (result.ptr != text.data() + pos + 4) {
+                fail("invalid unicode escape");
+            }
+            pos += 4;
+            return code;
+        }
+
+        static void appendUtf8(std::string& out, uint32_t code)
+        {
+            if (code < 0x80) {
+                out += static_cast<char>(code);
+            } else if (code < 0x800) {
+                out += static_cast<char>(0xC0 | (code >> 6));
+                out += static_cast<char>(0x80 | (code & 0x3F));
+            } else if (code < 0x10000) {
+                out += static_cast<char>(0xE0 | (code >> 12));
+                out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+                out += static_cast<char>(0x80 | (code & 0x3F));
+            } else {
+                out += static_cast<char>(0xF0 | (code >> 18));
+                out += static_cast<char>(0x80 | ((code >> 12) & 0x3F));
+                out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+                out += static_cast<char>(0x80 | (code & 0x3F));
+            }
+        }
+
+        std::string parseString()
+        {
+            pos++; // opening quote
+            size_t begin = pos;
+
+            // Fast path for strings without escapes, e.g. large base64 buffers
+            while (pos < text.size() && text[pos] != '"' && text[pos] != '\\') {
+                pos++;
+            }
+            std::string result{ text.substr(begin, pos - begin) };
+
+            while (true) {
+                if (pos >= text.size()) {
+                    fail("unterminated string");
+                }
+                char c = text[pos++];
+                if (c == '"') {
+                    return result;
+                }
+                if (c != '\\') {
+                    result += c;
+                    continue;
+                }
+                if (pos >= text.size()) {
+                    fail("unterminated string");
+                }
+                char escape = text[pos++];
+                switch (escape) {
+                    case '"':
+                    case '\\':
+                    case '/':
+                        result += escape;
+                        break;
+                    case 'b':
+                        result += '\b';
+                        break;
+                    case 'f':
+                        result += '\f';
+                        break;
+                    case 'n':
+                        result += '\n';
+                        break;
+                    case 'r':
+                        result += '\r';
+                        break;
+                    case 't':
+                        result += '\t';
+                        break;
+                    case 'u': {
+                        uint32_t code = parseHex4();
+                        if (code >= 0xD800 && code < 0xDC00 && consume("\\u")) {
+                            uint32_t low = parseHex4();
+                            code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                        }
+                        appendUtf8(result, code);
+                        break;
+                    }
+                    default:
+                        fail("invalid escape");
+                }
+            }
+        }
+
+        std::string_view text;
+        size_t pos = 0;
+    };
+
+    Value parse(std::string_view text)
+    {
+        return Parser{ text }.parseDocument();
+    }
+}
@@ -0,0 +1,239 @@
+#include "vktiny/Ktx2.hpp"
+#include "vktiny/Image.hpp"
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+
+#if __has_include(<basisu_transcoder.h>)
+#include <basisu_transcoder.h>
+#define VKT_HAS_BASISU 1
+#endif
+
+namespace vkt
+{
+    namespace
+    {
+        constexpr uint8_t identifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+        constexpr size_t headerSize = 80;
+        constexpr size_t levelIndexEntrySize = 24;
+
+        // Khronos data format descriptor values
+        constexpr uint32_t colorModelEtc1s = 163;
+        constexpr uint32_t colorModelUastc = 166;
+        constexpr uint32_t transferSrgb = 2;
+        constexpr uint32_t etc1sChannelAAA = 15;
+        constexpr uint32_t uastcChannelRGBA = 3;
+        constexpr uint32_t uastcChannelRRRG = 5;
+
+        template <typename T>
+        T read(const uint8_t* data, size_t offset)
+        {
+            T value;
+            std::memcpy(&value, data + offset, sizeof(T));
+            return value;
+        }
+
+        [[noreturn]] void fail(const std::string& message)
+        {
+            throw std::runtime_error("ktx2: " + message);
+        }
+
+        bool isSampled(const Context& context, vk::Format format)
+        {
+            vk::FormatProperties properties = context.getPhysicalDevice().getFormatProperties(format);
+            return static_cast<bool>(properties.optimalTilingFeatures & vk::FormatFeatureFlagBits::eSampledImage);
+        }
+
+        vk::Format toSrgb(vk::Format format)
+        {
+            switch (format) {
+                case vk::Format::eBc1RgbUnormBlock:
+                    return vk::Format::eBc1RgbSrgbBlock;
+                case vk::Format::eBc3UnormBlock:
+                    return vk::Format::eBc3SrgbBlock;
+                case vk::Format::eBc7UnormBlock:
+                    return vk::Format::eBc7SrgbBlock;
+                case vk::Format::eR8G8B8A8Unorm:
+                    return vk::Format::eR8G8B8A8Srgb;
+                default:
+                    return format;
+            }
+        }
+    }
+
+    Ktx2File::Ktx2File(const uint8_t* data, size_t size)
+        : data(data)
+        , size(size)
+    {
+        if (!isKtx2(data, size) || size < headerSize) {
+            fail("not a KTX2 file");
+        }
+        format = static_cast<vk::Format>(read<uint32_t>(data, 12));
+        extent.width = read<uint32_t>(data, 20);
+        extent.height = std::max(read<uint32_t>(data, 24), 1u);
+        uint32_t depth = read<uint32_t>(data, 28);
+        uint32_t layerCount = read<uint32_t>(data, 32);
+        uint32_t faceCount = read<uint32_t>(data, 36);
+        uint32_t levelCount = std::max(read<uint32_t>(data, 40), 1u);
+        supercompression = static_cast<Ktx2Supercompression>(read<uint32_t>(data, 44));
+        if (extent.width == 0 || depth > 1 || layerCount > 1 || faceCount != 1) {
+            fail("only 2D textures with a single layer and face are supported");
+        }
+        if (levelCount > getMipLevelCount(extent) || size < headerSize + levelCount * levelIndexEntrySize) {
+            fail("invalid level count");
+        }
+
+        for (uint32_t level = 0; level < levelCount; level++) {
+            size_t entry = headerSize + level * levelIndexEntrySize;
+            Ktx2Level& range = levels.emplace_back();
+            range.offset = read<uint64_t>(data, entry);
+            range.size = read<uint64_t>(data, entry + 8);
+            range.uncompressedSize = read<uint64_t>(data, entry + 16);
+            if (range.offset > size || range.size > size - range.offset) {
+                fail("level out of bounds");
+            }
+        }
+
+        // The basic descriptor block follows the total size
+        uint32_t dfdOffset = read<uint32_t>(data, 48);
+        uint32_t dfdSize = read<uint32_t>(data, 52);
+        if (dfdSize >= 28 && dfdOffset <= size && dfdSize <= size - dfdOffset) {
+            const uint8_t* dfd = data + dfdOffset;
+            uint32_t blockSize = read<uint32_t>(dfd, 8) >> 16;
+            colorModel = dfd[12];
+            srgb = dfd[14] == transferSrgb;
+            uint32_t sampleCount = blockSize >= 24 ? (blockSize - 24) / 16 : 0;
+            for (uint32_t i = 0; i < sampleCount && 28 + (i + 1) * 16 <= dfdSize; i++) {
+                uint32_t channel = dfd[28 + i * 16 + 3] & 0x0F;
+                if (colorModel == colorModelEtc1s) {
+                    alpha = alpha || channel == etc1sChannelAAA;
+                } else if (colorModel == colorModelUastc) {
+                    alpha = alpha || channel == uastcChannelRGBA || channel == uastcChannelRRRG;
+                }
+            }
+        }
+        if (format == vk::Format::eUndefined && !isBasis()) {
+            fail("undefined format without Basis Universal data");
+        }
+    }
+
+    bool Ktx2File::isKtx2(const uint8_t* data, size_t size)
+    {
+        return data && size >= sizeof(identifier) && std::memcmp(data, identifier, sizeof(identifier)) == 0;
+    }
+
+    bool Ktx2File::isBasis() const
+    {
+        return supercompression == Ktx2Supercompression::BasisLZ || isUastc();
+    }
+
+    bool Ktx2File::isUastc() const
+    {
+        return format == vk::Format::eUndefined && colorModel == colorModelUastc;
+    }
+
+    std::span<const uint8_t> Ktx2File::getLevelData(uint32_t level) const
+    {
+        return { data + levels[level].offset, static_cast<size_t>(levels[level].size) };
+    }
+
+    void Ktx2File::copyLevels(std::vector<uint8_t>& texels) const
+    {
+        if (isBasis()) {
+            fail("Basis Universal data needs to be transcoded");
+        }
+        if (supercompression != Ktx2Supercompression::None) {
+            fail("unsupported supercompression scheme " + std::to_string(static_cast<uint32_t>(supercompression)));
+        }
+        texels.reserve(texels.size() + getImageSize(extent, format, getMipLevels()));
+        for (uint32_t level = 0; level < getMipLevels(); level++) {
+            vk::Extent2D mipExtent{ std::max(extent.width >> level, 1u), std::max(extent.height >> level, 1u) };
+            if (levels[level].size != getImageSize(mipExtent, format)) {
+                fail("level " + std::to_string(level) + " has an unexpected size");
+            }
+            std::span<const uint8_t> bytes = getLevelData(level);
+            texels.insert(texels.end(), bytes.begin(), bytes.end());
+        }
+    }
+
+    BasisTranscoder getDefaultBasisTranscoder()
+    {
+#ifdef VKT_HAS_BASISU
+        static std::once_flag initFlag;
+        std::call_once(initFlag, []() { basist::basisu_transcoder_init(); });
+        return [](const Ktx2File& file, vk::Format target, std::vector<uint8_t>& texels) {
+            basist::transcoder_texture_format format;
+            switch (target) {
+                case vk::Format::eBc1RgbUnormBlock:
+                case vk::Format::eBc1RgbSrgbBlock:
+                    format = basist::transcoder_texture_format::cTFBC1_RGB;
+                    break;
+                case vk::Format::eBc3UnormBlock:
+                case vk::Format::eBc3SrgbBlock:
+                    format = basist::transcoder_texture_format::cTFBC3_RGBA;
+                    break;
+                case vk::Format::eBc5UnormBlock:
+                    format = basist::transcoder_texture_format::cTFBC5_RG;
+                    break;
+                case vk::Format::eBc7UnormBlock:
+                case vk::Format::eBc7SrgbBlock:
+                    format = basist::transcoder_texture_format::cTFBC7_RGBA;
+                    break;
+                case vk::Format::eR8G8B8A8Unorm:
+                case vk::Format::eR8G8B8A8Srgb:
+                    format = basist::transcoder_texture_format::cTFRGBA32;
+                    break;
+                default:
+                    return false;
+            }
+            if (file.getSize() > UINT32_MAX) {
+                return false;
+            }
+            basist::ktx2_transcoder transcoder;
+            if (!transcoder.init(file.getData(), static_cast<uint32_t>(file.getSize())) ||
+                !transcoder.start_transcoding()) {
+                return false;
+            }
+
+            // Output capacity is given in blocks, or in pixels for RGBA32
+            vk::Extent2D extent = file.getExtent();
+            texels.resize(getImageSize(extent, target, file.getMipLevels()));
+            size_t offset = 0;
+            for (uint32_t level = 0; level < file.getMipLevels(); level++) {
+                vk::Extent2D mipExtent{ std::max(extent.width >> level, 1u), std::max(extent.height >> level, 1u) };
+                vk::DeviceSize levelSize = getImageSize(mipExtent, target);
+                auto capacity = static_cast<uint32_t>(levelSize / getFormatSize(target));
+                if (!transcoder.transcode_image_level(level, 0, 0, texels.data() + offset, capacity, format)) {
+                    return false;
+                }
+                offset += levelSize;
+            }
+            return true;
+        };
+#else
+        return {};
+#endif
+    }
+
+    vk::Format selectTranscodeFormat(const Context& context, const Ktx2File& file, bool srgb)
+    {
+        using vkF = vk::Format;
+        if (context.getEnabledFeatures().textureCompressionBC) {
+            std::vector<vkF> candidates;
+            if (file.isUastc()) {
+                candidates = { vkF::eBc7UnormBlock, file.hasAlpha() ? vkF::eBc3UnormBlock : vkF::eBc1RgbUnormBlock };
+            } else if (file.hasAlpha()) {
+                candidates = { vkF::eBc3UnormBlock, vkF::eBc7UnormBlock };
+            } else {
+                candidates = { vkF::eBc1RgbUnormBlock, vkF::eBc7UnormBlock };
+            }
+            for (vkF candidate : candidates) {
+                vkF format = srgb ? toSrgb(candidate) : candidate;
+                if (isSampled(context, format)) {
+                    return format;
+                }
+            }
+        }
+        return srgb ? vkF::eR8G8B8A8Srgb : vkF::eR8G8B8A8Unorm;
+    }
+}
@@ -0,0 +1,220 @@
+#include "vktiny/Log.hpp"
+#include <atomic>
+#include <iostream>
+#include <thread>
+#include <unordered_map>
+
+namespace vkt::log
+{
+    namespace
+    {
+        struct Node
+        {
+            std::atomic<Node*> next{ nullptr };
+            Level level = Level::Info;
+            std::string message;
+
+            // Only set for Vulkan debug messages, which are deduplicated by ID
+            bool vulkan = false;
+            int32_t messageId = 0;
+        };
+
+        const char* toString(Level level)
+        {
+            switch (level) {
+                case Level::Trace:
+                    return "trace";
+                case Level::Info:
+                    return "info";
+                case Level::Warn:
+                    return "warn";
+                case Level::Error:
+                    return "error";
+                default:
+                    return "";
+            }
+        }
+
+        // Intrusive MPSC queue (Vyukov). Producers only do an exchange and a store,
+        // the single consumer is the logging thread.
+        class Logger
+        {
+        public:
+            Logger()
+                : head(&stub)
+                , tail(&stub)
+            {
+                thread = std::thread([this] { run(); });
+            }
+
+            ~Logger()
+            {
+                stopRequested.store(true, std::memory_order_release);
+                pushCount.fetch_add(1, std::memory_order_release);
+                pushCount.notify_one();
+                thread.join();
+                if (tail != &stub) {
+                    delete tail;
+                }
+            }
+
+            void push(Node* node)
+            {
+                Node* prev = head.exchange(node, std::memory_order_acq_rel);
+                prev->next.store(node, std::memory_order_release);
+                messageCount.fetch_add(1, std::memory_order_relaxed);
+                pushCount.fetch_add(1, std::memory_order_release);
+                pushCount.notify_one();
+            }
+
+            void flush()
+            {
+                uint64_t target = messageCount.load(std::memory_order_relaxed);
+                uint64_t written = writtenCount.load(std::memory_order_acquire);
+                while (written < target) {
+                    writtenCount.wait(written);
+                    written = writtenCount.load(std::memory_order_acquire);
+                }
+            }
+
+            std::atomic<Level> level{ Level::Info };
+            std::atomic<uint64_t> performanceCount{ 0 };
+
+            // Owned by the logger; replaced through setSink
+            std::atomic<std::function<void(Level, std::string_view)>*> sink{ nullptr };
+
+        private:
+            void run()
+            {
+                while (true) {
+                    uint64_t seen = pushCount.load(std::memory_order_acquire);
+                    bool wroteAny = false;
+                    while (Node* node = pop()) {
+                        writeNode(*node);
+                        wroteAny = true;
+                        writtenCount.fetch_add(1, std::memory_order_release);
+                    }
+                    if (wroteAny) {
+                        std::cout.flush();
+                        writtenCount.notify_all();
+                    }
+                    if (stopRequested.load(std::memory_order_acquire) && tail->next.load() == nullptr) {
+                        break;
+                    }
+                    pushCount.wait(seen, std::memory_order_acquire);
+                }
+                delete sink.exchange(nullptr);
+            }
+
+            // Returns the node holding the next message; it becomes the new stub
+            Node* pop()
+            {
+                Node* oldTail = tail;
+                Node* next = oldTail->next.load(std::memory_order_acquire);
+                if (!next) {
+                    return nullptr;
+                }
+                tail = next;
+                if (oldTail != &stub) {
+                    delete oldTail;
+                }
+                return next;
+            }
+
+            void writeNode(const Node& node)
+            {
+                std::string_view message = node.message;
+                std::string repeated;
+                if (node.vulkan) {
+                    uint64_t count = ++messageIdCounts[node.messageId];
+                    if ((count & (count - 1)) != 0) {
+                        return;
+                    }
+                    if (count > 1) {
+                        repeated = node.message + " (repeated " + std::to_string(count) + " times)";
+                        message = repeated;
+                    }
+                }
+
+                if (auto* customSink = sink.load(std::memory_order_acquire)) {
+                    (*customSink)(node.level, message);
+                    return;
+                }
+                std::ostream& out = node.level >= Level::Warn ? std::cerr : std::cout;
+                out << "[" << toString(node.level) << "] " << message << '\n';
+            }
+
+            std::atomic<Node*> head;
+            Node* tail;
+            Node stub;
+
+            std::atomic<uint64_t> pushCount{ 0 };
+            std::atomic<uint64_t> messageCount{ 0 };
+            std::atomic<uint64_t> writtenCount{ 0 };
+            std::atomic<bool> stopRequested{ false };
+            std::unordered_map<int32_t, uint64_t> messageIdCounts;
+            std::thread thread;
+        };
+
+        Logger& getLogger()
+        {
+            static Logger logger;
+            return logger;
+        }
+    }
+
+    void write(Level level, std::string message)
+    {
+        Node* node = new Node;
+        node->level = level;
+        node->message = std::move(message);
+        getLogger().push(node);
+    }
+
+    void flush()
+    {
+        getLogger().flush();
+    }
+
+    void setLevel(Level level)
+    {
+        getLogger().level.store(level, std::memory_order_relaxed);
+    }
+
+    bool isEnabled(Level level)
+    {
+        return level >= getLogger().level.load(std::memory_order_relaxed);
+    }
+
+    void setSink(std::function<void(Level, std::string_view)> sink)
+    {
+        // The previous sink may still be in use by the logging thread
+        flush();
+        auto* newSink = sink ? new std::function<void(Level, std::string_view)>(std::move(sink)) : nullptr;
+        delete getLogger().sink.exchange(newSink, std::memory_order_acq_rel);
+    }
+
+    void vulkanMessage(Level level, bool performance, int32_t messageId,
+                       const char* messageIdName, const char* message)
+    {
+        Logger& logger = getLogger();
+        if (performance) {
+            logger.performanceCount.fetch_add(1, std::memory_order_relaxed);
+        }
+        if (level < logger.level.load(std::memory_order_relaxed)) {
+            return;
+        }
+
+        Node* node = new Node;
+        node->level = level;
+        node->message = std::string("<") + (messageIdName ? messageIdName : "") + "> " + message;
+        node->vulkan = true;
+        node->messageId = messageId;
+        logger.push(node);
+    }
+
+    uint64_t getPerformanceMessageCount()
+    {
+        return getLogger().performanceCount.load(std::memory_order_relaxed);
+    }
+}
@@ -0,0 +1,118 @@
+#include "vktiny/MappedFile.hpp"
+#include "vktiny/Trace.hpp"
+#include <stdexcept>
+#include <utility>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace vkt
+{
+    MappedFile::MappedFile(const std::filesystem::path& path)
+    {
+        VKT_TRACE_SCOPE("MappedFile");
+        auto fail = [&](const char* what) {
+            throw std::runtime_error(std::string("failed to ") + what + " " + path.string());
+        };
+
+#ifdef _WIN32
+        HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                                  OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (file == INVALID_HANDLE_VALUE) {
+            fail("open");
+        }
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(file, &size)) {
+            CloseHandle(file);
+            fail("stat");
+        }
+        fileSize = static_cast<size_t>(size.QuadPart);
+        if (fileSize > 0) {
+            mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            if (mapping) {
+                mapped = static_cast<const uint8_t*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+            }
+        }
+        CloseHandle(file);
+        if (fileSize > 0 && !mapped) {
+            close();
+            fail("map");
+        }
+#else
+        int file = ::open(path.c_str(), O_RDONLY);
+        if (file < 0) {
+            fail("open");
+        }
+        struct stat status;
+        if (fstat(file, &status) != 0) {
+            ::close(file);
+            fail("stat");
+        }
+        fileSize = static_cast<size_t>(status.st_size);
+        if (fileSize > 0) {
+            void* address = mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, file, 0);
+            ::close(file);
+            if (address == MAP_FAILED) {
+                fileSize = 0;
+                fail("map");
+            }
+            // Accessors are decoded front to back
+            madvise(address, fileSize, MADV_SEQUENTIAL);
+            mapped = static_cast<const uint8_t*>(address);
+        } else {
+            ::close(file);
+        }
+#endif
+    }
+
+    MappedFile::MappedFile(MappedFile&& other) noexcept
+    {
+        *this = std::move(other);
+    }
+
+    MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+    {
+        if (this != &other) {
+            close();
+            mapped = std::exchange(other.mapped, nullptr);
+            fileSize = std::exchange(other.fileSize, 0);
+#ifdef _WIN32
+            mapping = std::exchange(other.mapping, nullptr);
+#endif
+        }
+        return *this;
+    }
+
+    MappedFile::~MappedFile()
+    {
+        close();
+    }
+
+    void MappedFile::close()
+    {
+#ifdef _WIN32
+        if (mapped) {
+            UnmapViewOfFile(mapped);
+        }
+        if (mapping) {
+            CloseHandle(mapping);
+        }
+        mapping = nullptr;
+#else
+        if (mapped) {
+            munmap(const_cast<uint8_t*>(mapped), fileSize);
+        }
+#endif
+        mapped = nullptr;
+        fileSize = 0;
+    }
+}
@@ -0,0 +1,526 @@
+#include "vktiny/MeshOptimizer.hpp"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+#include <tuple>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace vkt::meshopt
+{
+    namespace
+    {
+        static_assert(sizeof(Vertex) == 32, "Vertex is hashed and compared bytewise");
+
+        constexpr uint32_t invalidIndex = ~0u;
+
+        using Triangle = std::array<uint32_t, 3>;
+
+        struct TriangleHash
+        {
+            size_t operator()(const Triangle& triangle) const
+            {
+                uint64_t hash = triangle[0];
+                hash = hash * 0x9E3779B97F4A7C15ull + triangle[1];
+                hash = hash * 0x9E3779B97F4A7C15ull + triangle[2];
+                return static_cast<size_t>(hash ^ (hash >> 32));
+            }
+        };
+
+        // Forsyth's scoring parameters
+        constexpr uint32_t forsythCacheSize = 32;
+        constexpr uint32_t forsythMaxValence = 32;
+        constexpr float lastTriangleScore = 0.75f;
+        constexpr float cacheDecayPower = 1.5f;
+        constexpr float valenceBoostScale = 2.0f;
+        constexpr float valenceBoostPower = 0.5f;
+
+        struct ScoreTables
+        {
+            float cache[forsythCacheSize];
+            float valence[forsythMaxValence + 1];
+
+            ScoreTables()
+            {
+                for (uint32_t i = 0; i < forsythCacheSize; i++) {
+                    if (i < 3) {
+                        cache[i] = lastTriangleScore;
+                    } else {
+                        float scale = 1.0f / (forsythCacheSize - 3);
+                        cache[i] = std::pow(1.0f - (i - 3) * scale, cacheDecayPower);
+                    }
+                }
+                valence[0] = 0.0f;
+                for (uint32_t i = 1; i <= forsythMaxValence; i++) {
+                    valence[i] = valenceBoostScale * std::pow(static_cast<float>(i), -valenceBoostPower);
+                }
+            }
+        };
+
+        float getVertexScore(const ScoreTables& tables, int32_t cachePosition, uint32_t liveTriangles)
+        {
+            // Vertices without remaining triangles don't matter
+            if (liveTriangles == 0) {
+                return -1.0f;
+            }
+            float score = cachePosition >= 0 ? tables.cache[cachePosition] : 0.0f;
+            return score + tables.valence[std::min(liveTriangles, forsythMaxValence)];
+        }
+
+        uint32_t hashVertex(const Vertex& vertex)
+        {
+            uint32_t words[8];
+            std::memcpy(words, &vertex, sizeof(words));
+            uint32_t hash = 2166136261u;
+            for (uint32_t word : words) {
+                hash = (hash ^ word) * 16777619u;
+            }
+            return hash ^ (hash >> 15);
+        }
+
+        using Vec3 = std::array<float, 3>;
+
+        Vec3 sub(const Vec3& a, const Vec3& b) { return { a[0] - b[0], a[1] - b[1], a[2] - b[2] }; }
+        float dot(const Vec3& a, const Vec3& b) { return a[0] * b[0] + a[1] * b[1] + a[2] * b[2]; }
+        Vec3 cross(const Vec3& a, const Vec3& b)
+        {
+            return { a[1] * b[2] - a[2] * b[1], a[2] * b[0] - a[0] * b[2], a[0] * b[1] - a[1] * b[0] };
+        }
+
+        // Vertex clustering on a grid of gridSize cells per axis
+        std::vector<uint32_t> clusterVertices(const std::vector<uint32_t>& indices, const std::vector<Vertex>& vertices,
+                                              const Vec3& boundsMin, float cellScale, uint32_t gridSize)
+        {
+            auto getCell = [&](uint32_t vertex) {
+                uint64_t cell = 0;
+                for (int axis = 0; axis < 3; axis++) {
+                    float position = (vertices[vertex].position[axis] - boundsMin[axis]) * cellScale * gridSize;
+                    uint32_t coord = std::min(static_cast<uint32_t>(std::max(position, 0.0f)), gridSize - 1);
+                    cell = cell * gridSize + coord;
+                }
+                return cell;
+            };
+
+            // The representative of a cell is the vertex closest to the mean of its vertices
+            struct Cell
+            {
+                Vec3 sum{};
+                uint32_t count = 0;
+                uint32_t representative = invalidIndex;
+                float distance = 0.0f;
+            };
+            std::unordered_map<uint64_t, uint32_t> cellIndices;
+            std::vector<Cell> cells;
+            std::vector<uint32_t> vertexCells(vertices.size(), invalidIndex);
+            for (uint32_t index : indices) {
+                if (vertexCells[index] != invalidIndex) {
+                    continue;
+                }
+                auto [it, inserted] = cellIndices.try_emplace(getCell(index), static_cast<uint32_t>(cells.size()));
+                if (inserted) {
+                    cells.emplace_back();
+                }
+                Cell& cell = cells[it->second];
+                for (int axis = 0; axis < 3; axis++) {
+                    cell.sum[axis] += vertices[index].position[axis];
+                }
+                cell.count++;
+                vertexCells[index] = it->second;
+            }
+            for (uint32_t vertex = 0; vertex < vertices.size(); vertex++) {
+                if (vertexCells[vertex] == invalidIndex) {
+                    continue;
+                }
+                Cell& cell = cells[vertexCells[vertex]];
+                Vec3 mean{ cell.sum[0] / cell.count, cell.sum[1] / cell.count, cell.sum[2] / cell.count };
+                Vec3 offset = sub(vertices[vertex].position, mean);
+                float distance = dot(offset, offset);
+                if (cell.representative == invalidIndex || distance < cell.distance) {
+                    cell.representative = vertex;
+                    cell.distance = distance;
+                }
+            }
+
+            // Keep triangles whose corners fall into three different cells, once each
+            std::vector<uint32_t> result;
+            std::unordered_set<Triangle, TriangleHash> emitted;
+            for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+                uint32_t a = cells[vertexCells[indices[i + 0]]].representative;
+                uint32_t b = cells[vertexCells[indices[i + 1]]].representative;
+                uint32_t c = cells[vertexCells[indices[i + 2]]].representative;
+                if (a == b || b == c || c == a) {
+                    continue;
+                }
+                // Rotate the smallest index first, which keeps the winding, so the key
+                // is exact and the two sides of double-sided geometry stay distinct
+                while (a > b || a > c) {
+                    std::tie(a, b, c) = std::make_tuple(b, c, a);
+                }
+                if (!emitted.insert({ a, b, c }).second) {
+                    continue;
+                }
+                result.insert(result.end(), { a, b, c });
+            }
+            return result;
+        }
+    }
+
+    VertexCacheStats analyzeVertexCache(const std::vector<uint32_t>& indices, uint32_t vertexCount, uint32_t cacheSize)
+    {
+        VertexCacheStats stats;
+        if (indices.empty() || vertexCount == 0) {
+            return stats;
+        }
+
+        // A vertex hits if fewer than cacheSize misses happened since it was loaded
+        std::vector<uint32_t> timestamps(vertexCount, 0);
+        uint32_t time = cacheSize + 1;
+        for (uint32_t index : indices) {
+            if (time - timestamps[index] > cacheSize) {
+                timestamps[index] = time++;
+                stats.verticesTransformed++;
+            }
+        }
+        stats.acmr = static_cast<float>(stats.verticesTransformed) / (indices.size() / 3);
+        stats.atvr = static_cast<float>(stats.verticesTransformed) / vertexCount;
+        return stats;
+    }
+
+    void deduplicateVertices(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+    {
+        size_t tableSize = 16;
+        while (tableSize < vertices.size() * 2) {
+            tableSize *= 2;
+        }
+        std::vector<uint32_t> table(tableSize, invalidIndex);
+        std::vector<uint32_t> remap(vertices.size());
+        std::vector<Vertex> unique;
+        unique.reserve(vertices.size());
+
+        // Open addressing over the unique vertices
+        for (uint32_t vertex = 0; vertex < vertices.size(); vertex++) {
+            size_t slot = hashVertex(vertices[vertex]) & (tableSize - 1);
+            while (table[slot] != invalidIndex &&
+                   std::memcmp(&unique[table[slot]], &vertices[vertex], sizeof(Vertex)) != 0) {
+                slot = (slot + 1) & (tableSize - 1);
+            }
+            if (table[slot] == invalidIndex) {
+                table[slot] = static_cast<uint32_t>(unique.size());
+                unique.push_back(vertices[vertex]);
+            }
+            remap[vertex] = table[slot];
+        }
+        for (uint32_t& index : indices) {
+            index = remap[index];
+        }
+        vertices = std::move(unique);
+    }
+
+    void optimizeVertexCache(std::vector<uint32_t>& indices, uint32_t vertexCount)
+    {
+        static const ScoreTables tables;
+        uint32_t triangleCount = static_cast<uint32_t>(indices.size() / 3);
+        if (triangleCount == 0) {
+            return;
+        }
+
+        // Triangles adjacent to each vertex; the first liveTriangles[v] entries are not emitted yet
+        std::vector<uint32_t> liveTriangles(vertexCount, 0);
+        for (uint32_t index : indices) {
+            liveTriangles[index]++;
+        }
+        std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+        for (uint32_t vertex = 0; vertex < vertexCount; vertex++) {
+            adjacencyOffsets[vertex + 1] = adjacencyOffsets[vertex] + liveTriangles[vertex];
+        }
+        std::vector<uint32_t> adjacency(indices.size());
+        {
+            std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+            for (uint32_t triangle = 0; triangle < triangleCount; triangle++) {
+                for (int corner = 0; corner < 3; corner++) {
+                    adjacency[fill[indices[triangle * 3 + corner]]++] = triangle;
+                }
+            }
+        }
+
+        std::vector<int32_t> cachePositions(vertexCount, -1);
+        std::vector<float> vertexScores(vertexCount);
+        for (uint32_t vertex = 0; vertex < vertexCount; vertex++) {
+            vertexScores[vertex] = getVertexScore(tables, -1, liveTriangles[vertex]);
+        }
+        std::vector<float> triangleScores(triangleCount);
+        std::vector<bool> emitted(triangleCount, false);
+        uint32_t bestTriangle = 0;
+        for (uint32_t triangle = 0; triangle < triangleCount; triangle++) {
+            const uint32_t* corners = &indices[triangle * 3];
+            triangleScores[triangle] = vertexScores[corners[0]] + vertexScores[corners[1]] + vertexScores[corners[2]];
+            if (triangleScores[triangle] > triangleScores[bestTriangle]) {
+                bestTriangle = triangle;
+            }
+        }
+
+        std::vector<uint32_t> result;
+        result.reserve(indices.size());
+        std::vector<uint32_t> cache;
+        std::vector<uint32_t> newCache;
+        cache.reserve(forsythCacheSize + 3);
+        newCache.reserve(forsythCacheSize + 3);
+        uint32_t inputCursor = 0;
+
+        while (result.size() < indices.size()) {
+            // Nothing in the cache has triangles left, continue with the next triangle in input order
+            if (bestTriangle == invalidIndex) {
+                while (emitted[inputCursor]) {
+                    inputCursor++;
+                }
+                bestTriangle = inputCursor;
+            }
+
+            const uint32_t* corners = &indices[bestTriangle * 3];
+            result.insert(result.end(), corners, corners + 3);
+            emitted[bestTriangle] = true;
+
+            // Remove the triangle from its vertices' live lists
+            for (int corner = 0; corner < 3; corner++) {
+                uint32_t vertex = corners[corner];
+                uint32_t* begin = &adjacency[adjacencyOffsets[vertex]];
+                uint32_t* end = begin + liveTriangles[vertex];
+                std::iter_swap(std::find(begin, end, bestTriangle), end - 1);
+                liveTriangles[vertex]--;
+            }
+
+            // Move the triangle's vertices to the front of the LRU cache
+            newCache.assign(corners, corners + 3);
+            for (uint32_t vertex : cache) {
+                if (vertex != corners[0] && vertex != corners[1] && vertex != corners[2]) {
+                    newCache.push_back(vertex);
+                }
+            }
+            for (size_t i = forsythCacheSize; i < newCache.size(); i++) {
+                cachePositions[newCache[i]] = -1;
+            }
+
+            // Update the scores of the cached and evicted vertices and of their triangles
+            bestTriangle = invalidIndex;
+            float bestScore = -1.0f;
+            for (size_t i = 0; i < newCache.size(); i++) {
+                uint32_t vertex = newCache[i];
+                if (i < forsythCacheSize) {
+                    cachePositions[vertex] = static_cast<int32_t>(i);
+                }
+                float score = getVertexScore(tables, cachePositions[vertex], liveTriangles[vertex]);
+                float delta = score - vertexScores[vertex];
+                vertexScores[vertex] = score;
+
+                const uint32_t* begin = &adjacency[adjacencyOffsets[vertex]];
+                for (const uint32_t* it = begin; it != begin + liveTriangles[vertex]; ++it) {
+                    triangleScores[*it] += delta;
+                    if (i < forsythCacheSize && triangleScores[*it] > bestScore) {
+                        bestScore = triangleScores[*it];
+                        bestTriangle = *it;
+                    }
+                }
+            }
+            newCache.resize(std::min<size_t>(newCache.size(), forsythCacheSize));
+            std::swap(cache, newCache);
+        }
+        indices = std::move(result);
+    }
+
+    void optimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<Vertex>& vertices, float threshold)
+    {
+        constexpr uint32_t cacheSize = 16;
+        uint32_t triangleCount = static_cast<uint32_t>(indices.size() / 3);
+        if (triangleCount < 2) {
+            return;
+        }
+
+        // Split at triangles that miss the cache with all three vertices; reordering
+        // whole clusters then barely changes the cache efficiency
+        std::vector<uint32_t> clusterStarts;
+        std::vector<uint32_t> timestamps(vertices.size(), 0);
+        uint32_t time = cacheSize + 1;
+        for (uint32_t triangle = 0; triangle < triangleCount; triangle++) {
+            uint32_t misses = 0;
+            for (int corner = 0; corner < 3; corner++) {
+                uint32_t vertex = indices[triangle * 3 + corner];
+                if (time - timestamps[vertex] > cacheSize) {
+                    timestamps[vertex] = time++;
+                    misses++;
+                }
+            }
+            if (triangle == 0 || misses == 3) {
+                clusterStarts.push_back(triangle);
+            }
+        }
+        if (clusterStarts.size() < 2) {
+            return;
+        }
+        clusterStarts.push_back(triangleCount);
+
+        // Area-weighted centroid and normal of every cluster and of the whole mesh
+        struct Cluster
+        {
+            Vec3 centroid{};
+            Vec3 normal{};
+            float area = 0.0f;
+            float sortKey = 0.0f;
+        };
+        size_t clusterCount = clusterStarts.size() - 1;
+        std::vector<Cluster> clusters(clusterCount);
+        Vec3 meshCentroid{};
+        float meshArea = 0.0f;
+        for (size_t c = 0; c < clusterCount; c++) {
+            Cluster& cluster = clusters[c];
+            for (uint32_t triangle = clusterStarts[c]; triangle < clusterStarts[c + 1]; triangle++) {
+                const Vec3& p0 = vertices[indices[triangle * 3 + 0]].position;
+                const Vec3& p1 = vertices[indices[triangle * 3 + 1]].position;
+                const Vec3& p2 = vertices[indices[triangle * 3 + 2]].position;
+                Vec3 normal = cross(sub(p1, p0), sub(p2, p0));
+                float area = std::sqrt(dot(normal, normal));
+                for (int axis = 0; axis < 3; axis++) {
+                    cluster.centroid[axis] += (p0[axis] + p1[axis] + p2[axis]) * (area / 3.0f);
+                    cluster.normal[axis] += normal[axis];
+                }
+                cluster.area += area;
+            }
+            for (int axis = 0; axis < 3; axis++) {
+                meshCentroid[axis] += cluster.centroid[axis];
+            }
+            meshArea += cluster.area;
+        }
+        if (meshArea <= 0.0f) {
+            return;
+        }
+        for (float& value : meshCentroid) {
+            value /= meshArea;
+        }
+
+        // Clusters facing away from the center are more likely to occlude the rest
+        for (Cluster& cluster : clusters) {
+            if (cluster.area <= 0.0f) {
+                continue;
+            }
+            Vec3 centroid{ cluster.centroid[0] / cluster.area, cluster.centroid[1] / cluster.area,
+                           cluster.centroid[2] / cluster.area };
+            float length = std::sqrt(dot(cluster.normal, cluster.normal));
+            if (length > 0.0f) {
+                cluster.sortKey = dot(sub(centroid, meshCentroid), cluster.normal) / length;
+            }
+        }
+        std::vector<uint32_t> order(clusterCount);
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+            return clusters[a].sortKey > clusters[b].sortKey;
+        });
+
+        std::vector<uint32_t> result;
+        result.reserve(indices.size());
+        for (uint32_t c : order) {
+            result.insert(result.end(), indices.begin() + clusterStarts[c] * 3, indices.begin() + clusterStarts[c + 1] * 3);
+        }
+        uint32_t vertexCount = static_cast<uint32_t>(vertices.size());
+        float acmrBefore = analyzeVertexCache(indices, vertexCount, cacheSize).acmr;
+        float acmrAfter = analyzeVertexCache(result, vertexCount, cacheSize).acmr;
+        if (acmrAfter <= acmrBefore * threshold) {
+            indices = std::move(result);
+        }
+    }
+
+    void optimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices)
+    {
+        std::vector<uint32_t> remap(vertices.size(), invalidIndex);
+        std::vector<Vertex> reordered;
+        reordered.reserve(vertices.size());
+        for (uint32_t& index : indices) {
+            if (remap[index] == invalidIndex) {
+                remap[index] = static_cast<uint32_t>(reordered.size());
+                reordered.push_back(vertices[index]);
+            }
+            index = remap[index];
+        }
+        vertices = std::move(reordered);
+    }
+
+    std::vector<uint32_t> simplify(const std::vector<uint32_t>& indices, const std::vector<Vertex>& vertices,
+                                   uint32_t targetIndexCount)
+    {
+        if (indices.size() <= targetIndexCount || indices.empty()) {
+            return indices;
+        }
+
+        Vec3 boundsMin = vertices[indices[0]].position;
+        Vec3 boundsMax = boundsMin;
+        for (uint32_t index : indices) {
+            for (int axis = 0; axis < 3; axis++) {
+                boundsMin[axis] = std::min(boundsMin[axis], vertices[index].position[axis]);
+                boundsMax[axis] = std::max(boundsMax[axis], vertices[index].position[axis]);
+            }
+        }
+        float extent = std::max({ boundsMax[0] - boundsMin[0], boundsMax[1] - boundsMin[1], boundsMax[2] - boundsMin[2] });
+        if (extent <= 0.0f) {
+            return {};
+        }
+        float cellScale = 1.0f / extent;
+
+        // The triangle count grows with the grid resolution, find the finest grid within the target
+        std::vector<uint32_t> best;
+        uint32_t low = 1;
+        uint32_t high = 1024;
+        while (low <= high) {
+            uint32_t gridSize = (low + high) / 2;
+            std::vector<uint32_t> result = clusterVertices(indices, vertices, boundsMin, cellScale, gridSize);
+            if (result.size() <= targetIndexCount) {
+                if (result.size() > best.size()) {
+                    best = std::move(result);
+                }
+                low = gridSize + 1;
+            } else {
+                high = gridSize - 1;
+            }
+        }
+        return best;
+    }
+
+    OptimizeStats optimizeMesh(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices,
+                               std::vector<Lod>& lods, const OptimizeInfo& info)
+    {
+        OptimizeStats stats;
+        stats.vertexCountBefore = static_cast<uint32_t>(vertices.size());
+        stats.before = analyzeVertexCache(indices, stats.vertexCountBefore);
+
+        if (info.deduplicate) {
+            deduplicateVertices(vertices, indices);
+        }
+        if (info.vertexCache) {
+            optimizeVertexCache(indices, static_cast<uint32_t>(vertices.size()));
+        }
+        if (info.overdraw) {
+            optimizeOverdraw(indices, vertices, info.overdrawThreshold);
+        }
+        if (info.vertexFetch) {
+            optimizeVertexFetch(vertices, indices);
+        }
+        stats.vertexCountAfter = static_cast<uint32_t>(vertices.size());
+        stats.after = analyzeVertexCache(indices, stats.vertexCountAfter);
+
+        // Every level is simplified from the full mesh, which keeps errors from accumulating
+        lods.assign(1, { 0, static_cast<uint32_t>(indices.size()) });
+        size_t fullCount = indices.size();
+        for (uint32_t level = 0; level < info.lodCount; level++) {
+            uint32_t target = static_cast<uint32_t>(lods.back().indexCount * info.lodRatio) / 3 * 3;
+            std::vector<uint32_t> lod = simplify({ indices.begin(), indices.begin() + fullCount }, vertices, target);
+            if (lod.empty() || lod.size() >= lods.back().indexCount) {
+                break;
+            }
+            if (info.vertexCache) {
+                optimizeVertexCache(lod, static_cast<uint32_t>(vertices.size()));
+            }
+            lods.push_back({ static_cast<uint32_t>(indices.size()), static_cast<uint32_t>(lod.size()) });
+            indices.insert(indices.end(), lod.begin(), lod.end());
+        }
+        return stats;
+    }
+}
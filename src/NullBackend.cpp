@@ -0,0 +1,852 @@
+#include "vktiny/NullBackend.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <unordered_map>
+
+namespace vkt::null
+{
+    namespace
+    {
+        struct Counter
+        {
+            std::string name;
+            std::atomic<uint64_t> count{ 0 };
+        };
+
+        struct Registry
+        {
+            std::mutex mutex;
+            std::deque<Counter> counters; // stable addresses
+        };
+
+        Registry& getRegistry()
+        {
+            static Registry registry;
+            return registry;
+        }
+
+        std::atomic<uint64_t>& registerCounter(const char* function)
+        {
+            Registry& registry = getRegistry();
+            std::lock_guard lock{ registry.mutex };
+            Counter& counter = registry.counters.emplace_back();
+            counter.name = std::string("vk") + function;
+            return counter.count;
+        }
+
+// Each stub registers its counter on first use, after that counting is a relaxed add
+#define VKT_NULL_COUNT()                                                     \
+    static std::atomic<uint64_t>& callCount = registerCounter(__func__); \
+    callCount.fetch_add(1, std::memory_order_relaxed)
+
+        // Handles are either unique fake values or pointers to the objects below.
+        // Non-dispatchable handles are 64-bit integers on 32-bit platforms, hence the casts.
+        template <typename Handle>
+        Handle makeHandle()
+        {
+            static std::atomic<uintptr_t> nextHandle{ 0x1000 };
+            return (Handle)nextHandle.fetch_add(0x10, std::memory_order_relaxed);
+        }
+
+        template <typename Handle, typename T>
+        Handle toHandle(T* object)
+        {
+            return (Handle) reinterpret_cast<uintptr_t>(object);
+        }
+
+        template <typename T, typename Handle>
+        T* fromHandle(Handle handle)
+        {
+            return reinterpret_cast<T*>((uintptr_t)handle);
+        }
+
+        struct BufferObject
+        {
+            VkDeviceSize size;
+        };
+
+        struct ImageObject
+        {
+            VkDeviceSize size;
+        };
+
+        struct MemoryObject
+        {
+            VkDeviceSize size;
+            std::unique_ptr<std::byte[]> data; // allocated on first map
+        };
+
+        const VkPhysicalDevice physicalDevice = makeHandle<VkPhysicalDevice>();
+
+        template <typename T>
+        VkResult fillArray(const std::vector<T>& values, uint32_t* count, T* data)
+        {
+            if (!data) {
+                *count = static_cast<uint32_t>(values.size());
+                return VK_SUCCESS;
+            }
+            uint32_t written = std::min(*count, static_cast<uint32_t>(values.size()));
+            std::copy_n(values.begin(), written, data);
+            *count = written;
+            return written < values.size() ? VK_INCOMPLETE : VK_SUCCESS;
+        }
+
+        PFN_vkVoidFunction lookup(const char* name);
+
+        // Instance
+
+        VKAPI_ATTR VkResult VKAPI_CALL CreateInstance(const VkInstanceCreateInfo*, const VkAllocationCallbacks*,
+                                                      VkInstance* instance)
+        {
+            VKT_NULL_COUNT();
+            *instance = makeHandle<VkInstance>();
+            return VK_SUCCESS;
+        }
+
+        VKAPI_ATTR void VKAPI_CALL DestroyInstance(VkInstance, const VkAllocationCallbacks*)
+        {
+            VKT_NULL_COUNT();
+        }
+
+        VKAPI_ATTR VkResult VKAPI_CALL EnumerateInstanceVersion(uint32_t* apiVersion)
+        {
+            VKT_NULL_COUNT();
+            *apiVersion = VK_API_VERSION_1_2;
+            return VK_SUCCESS;
+        }
+
+        VKAPI_ATTR VkResult VKAPI_CALL EnumerateInstanceExtensionProperties(const char*, uint32_t* count,
+                                                                            VkExtensionProperties* properties)
+        {
+            VKT_NULL_COUNT();
+            return fillArray<VkExtensionProperties>({}, count, properties);
+        }
+
+        VKAPI_ATTR VkResult VKAPI_CALL EnumerateInstanceLayerProperties(uint32_t* count, VkLayerProperties* properties)
+        {
+            VKT_NULL_COUNT();
+            return fillArray<VkLayerProperties>({}, count, properties);
+        }
+
+        VKAPI_ATTR VkResult VKAPI_CALL EnumeratePhysicalDevices(VkInstance, uint32_t* count,
+                                                                VkPhysicalDevice* devices)
+        {
+            VKT_NULL_COUNT();
+            return fillArray<VkPhysicalDevice>({ physicalDevice }, count, devices);
+        }
+
+        VKAPI_ATTR void VKAPI_CALL GetPhysicalDeviceProperties(VkPhysicalDevice, VkPhysicalDeviceProperties* properties)
+        {
+            VKT_NULL_COUNT();
+            *properties = {};
+            properties->apiVersion = VK_API_VERSION_1_2;
+            properties->deviceType = VK_PHYSICAL_DEVICE_TYPE_CPU;
+            std::strcpy(properties->deviceName, "vktiny null device");
+            properties->limits.timestampPeriod = 1.0f;
+            properties->limits.timestampComputeAndGraphics = VK_TRUE;
+            properties->limits.maxBoundDescriptorSets = 32;
+            properties->limits.maxComputeWorkGroupCount[0] = UINT32_MAX;
+            properties->limits.maxComputeWorkGroupCount[1] = UINT16_MAX;
+            properties->limits.maxComputeWorkGroupCount[2] = UINT16_MAX;
+            properties->limits.maxComputeWorkGroupSize[0] = 1024;
+            properties->limits.maxComputeWorkGroupSize[1] = 1024;
+            properties->limits.maxComputeWorkGroupSize[2] = 64;
+            properties->limits.maxComputeWorkGroupInvocations = 1024;
+            properties->limits.minStorageBufferOffsetAlignment = 16;
+            properties->limits.minUniformBufferOffsetAlignment = 16;
+            properties->limits.nonCoherentAtomSize = 1;
+        }
+
+        VKAPI_ATTR void VKAPI_CALL GetPhysicalDeviceProperties2(VkPhysicalDevice device,
+                                                                VkPhysicalDeviceProperties2* properties)
+        {
+            VKT_NULL_COUNT();
+            GetPhysicalDeviceProperties(device, &properties->properties);
+            for (auto* next = static_cast<VkBaseOutStructure*>(properties->pNext); next; next = next->pNext) {
+                if (next->sType == VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ID_PROPERTIES) {
+                    auto* idProperties = reinterpret_cast<VkPhysicalDeviceIDProperties*>(next);
+                    std::memset(idProperties->deviceUUID, 0, VK_UUID_SIZE);
+                    std::memset(idProperties->driverUUID, 0, VK_UUID_SIZE);
+                }
+            }
+        }
+
+        VKAPI_ATTR void VKAPI_CALL GetPhysicalDeviceFeatures(VkPhysicalDevice, VkPhysicalDeviceFeatures* features)
+        {
+            VKT_NULL_COUNT();
+            // Everything is supported
+            auto* bits = reinterpret_cast<VkBool32*>(features);
+            std::fill_n(bits, sizeof(VkPhysicalDeviceFeatures) / sizeof(VkBool32), VK_TRUE);
+        }
+
+        VKAPI_ATTR void VKAPI_CALL GetPhysicalDeviceFormatProperties(VkPhysicalDevice, VkFormat,
+                                                                     VkFormatProperties* properties)
+        {
+            VKT_NULL_COUNT();
+            properties->linearTilingFeatures = ~VkFormatFeatureFlags{ 0 };
+            properties->optimalTilingFeatures = ~VkFormatFeatureFlags{ 0 };
+            properties->bufferFeatures = ~VkFormatFeatureFlags{ 0 };
+        }
+
+        VKAPI_ATTR void VKAPI_CALL GetPhysicalDeviceQueueFamilyProperties(VkPhysicalDevice, uint32_t* count,
+                                                                          VkQueueFamilyProperties* properties)
+        {
+            VKT_NULL_COUNT();
+            VkQueueFamilyProperties family{};
+            family.queueFlags = VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT | VK_QUEUE_TRANSFER_BIT;
+            family.queueCount = 1;
+            family.timestampValidBits = 64;
+            family.minImageTransferGranularity = { 1, 1, 1 };
+            fillArray<VkQueueFamilyProperties>({ family }, count, properties);
+        }
+
+        VKAPI_ATTR void VKAPI_CALL GetPhysicalDeviceMemoryProperties(VkPhysicalDevice,
+                                                                     VkPhysicalDeviceMemoryProperties* properties)
+        {
+            VKT_NULL_COUNT();
+            *properties = {};
+            properties->memoryHeapCount = 1;
+            properties->memoryHeaps[0] = { VkDeviceSize{ 8 } << 30, VK_MEMORY_HEAP_DEVICE_LOCAL_BIT };
+            properties->memoryTypeCount = 1;
+            properties->memoryTypes[0].propertyFlags =
+                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                VK_MEMORY_PROPERTY_HOST_COHERENT_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT;
+            properties->memoryTypes[0].heapIndex = 0;
+        }
+
+        VKAPI_ATTR VkResult VKAPI_CALL EnumerateDeviceExtensionProperties(VkPhysicalDevice, const char*,
+                                                                          uint32_t* count,
+                                                                          VkExtensionProperties* properties)
+        {
+            VKT_NULL_COUNT();
+            return fillArray<VkExtensionProperties>({}, count, properties);
+        }
+
+        VKAPI_ATTR VkResult VKAPI_CALL CreateDevice(VkPhysicalDevice, const VkDeviceCreateInfo*,
+                                                    const VkAllocationCallbacks*, VkDevice* device)
+        {
+            VKT_NULL_COUNT();
+            *device = makeHandle<VkDevice>();
+            return VK_SUCCESS;
+        }
+
+        VKAPI_ATTR PFN_vkVoidFunction VKAPI_CALL GetDeviceProcAddr(VkDevice, const char* name)
+        {
+            return lookup(name);
+        }
+
+        // Device
+
+        VKAPI_ATTR void VKAPI_CALL DestroyDevice(VkDevice, const VkAllocationCallbacks*)
+        {
+            VKT_NULL_COUNT();
+        }
+
+        VKAPI_ATTR void VKAPI_CALL GetDeviceQueue(VkDevice, uint32_t, uint32_t, VkQueue* queue)
+        {
+            VKT_NULL_COUNT();
+            static const VkQueue nullQueue = makeHandle<VkQueue>();
+            *queue = nullQueue;
+        }
+
+        VKAPI_ATTR VkResult VKAPI_CALL DeviceWaitIdle(VkDevice)
+        {
+            VKT_NULL_COUNT();
+            return VK_SUCCESS;
+        }
+
+        VKAPI_ATTR VkResult VKAPI_CALL QueueSubmit(VkQueue, uint32_t, const VkSubmitInfo*, VkFence)
+        {
+            VKT_NULL_COUNT();
+            return VK_SUCCESS;
+        }
+
+        VKAPI_ATTR VkResult VKAPI_CALL QueueWaitIdle(VkQueue)
+        {
+            VKT_NULL_COUNT();
+            return VK_SUCCESS;
+        }
+
+        // Memory
+
+        VKAPI_ATTR VkResult VKAPI_CALL AllocateMemory(VkDevice, const VkMemoryAllocateInfo* info,
+                                                      const VkAllocationCallbacks*, VkDeviceMemory* memory)
+        {
+            VKT_NULL_COUNT();
+            *memory = toHandle<VkDeviceMemory>(new MemoryObject{ info->allocationSize });
+            return VK_SUCCESS;
+        }
+
+        VKAPI_ATTR void VKAPI_CALL FreeMemory(VkDevice, VkDeviceMemory memory, const VkAllocationCallbacks*)
+        {
+            VKT_NULL_COUNT();
+            delete fromHandle<MemoryObject>(memory);
+        }
+
+        VKAPI_ATTR VkResult VKAPI_CALL MapMemory(VkDevice, VkDeviceMemory memory, VkDeviceSize offset,
+                                                 VkDeviceSize, VkMemoryMapFlags, void** data)
+        {
+            VKT_NULL_COUNT();
+            auto* object = fromHandle<MemoryObject>(memory);
+            if (!object->data) {
+                object->data = std::make_unique<std::byte[]>(static_cast<size_t>(object->size));
+            }
+            *data = object->data.get() + offset;
+            return VK_SUCCESS;
+        }
+
+        VKAPI_ATTR void VKAPI_CALL UnmapMemory(VkDevice, VkDeviceMemory)
+        {
+            VKT_NULL_COUNT();
+        }
+
+        // Buffers and images
+
+        VKAPI_ATTR VkResult VKAPI_CALL CreateBuffer(VkDevice, const VkBufferCreateInfo* info,
+                                                    const VkAllocationCallbacks*, VkBuffer* buffer)
+        {
+            VKT_NULL_COUNT();
+            *buffer = toHandle<VkBuffer>(new BufferObject{ info->size });
+            return VK_SUCCESS;
+        }
+
+        VKAPI_ATTR void VKAPI_CALL DestroyBuffer(VkDevice, VkBuffer buffer, const VkAllocationCallbacks*)
+        {
+            VKT_NULL_COUNT();
+            delete fromHandle<BufferObject>(buffer);
+        }
+
+        VKAPI_ATTR void VKAPI_CALL GetBufferMemoryRequirements(VkDevice, VkBuffer buffer,
+                                                               VkMemoryRequirements* requirements)
+        {
+            VKT_NULL_COUNT();
+            *requirements = { fromHandle<BufferObject>(buffer)->size, 16, 1 };
+        }
+
+        VKAPI_ATTR VkResult VKAPI_CALL BindBufferMemory(VkDevice, VkBuffer, VkDeviceMemory, VkDeviceSize)
+        {
+            VKT_NULL_COUNT();
+            return VK_SUCCESS;
+        }
+
+        VKAPI_ATTR VkDeviceAddress VKAPI_CALL GetBufferDeviceAddress(VkDevice, const VkBufferDeviceAddressInfo* info)
+        {
+            VKT_NULL_COUNT();
+            return static_cast<VkDeviceAddress>((uintptr_t)info->buffer);
+        }
+
+        VKAPI_ATTR VkResult VKAPI_CALL CreateImage(VkDevice, const VkImageCreateInfo* info,
+                                                   const VkAllocationCallbacks*, VkImage* image)
+        {
+            VKT_NULL_COUNT();
+            // Large enough for any uncompressed format
+            VkDeviceSize size = VkDeviceSize{ 16 } * info->extent.width * info->extent.height *
+                                info->extent.depth * info->arrayLayers;
+            *image = toHandle<VkImage>(new ImageObject{ size });
+            return VK_SUCCESS;
+        }
+
+        VKAPI_ATTR void VKAPI_CALL DestroyImage(VkDevice, VkImage image, const VkAllocationCallbacks*)
+        {
+            VKT_NULL_COUNT();
+            delete fromHandle<ImageObject>(image);
+        }
+
+        VKAPI_ATTR void VKAPI_CALL GetImageMemoryRequirements(VkDevice, VkImage image,
+                                                              VkMemoryRequirements* requirements)
+        {
+            VKT_NULL_COUNT();
+            *requirements = { fromHandle<ImageObject>(image)->size, 256, 1 };
+        }
+
+        VKAPI_ATTR VkResult VKAPI_CALL BindImageMemory(VkDevice, VkImage, VkDeviceMemory, VkDeviceSize)
+        {
+            VKT_NULL_COUNT();
+            return VK_SUCCESS;
+        }
+
+        VKAPI_ATTR VkResult VKAPI_CALL CreateImageView(VkDevice, const VkImageViewCreateInfo*,
+                                                       const VkAllocationCallbacks*, VkImageView* view)
+        {
+            VKT_NULL_COUNT();
+            *view = makeHandle<VkImageView>();
+            return VK_SUCCESS;
+        }
+
+        VKAPI_ATTR void VKAPI_CALL DestroyImageView(VkDevice, VkImageView, const VkAllocationCallbacks*)
+        {
+            VKT_NULL_COUNT();
+        }
+
+        VKAPI_ATTR VkResult VKAPI_CALL CreateSampler(VkDevice, const VkSamplerCreateInfo*,
+                                                     const VkAllocationCallbacks*, VkSampler* sampler)
+        {
+            VKT_NULL_COUNT();
+            *sampler = makeHandle<VkSampler>();
+            return VK_SUCCESS;
+        }
+
+        VKAPI_ATTR void VKAPI_CALL DestroySampler(VkDevice, VkSampler, const VkAllocationCallbacks*)
+        {
+            VKT_NULL_COUNT();
+        }
+
+        // Descriptors
+
+        VKAPI_ATTR VkResult VKAPI_CALL CreateDescriptorPool(VkDevice, const VkDescriptorPoolCreateInfo*,
+                                                            const VkAllocationCallbacks*, VkDescriptorPool* pool)
+        {
+            VKT_NULL_COUNT();
+            *pool = makeHandle<VkDescriptorPool>();
+            return VK_SUCCESS;
+        }
+
+        VKAPI_ATTR void VKAPI_CALL DestroyDescriptorPool(VkDevice, VkDescriptorPool, const VkAllocationCallbacks*)
+        {
+            VKT_NULL_COUNT();
+        }
+
+        VKAPI_ATTR VkResult VKAPI_CALL ResetDescriptorPool(VkDevice, VkDescriptorPool, VkDescriptorPoolResetFlags)
+        {
+            VKT_NULL_COUNT();
+            return VK_SUCCESS;
+        }
+
+        VKAPI_ATTR VkResult VKAPI_CALL CreateDescriptorSetLayout(VkDevice, const VkDescriptorSetLayoutCreateInfo*,
+                                                                 const VkAllocationCallbacks*,
+                                                                 VkDescriptorSetLayout* layout)
+        {
+            VKT_NULL_COUNT();
+            *layout = makeHandle<VkDescriptorSetLayout>();
+            return VK_SUCCESS;
+        }
+
+        VKAPI_ATTR void VKAPI_CALL DestroyDescriptorSetLayout(VkDevice, VkDescriptorSetLayout,
+                                                              const VkAllocationCallbacks*)
+        {
+            VKT_NULL_COUNT();
+        }
+
+        VKAPI_ATTR VkResult VKAPI_CALL AllocateDescriptorSets(VkDevice, const VkDescriptorSetAllocateInfo* info,
+                                                              VkDescriptorSet* sets)
+        {
+            VKT_NULL_COUNT();
+            for (uint32_t i = 0; i < info->descriptorSetCount; i++) {
+                sets[i] = makeHandle<VkDescriptorSet>();
+            }
+            return VK_SUCCESS;
+        }
+
+        VKAPI_ATTR VkResult VKAPI_CALL FreeDescriptorSets(VkDevice, VkDescriptorPool, uint32_t,
+                                                          const VkDescriptorSet*)
+        {
+            VKT_NULL_COUNT();
+            return VK_SUCCESS;
+        }
+
+        VKAPI_ATTR void VKAPI_CALL UpdateDescriptorSets(VkDevice, uint32_t, const VkWriteDescriptorSet*,
+                                                        uint32_t, const VkCopyDescriptorSet*)
+        {
+            VKT_NULL_COUNT();
+        }
+
+        // Pipelines
+
+        VKAPI_ATTR VkResult VKAPI_CALL CreateShaderModule(VkDevice, const VkShaderModuleCreateInfo*,
+                                                          const VkAllocationCallbacks*, VkShaderModule* module)
+        {
+            VKT_NULL_COUNT();
+            *module = makeHandle<VkShaderModule>();
+            return VK_SUCCESS;
+        }
+
+        VKAPI_ATTR void VKAPI_CALL DestroyShaderModule(VkDevice, VkShaderModule, const VkAllocationCallbacks*)
+        {
+            VKT_NULL_COUNT();
+        }
+
+        VKAPI_ATTR VkResult VKAPI_CALL CreatePipelineLayout(VkDevice, const VkPipelineLayoutCreateInfo*,
+                                                            const VkAllocationCallbacks*, VkPipelineLayout* layout)
+        {
+            VKT_NULL_COUNT();
+            *layout = makeHandle<VkPipelineLayout>();
+            return VK_SUCCESS;
+        }
+
+        VKAPI_ATTR void VKAPI_CALL DestroyPipelineLayout(VkDevice, VkPipelineLayout, const VkAllocationCallbacks*)
+        {
+            VKT_NULL_COUNT();
+        }
+
+        VKAPI_ATTR VkResult VKAPI_CALL CreateComputePipelines(VkDevice, VkPipelineCache, uint32_t count,
+                                                              const VkComputePipelineCreateInfo*,
+                                                              const VkAllocationCallbacks*, VkPipeline* pipelines)
+        {
+            VKT_NULL_COUNT();
+            for (uint32_t i = 0; i < count; i++) {
+                pipelines[i] = makeHandle<VkPipeline>();
+            }
+            return VK_SUCCESS;
+        }
+
+        VKAPI_ATTR VkResult VKAPI_CALL CreateGraphicsPipelines(VkDevice, VkPipelineCache, uint32_t count,
+                                                               const VkGraphicsPipelineCreateInfo*,
+                                                               const VkAllocationCallbacks*, VkPipeline* pipelines)
+        {
+            VKT_NULL_COUNT();
+            for (uint32_t i = 0; i < count; i++) {
+                pipelines[i] = makeHandle<VkPipeline>();
+            }
+            return VK_SUCCESS;
+        }
+
+        VKAPI_ATTR void VKAPI_CALL DestroyPipeline(VkDevice, VkPipeline, const VkAllocationCallbacks*)
+        {
+            VKT_NULL_COUNT();
+        }
+
+        // Synchronization and queries
+
+        VKAPI_ATTR VkResult VKAPI_CALL CreateFence(VkDevice, const VkFenceCreateInfo*,
+                                                   const VkAllocationCallbacks*, VkFence* fence)
+        {
+            VKT_NULL_COUNT();
+            *fence = makeHandle<VkFence>();
+            return VK_SUCCESS;
+        }
+
+        VKAPI_ATTR void VKAPI_CALL DestroyFence(VkDevice, VkFence, const VkAllocationCallbacks*)
+        {
+            VKT_NULL_COUNT();
+        }
+
+        VKAPI_ATTR VkResult VKAPI_CALL ResetFences(VkDevice, uint32_t, const VkFence*)
+        {
+            VKT_NULL_COUNT();
+            return VK_SUCCESS;
+        }
+
+        VKAPI_ATTR VkResult VKAPI_CALL WaitForFences(VkDevice, uint32_t, const VkFence*, VkBool32, uint64_t)
+        {
+            VKT_NULL_COUNT();
+            return VK_SUCCESS;
+        }
+
+        VKAPI_ATTR VkResult VKAPI_CALL GetFenceStatus(VkDevice, VkFence)
+        {
+            VKT_NULL_COUNT();
+            return VK_SUCCESS;
+        }
+
+        VKAPI_ATTR VkResult VKAPI_CALL CreateSemaphore(VkDevice, const VkSemaphoreCreateInfo*,
+                                                       const VkAllocationCallbacks*, VkSemaphore* semaphore)
+        {
+            VKT_NULL_COUNT();
+            *semaphore = makeHandle<VkSemaphore>();
+            return VK_SUCCESS;
+        }
+
+        VKAPI_ATTR void VKAPI_CALL DestroySemaphore(VkDevice, VkSemaphore, const VkAllocationCallbacks*)
+        {
+            VKT_NULL_COUNT();
+        }
+
+        VKAPI_ATTR VkResult VKAPI_CALL CreateQueryPool(VkDevice, const VkQueryPoolCreateInfo*,
+                                                       const VkAllocationCallbacks*, VkQueryPool* pool)
+        {
+            VKT_NULL_COUNT();
+            *pool = makeHandle<VkQueryPool>();
+            return VK_SUCCESS;
+        }
+
+        VKAPI_ATTR void VKAPI_CALL DestroyQueryPool(VkDevice, VkQueryPool, const VkAllocationCallbacks*)
+        {
+            VKT_NULL_COUNT();
+        }
+
+        VKAPI_ATTR VkResult VKAPI_CALL GetQueryPoolResults(VkDevice, VkQueryPool, uint32_t, uint32_t,
+                                                           size_t dataSize, void* data, VkDeviceSize,
+                                                           VkQueryResultFlags)
+        {
+            VKT_NULL_COUNT();
+            std::memset(data, 0, dataSize);
+            return VK_SUCCESS;
+        }
+
+        // Command buffers
+
+        VKAPI_ATTR VkResult VKAPI_CALL CreateCommandPool(VkDevice, const VkCommandPoolCreateInfo*,
+                                                         const VkAllocationCallbacks*, VkCommandPool* pool)
+        {
+            VKT_NULL_COUNT();
+            *pool = makeHandle<VkCommandPool>();
+            return VK_SUCCESS;
+        }
+
+        VKAPI_ATTR void VKAPI_CALL DestroyCommandPool(VkDevice, VkCommandPool, const VkAllocationCallbacks*)
+        {
+            VKT_NULL_COUNT();
+        }
+
+        VKAPI_ATTR VkResult VKAPI_CALL ResetCommandPool(VkDevice, VkCommandPool, VkCommandPoolResetFlags)
+        {
+            VKT_NULL_COUNT();
+            return VK_SUCCESS;
+        }
+
+        VKAPI_ATTR VkResult VKAPI_CALL AllocateCommandBuffers(VkDevice, const VkCommandBufferAllocateInfo* info,
+                                                              VkCommandBuffer* commandBuffers)
+        {
+            VKT_NULL_COUNT();
+            for (uint32_t i = 0; i < info->commandBufferCount; i++) {
+                commandBuffers[i] = makeHandle<VkCommandBuffer>();
+            }
+            return VK_SUCCESS;
+        }
+
+        VKAPI_ATTR void VKAPI_CALL FreeCommandBuffers(VkDevice, VkCommandPool, uint32_t, const VkCommandBuffer*)
+        {
+            VKT_NULL_COUNT();
+        }
+
+        VKAPI_ATTR VkResult VKAPI_CALL BeginCommandBuffer(VkCommandBuffer, const VkCommandBufferBeginInfo*)
+        {
+            VKT_NULL_COUNT();
+            return VK_SUCCESS;
+        }
+
+        VKAPI_ATTR VkResult VKAPI_CALL EndCommandBuffer(VkCommandBuffer)
+        {
+            VKT_NULL_COUNT();
+            return VK_SUCCESS;
+        }
+
+        VKAPI_ATTR VkResult VKAPI_CALL ResetCommandBuffer(VkCommandBuffer, VkCommandBufferResetFlags)
+        {
+            VKT_NULL_COUNT();
+            return VK_SUCCESS;
+        }
+
+        VKAPI_ATTR void VKAPI_CALL CmdBindPipeline(VkCommandBuffer, VkPipelineBindPoint, VkPipeline)
+        {
+            VKT_NULL_COUNT();
+        }
+
+        VKAPI_ATTR void VKAPI_CALL CmdBindDescriptorSets(VkCommandBuffer, VkPipelineBindPoint, VkPipelineLayout,
+                                                         uint32_t, uint32_t, const VkDescriptorSet*,
+                                                         uint32_t, const uint32_t*)
+        {
+            VKT_NULL_COUNT();
+        }
+
+        VKAPI_ATTR void VKAPI_CALL CmdPushConstants(VkCommandBuffer, VkPipelineLayout, VkShaderStageFlags,
+                                                    uint32_t, uint32_t, const void*)
+        {
+            VKT_NULL_COUNT();
+        }
+
+        VKAPI_ATTR void VKAPI_CALL CmdDispatch(VkCommandBuffer, uint32_t, uint32_t, uint32_t)
+        {
+            VKT_NULL_COUNT();
+        }
+
+        VKAPI_ATTR void VKAPI_CALL CmdPipelineBarrier(VkCommandBuffer, VkPipelineStageFlags, VkPipelineStageFlags,
+                                                      VkDependencyFlags, uint32_t, const VkMemoryBarrier*,
+                                                      uint32_t, const VkBufferMemoryBarrier*,
+                                                      uint32_t, const VkImageMemoryBarrier*)
+        {
+            VKT_NULL_COUNT();
+        }
+
+        VKAPI_ATTR void VKAPI_CALL CmdCopyBuffer(VkCommandBuffer, VkBuffer, VkBuffer, uint32_t, const VkBufferCopy*)
+        {
+            VKT_NULL_COUNT();
+        }
+
+        VKAPI_ATTR void VKAPI_CALL CmdCopyImage(VkCommandBuffer, VkImage, VkImageLayout, VkImage, VkImageLayout,
+                                                uint32_t, const VkImageCopy*)
+        {
+            VKT_NULL_COUNT();
+        }
+
+        VKAPI_ATTR void VKAPI_CALL CmdCopyBufferToImage(VkCommandBuffer, VkBuffer, VkImage, VkImageLayout,
+                                                        uint32_t, const VkBufferImageCopy*)
+        {
+            VKT_NULL_COUNT();
+        }
+
+        VKAPI_ATTR void VKAPI_CALL CmdCopyImageToBuffer(VkCommandBuffer, VkImage, VkImageLayout, VkBuffer,
+                                                        uint32_t, const VkBufferImageCopy*)
+        {
+            VKT_NULL_COUNT();
+        }
+
+        VKAPI_ATTR void VKAPI_CALL CmdFillBuffer(VkCommandBuffer, VkBuffer, VkDeviceSize, VkDeviceSize, uint32_t)
+        {
+            VKT_NULL_COUNT();
+        }
+
+        VKAPI_ATTR void VKAPI_CALL CmdWriteTimestamp(VkCommandBuffer, VkPipelineStageFlagBits, VkQueryPool, uint32_t)
+        {
+            VKT_NULL_COUNT();
+        }
+
+        VKAPI_ATTR void VKAPI_CALL CmdResetQueryPool(VkCommandBuffer, VkQueryPool, uint32_t, uint32_t)
+        {
+            VKT_NULL_COUNT();
+        }
+
+        VKAPI_ATTR void VKAPI_CALL CmdBeginQuery(VkCommandBuffer, VkQueryPool, uint32_t, VkQueryControlFlags)
+        {
+            VKT_NULL_COUNT();
+        }
+
+        VKAPI_ATTR void VKAPI_CALL CmdEndQuery(VkCommandBuffer, VkQueryPool, uint32_t)
+        {
+            VKT_NULL_COUNT();
+        }
+
+#undef VKT_NULL_COUNT
+
+#define VKT_NULL_ENTRY(function) { "vk" #function, reinterpret_cast<PFN_vkVoidFunction>(&function) }
+
+        PFN_vkVoidFunction lookup(const char* name)
+        {
+            static const std::unordered_map<std::string_view, PFN_vkVoidFunction> functions = {
+                { "vkGetInstanceProcAddr", reinterpret_cast<PFN_vkVoidFunction>(&getInstanceProcAddr) },
+                VKT_NULL_ENTRY(GetDeviceProcAddr),
+                VKT_NULL_ENTRY(CreateInstance),
+                VKT_NULL_ENTRY(DestroyInstance),
+                VKT_NULL_ENTRY(EnumerateInstanceVersion),
+                VKT_NULL_ENTRY(EnumerateInstanceExtensionProperties),
+                VKT_NULL_ENTRY(EnumerateInstanceLayerProperties),
+                VKT_NULL_ENTRY(EnumeratePhysicalDevices),
+                VKT_NULL_ENTRY(GetPhysicalDeviceProperties),
+                VKT_NULL_ENTRY(GetPhysicalDeviceProperties2),
+                { "vkGetPhysicalDeviceProperties2KHR", reinterpret_cast<PFN_vkVoidFunction>(&GetPhysicalDeviceProperties2) },
+                VKT_NULL_ENTRY(GetPhysicalDeviceFeatures),
+                VKT_NULL_ENTRY(GetPhysicalDeviceFormatProperties),
+                VKT_NULL_ENTRY(GetPhysicalDeviceQueueFamilyProperties),
+                VKT_NULL_ENTRY(GetPhysicalDeviceMemoryProperties),
+                VKT_NULL_ENTRY(EnumerateDeviceExtensionProperties),
+                VKT_NULL_ENTRY(CreateDevice),
+                VKT_NULL_ENTRY(DestroyDevice),
+                VKT_NULL_ENTRY(GetDeviceQueue),
+                VKT_NULL_ENTRY(DeviceWaitIdle),
+                VKT_NULL_ENTRY(QueueSubmit),
+                VKT_NULL_ENTRY(QueueWaitIdle),
+                VKT_NULL_ENTRY(AllocateMemory),
+                VKT_NULL_ENTRY(FreeMemory),
+                VKT_NULL_ENTRY(MapMemory),
+                VKT_NULL_ENTRY(UnmapMemory),
+                VKT_NULL_ENTRY(CreateBuffer),
+                VKT_NULL_ENTRY(DestroyBuffer),
+                VKT_NULL_ENTRY(GetBufferMemoryRequirements),
+                VKT_NULL_ENTRY(BindBufferMemory),
+                VKT_NULL_ENTRY(GetBufferDeviceAddress),
+                { "vkGetBufferDeviceAddressKHR", reinterpret_cast<PFN_vkVoidFunction>(&GetBufferDeviceAddress) },
+                VKT_NULL_ENTRY(CreateImage),
+                VKT_NULL_ENTRY(DestroyImage),
+                VKT_NULL_ENTRY(GetImageMemoryRequirements),
+                VKT_NULL_ENTRY(BindImageMemory),
+                VKT_NULL_ENTRY(CreateImageView),
+                VKT_NULL_ENTRY(DestroyImageView),
+                VKT_NULL_ENTRY(CreateSampler),
+                VKT_NULL_ENTRY(DestroySampler),
+                VKT_NULL_ENTRY(CreateDescriptorPool),
+                VKT_NULL_ENTRY(DestroyDescriptorPool),
+                VKT_NULL_ENTRY(ResetDescriptorPool),
+                VKT_NULL_ENTRY(CreateDescriptorSetLayout),
+                VKT_NULL_ENTRY(DestroyDescriptorSetLayout),
+                VKT_NULL_ENTRY(AllocateDescriptorSets),
+                VKT_NULL_ENTRY(FreeDescriptorSets),
+                VKT_NULL_ENTRY(UpdateDescriptorSets),
+                VKT_NULL_ENTRY(CreateShaderModule),
+                VKT_NULL_ENTRY(DestroyShaderModule),
+                VKT_NULL_ENTRY(CreatePipelineLayout),
+                VKT_NULL_ENTRY(DestroyPipelineLayout),
+                VKT_NULL_ENTRY(CreateComputePipelines),
+                VKT_NULL_ENTRY(CreateGraphicsPipelines),
+                VKT_NULL_ENTRY(DestroyPipeline),
+                VKT_NULL_ENTRY(CreateFence),
+                VKT_NULL_ENTRY(DestroyFence),
+                VKT_NULL_ENTRY(ResetFences),
+                VKT_NULL_ENTRY(WaitForFences),
+                VKT_NULL_ENTRY(GetFenceStatus),
+                VKT_NULL_ENTRY(CreateSemaphore),
+                VKT_NULL_ENTRY(DestroySemaphore),
+                VKT_NULL_ENTRY(CreateQueryPool),
+                VKT_NULL_ENTRY(DestroyQueryPool),
+                VKT_NULL_ENTRY(GetQueryPoolResults),
+                VKT_NULL_ENTRY(CreateCommandPool),
+                VKT_NULL_ENTRY(DestroyCommandPool),
+                VKT_NULL_ENTRY(ResetCommandPool),
+                VKT_NULL_ENTRY(AllocateCommandBuffers),
+                VKT_NULL_ENTRY(FreeCommandBuffers),
+                VKT_NULL_ENTRY(BeginCommandBuffer),
+                VKT_NULL_ENTRY(EndCommandBuffer),
+                VKT_NULL_ENTRY(ResetCommandBuffer),
+                VKT_NULL_ENTRY(CmdBindPipeline),
+                VKT_NULL_ENTRY(CmdBindDescriptorSets),
+                VKT_NULL_ENTRY(CmdPushConstants),
+                VKT_NULL_ENTRY(CmdDispatch),
+                VKT_NULL_ENTRY(CmdPipelineBarrier),
+                VKT_NULL_ENTRY(CmdCopyBuffer),
+                VKT_NULL_ENTRY(CmdCopyImage),
+                VKT_NULL_ENTRY(CmdCopyBufferToImage),
+                VKT_NULL_ENTRY(CmdCopyImageToBuffer),
+                VKT_NULL_ENTRY(CmdFillBuffer),
+                VKT_NULL_ENTRY(CmdWriteTimestamp),
+                VKT_NULL_ENTRY(CmdResetQueryPool),
+                VKT_NULL_ENTRY(CmdBeginQuery),
+                VKT_NULL_ENTRY(CmdEndQuery),
+            };
+            auto it = functions.find(name);
+            return it != functions.end() ? it->second : nullptr;
+        }
+
+#undef VKT_NULL_ENTRY
+    }
+
+    VKAPI_ATTR PFN_vkVoidFunction VKAPI_CALL getInstanceProcAddr(VkInstance, const char* name)
+    {
+        return lookup(name);
+    }
+
+    std::vector<CallCount> getCallCounts()
+    {
+        Registry& registry = getRegistry();
+        std::lock_guard lock{ registry.mutex };
+        std::vector<CallCount> counts;
+        for (const Counter& counter : registry.counters) {
+            uint64_t count = counter.count.load(std::memory_order_relaxed);
+            if (count > 0) {
+                counts.push_back({ counter.name, count });
+            }
+        }
+        return counts;
+    }
+
+    uint64_t getTotalCallCount()
+    {
+        uint64_t total = 0;
+        for (const CallCount& count : getCallCounts()) {
+            total += count.count;
+        }
+        return total;
+    }
+
+    void resetCallCounts()
+    {
+        Registry& registry = getRegistry();
+        std::lock_guard lock{ registry.mutex };
+        for (Counter& counter : registry.counters) {
+            counter.count.store(0, std::memory_order_relaxed);
+        }
+    }
+}
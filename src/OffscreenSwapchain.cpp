@@ -0,0 +1,157 @@
+#include "vktiny/OffscreenSwapchain.hpp"
+#include "vktiny/Trace.hpp"
+#include "vktiny/DriverStats.hpp"
+
+namespace vkt
+{
+    OffscreenSwapchain::OffscreenSwapchain(const Context& context,
+                                           const OffscreenSwapchainCreateInfo& info)
+        : context(&context)
+        , extent{ static_cast<uint32_t>(info.width), static_cast<uint32_t>(info.height) }
+        , format(info.format)
+    {
+        using vkIU = vk::ImageUsageFlagBits;
+        vk::Device device = context.getDevice();
+        const vk::DispatchLoaderDynamic& dispatcher = context.getDispatcher();
+        vk::ImageUsageFlags usage = info.usage | vkIU::eTransferSrc | vkIU::eTransferDst;
+        vk::DeviceSize frameSize = vk::DeviceSize{ extent.width } * extent.height * getFormatSize(format);
+
+        uint32_t imageCount = std::max(info.imageCount, 1u);
+        targets.reserve(imageCount);
+        for (uint32_t i = 0; i < imageCount; i++) {
+            Target target{ Image{ context, extent, format, usage } };
+            target.image.createImageView();
+            target.image.transitionLayout(vk::ImageLayout::eGeneral);
+            if (info.enableReadback) {
+                target.readbackBuffer.emplace(context, frameSize,
+                                              vk::BufferUsageFlagBits::eTransferDst,
+                                              context.getHostReadbackMemoryProperties());
+                target.readbackBuffer->map();
+                target.readbackCommandBuffer.emplace(device, context.getGraphicsCommandPool(),
+                                                     context.getGraphicsQueue(), dispatcher);
+                recordReadback(target);
+            }
+            target.imageAvailableSemaphore = device.createSemaphoreUnique({}, nullptr, dispatcher);
+            target.renderFinishedSemaphore = device.createSemaphoreUnique({}, nullptr, dispatcher);
+            target.inFlightFence =
+                device.createFenceUnique({ vk::FenceCreateFlagBits::eSignaled }, nullptr, dispatcher);
+            target.readbackFence =
+                device.createFenceUnique({ vk::FenceCreateFlagBits::eSignaled }, nullptr, dispatcher);
+            targets.push_back(std::move(target));
+        }
+    }
+
+    FrameInfo OffscreenSwapchain::beginFrame(std::source_location location)
+    {
+        collectFinishedFrames(false, location);
+
+        // This is the oldest target, so delivering it here keeps submission order
+        Target& target = targets[nextIndex];
+        std::array fences{ *target.inFlightFence, *target.readbackFence };
+        {
+            VKT_TRACE_SCOPE("WaitForFrameFence");
+            stats::WaitScope waitScope{ stats::Counter::WaitForFences, location };
+            context->getDevice().waitForFences(fences, true, UINT64_MAX, context->getDispatcher());
+        }
+        if (target.pending) {
+            deliver(target);
+        }
+        context->getDevice().resetFences(fences, context->getDispatcher());
+
+        // There is no presentation engine to signal the acquire semaphore
+        vk::SubmitInfo submitInfo;
+        submitInfo.setSignalSemaphores(*target.imageAvailableSemaphore);
+        context->getGraphicsQueue().submit(submitInfo, nullptr, context->getDispatcher());
+        stats::increment(stats::Counter::QueueSubmit);
+
+        FrameInfo frameInfo;
+        frameInfo.imageIndex = nextIndex;
+        frameInfo.currentFrame = nextIndex;
+        frameInfo.image = target.image.get();
+        frameInfo.imageView = target.image.getView();
+        frameInfo.imageAvailableSemaphore = *target.imageAvailableSemaphore;
+        frameInfo.renderFinishedSemaphore = *target.renderFinishedSemaphore;
+        frameInfo.inFlightFence = *target.inFlightFence;
+        return frameInfo;
+    }
+
+    void OffscreenSwapchain::endFrame(uint32_t imageIndex)
+    {
+        Target& target = targets[imageIndex];
+
+        // Always consume the render finished semaphore, even without readback
+        vk::PipelineStageFlags waitStage{ vk::PipelineStageFlagBits::eTransfer };
+        vk::SubmitInfo submitInfo;
+        submitInfo.setWaitSemaphores(*target.renderFinishedSemaphore);
+        submitInfo.setWaitDstStageMask(waitStage);
+        vk::CommandBuffer commandBuffer;
+        if (target.readbackCommandBuffer) {
+            commandBuffer = target.readbackCommandBuffer->get();
+            submitInfo.setCommandBuffers(commandBuffer);
+        }
+        context->getGraphicsQueue().submit(submitInfo, *target.readbackFence, context->getDispatcher());
+        stats::increment(stats::Counter::QueueSubmit);
+
+        target.frameNumber = frameCount++;
+        target.pending = target.readbackCommandBuffer.has_value();
+        nextIndex = (imageIndex + 1) % targets.size();
+        stats::endFrame();
+    }
+
+    void OffscreenSwapchain::flush(std::source_location location)
+    {
+        collectFinishedFrames(true, location);
+    }
+
+    void OffscreenSwapchain::recordReadback(Target& target)
+    {
+        using vkIL = vk::ImageLayout;
+        using vkPS = vk::PipelineStageFlagBits;
+        using vkAF = vk::AccessFlagBits;
+        const CommandBuffer& cmdBuf = *target.readbackCommandBuffer;
+        vk::Image image = target.image.get();
+
+        cmdBuf.begin();
+        cmdBuf.transitionImageLayout(image, vkIL::eGeneral, vkIL::eTransferSrcOptimal);
+        cmdBuf.copyImageToBuffer(image, target.readbackBuffer->get(), extent);
+        cmdBuf.transitionImageLayout(image, vkIL::eTransferSrcOptimal, vkIL::eGeneral);
+        cmdBuf.memoryBarrier(vkPS::eTransfer, vkAF::eTransferWrite, vkPS::eHost, vkAF::eHostRead);
+        cmdBuf.end();
+    }
+
+    void OffscreenSwapchain::collectFinishedFrames(bool wait, std::source_location location)
+    {
+        vk::Device device = context->getDevice();
+        for (size_t i = 0; i < targets.size(); i++) {
+            Target& target = targets[(nextIndex + i) % targets.size()];
+            if (!target.pending) {
+                continue;
+            }
+            if (wait) {
+                VKT_TRACE_SCOPE("WaitForReadbackFence");
+                stats::WaitScope waitScope{ stats::Counter::WaitForFences, location };
+                device.waitForFences(*target.readbackFence, true, UINT64_MAX, context->getDispatcher());
+            } else if (device.getFenceStatus(*target.readbackFence, context->getDispatcher()) != vk::Result::eSuccess) {
+                break;
+            }
+            deliver(target);
+        }
+    }
+
+    void OffscreenSwapchain::deliver(Target& target)
+    {
+        target.pending = false;
+        if (!onFrameReady) {
+            return;
+        }
+
+        ReadbackFrame frame;
+        frame.frameNumber = target.frameNumber;
+        frame.imageIndex = static_cast<uint32_t>(&target - targets.data());
+        frame.extent = extent;
+        frame.format = format;
+        frame.data = target.readbackBuffer->map();
+        frame.size = target.readbackBuffer->getSize();
+        onFrameReady(frame);
+    }
+}
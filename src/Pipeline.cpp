@@ -7,10 +7,10 @@ vkt::ComputePipeline::ComputePipeline(const Context& context,
                                       const ComputeShaderModule& shaderModule)
 {
     vk::DescriptorSetLayout setLayout = descSetLayout.get();
-    layout = context.getDevice().createPipelineLayoutUnique({ {}, setLayout });
+    layout = context.getDevice().createPipelineLayoutUnique({ {}, setLayout }, nullptr, context.getDispatcher());
 
     vk::ComputePipelineCreateInfo pipelineInfo;
     pipelineInfo.setStage(shaderModule.getStageInfo());
     pipelineInfo.setLayout(*layout);
-    pipeline = context.getDevice().createComputePipelineUnique(nullptr, pipelineInfo);
+    pipeline = context.getDevice().createComputePipelineUnique(nullptr, pipelineInfo, nullptr, context.getDispatcher());
 }
@@ -0,0 +1,98 @@
+#include "vktiny/Readback.hpp"
+#include "vktiny/Trace.hpp"
+#include "vktiny/DriverStats.hpp"
+
+namespace vkt
+{
+    bool ReadbackFuture::isReady() const
+    {
+        return state->device.getFenceStatus(state->fence, *state->dispatcher) == vk::Result::eSuccess;
+    }
+
+    void ReadbackFuture::wait(std::source_location location) const
+    {
+        VKT_TRACE_SCOPE("WaitForReadback");
+        stats::WaitScope waitScope{ stats::Counter::WaitForFences, location };
+        state->device.waitForFences(state->fence, true, UINT64_MAX, *state->dispatcher);
+    }
+
+    const void* ReadbackFuture::get(std::source_location location) const
+    {
+        wait(location);
+        return state->data;
+    }
+
+    ReadbackRing::ReadbackRing(const Context& context, vk::DeviceSize capacity)
+        : context(&context)
+        , buffer(context, capacity, vk::BufferUsageFlagBits::eTransferDst,
+                 context.getHostReadbackMemoryProperties())
+        , capacity(capacity)
+    {
+        buffer.map();
+    }
+
+    ReadbackFuture ReadbackRing::allocate(vk::DeviceSize size, vk::Fence fence)
+    {
+        // Keep copies aligned for vkCmdCopyImageToBuffer
+        const vk::DeviceSize alignment = 16;
+        vk::DeviceSize alignedSize = (size + alignment - 1) & ~(alignment - 1);
+        if (alignedSize >= capacity) {
+            throw std::runtime_error("readback is larger than the ring");
+        }
+
+        auto tryAllocate = [&]() -> std::optional<vk::DeviceSize> {
+            if (entries.empty()) {
+                head = 0;
+                return 0;
+            }
+            vk::DeviceSize tail = entries.front()->offset;
+            if (head > tail) {
+                if (head + alignedSize <= capacity) {
+                    return head;
+                }
+                if (alignedSize < tail) {
+                    return 0;
+                }
+            } else if (head + alignedSize < tail) {
+                return head;
+            }
+            return std::nullopt;
+        };
+
+        std::optional<vk::DeviceSize> offset = tryAllocate();
+        if (!offset) {
+            reclaim();
+            offset = tryAllocate();
+        }
+        if (!offset) {
+            throw std::runtime_error("readback ring is full");
+        }
+
+        auto state = std::make_shared<ReadbackFuture::State>();
+        state->device = context->getDevice();
+        state->dispatcher = &context->getDispatcher();
+        state->data = static_cast<const char*>(buffer.map()) + *offset;
+        state->offset = *offset;
+        state->size = size;
+        state->fence = fence;
+        head = *offset + alignedSize;
+        entries.push_back(state);
+
+        ReadbackFuture future;
+        future.state = std::move(state);
+        return future;
+    }
+
+    void ReadbackRing::reclaim()
+    {
+        // Allocations are retired in order once nobody holds them and the GPU is done
+        while (!entries.empty()) {
+            const auto& entry = entries.front();
+            if (entry.use_count() > 1 ||
+                entry->device.getFenceStatus(entry->fence, *entry->dispatcher) != vk::Result::eSuccess) {
+                break;
+            }
+            entries.pop_front();
+        }
+    }
+}
@@ -0,0 +1,119 @@
+#include "vktiny/ResidencyPlanner.hpp"
+#include <algorithm>
+
+namespace vkt
+{
+    vk::DeviceSize getMipChainSize(const StreamedTextureSource& source, uint32_t baseMip)
+    {
+        vk::Extent2D extent{ std::max(source.extent.width >> baseMip, 1u), std::max(source.extent.height >> baseMip, 1u) };
+        return getImageSize(extent, source.format, source.mipLevels - baseMip);
+    }
+
+    ResidencyPlanner::ResidencyPlanner(std::span<const StreamedTextureSource> sources,
+                                       const TextureStreamerCreateInfo& info)
+        : sources(sources)
+        , info(info)
+        , states(sources.size())
+    {
+        for (size_t i = 0; i < sources.size(); i++) {
+            const StreamedTextureSource& source = sources[i];
+            uint32_t tailMip = 0;
+            while (tailMip + 1 < source.mipLevels &&
+                   std::max(source.extent.width >> tailMip, source.extent.height >> tailMip) > info.tailExtent) {
+                tailMip++;
+            }
+            states[i] = { tailMip, tailMip, tailMip };
+            residentSize += getMipChainSize(source, tailMip);
+        }
+    }
+
+    std::vector<ResidencyJob> ResidencyPlanner::plan(const std::vector<uint32_t>& requested)
+    {
+        serial++;
+        std::vector<uint32_t> missing;
+        for (uint32_t i = 0; i < states.size(); i++) {
+            State& state = states[i];
+            if (requested[i] == notRequested) {
+                continue;
+            }
+            state.lastUsed = serial;
+            state.requestedMip = std::min(requested[i], state.tailMip);
+            if (state.requestedMip < state.baseMip) {
+                missing.push_back(i);
+            }
+        }
+        std::stable_sort(missing.begin(), missing.end(), [&](uint32_t a, uint32_t b) {
+            return states[a].baseMip - states[a].requestedMip > states[b].baseMip - states[b].requestedMip;
+        });
+
+        std::vector<ResidencyJob> jobs;
+        vk::DeviceSize uploadSize = 0;
+        for (uint32_t texture : missing) {
+            State& state = states[texture];
+            vk::DeviceSize currentSize = getMipChainSize(sources[texture], state.baseMip);
+            vk::DeviceSize evictable = getEvictableSize(texture);
+
+            // Fall back to coarser levels when the finest doesn't fit
+            for (uint32_t mip = state.requestedMip; mip < state.baseMip; mip++) {
+                vk::DeviceSize size = getMipChainSize(sources[texture], mip);
+                if (uploadSize + size > info.maxUploadSize && uploadSize > 0) {
+                    continue;
+                }
+                vk::DeviceSize growth = size - currentSize;
+                if (residentSize + growth > info.budget + evictable) {
+                    continue;
+                }
+                evict(texture, growth, jobs);
+                residentSize += growth;
+                uploadSize += size;
+                state.baseMip = mip;
+                jobs.push_back({ texture, mip });
+                break;
+            }
+        }
+        return jobs;
+    }
+
+    uint32_t ResidencyPlanner::getEvictionMip(const State& state) const
+    {
+        return state.lastUsed == serial ? std::max(state.requestedMip, state.baseMip) : state.tailMip;
+    }
+
+    vk::DeviceSize ResidencyPlanner::getEvictableSize(uint32_t exclude) const
+    {
+        vk::DeviceSize size = 0;
+        for (uint32_t i = 0; i < states.size(); i++) {
+            uint32_t mip = getEvictionMip(states[i]);
+            if (i != exclude && mip > states[i].baseMip) {
+                size += getMipChainSize(sources[i], states[i].baseMip) - getMipChainSize(sources[i], mip);
+            }
+        }
+        return size;
+    }
+
+    void ResidencyPlanner::evict(uint32_t exclude, vk::DeviceSize growth, std::vector<ResidencyJob>& jobs)
+    {
+        if (residentSize + growth <= info.budget) {
+            return;
+        }
+        std::vector<uint32_t> candidates;
+        for (uint32_t i = 0; i < states.size(); i++) {
+            if (i != exclude && getEvictionMip(states[i]) > states[i].baseMip) {
+                candidates.push_back(i);
+            }
+        }
+        std::stable_sort(candidates.begin(), candidates.end(), [&](uint32_t a, uint32_t b) {
+            return states[a].lastUsed < states[b].lastUsed;
+        });
+        for (uint32_t i : candidates) {
+            if (residentSize + growth <= info.budget) {
+                break;
+            }
+            State& state = states[i];
+            uint32_t mip = getEvictionMip(state);
+            residentSize -= getMipChainSize(sources[i], state.baseMip) - getMipChainSize(sources[i], mip);
+            state.baseMip = mip;
+            jobs.push_back({ i, mip });
+        }
+    }
+}
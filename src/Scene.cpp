@@ -0,0 +1,401 @@
+#include "vktiny/Scene.hpp"
+#include "vktiny/SceneCache.hpp"
+#include "vktiny/CommandBuffer.hpp"
+#include "vktiny/ThreadPool.hpp"
+#include "vktiny/Trace.hpp"
+#include "vktiny/Log.hpp"
+#include <algorithm>
+#include <cstring>
+#include <span>
+
+namespace vkt
+{
+    namespace
+    {
+        // glTF uses the OpenGL sampler enums
+        vk::SamplerAddressMode getAddressMode(uint32_t wrap)
+        {
+            switch (wrap) {
+                case 33071:
+                    return vk::SamplerAddressMode::eClampToEdge;
+                case 33648:
+                    return vk::SamplerAddressMode::eMirroredRepeat;
+                default:
+                    return vk::SamplerAddressMode::eRepeat;
+            }
+        }
+    }
+
+    vk::SamplerCreateInfo getSamplerInfo(const TextureInfo& texture)
+    {
+        bool nearestMag = texture.magFilter == 9728;
+        bool nearestMin = texture.minFilter == 9728 || texture.minFilter == 9984 || texture.minFilter == 9986;
+
+        vk::SamplerCreateInfo samplerInfo;
+        samplerInfo.setMagFilter(nearestMag ? vk::Filter::eNearest : vk::Filter::eLinear);
+        samplerInfo.setMinFilter(nearestMin ? vk::Filter::eNearest : vk::Filter::eLinear);
+        samplerInfo.setMipmapMode(vk::SamplerMipmapMode::eLinear);
+        samplerInfo.setAddressModeU(getAddressMode(texture.wrapS));
+        samplerInfo.setAddressModeV(getAddressMode(texture.wrapT));
+        samplerInfo.setAddressModeW(vk::SamplerAddressMode::eRepeat);
+        samplerInfo.setMaxLod(0.0f);
+        return samplerInfo;
+    }
+
+    std::vector<vk::Format> getTextureFormats(const GltfLoader& loader)
+    {
+        std::vector<vk::Format> formats(loader.getTextures().size(), vk::Format::eUndefined);
+        auto use = [&](int32_t index, vk::Format format) {
+            if (index < 0 || index >= static_cast<int32_t>(formats.size())) {
+                return;
+            }
+            vk::Format& current = formats[index];
+            if (current != vk::Format::eUndefined && current != format) {
+                log::warn("texture {} is sampled as color and as linear data, using sRGB", index);
+                format = vk::Format::eR8G8B8A8Srgb;
+            }
+            current = format;
+        };
+        for (const Material& material : loader.getMaterials()) {
+            use(material.baseColorTextureIndex, vk::Format::eR8G8B8A8Srgb);
+            use(material.emissiveTextureIndex, vk::Format::eR8G8B8A8Srgb);
+            use(material.metallicRoughnessTextureIndex, vk::Format::eR8G8B8A8Unorm);
+            use(material.normalTextureIndex, vk::Format::eR8G8B8A8Unorm);
+            use(material.occlusionTextureIndex, vk::Format::eR8G8B8A8Unorm);
+        }
+
+        // Textures no material uses are treated as data
+        for (vk::Format& format : formats) {
+            if (format == vk::Format::eUndefined) {
+                format = vk::Format::eR8G8B8A8Unorm;
+            }
+        }
+        return formats;
+    }
+
+    struct Scene::Source
+    {
+        std::optional<SceneCache> cache;
+        std::optional<ThreadPool> pool;
+        std::optional<GltfLoader> loader;
+
+        Source(const std::filesystem::path& path, const SceneCreateInfo& info)
+        {
+            if (!info.cachePath.empty()) {
+                cache = SceneCache::open(info.cachePath, path, info);
+            }
+            if (!cache) {
+                pool.emplace(info.threadCount);
+                loader.emplace(path, &*pool);
+            }
+        }
+
+        GeometryPoolCreateInfo getGeometryPoolInfo(const SceneCreateInfo& info) const
+        {
+            if (loader) {
+                return vkt::getGeometryPoolInfo(*loader, info);
+            }
+            GeometryPoolCreateInfo poolInfo{ 0, 0, info.meshUsage, info.meshProperties };
+            poolInfo.vertexStride = cache->getVertexStride();
+            poolInfo.indexType = cache->getIndexType();
+            poolInfo.vertexCapacity = static_cast<uint32_t>(cache->getVertexData().size() / poolInfo.vertexStride);
+            poolInfo.indexCapacity = static_cast<uint32_t>(cache->getIndexData().size() /
+                                                           (poolInfo.indexType == vk::IndexType::eUint16 ? 2 : 4));
+            return poolInfo;
+        }
+    };
+
+    Scene::Scene(const Context& context, const std::filesystem::path& path, const SceneCreateInfo& info)
+        : Scene(context, Source{ path, info }, info)
+    {
+    }
+
+    Scene::Scene(const Context& context, Source&& source, const SceneCreateInfo& info)
+        : context(&context)
+        , geometryPool(context, source.getGeometryPoolInfo(info))
+    {
+        VKT_TRACE_SCOPE("Scene");
+        if (source.cache) {
+            loadCache(*source.cache, info);
+            return;
+        }
+
+        const GltfLoader& loader = *source.loader;
+        ThreadPool& pool = *source.pool;
+        meshes.reserve(loader.getMeshes().size());
+        if (info.optimizeMeshes || info.quantizeVertices) {
+            uploadProcessed(pool, loader, info);
+        } else {
+            for (const MeshInfo& mesh : loader.getMeshes()) {
+                meshes.emplace_back(geometryPool.allocate(mesh.vertexCount, mesh.indexCount), mesh);
+            }
+            if (geometryPool.getMappedVertices()) {
+                uploadDirect(pool, loader);
+            } else {
+                uploadStaged(pool, loader);
+            }
+        }
+
+        if (info.loadTextures) {
+            loadTextures(loader, info.textureInfo);
+        }
+
+        materials = loader.getMaterials();
+        instances = loader.getInstances();
+    }
+
+    void Scene::uploadDirect(ThreadPool& pool, const GltfLoader& loader)
+    {
+        VKT_TRACE_SCOPE("Scene::uploadDirect");
+        auto* vertices = static_cast<Vertex*>(geometryPool.getMappedVertices());
+        auto* indices = static_cast<uint32_t*>(geometryPool.getMappedIndices());
+        pool.parallelFor(meshes.size(), [&](size_t i) {
+            const GeometryRange& range = geometryPool.getRange(meshes[i].getGeometryId());
+            loader.decodeMesh(static_cast<uint32_t>(i), vertices + range.vertexOffset, indices + range.indexOffset);
+        });
+    }
+
+    void Scene::uploadStaged(ThreadPool& pool, const GltfLoader& loader)
+    {
+        VKT_TRACE_SCOPE("Scene::uploadStaged");
+
+        // Vertices followed by indices, decoded in place and copied with a single submission
+        vk::DeviceSize vertexSize = sizeof(Vertex) * vk::DeviceSize{ loader.getVertexCount() };
+        vk::DeviceSize indexSize = sizeof(uint32_t) * vk::DeviceSize{ loader.getIndexCount() };
+        if (vertexSize == 0) {
+            return;
+        }
+        using vkMP = vk::MemoryPropertyFlagBits;
+        Buffer stagingBuffer{ *context, vertexSize + indexSize, vk::BufferUsageFlagBits::eTransferSrc,
+                              vkMP::eHostVisible | vkMP::eHostCoherent };
+        auto* mapped = static_cast<uint8_t*>(stagingBuffer.map());
+        loader.decode(pool, reinterpret_cast<Vertex*>(mapped), reinterpret_cast<uint32_t*>(mapped + vertexSize));
+
+        context->OneTimeSubmitGraphics([&](const CommandBuffer& commandBuffer) {
+            const std::vector<MeshInfo>& infos = loader.getMeshes();
+            for (size_t i = 0; i < meshes.size(); i++) {
+                geometryPool.upload(commandBuffer, meshes[i].getGeometryId(), stagingBuffer.get(),
+                                    sizeof(Vertex) * vk::DeviceSize{ infos[i].vertexOffset },
+                                    vertexSize + sizeof(uint32_t) * vk::DeviceSize{ infos[i].indexOffset });
+            }
+        });
+    }
+
+    void Scene::uploadProcessed(ThreadPool& pool, const GltfLoader& loader, const SceneCreateInfo& info)
+    {
+        VKT_TRACE_SCOPE("Scene::uploadProcessed");
+
+        // The final sizes are only known afterwards, so every mesh is decoded into its own arrays
+        const std::vector<MeshInfo>& infos = loader.getMeshes();
+        std::vector<ProcessedMesh> results = processMeshes(pool, loader, info, geometryPool.getIndexType());
+
+        vk::DeviceSize vertexSize = 0;
+        vk::DeviceSize indexSize = 0;
+        vk::DeviceSize stride = geometryPool.getVertexStride();
+        vk::DeviceSize indexElementSize = geometryPool.getIndexSize();
+        for (size_t i = 0; i < infos.size(); i++) {
+            ProcessedMesh& result = results[i];
+            MeshInfo meshInfo = infos[i];
+            meshInfo.vertexCount = result.vertexCount;
+            meshInfo.indexCount = result.indexCount;
+            meshes.emplace_back(geometryPool.allocate(meshInfo.vertexCount, meshInfo.indexCount), meshInfo,
+                                std::move(result.lods), result.quantized.quantization);
+            vertexSize += stride * result.vertexCount;
+            indexSize += indexElementSize * result.indexCount;
+        }
+        if (info.optimizeMeshes) {
+            optimizeStats = sumOptimizeStats(results);
+            log::info("optimized {} meshes: ACMR {:.3f} -> {:.3f}, {} -> {} vertices", meshes.size(),
+                      optimizeStats.before.acmr, optimizeStats.after.acmr,
+                      optimizeStats.vertexCountBefore, optimizeStats.vertexCountAfter);
+        }
+        if (info.quantizeVertices) {
+            log::info("quantized {} meshes: {} bytes per vertex, {}-bit indices, {} KiB of geometry",
+                      meshes.size(), stride, indexElementSize * 8, (vertexSize + indexSize) / 1024);
+        }
+
+        if (void* mappedVertices = geometryPool.getMappedVertices()) {
+            auto* vertices = static_cast<uint8_t*>(mappedVertices);
+            auto* indices = static_cast<uint8_t*>(geometryPool.getMappedIndices());
+            pool.parallelFor(meshes.size(), [&](size_t i) {
+                const GeometryRange& range = geometryPool.getRange(meshes[i].getGeometryId());
+                std::memcpy(vertices + stride * range.vertexOffset, results[i].getVertexData(),
+                            stride * results[i].vertexCount);
+                std::memcpy(indices + indexElementSize * range.indexOffset, results[i].getIndexData(),
+                            indexElementSize * results[i].indexCount);
+            });
+            return;
+        }
+        if (vertexSize == 0) {
+            return;
+        }
+
+        // Same layout as uploadStaged: all vertices, then all indices
+        using vkMP = vk::MemoryPropertyFlagBits;
+        Buffer stagingBuffer{ *context, vertexSize + indexSize, vk::BufferUsageFlagBits::eTransferSrc,
+                              vkMP::eHostVisible | vkMP::eHostCoherent };
+        auto* mapped = static_cast<uint8_t*>(stagingBuffer.map());
+        std::vector<vk::DeviceSize> vertexOffsets(meshes.size());
+        std::vector<vk::DeviceSize> indexOffsets(meshes.size());
+        vk::DeviceSize vertexOffset = 0;
+        vk::DeviceSize indexOffset = vertexSize;
+        for (size_t i = 0; i < meshes.size(); i++) {
+            vertexOffsets[i] = vertexOffset;
+            indexOffsets[i] = indexOffset;
+            vertexOffset += stride * results[i].vertexCount;
+            indexOffset += indexElementSize * results[i].indexCount;
+        }
+        pool.parallelFor(meshes.size(), [&](size_t i) {
+            std::memcpy(mapped + vertexOffsets[i], results[i].getVertexData(), stride * results[i].vertexCount);
+            std::memcpy(mapped + indexOffsets[i], results[i].getIndexData(), indexElementSize * results[i].indexCount);
+        });
+
+        context->OneTimeSubmitGraphics([&](const CommandBuffer& commandBuffer) {
+            for (size_t i = 0; i < meshes.size(); i++) {
+                geometryPool.upload(commandBuffer, meshes[i].getGeometryId(), stagingBuffer.get(),
+                                    vertexOffsets[i], indexOffsets[i]);
+            }
+        });
+    }
+
+    void Scene::loadCache(const SceneCache& cache, const SceneCreateInfo& info)
+    {
+        VKT_TRACE_SCOPE("Scene::loadCache");
+        std::span<const meshopt::Lod> lods = cache.getLods();
+        for (const SceneCacheMesh& record : cache.getMeshes()) {
+            MeshInfo meshInfo;
+            meshInfo.vertexCount = record.vertexCount;
+            meshInfo.indexCount = record.indexCount;
+            meshInfo.materialIndex = record.materialIndex;
+            std::vector<meshopt::Lod> meshLods(lods.begin() + record.lodOffset,
+                                               lods.begin() + record.lodOffset + record.lodCount);
+            meshes.emplace_back(geometryPool.allocate(record.vertexCount, record.indexCount), meshInfo,
+                                std::move(meshLods), record.quantization);
+        }
+        materials.assign(cache.getMaterials().begin(), cache.getMaterials().end());
+        instances.assign(cache.getInstances().begin(), cache.getInstances().end());
+        optimizeStats = cache.getOptimizeStats();
+
+        // Geometry is stored in the pool's format, so it is copied without conversion
+        std::span<const uint8_t> vertexData = cache.getVertexData();
+        std::span<const uint8_t> indexData = cache.getIndexData();
+        vk::DeviceSize stride = geometryPool.getVertexStride();
+        vk::DeviceSize indexSize = geometryPool.getIndexSize();
+        std::span<const SceneCacheMesh> records = cache.getMeshes();
+        if (void* mappedVertices = geometryPool.getMappedVertices()) {
+            auto* vertices = static_cast<uint8_t*>(mappedVertices);
+            auto* indices = static_cast<uint8_t*>(geometryPool.getMappedIndices());
+            for (size_t i = 0; i < meshes.size(); i++) {
+                const GeometryRange& range = geometryPool.getRange(meshes[i].getGeometryId());
+                std::memcpy(vertices + stride * range.vertexOffset, vertexData.data() + stride * records[i].vertexOffset,
+                            stride * range.vertexCount);
+                std::memcpy(indices + indexSize * range.indexOffset, indexData.data() + indexSize * records[i].indexOffset,
+                            indexSize * range.indexCount);
+            }
+        } else if (!vertexData.empty()) {
+            using vkMP = vk::MemoryPropertyFlagBits;
+            Buffer stagingBuffer{ *context, vertexData.size() + indexData.size(), vk::BufferUsageFlagBits::eTransferSrc,
+                                  vkMP::eHostVisible | vkMP::eHostCoherent };
+            auto* mapped = static_cast<uint8_t*>(stagingBuffer.map());
+            std::memcpy(mapped, vertexData.data(), vertexData.size());
+            std::memcpy(mapped + vertexData.size(), indexData.data(), indexData.size());
+            context->OneTimeSubmitGraphics([&](const CommandBuffer& commandBuffer) {
+                for (size_t i = 0; i < meshes.size(); i++) {
+                    geometryPool.upload(commandBuffer, meshes[i].getGeometryId(), stagingBuffer.get(),
+                                        stride * records[i].vertexOffset,
+                                        vertexData.size() + indexSize * records[i].indexOffset);
+                }
+            });
+        }
+
+        if (!info.loadTextures || cache.getTextures().empty()) {
+            return;
+        }
+
+        // Texels and mips are stored ready to copy. Textures are uploaded in batches
+        // that fit the staging buffer, which grows for a single larger texture.
+        std::span<const SceneCacheTexture> textureRecords = cache.getTextures();
+        vk::DeviceSize largest = 0;
+        for (const SceneCacheTexture& texture : textureRecords) {
+            largest = std::max<vk::DeviceSize>(largest, texture.dataSize);
+        }
+        using vkMP = vk::MemoryPropertyFlagBits;
+        Buffer stagingBuffer{ *context, std::max(info.textureInfo.stagingSize, largest),
+                              vk::BufferUsageFlagBits::eTransferSrc, vkMP::eHostVisible | vkMP::eHostCoherent };
+        auto* mapped = static_cast<uint8_t*>(stagingBuffer.map());
+        textures.reserve(textureRecords.size());
+        for (size_t first = 0; first < textureRecords.size();) {
+            size_t last = first;
+            vk::DeviceSize used = 0;
+            std::vector<vk::DeviceSize> offsets;
+            while (last < textureRecords.size()) {
+                vk::DeviceSize offset = (used + 15) / 16 * 16;
+                if (offset + textureRecords[last].dataSize > stagingBuffer.getSize()) {
+                    break;
+                }
+                std::span<const uint8_t> data = cache.getTextureData(textureRecords[last]);
+                std::memcpy(mapped + offset, data.data(), data.size());
+                offsets.push_back(offset);
+                used = offset + data.size();
+                last++;
+            }
+            context->OneTimeSubmitGraphics([&](const CommandBuffer& commandBuffer) {
+                for (size_t i = first; i < last; i++) {
+                    const SceneCacheTexture& record = textureRecords[i];
+                    Image& texture = textures.emplace_back(*context, vk::Extent2D{ record.width, record.height },
+                                                           record.format,
+                                                           vk::ImageUsageFlagBits::eSampled |
+                                                           vk::ImageUsageFlagBits::eTransferDst,
+                                                           record.mipLevels);
+                    texture.createImageView();
+                    vk::SamplerCreateInfo samplerInfo = getSamplerInfo(record.sampler);
+                    samplerInfo.setMaxLod(static_cast<float>(record.mipLevels));
+                    texture.createSampler(samplerInfo);
+                    texture.upload(commandBuffer, stagingBuffer.get(), offsets[i - first]);
+                }
+            });
+            first = last;
+        }
+    }
+
+    void Scene::loadTextures(const GltfLoader& loader, const TextureLoaderCreateInfo& textureInfo)
+    {
+        if (loader.getTextures().empty()) {
+            return;
+        }
+
+        // Sources point into the loader's mappings, which stay valid until the upload finished
+        // KTX2 images are preferred if they can be transcoded or there is no fallback
+        std::vector<vk::Format> formats = getTextureFormats(loader);
+        std::vector<TextureSource> sources;
+        for (const TextureInfo& texture : loader.getTextures()) {
+            TextureSource& source = sources.emplace_back();
+            source.format = formats[sources.size() - 1];
+            int32_t imageIndex = texture.imageIndex;
+            if (texture.basisImageIndex >= 0 && (textureInfo.transcoder || imageIndex < 0)) {
+                imageIndex = texture.basisImageIndex;
+            }
+            if (imageIndex >= 0 && imageIndex < static_cast<int32_t>(loader.getImages().size())) {
+                const ImageSource& image = loader.getImages()[imageIndex];
+                source.data = image.data;
+                source.size = image.size;
+                source.path = image.path;
+            }
+            source.samplerInfo = getSamplerInfo(texture);
+        }
+
+        // Only images that aren't KTX2 need the decoder
+        if (!textureInfo.decoder) {
+            auto needsDecoder = [](const TextureSource& source) {
+                return source.data && !Ktx2File::isKtx2(source.data, source.size);
+            };
+            if (size_t count = std::count_if(sources.begin(), sources.end(), needsDecoder); count > 0) {
+                log::warn("skipped {} textures: no image decoder for {} of them", sources.size(), count);
+                return;
+            }
+        }
+
+        TextureLoader textureLoader{ *context, textureInfo };
+        textures = textureLoader.load(sources);
+    }
+}
@@ -0,0 +1,620 @@
+#include "vktiny/SceneCache.hpp"
+#include "vktiny/ThreadPool.hpp"
+#include "vktiny/Trace.hpp"
+#include "vktiny/Log.hpp"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+namespace vkt
+{
+    namespace
+    {
+        constexpr char cacheMagic[8] = { 'V', 'K', 'T', 'S', 'C', 'E', 'N', 'E' };
+        constexpr uint32_t cacheVersion = 3;
+
+        // Covers the staging copy alignments of common devices
+        constexpr uint64_t sectionAlignment = 256;
+
+        enum Section : uint32_t
+        {
+            MeshSection,
+            LodSection,
+            MaterialSection,
+            InstanceSection,
+            TextureSection,
+            VertexSection,
+            IndexSection,
+            TextureDataSection,
+            DependencySection,
+            SectionCount,
+        };
+
+        struct SectionRange
+        {
+            uint64_t offset = 0;
+            uint64_t size = 0;
+        };
+
+        struct Header
+        {
+            char magic[8];
+            uint32_t version = cacheVersion;
+            uint32_t sectionCount = SectionCount;
+
+            // Identify the source file and settings the cache was written from
+            uint64_t sourceSize = 0;
+            int64_t sourceTime = 0;
+            uint64_t settingsHash = 0;
+
+            // Records are stored as in memory, so their layouts must match
+            uint32_t recordSizes[5] = {};
+            uint32_t vertexStride = 0;
+            vk::IndexType indexType = vk::IndexType::eUint32;
+            uint32_t padding = 0;
+            meshopt::OptimizeStats optimizeStats;
+            SectionRange sections[SectionCount];
+        };
+
+        static_assert(std::is_trivially_copyable_v<Material>);
+        static_assert(std::is_trivially_copyable_v<MeshInstance>);
+        static_assert(std::is_trivially_copyable_v<SceneCacheMesh>);
+        static_assert(std::is_trivially_copyable_v<SceneCacheTexture>);
+
+        void getRecordSizes(uint32_t sizes[5])
+        {
+            sizes[0] = sizeof(SceneCacheMesh);
+            sizes[1] = sizeof(meshopt::Lod);
+            sizes[2] = sizeof(Material);
+            sizes[3] = sizeof(MeshInstance);
+            sizes[4] = sizeof(SceneCacheTexture);
+        }
+
+        // Everything that changes the stored geometry, and whether textures could be written
+        uint64_t getSettingsHash(const SceneCreateInfo& info)
+        {
+            uint64_t hash = 14695981039346656037ull;
+            auto add = [&](auto value) {
+                uint8_t bytes[sizeof(value)];
+                std::memcpy(bytes, &value, sizeof(value));
+                for (uint8_t byte : bytes) {
+                    hash = (hash ^ byte) * 1099511628211ull;
+                }
+            };
+            add(info.optimizeMeshes);
+            if (info.optimizeMeshes) {
+                const meshopt::OptimizeInfo& optimize = info.optimizeInfo;
+                add(optimize.deduplicate);
+                add(optimize.vertexCache);
+                add(optimize.overdraw);
+                add(optimize.overdrawThreshold);
+                add(optimize.vertexFetch);
+                add(optimize.lodCount);
+                add(optimize.lodRatio);
+            }
+            add(info.quantizeVertices);
+            if (info.quantizeVertices) {
+                add(info.vertexLayout.position);
+                add(info.vertexLayout.normal);
+                add(info.vertexLayout.texCoord);
+                add(info.smallIndices);
+            }
+            add(static_cast<bool>(info.textureInfo.decoder));
+            return hash;
+        }
+
+        int64_t getSourceTime(const std::filesystem::path& path)
+        {
+            std::error_code error;
+            return std::filesystem::last_write_time(path, error).time_since_epoch().count();
+        }
+
+        // A buffer or image file next to the glTF file, followed by pathSize bytes of its
+        // path relative to the glTF directory and padding to 8 bytes. Missing files are
+        // recorded too, so the cache goes stale when they appear.
+        struct Dependency
+        {
+            uint64_t size = 0;
+            int64_t time = 0;
+            uint32_t pathSize = 0;
+            uint32_t padding = 0;
+        };
+
+        Dependency getDependency(const std::filesystem::path& path)
+        {
+            std::error_code error;
+            return { static_cast<uint64_t>(std::filesystem::file_size(path, error)), getSourceTime(path) };
+        }
+
+        std::vector<uint8_t> writeDependencies(const GltfLoader& loader, const std::filesystem::path& gltfPath)
+        {
+            std::vector<uint8_t> bytes;
+            for (const std::filesystem::path& path : loader.getExternalFiles()) {
+                std::string relative = path.lexically_relative(gltfPath.parent_path()).generic_string();
+                Dependency dependency = getDependency(path);
+                dependency.pathSize = static_cast<uint32_t>(relative.size());
+                size_t offset = bytes.size();
+                bytes.resize(offset + sizeof(Dependency) + (relative.size() + 7) / 8 * 8);
+                std::memcpy(bytes.data() + offset, &dependency, sizeof(dependency));
+                std::memcpy(bytes.data() + offset + sizeof(dependency), relative.data(), relative.size());
+            }
+            return bytes;
+        }
+
+        // Whether every dependency still has the recorded size and modification time
+        bool checkDependencies(std::span<const uint8_t> bytes, const std::filesystem::path& gltfPath)
+        {
+            size_t offset = 0;
+            while (offset < bytes.size()) {
+                Dependency recorded;
+                if (bytes.size() - offset < sizeof(recorded)) {
+                    return false;
+                }
+                std::memcpy(&recorded, bytes.data() + offset, sizeof(recorded));
+                offset += sizeof(recorded);
+                if (recorded.pathSize > bytes.size() - offset) {
+                    return false;
+                }
+                std::string relative{ reinterpret_cast<const char*>(bytes.data() + offset), recorded.pathSize };
+                offset += (size_t{ recorded.pathSize } + 7) / 8 * 8;
+
+                Dependency current = getDependency(gltfPath.parent_path() / relative);
+                if (current.size != recorded.size || current.time != recorded.time) {
+                    log::info("scene cache dependency {} changed", relative);
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        uint64_t alignSection(uint64_t offset)
+        {
+            return (offset + sectionAlignment - 1) / sectionAlignment * sectionAlignment;
+        }
+
+        // Decoded image with all mip levels appended, or a white texel if it can't be decoded
+        struct CachedImage
+        {
+            uint32_t width = 1;
+            uint32_t height = 1;
+            uint32_t mipLevels = 1;
+            std::vector<uint8_t> data{ 255, 255, 255, 255 };
+        };
+
+        CachedImage decodeImage(const ImageSource& source, const ImageDecoder& decoder, bool srgb)
+        {
+            CachedImage result;
+            MappedFile file;
+            const uint8_t* data = source.data;
+            size_t size = source.size;
+            try {
+                if (!data && !source.path.empty()) {
+                    file = MappedFile{ source.path };
+                    data = file.data();
+                    size = file.size();
+                }
+            } catch (const std::exception& e) {
+                log::warn("image {}: {}", source.name, e.what());
+            }
+
+            // Mip levels are generated like TextureLoader does for the glTF path
+            DecodedImage image;
+            image.format = srgb ? vk::Format::eR8G8B8A8Srgb : vk::Format::eR8G8B8A8Unorm;
+            try {
+                if (!data || !decoder(data, size, image) || image.width == 0 || image.height == 0 ||
+                    image.mipLevels != 1 || image.pixels.size() != size_t{ image.width } * image.height * 4) {
+                    log::warn("image {} could not be decoded, using a white texel", source.name);
+                    return result;
+                }
+                generateMipLevels(image);
+            } catch (const std::exception& e) {
+                log::warn("image {}: {}, using a white texel", source.name, e.what());
+                return result;
+            }
+            result.width = image.width;
+            result.height = image.height;
+            result.mipLevels = image.mipLevels;
+            result.data = std::move(image.pixels);
+            return result;
+        }
+
+        template <typename T>
+        std::span<const T> asRecords(std::span<const uint8_t> bytes)
+        {
+            return { reinterpret_cast<const T*>(bytes.data()), bytes.size() / sizeof(T) };
+        }
+    }
+
+    const void* ProcessedMesh::getVertexData() const
+    {
+        return isQuantized ? static_cast<const void*>(quantized.vertexData.data()) : vertices.data();
+    }
+
+    const void* ProcessedMesh::getIndexData() const
+    {
+        return isQuantized ? static_cast<const void*>(quantized.indexData.data()) : indices.data();
+    }
+
+    GeometryPoolCreateInfo getGeometryPoolInfo(const GltfLoader& loader, const SceneCreateInfo& info)
+    {
+        // Optimization only removes vertices. With a LOD ratio up to 0.5 all levels
+        // together need fewer indices than the full meshes.
+        uint32_t indexCapacity = loader.getIndexCount();
+        if (info.optimizeMeshes && info.optimizeInfo.lodCount > 0) {
+            indexCapacity *= 2;
+        }
+        GeometryPoolCreateInfo poolInfo{ loader.getVertexCount(), indexCapacity, info.meshUsage, info.meshProperties };
+        if (info.quantizeVertices) {
+            // Indices are relative to each mesh, so only the largest mesh has to fit 16 bits
+            uint32_t maxVertexCount = 0;
+            for (const MeshInfo& mesh : loader.getMeshes()) {
+                maxVertexCount = std::max(maxVertexCount, mesh.vertexCount);
+            }
+            poolInfo.vertexStride = info.vertexLayout.getStride();
+            if (info.smallIndices && maxVertexCount <= 65536) {
+                poolInfo.indexType = vk::IndexType::eUint16;
+            }
+        }
+        return poolInfo;
+    }
+
+    std::vector<ProcessedMesh> processMeshes(ThreadPool& pool, const GltfLoader& loader,
+                                             const SceneCreateInfo& info, vk::IndexType indexType)
+    {
+        VKT_TRACE_SCOPE("processMeshes");
+        const std::vector<MeshInfo>& infos = loader.getMeshes();
+        std::vector<ProcessedMesh> results(infos.size());
+        pool.parallelFor(infos.size(), [&](size_t i) {
+            ProcessedMesh& result = results[i];
+            result.vertices.resize(infos[i].vertexCount);
+            result.indices.resize(infos[i].indexCount);
+            loader.decodeMesh(static_cast<uint32_t>(i), result.vertices.data(), result.indices.data());
+            if (info.optimizeMeshes) {
+                result.stats = meshopt::optimizeMesh(result.vertices, result.indices, result.lods, info.optimizeInfo);
+            }
+            result.vertexCount = static_cast<uint32_t>(result.vertices.size());
+            result.indexCount = static_cast<uint32_t>(result.indices.size());
+            if (info.quantizeVertices) {
+                result.quantized = quantizeMesh(result.vertices.data(), result.vertexCount,
+                                                result.indices.data(), result.indexCount,
+                                                info.vertexLayout, indexType);
+                result.isQuantized = true;
+                result.vertices = {};
+                result.indices = {};
+            }
+        });
+        return results;
+    }
+
+    meshopt::OptimizeStats sumOptimizeStats(const std::vector<ProcessedMesh>& meshes)
+    {
+        meshopt::OptimizeStats total;
+        uint64_t triangleCount = 0;
+        for (const ProcessedMesh& mesh : meshes) {
+            total.vertexCountBefore += mesh.stats.vertexCountBefore;
+            total.vertexCountAfter += mesh.stats.vertexCountAfter;
+            total.before.verticesTransformed += mesh.stats.before.verticesTransformed;
+            total.after.verticesTransformed += mesh.stats.after.verticesTransformed;
+            triangleCount += (mesh.lods.empty() ? mesh.indexCount : mesh.lods[0].indexCount) / 3;
+        }
+        auto finish = [&](meshopt::VertexCacheStats& stats, uint32_t vertexCount) {
+            stats.acmr = triangleCount > 0 ? static_cast<float>(stats.verticesTransformed) / triangleCount : 0.0f;
+            stats.atvr = vertexCount > 0 ? static_cast<float>(stats.verticesTransformed) / vertexCount : 0.0f;
+        };
+        finish(total.before, total.vertexCountBefore);
+        finish(total.after, total.vertexCountAfter);
+        return total;
+    }
+
+    void SceneCache::write(const std::filesystem::path& cachePath, const std::filesystem::path& gltfPath,
+                           const SceneCreateInfo& info)
+    {
+        VKT_TRACE_SCOPE("SceneCache::write");
+        ThreadPool pool{ info.threadCount };
+        GltfLoader loader{ gltfPath, &pool };
+        GeometryPoolCreateInfo poolInfo = getGeometryPoolInfo(loader, info);
+        std::vector<ProcessedMesh> processed = processMeshes(pool, loader, info, poolInfo.indexType);
+        uint64_t indexSize = poolInfo.indexType == vk::IndexType::eUint16 ? 2 : 4;
+
+        Header header;
+        std::memcpy(header.magic, cacheMagic, sizeof(cacheMagic));
+        header.sourceSize = std::filesystem::file_size(gltfPath);
+        header.sourceTime = getSourceTime(gltfPath);
+        header.settingsHash = getSettingsHash(info);
+        getRecordSizes(header.recordSizes);
+        header.vertexStride = poolInfo.vertexStride;
+        header.indexType = poolInfo.indexType;
+        if (info.optimizeMeshes) {
+            header.optimizeStats = sumOptimizeStats(processed);
+        }
+
+        std::vector<SceneCacheMesh> meshRecords;
+        std::vector<meshopt::Lod> lods;
+        uint64_t vertexCount = 0;
+        uint64_t indexCount = 0;
+        for (size_t i = 0; i < processed.size(); i++) {
+            SceneCacheMesh& record = meshRecords.emplace_back();
+            record.vertexOffset = static_cast<uint32_t>(vertexCount);
+            record.vertexCount = processed[i].vertexCount;
+            record.indexOffset = static_cast<uint32_t>(indexCount);
+            record.indexCount = processed[i].indexCount;
+            record.lodOffset = static_cast<uint32_t>(lods.size());
+            record.lodCount = static_cast<uint32_t>(processed[i].lods.size());
+            record.materialIndex = loader.getMeshes()[i].materialIndex;
+            record.quantization = processed[i].quantized.quantization;
+            lods.insert(lods.end(), processed[i].lods.begin(), processed[i].lods.end());
+            vertexCount += record.vertexCount;
+            indexCount += record.indexCount;
+        }
+
+        // Images are decoded once even if several textures sample them
+        std::vector<CachedImage> images;
+        bool writeTextures = static_cast<bool>(info.textureInfo.decoder) && !loader.getTextures().empty();
+        std::vector<vk::Format> formats = getTextureFormats(loader);
+        if (writeTextures) {
+            // Mips of images that any texture samples as color are filtered in linear space
+            std::vector<bool> srgbImages(loader.getImages().size());
+            for (size_t i = 0; i < formats.size(); i++) {
+                int32_t imageIndex = loader.getTextures()[i].imageIndex;
+                bool valid = imageIndex >= 0 && imageIndex < static_cast<int32_t>(srgbImages.size());
+                if (valid && formats[i] == vk::Format::eR8G8B8A8Srgb) {
+                    srgbImages[imageIndex] = true;
+                }
+            }
+            images.resize(loader.getImages().size());
+            pool.parallelFor(images.size(), [&](size_t i) {
+                images[i] = decodeImage(loader.getImages()[i], info.textureInfo.decoder, srgbImages[i]);
+            });
+        } else if (!loader.getTextures().empty()) {
+            log::warn("writing {} without textures: no image decoder", cachePath.string());
+        }
+        std::vector<uint64_t> imageOffsets(images.size());
+        uint64_t textureDataSize = 0;
+        for (size_t i = 0; i < images.size(); i++) {
+            imageOffsets[i] = textureDataSize;
+            textureDataSize = alignSection(textureDataSize + images[i].data.size());
+        }
+        std::vector<SceneCacheTexture> textureRecords;
+        if (writeTextures) {
+            static const CachedImage placeholder;
+            for (const TextureInfo& texture : loader.getTextures()) {
+                SceneCacheTexture& record = textureRecords.emplace_back();
+                bool valid = texture.imageIndex >= 0 && texture.imageIndex < static_cast<int32_t>(images.size());
+                const CachedImage& image = valid ? images[texture.imageIndex] : placeholder;
+                if (texture.imageIndex < 0 && texture.basisImageIndex >= 0) {
+                    log::warn("texture {} only has a KTX2 image, which scene caches don't store", textureRecords.size() - 1);
+                }
+                record.width = image.width;
+                record.height = image.height;
+                record.mipLevels = image.mipLevels;
+                record.format = formats[textureRecords.size() - 1];
+                record.sampler = texture;
+                if (valid) {
+                    record.dataOffset = imageOffsets[texture.imageIndex];
+                    record.dataSize = image.data.size();
+                } else {
+                    // Points at the end of the texture data, where the placeholder is appended
+                    record.dataOffset = textureDataSize;
+                    record.dataSize = placeholder.data.size();
+                }
+            }
+        }
+        uint64_t placeholderOffset = textureDataSize;
+        textureDataSize += 4;
+        std::vector<uint8_t> dependencies = writeDependencies(loader, gltfPath);
+
+        uint64_t sizes[SectionCount] = {
+            sizeof(SceneCacheMesh) * meshRecords.size(),
+            sizeof(meshopt::Lod) * lods.size(),
+            sizeof(Material) * loader.getMaterials().size(),
+            sizeof(MeshInstance) * loader.getInstances().size(),
+            sizeof(SceneCacheTexture) * textureRecords.size(),
+            header.vertexStride * vertexCount,
+            indexSize * indexCount,
+            textureDataSize,
+            dependencies.size(),
+        };
+        uint64_t offset = alignSection(sizeof(Header));
+        for (uint32_t section = 0; section < SectionCount; section++) {
+            header.sections[section] = { offset, sizes[section] };
+            offset = alignSection(offset + sizes[section]);
+        }
+
+        // Written to a temporary file first so a reader never sees a partial cache
+        std::filesystem::path tempPath = cachePath;
+        tempPath += ".tmp";
+        {
+            std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+            if (!out) {
+                throw std::runtime_error("failed to open " + tempPath.string());
+            }
+            auto writeAt = [&](uint64_t position, const void* data, uint64_t size) {
+                out.seekp(static_cast<std::streamoff>(position));
+                out.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+            };
+            writeAt(0, &header, sizeof(header));
+            writeAt(header.sections[MeshSection].offset, meshRecords.data(), sizes[MeshSection]);
+            writeAt(header.sections[LodSection].offset, lods.data(), sizes[LodSection]);
+            writeAt(header.sections[MaterialSection].offset, loader.getMaterials().data(), sizes[MaterialSection]);
+            writeAt(header.sections[InstanceSection].offset, loader.getInstances().data(), sizes[InstanceSection]);
+            writeAt(header.sections[TextureSection].offset, textureRecords.data(), sizes[TextureSection]);
+
+            uint64_t position = header.sections[VertexSection].offset;
+            for (const ProcessedMesh& mesh : processed) {
+                uint64_t size = header.vertexStride * uint64_t{ mesh.vertexCount };
+                writeAt(position, mesh.getVertexData(), size);
+                position += size;
+            }
+            position = header.sections[IndexSection].offset;
+            for (const ProcessedMesh& mesh : processed) {
+                uint64_t size = indexSize * mesh.indexCount;
+                writeAt(position, mesh.getIndexData(), size);
+                position += size;
+            }
+            uint64_t textureBase = header.sections[TextureDataSection].offset;
+            for (size_t i = 0; i < images.size(); i++) {
+                writeAt(textureBase + imageOffsets[i], images[i].data.data(), images[i].data.size());
+            }
+            const uint8_t white[4] = { 255, 255, 255, 255 };
+            writeAt(textureBase + placeholderOffset, white, sizeof(white));
+            writeAt(header.sections[DependencySection].offset, dependencies.data(), dependencies.size());
+
+            // Pad to the end of the last section
+            out.seekp(0, std::ios::end);
+            if (static_cast<uint64_t>(out.tellp()) < offset) {
+                writeAt(offset - 1, "", 1);
+            }
+            if (!out) {
+                throw std::runtime_error("failed to write " + tempPath.string());
+            }
+        }
+        std::filesystem::rename(tempPath, cachePath);
+        log::info("wrote {}: {} meshes, {} textures, {} KiB", cachePath.string(), meshRecords.size(),
+                  textureRecords.size(), offset / 1024);
+    }
+
+    std::optional<SceneCache> SceneCache::open(const std::filesystem::path& cachePath,
+                                               const std::filesystem::path& gltfPath,
+                                               const SceneCreateInfo& info)
+    {
+        std::error_code error;
+        if (!std::filesystem::exists(cachePath, error)) {
+            log::info("no scene cache at {}, loading {}", cachePath.string(), gltfPath.string());
+            return std::nullopt;
+        }
+
+        std::optional<SceneCache> cache;
+        try {
+            cache.emplace(SceneCache{ MappedFile{ cachePath } });
+        } catch (const std::exception& e) {
+            log::warn("ignoring scene cache {}: {}", cachePath.string(), e.what());
+            return std::nullopt;
+        }
+        Header header;
+        std::memcpy(&header, cache->file.data(), sizeof(header));
+        if (header.sourceSize != std::filesystem::file_size(gltfPath, error) ||
+            header.sourceTime != getSourceTime(gltfPath) ||
+            header.settingsHash != getSettingsHash(info) ||
+            !checkDependencies(cache->getSection(DependencySection), gltfPath)) {
+            log::info("scene cache {} is stale, loading {}", cachePath.string(), gltfPath.string());
+            return std::nullopt;
+        }
+        return cache;
+    }
+
+    SceneCache::SceneCache(MappedFile&& mappedFile)
+        : file(std::move(mappedFile))
+    {
+        if (file.size() < sizeof(Header)) {
+            throw std::runtime_error("file too small");
+        }
+        Header header;
+        std::memcpy(&header, file.data(), sizeof(header));
+        uint32_t recordSizes[5];
+        getRecordSizes(recordSizes);
+        if (std::memcmp(header.magic, cacheMagic, sizeof(cacheMagic)) != 0) {
+            throw std::runtime_error("not a scene cache");
+        }
+        if (header.version != cacheVersion || header.sectionCount != SectionCount ||
+            std::memcmp(header.recordSizes, recordSizes, sizeof(recordSizes)) != 0) {
+            throw std::runtime_error("written by a different version");
+        }
+        for (const SectionRange& section : header.sections) {
+            if (section.offset > file.size() || section.size > file.size() - section.offset ||
+                section.offset % sectionAlignment != 0) {
+                throw std::runtime_error("section out of bounds");
+            }
+        }
+
+        // Validate the records so the ranges can be used without further checks
+        uint64_t indexSize = header.indexType == vk::IndexType::eUint16 ? 2 : 4;
+        uint64_t vertexCount = header.vertexStride > 0 ? getVertexData().size() / header.vertexStride : 0;
+        uint64_t indexCount = getIndexData().size() / indexSize;
+        for (const SceneCacheMesh& mesh : getMeshes()) {
+            if (uint64_t{ mesh.vertexOffset } + mesh.vertexCount > vertexCount ||
+                uint64_t{ mesh.indexOffset } + mesh.indexCount > indexCount ||
+                uint64_t{ mesh.lodOffset } + mesh.lodCount > getLods().size()) {
+                throw std::runtime_error("mesh out of bounds");
+            }
+            for (const meshopt::Lod& lod : getLods().subspan(mesh.lodOffset, mesh.lodCount)) {
+                if (uint64_t{ lod.indexOffset } + lod.indexCount > mesh.indexCount) {
+                    throw std::runtime_error("LOD out of bounds");
+                }
+            }
+        }
+        uint64_t textureDataSize = getSection(TextureDataSection).size();
+        for (const SceneCacheTexture& texture : getTextures()) {
+            uint64_t size = 0;
+            for (uint32_t level = 0; level < texture.mipLevels; level++) {
+                size += uint64_t{ std::max(texture.width >> level, 1u) } * std::max(texture.height >> level, 1u) * 4;
+            }
+            bool rgba8 = texture.format == vk::Format::eR8G8B8A8Unorm || texture.format == vk::Format::eR8G8B8A8Srgb;
+            if (!rgba8 || texture.mipLevels == 0 || texture.mipLevels > 32 ||
+                texture.dataSize != size || texture.dataOffset > textureDataSize ||
+                texture.dataSize > textureDataSize - texture.dataOffset) {
+                throw std::runtime_error("texture out of bounds");
+            }
+        }
+    }
+
+    std::span<const uint8_t> SceneCache::getSection(uint32_t section) const
+    {
+        const auto* header = reinterpret_cast<const Header*>(file.data());
+        return { file.data() + header->sections[section].offset, header->sections[section].size };
+    }
+
+    std::span<const SceneCacheMesh> SceneCache::getMeshes() const
+    {
+        return asRecords<SceneCacheMesh>(getSection(MeshSection));
+    }
+
+    std::span<const meshopt::Lod> SceneCache::getLods() const
+    {
+        return asRecords<meshopt::Lod>(getSection(LodSection));
+    }
+
+    std::span<const Material> SceneCache::getMaterials() const
+    {
+        return asRecords<Material>(getSection(MaterialSection));
+    }
+
+    std::span<const MeshInstance> SceneCache::getInstances() const
+    {
+        return asRecords<MeshInstance>(getSection(InstanceSection));
+    }
+
+    std::span<const SceneCacheTexture> SceneCache::getTextures() const
+    {
+        return asRecords<SceneCacheTexture>(getSection(TextureSection));
+    }
+
+    std::span<const uint8_t> SceneCache::getVertexData() const
+    {
+        return getSection(VertexSection);
+    }
+
+    std::span<const uint8_t> SceneCache::getIndexData() const
+    {
+        return getSection(IndexSection);
+    }
+
+    std::span<const uint8_t> SceneCache::getTextureData(const SceneCacheTexture& texture) const
+    {
+        return getSection(TextureDataSection).subspan(texture.dataOffset, texture.dataSize);
+    }
+
+    uint32_t SceneCache::getVertexStride() const
+    {
+        return reinterpret_cast<const Header*>(file.data())->vertexStride;
+    }
+
+    vk::IndexType SceneCache::getIndexType() const
+    {
+        return reinterpret_cast<const Header*>(file.data())->indexType;
+    }
+
+    const meshopt::OptimizeStats& SceneCache::getOptimizeStats() const
+    {
+        return reinterpret_cast<const Header*>(file.data())->optimizeStats;
+    }
+}
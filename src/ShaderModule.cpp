@@ -1,7 +1,10 @@
 #include "vktiny/Context.hpp"
 #include "vktiny/ShaderModule.hpp"
+#include "vktiny/Trace.hpp"
+#include <algorithm>
 #include <fstream>
 #include <SPIRV/GlslangToSpv.h>
+#include <glslang/Include/Types.h>
 #include <StandAlone/ResourceLimits.h>
 
 namespace vkt
@@ -57,9 +60,72 @@ namespace vkt
         }
     }
 
+    vk::DescriptorType getDescriptorType(const glslang::TType& type, bool bufferBlock)
+    {
+        if (type.getBasicType() != glslang::EbtSampler) {
+            return bufferBlock ? vk::DescriptorType::eStorageBuffer : vk::DescriptorType::eUniformBuffer;
+        }
+        const glslang::TSampler& sampler = type.getSampler();
+        if (sampler.isImage()) {
+            return sampler.isBuffer() ? vk::DescriptorType::eStorageTexelBuffer : vk::DescriptorType::eStorageImage;
+        }
+        if (sampler.isBuffer()) {
+            return vk::DescriptorType::eUniformTexelBuffer;
+        }
+        if (sampler.isPureSampler()) {
+            return vk::DescriptorType::eSampler;
+        }
+        return sampler.isCombined() ? vk::DescriptorType::eCombinedImageSampler : vk::DescriptorType::eSampledImage;
+    }
+
+    void addBinding(ShaderReflection& reflection, const glslang::TObjectReflection& object, bool bufferBlock)
+    {
+        const glslang::TType* type = object.getType();
+        if (!type || object.getBinding() < 0) {
+            return;
+        }
+        const glslang::TQualifier& qualifier = type->getQualifier();
+        if (qualifier.hasSet() && qualifier.layoutSet != 0) {
+            return;
+        }
+
+        ShaderBinding binding;
+        binding.name = object.name;
+        binding.binding = static_cast<uint32_t>(object.getBinding());
+        binding.type = getDescriptorType(*type, bufferBlock);
+        binding.count = type->isSizedArray() ? std::max(type->getOuterArraySize(), 1) : 1;
+        binding.readonly = qualifier.readonly;
+        binding.writeonly = qualifier.writeonly;
+        reflection.bindings.push_back(binding);
+    }
+
+    void reflect(glslang::TProgram& program, ShaderReflection& reflection)
+    {
+        if (!program.buildReflection()) {
+            throw std::runtime_error("failed to reflect shader");
+        }
+        for (int i = 0; i < program.getNumBufferBlocks(); i++) {
+            addBinding(reflection, program.getBufferBlock(i), true);
+        }
+        for (int i = 0; i < program.getNumUniformBlocks(); i++) {
+            addBinding(reflection, program.getUniformBlock(i), false);
+        }
+        for (int i = 0; i < program.getNumUniformVariables(); i++) {
+            const glslang::TObjectReflection& uniform = program.getUniform(i);
+            if (uniform.getType() && uniform.getType()->getBasicType() == glslang::EbtSampler) {
+                addBinding(reflection, uniform, false);
+            }
+        }
+        for (int dim = 0; dim < 3; dim++) {
+            reflection.localSize[dim] = std::max(program.getLocalSize(dim), 1u);
+        }
+    }
+
     std::vector<unsigned int> compileToSPV(const vk::ShaderStageFlagBits shaderType,
-                                           std::string const& glslShader)
+                                           std::string const& glslShader,
+                                           ShaderReflection* reflection)
     {
+        VKT_TRACE_SCOPE("CompileShader");
         glslang::InitializeProcess();
 
         EShLanguage stage = translateShaderStage(shaderType);
@@ -88,6 +154,10 @@ namespace vkt
             throw std::runtime_error(shader.getInfoLog());
         }
 
+        if (reflection) {
+            reflect(program, *reflection);
+        }
+
         std::vector<unsigned int> spvShader;
         glslang::GlslangToSpv(*program.getIntermediate(stage), spvShader);
         glslang::FinalizeProcess();
@@ -99,7 +169,14 @@ namespace vkt
     {
         std::vector<unsigned int> shaderSPV = compileToSPV(shaderStage, shaderText);
         vk::ShaderModuleCreateInfo createInfo{ {}, shaderSPV };
-        shaderModule = context.getDevice().createShaderModuleUnique(createInfo);
+        shaderModule = context.getDevice().createShaderModuleUnique(createInfo, nullptr, context.getDispatcher());
+    }
+
+    ShaderModule::ShaderModule(const Context& context, const std::vector<unsigned int>& shaderSPV, vk::ShaderStageFlagBits shaderStage)
+        : shaderStage(shaderStage)
+    {
+        vk::ShaderModuleCreateInfo createInfo{ {}, shaderSPV };
+        shaderModule = context.getDevice().createShaderModuleUnique(createInfo, nullptr, context.getDispatcher());
     }
 
     vk::PipelineShaderStageCreateInfo ShaderModule::getStageInfo() const
@@ -1,5 +1,8 @@
 #include <iostream>
+#include <thread>
 #include "vktiny/Swapchain.hpp"
+#include "vktiny/Trace.hpp"
+#include "vktiny/DriverStats.hpp"
 
 namespace vkt
 {
@@ -27,16 +30,34 @@ namespace vkt
     }
 
     vk::PresentModeKHR chooseSwapPresentMode(
-        const std::vector<vk::PresentModeKHR>& availablePresentModes)
+        const std::vector<vk::PresentModeKHR>& availablePresentModes,
+        const std::vector<vk::PresentModeKHR>& requestedPresentModes)
     {
-        for (const auto& availablePresentMode : availablePresentModes) {
-            if (availablePresentMode == vk::PresentModeKHR::eFifoRelaxed) {
-                return availablePresentMode;
+        for (const auto& requestedPresentMode : requestedPresentModes) {
+            for (const auto& availablePresentMode : availablePresentModes) {
+                if (availablePresentMode == requestedPresentMode) {
+                    return availablePresentMode;
+                }
             }
         }
         return vk::PresentModeKHR::eFifo;
     }
 
+    uint32_t chooseSwapImageCount(const vk::SurfaceCapabilitiesKHR& capabilities,
+                                  uint32_t requestedImageCount)
+    {
+        uint32_t imageCount = requestedImageCount;
+        if (imageCount == 0) {
+            imageCount = capabilities.minImageCount + 1;
+        }
+        imageCount = std::max(imageCount, capabilities.minImageCount);
+        if (capabilities.maxImageCount > 0 &&
+            imageCount > capabilities.maxImageCount) {
+            imageCount = capabilities.maxImageCount;
+        }
+        return imageCount;
+    }
+
     vk::Extent2D chooseSwapExtent(const vk::SurfaceCapabilitiesKHR& capabilities,
                                   int width, int height)
     {
@@ -52,6 +73,22 @@ namespace vkt
         }
     }
 
+    vk::ImageUsageFlags chooseSwapImageUsage(vk::PhysicalDevice physicalDevice,
+                                             const vk::SurfaceCapabilitiesKHR& capabilities,
+                                             vk::Format format)
+    {
+        using vkIU = vk::ImageUsageFlagBits;
+        vk::ImageUsageFlags usage = vkIU::eColorAttachment | vkIU::eTransferDst;
+
+        // Allow shaders to write straight into the presented image
+        vk::FormatProperties formatProperties = physicalDevice.getFormatProperties(format);
+        if ((capabilities.supportedUsageFlags & vkIU::eStorage) &&
+            (formatProperties.optimalTilingFeatures & vk::FormatFeatureFlagBits::eStorageImage)) {
+            usage |= vkIU::eStorage;
+        }
+        return usage;
+    }
+
     SupportDetails querySwapChainSupport(vk::PhysicalDevice device, vk::SurfaceKHR surface)
     {
         SupportDetails details;
@@ -63,30 +100,40 @@ namespace vkt
 
     Swapchain::~Swapchain()
     {
-        for (size_t i = 0; i < maxFramesInFlight; i++) {
-            context->getDevice().destroyFence(inFlightFences[i]);
+        for (auto& fence : inFlightFences) {
+            context->getDevice().destroyFence(fence, nullptr, context->getDispatcher());
         }
     }
 
     Swapchain::Swapchain(const Context& context, int width, int height)
+        : Swapchain(context, SwapchainCreateInfo{ .width = width, .height = height })
+    {
+    }
+
+    Swapchain::Swapchain(const Context& context, const SwapchainCreateInfo& info)
         : context(&context)
+        , info(info)
+        , maxFramesInFlight(std::max(info.maxFramesInFlight, 1u))
+        , enableFramePacing(info.enableFramePacing)
+    {
+        createSwapchain(nullptr);
+        createViews();
+        createSyncObjects();
+    }
+
+    void Swapchain::createSwapchain(vk::SwapchainKHR oldSwapchain)
     {
-        vk::Device device = context.getDevice();
-        vk::PhysicalDevice physicalDevice = context.getPhysicalDevice();
-        vk::SurfaceKHR surface = context.getSurface();
+        vk::Device device = context->getDevice();
+        vk::PhysicalDevice physicalDevice = context->getPhysicalDevice();
+        vk::SurfaceKHR surface = context->getSurface();
         auto swapChainSupport = querySwapChainSupport(physicalDevice, surface);
 
         vk::SurfaceFormatKHR surfaceFormat = chooseSwapSurfaceFormat(swapChainSupport.formats);
-        vk::PresentModeKHR presentMode = chooseSwapPresentMode(swapChainSupport.presentModes);
-        vk::Extent2D extent = chooseSwapExtent(swapChainSupport.capabilities, width, height);
-
-        uint32_t imageCount = swapChainSupport.capabilities.minImageCount + 1;
-        if (swapChainSupport.capabilities.maxImageCount > 0 &&
-            imageCount > swapChainSupport.capabilities.maxImageCount) {
-            imageCount = swapChainSupport.capabilities.maxImageCount;
-        }
+        presentMode = chooseSwapPresentMode(swapChainSupport.presentModes, info.presentModes);
+        vk::Extent2D extent = chooseSwapExtent(swapChainSupport.capabilities, info.width, info.height);
+        uint32_t imageCount = chooseSwapImageCount(swapChainSupport.capabilities, info.imageCount);
+        imageUsage = chooseSwapImageUsage(physicalDevice, swapChainSupport.capabilities, surfaceFormat.format);
 
-        using vkIU = vk::ImageUsageFlagBits;
         vk::SwapchainCreateInfoKHR createInfo;
         createInfo.setSurface(surface);
         createInfo.setMinImageCount(imageCount);
@@ -94,25 +141,62 @@ namespace vkt
         createInfo.setImageColorSpace(surfaceFormat.colorSpace);
         createInfo.setImageExtent(extent);
         createInfo.setImageArrayLayers(1);
-        createInfo.setImageUsage(vkIU::eColorAttachment | vkIU::eTransferDst);
+        createInfo.setImageUsage(imageUsage);
         createInfo.setImageSharingMode(vk::SharingMode::eExclusive);
         createInfo.setPreTransform(swapChainSupport.capabilities.currentTransform);
         createInfo.setCompositeAlpha(vk::CompositeAlphaFlagBitsKHR::eOpaque);
         createInfo.setPresentMode(presentMode);
         createInfo.setClipped(VK_TRUE);
+        createInfo.setOldSwapchain(oldSwapchain);
 
-        if (context.getGraphicsFamily() != context.getPresentFamily()) {
-            std::array familyIndices{ context.getGraphicsFamily(), context.getPresentFamily() };
+        std::array familyIndices{ context->getGraphicsFamily(), context->getPresentFamily() };
+        if (context->getGraphicsFamily() != context->getPresentFamily()) {
             createInfo.setImageSharingMode(vk::SharingMode::eConcurrent);
             createInfo.setQueueFamilyIndices(familyIndices);
         }
 
-        swapchain = device.createSwapchainKHRUnique(createInfo);
-        images = device.getSwapchainImagesKHR(*swapchain);
+        swapchain = device.createSwapchainKHRUnique(createInfo, nullptr, context->getDispatcher());
+        images = device.getSwapchainImagesKHR(*swapchain, context->getDispatcher());
         imageFormat = surfaceFormat.format;
         imageExtent = extent;
+    }
+
+    void Swapchain::recreate()
+    {
+        VKT_TRACE_SCOPE("RecreateSwapchain");
+        // Only the current frame's fence has been waited for, and the next image is acquired
+        // from the new swapchain. The old one may still be in use by the other frames in
+        // flight, the last of which is the previous frame. Its fence has been waited for
+        // once that frame's slot comes around again, maxFramesInFlight - 1 frames from now.
+        RetiredSwapchain retired;
+        retired.swapchain = std::move(swapchain);
+        retired.imageViews = std::move(imageViews);
+        retired.retireFrame = frameCount + maxFramesInFlight - 1;
+
+        createSwapchain(*retired.swapchain);
+        retiredSwapchains.push_back(std::move(retired));
         createViews();
-        createSyncObjects();
+        imagesInFlight.assign(images.size(), nullptr);
+        needsRecreate = false;
+
+        if (onRecreate) {
+            onRecreate(imageExtent);
+        }
+    }
+
+    void Swapchain::releaseRetiredSwapchains()
+    {
+        std::erase_if(retiredSwapchains,
+                      [&](const RetiredSwapchain& retired) {
+                          return retired.retireFrame <= frameCount;
+                      });
+    }
+
+    void Swapchain::resize(int width, int height)
+    {
+        info.width = width;
+        info.height = height;
+        needsRecreate = true;
     }
 
     std::vector<vk::UniqueCommandBuffer> Swapchain::allocateDrawComamndBuffers() const
@@ -121,34 +205,87 @@ namespace vkt
         allocInfo.setCommandPool(context->getGraphicsCommandPool());
         allocInfo.setLevel(vk::CommandBufferLevel::ePrimary);
         allocInfo.setCommandBufferCount(images.size());
-        return context->getDevice().allocateCommandBuffersUnique(allocInfo);
+        return context->getDevice().allocateCommandBuffersUnique(allocInfo, context->getDispatcher());
     }
 
-    uint32_t Swapchain::acquireNextImageIndex() const
+    std::optional<uint32_t> Swapchain::acquireNextImageIndex()
     {
+        VKT_TRACE_SCOPE("AcquireNextImage");
         vk::Semaphore semaphore = *imageAvailableSemaphores[currentFrame];
-        auto res = context->getDevice().acquireNextImageKHR(*swapchain, UINT64_MAX, semaphore);
-        if (res.result != vk::Result::eSuccess) {
-            throw std::runtime_error("failed to acquire next image!");
+        try {
+            auto res = context->getDevice().acquireNextImageKHR(*swapchain, UINT64_MAX, semaphore, {},
+                                                                context->getDispatcher());
+            if (res.result == vk::Result::eSuboptimalKHR) {
+                // The image is acquired and the semaphore will be signaled,
+                // so finish this frame and recreate on the next one
+                needsRecreate = true;
+            } else if (res.result != vk::Result::eSuccess) {
+                throw std::runtime_error("failed to acquire next image!");
+            }
+            return res.value;
+        } catch (const vk::OutOfDateKHRError&) {
+            return std::nullopt;
+        }
+    }
+
+    void Swapchain::waitForFrame(std::source_location location)
+    {
+        VKT_TRACE_SCOPE("WaitForFrameFence");
+        vk::Device device = context->getDevice();
+        vk::Fence fence = inFlightFences[currentFrame];
+        if (!enableFramePacing) {
+            stats::WaitScope waitScope{ stats::Counter::WaitForFences, location };
+            device.waitForFences(fence, true, UINT64_MAX, context->getDispatcher());
+            return;
+        }
+
+        // Sleep until shortly before the fence is expected to signal,
+        // then let the driver do the remaining short wait
+        const auto margin = std::chrono::microseconds(200);
+        if (frameInterval > margin && device.getFenceStatus(fence, context->getDispatcher()) == vk::Result::eNotReady) {
+            std::this_thread::sleep_until(lastFrameTime + frameInterval - margin);
+        }
+        {
+            stats::WaitScope waitScope{ stats::Counter::WaitForFences, location };
+            device.waitForFences(fence, true, UINT64_MAX, context->getDispatcher());
         }
-        return res.value;
+
+        Clock::time_point now = Clock::now();
+        if (lastFrameTime != Clock::time_point{}) {
+            frameInterval = (frameInterval * 7 + (now - lastFrameTime)) / 8;
+        }
+        lastFrameTime = now;
     }
 
-    FrameInfo Swapchain::beginFrame()
+    FrameInfo Swapchain::beginFrame(std::source_location location)
     {
-        context->getDevice().waitForFences(inFlightFences[currentFrame], true, UINT64_MAX);
+        waitForFrame(location);
+        releaseRetiredSwapchains();
 
-        uint32_t imageIndex = acquireNextImageIndex();
+        if (needsRecreate) {
+            recreate();
+        }
+        std::optional<uint32_t> acquiredIndex = acquireNextImageIndex();
+        while (!acquiredIndex) {
+            recreate();
+            acquiredIndex = acquireNextImageIndex();
+        }
+        uint32_t imageIndex = *acquiredIndex;
 
         if (imagesInFlight[imageIndex]) {
-            context->getDevice().waitForFences(imagesInFlight[imageIndex], true, UINT64_MAX);
+            VKT_TRACE_SCOPE("WaitForImageFence");
+            stats::WaitScope waitScope{ stats::Counter::WaitForFences, location };
+            context->getDevice().waitForFences(imagesInFlight[imageIndex], true, UINT64_MAX,
+                                               context->getDispatcher());
         }
         imagesInFlight[imageIndex] = inFlightFences[currentFrame];
-        context->getDevice().resetFences(inFlightFences[currentFrame]);
+        context->getDevice().resetFences(inFlightFences[currentFrame], context->getDispatcher());
 
         FrameInfo frameInfo;
         frameInfo.imageIndex = imageIndex;
         frameInfo.currentFrame = currentFrame;
+        frameInfo.image = images[imageIndex];
+        frameInfo.imageView = *imageViews[imageIndex];
         frameInfo.imageAvailableSemaphore = *imageAvailableSemaphores[currentFrame];
         frameInfo.renderFinishedSemaphore = *renderFinishedSemaphores[currentFrame];
         frameInfo.inFlightFence = inFlightFences[currentFrame];
@@ -157,13 +294,24 @@ namespace vkt
 
     void Swapchain::endFrame(uint32_t imageIndex)
     {
-        context->getPresentQueue().presentKHR(
-            vk::PresentInfoKHR{}
-            .setWaitSemaphores(*renderFinishedSemaphores[currentFrame])
-            .setSwapchains(*swapchain)
-            .setImageIndices(imageIndex));
+        VKT_TRACE_SCOPE("Present");
+        try {
+            vk::Result result = context->getPresentQueue().presentKHR(
+                vk::PresentInfoKHR{}
+                .setWaitSemaphores(*renderFinishedSemaphores[currentFrame])
+                .setSwapchains(*swapchain)
+                .setImageIndices(imageIndex),
+                context->getDispatcher());
+            if (result == vk::Result::eSuboptimalKHR) {
+                needsRecreate = true;
+            }
+        } catch (const vk::OutOfDateKHRError&) {
+            needsRecreate = true;
+        }
 
+        frameCount++;
         currentFrame = (currentFrame + 1) % maxFramesInFlight;
+        stats::endFrame();
     }
 
     void Swapchain::createViews()
@@ -177,7 +325,7 @@ namespace vkt
             createInfo.setViewType(vk::ImageViewType::e2D);
             createInfo.setFormat(imageFormat);
             createInfo.setSubresourceRange(subresourceRange);
-            imageViews[i] = context->getDevice().createImageViewUnique(createInfo);
+            imageViews[i] = context->getDevice().createImageViewUnique(createInfo, nullptr, context->getDispatcher());
         }
     }
 
@@ -190,9 +338,10 @@ namespace vkt
 
         vk::Device device = context->getDevice();
         for (size_t i = 0; i < maxFramesInFlight; i++) {
-            imageAvailableSemaphores[i] = device.createSemaphoreUnique({});
-            renderFinishedSemaphores[i] = device.createSemaphoreUnique({});
-            inFlightFences[i] = device.createFence({ vk::FenceCreateFlagBits::eSignaled });
+            imageAvailableSemaphores[i] = device.createSemaphoreUnique({}, nullptr, context->getDispatcher());
+            renderFinishedSemaphores[i] = device.createSemaphoreUnique({}, nullptr, context->getDispatcher());
+            inFlightFences[i] = device.createFence({ vk::FenceCreateFlagBits::eSignaled }, nullptr,
+                                                   context->getDispatcher());
         }
     }
 }
@@ -0,0 +1,441 @@
+#include "vktiny/TextureLoader.hpp"
+#include "vktiny/ThreadPool.hpp"
+#include "vktiny/Trace.hpp"
+#include "vktiny/DriverStats.hpp"
+#include "vktiny/Log.hpp"
+#include <atomic>
+#include <array>
+#include <climits>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <span>
+
+#if __has_include(<stb_image.h>)
+#define STB_IMAGE_STATIC
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+#define VKT_HAS_STB_IMAGE 1
+#endif
+
+namespace vkt
+{
+    namespace
+    {
+        struct EncodedItem
+        {
+            size_t index;
+            const uint8_t* data;
+            size_t size;
+            std::vector<uint8_t> owned;
+        };
+
+        struct DecodedItem
+        {
+            size_t index;
+            DecodedImage image;
+        };
+
+        // Fault the pages in on the reader thread rather than in the decoders
+        void touchPages(const uint8_t* data, size_t size)
+        {
+            static volatile uint8_t sink;
+            uint8_t sum = 0;
+            for (size_t offset = 0; offset < size; offset += 4096) {
+                sum ^= data[offset];
+            }
+            sink = sum;
+        }
+
+        std::vector<uint8_t> readFile(const std::filesystem::path& path)
+        {
+            std::ifstream file{ path, std::ios::binary | std::ios::ate };
+            if (!file) {
+                return {};
+            }
+            std::vector<uint8_t> bytes(static_cast<size_t>(file.tellg()));
+            file.seekg(0);
+            file.read(reinterpret_cast<char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+            return bytes;
+        }
+
+        vk::DeviceSize alignUp(vk::DeviceSize value, vk::DeviceSize alignment)
+        {
+            return (value + alignment - 1) / alignment * alignment;
+        }
+
+        float toLinear(uint8_t value)
+        {
+            float c = value / 255.0f;
+            return c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+        }
+
+        uint8_t toSrgb(float linear)
+        {
+            float c = linear <= 0.0031308f ? linear * 12.92f : 1.055f * std::pow(linear, 1.0f / 2.4f) - 0.055f;
+            return static_cast<uint8_t>(std::clamp(c, 0.0f, 1.0f) * 255.0f + 0.5f);
+        }
+
+        // 2x2 box filter of RGBA8 texels, clamping at odd edges. sRGB color is averaged in linear space.
+        std::vector<uint8_t> downsample(std::span<const uint8_t> texels, uint32_t width, uint32_t height, bool srgb)
+        {
+            static const std::array<float, 256> linear = [] {
+                std::array<float, 256> table;
+                for (int i = 0; i < 256; i++) {
+                    table[i] = toLinear(static_cast<uint8_t>(i));
+                }
+                return table;
+            }();
+
+            uint32_t mipWidth = std::max(width / 2, 1u);
+            uint32_t mipHeight = std::max(height / 2, 1u);
+            std::vector<uint8_t> mip(size_t{ mipWidth } * mipHeight * 4);
+            for (uint32_t y = 0; y < mipHeight; y++) {
+                uint32_t y0 = std::min(y * 2, height - 1);
+                uint32_t y1 = std::min(y * 2 + 1, height - 1);
+                for (uint32_t x = 0; x < mipWidth; x++) {
+                    uint32_t x0 = std::min(x * 2, width - 1);
+                    uint32_t x1 = std::min(x * 2 + 1, width - 1);
+                    const uint8_t* p00 = &texels[(size_t{ y0 } * width + x0) * 4];
+                    const uint8_t* p01 = &texels[(size_t{ y0 } * width + x1) * 4];
+                    const uint8_t* p10 = &texels[(size_t{ y1 } * width + x0) * 4];
+                    const uint8_t* p11 = &texels[(size_t{ y1 } * width + x1) * 4];
+                    uint8_t* dst = &mip[(size_t{ y } * mipWidth + x) * 4];
+                    for (uint32_t c = 0; c < 4; c++) {
+                        if (srgb && c < 3) {
+                            dst[c] = toSrgb((linear[p00[c]] + linear[p01[c]] + linear[p10[c]] + linear[p11[c]]) * 0.25f);
+                        } else {
+                            uint32_t sum = p00[c] + p01[c] + p10[c] + p11[c];
+                            dst[c] = static_cast<uint8_t>((sum + 2) / 4);
+                        }
+                    }
+                }
+            }
+            return mip;
+        }
+    }
+
+    ImageDecoder getDefaultImageDecoder()
+    {
+#ifdef VKT_HAS_STB_IMAGE
+        return [](const uint8_t* data, size_t size, DecodedImage& image) {
+            if (size > INT_MAX) {
+                return false;
+            }
+            int width, height, channels;
+            stbi_uc* pixels = stbi_load_from_memory(data, static_cast<int>(size),
+                                                    &width, &height, &channels, STBI_rgb_alpha);
+            if (!pixels) {
+                return false;
+            }
+            image.width = static_cast<uint32_t>(width);
+            image.height = static_cast<uint32_t>(height);
+            image.pixels.assign(pixels, pixels + size_t{ image.width } * image.height * 4);
+            stbi_image_free(pixels);
+            return true;
+        };
+#else
+        return {};
+#endif
+    }
+
+    void generateMipLevels(DecodedImage& image)
+    {
+        bool srgb = image.format == vk::Format::eR8G8B8A8Srgb;
+        if (!srgb && image.format != vk::Format::eR8G8B8A8Unorm) {
+            throw std::runtime_error("mip levels are only generated for RGBA8, not " + vk::to_string(image.format));
+        }
+        if (image.mipLevels != 1) {
+            return;
+        }
+        image.mipLevels = getMipLevelCount({ image.width, image.height });
+        image.pixels.reserve(getImageSize({ image.width, image.height }, image.format, image.mipLevels));
+
+        uint32_t width = image.width;
+        uint32_t height = image.height;
+        size_t offset = 0;
+        for (uint32_t level = 1; level < image.mipLevels; level++) {
+            std::span<const uint8_t> previous{ image.pixels.data() + offset, size_t{ width } * height * 4 };
+            std::vector<uint8_t> next = downsample(previous, width, height, srgb);
+            offset += previous.size();
+            width = std::max(width / 2, 1u);
+            height = std::max(height / 2, 1u);
+            image.pixels.insert(image.pixels.end(), next.begin(), next.end());
+        }
+    }
+
+    TextureLoader::TextureLoader(const Context& context, const TextureLoaderCreateInfo& info)
+        : context(&context)
+        , info(info)
+    {
+        stagings.push_back(createStaging(info.stagingSize));
+        stagings.push_back(createStaging(info.stagingSize));
+    }
+
+    TextureLoader::~TextureLoader()
+    {
+        for (Staging& staging : stagings) {
+            wait(staging);
+        }
+    }
+
+    bool TextureLoader::decode(size_t index, const uint8_t* data, size_t size, vk::Format format,
+                               DecodedImage& image) const
+    {
+        if (Ktx2File::isKtx2(data, size)) {
+            return decodeKtx2(index, data, size, format, image);
+        }
+        if (size == 0) {
+            return false;
+        }
+        if (!info.decoder) {
+            throw std::runtime_error("texture " + std::to_string(index) + " is not KTX2 and there is no image decoder: "
+                                     "build with stb_image or set TextureLoaderCreateInfo::decoder");
+        }
+        if (!info.decoder(data, size, image)) {
+            return false;
+        }
+        if (image.format == vk::Format::eUndefined) {
+            image.format = format;
+        }
+        try {
+            bool valid = image.width > 0 && image.height > 0 && image.mipLevels > 0 &&
+                         image.mipLevels <= getMipLevelCount({ image.width, image.height }) &&
+                         image.pixels.size() == getImageSize({ image.width, image.height }, image.format, image.mipLevels);
+            if (valid && image.mipLevels == 1) {
+                generateMipLevels(image);
+            }
+            return valid;
+        } catch (const std::runtime_error& error) {
+            log::warn("texture {}: {}", index, error.what());
+            return false;
+        }
+    }
+
+    bool TextureLoader::decodeKtx2(size_t index, const uint8_t* data, size_t size, vk::Format format,
+                                   DecodedImage& image) const
+    {
+        try {
+            Ktx2File file{ data, size };
+            image.width = file.getExtent().width;
+            image.height = file.getExtent().height;
+            image.mipLevels = file.getMipLevels();
+            if (file.isBasis()) {
+                if (!info.transcoder) {
+                    log::warn("texture {}: no Basis Universal transcoder", index);
+                    return false;
+                }
+                image.format = selectTranscodeFormat(*context, file, format == vk::Format::eR8G8B8A8Srgb);
+                if (!info.transcoder(file, image.format, image.pixels)) {
+                    return false;
+                }
+            } else {
+                image.format = file.getFormat();
+                if (isBlockCompressed(image.format) && !context->getEnabledFeatures().textureCompressionBC) {
+                    log::warn("texture {}: {} needs the textureCompressionBC feature", index,
+                              vk::to_string(image.format));
+                    return false;
+                }
+                file.copyLevels(image.pixels);
+            }
+            return image.pixels.size() == getImageSize(file.getExtent(), image.format, image.mipLevels);
+        } catch (const std::runtime_error& error) {
+            log::warn("texture {}: {}", index, error.what());
+            return false;
+        }
+    }
+
+    TextureLoader::Staging TextureLoader::createStaging(vk::DeviceSize size) const
+    {
+        using vkMP = vk::MemoryPropertyFlagBits;
+        Staging staging{
+            Buffer{ *context, size, vk::BufferUsageFlagBits::eTransferSrc, vkMP::eHostVisible | vkMP::eHostCoherent },
+            CommandBuffer{ context->getDevice(), context->getGraphicsCommandPool(), context->getGraphicsQueue(),
+                           context->getDispatcher() },
+            context->getDevice().createFenceUnique({}, nullptr, context->getDispatcher()),
+        };
+        staging.buffer.map();
+        return staging;
+    }
+
+    void TextureLoader::flush(Staging& staging)
+    {
+        if (!staging.recording) {
+            return;
+        }
+        staging.commandBuffer.end();
+        staging.commandBuffer.submit(*staging.fence);
+        staging.recording = false;
+        staging.inFlight = true;
+    }
+
+    void TextureLoader::wait(Staging& staging)
+    {
+        if (staging.inFlight) {
+            vk::Device device = context->getDevice();
+            {
+                stats::WaitScope waitScope{ stats::Counter::WaitForFences };
+                device.waitForFences(*staging.fence, true, UINT64_MAX, context->getDispatcher());
+            }
+            device.resetFences(*staging.fence, context->getDispatcher());
+            staging.inFlight = false;
+        }
+        staging.used = 0;
+    }
+
+    std::vector<Image> TextureLoader::load(const std::vector<TextureSource>& sources)
+    {
+        if (sources.empty()) {
+            return {};
+        }
+        for (const TextureSource& source : sources) {
+            if (getFormatSize(source.format) != 4) {
+                throw std::runtime_error("textures are decoded to RGBA8, unsupported format: " +
+                                         vk::to_string(source.format));
+            }
+        }
+        VKT_TRACE_SCOPE("TextureLoader::load");
+
+        // The queues must outlive the pool, whose destructor joins the stages
+        BoundedQueue<EncodedItem> encodedQueue{ info.queueCapacity };
+        BoundedQueue<DecodedItem> decodedQueue{ info.queueCapacity };
+        std::atomic<size_t> decodedBytes{ 0 };
+        std::atomic<size_t> peakBytes{ 0 };
+
+        uint32_t decoderCount = info.threadCount;
+        if (decoderCount == 0) {
+            decoderCount = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+        }
+        std::atomic<uint32_t> activeDecoders{ decoderCount };
+        ThreadPool pool{ decoderCount + 1 };
+        std::vector<std::future<void>> stages;
+
+        // Stage 1: read
+        stages.push_back(pool.submit([&]() {
+            VKT_TRACE_SCOPE("TextureLoader::read");
+            try {
+                for (size_t i = 0; i < sources.size(); i++) {
+                    EncodedItem item{ i, sources[i].data, sources[i].size };
+                    if (item.data) {
+                        touchPages(item.data, item.size);
+                    } else {
+                        item.owned = readFile(sources[i].path);
+                        item.data = item.owned.data();
+                        item.size = item.owned.size();
+                    }
+                    if (!encodedQueue.push(std::move(item))) {
+                        return;
+                    }
+                }
+            } catch (...) {
+                encodedQueue.cancel();
+                decodedQueue.cancel();
+                throw;
+            }
+            encodedQueue.close();
+        }));
+
+        // Stage 2: decode
+        for (uint32_t i = 0; i < decoderCount; i++) {
+            stages.push_back(pool.submit([&]() {
+                try {
+                    while (std::optional<EncodedItem> item = encodedQueue.pop()) {
+                        VKT_TRACE_SCOPE("TextureLoader::decode");
+                        DecodedItem decoded{ item->index };
+                        DecodedImage& image = decoded.image;
+                        if (!decode(item->index, item->data, item->size, sources[item->index].format, image)) {
+                            log::warn("failed to decode texture {}", item->index);
+                            image = { 1, 1, { 255, 255, 255, 255 }, sources[item->index].format };
+                        }
+                        item.reset();
+
+                        size_t bytes = decodedBytes += image.pixels.size();
+                        size_t peak = peakBytes.load();
+                        while (bytes > peak && !peakBytes.compare_exchange_weak(peak, bytes)) {
+                        }
+                        if (!decodedQueue.push(std::move(decoded))) {
+                            return;
+                        }
+                    }
+                } catch (...) {
+                    encodedQueue.cancel();
+                    decodedQueue.cancel();
+                    throw;
+                }
+                if (--activeDecoders == 0) {
+                    decodedQueue.close();
+                }
+            }));
+        }
+
+        // Stage 3: upload on the calling thread, which owns the command buffers
+        std::vector<std::optional<Image>> images(sources.size());
+        try {
+            while (std::optional<DecodedItem> item = decodedQueue.pop()) {
+                VKT_TRACE_SCOPE("TextureLoader::upload");
+                const DecodedImage& image = item->image;
+                vk::DeviceSize size = image.pixels.size();
+
+                // Switch buffers when full, so the GPU copies from one while the other is filled
+                Staging* staging = &stagings[current];
+                if (staging->used + size > staging->buffer.getSize()) {
+                    flush(*staging);
+                    current = (current + 1) % stagings.size();
+                    staging = &stagings[current];
+                    wait(*staging);
+                    if (size > staging->buffer.getSize()) {
+                        *staging = createStaging(size);
+                    }
+                }
+                if (!staging->recording) {
+                    staging->commandBuffer.begin({ vk::CommandBufferUsageFlagBits::eOneTimeSubmit });
+                    staging->recording = true;
+                }
+
+                auto* mapped = static_cast<uint8_t*>(staging->buffer.map());
+                std::memcpy(mapped + staging->used, image.pixels.data(), image.pixels.size());
+                decodedBytes -= image.pixels.size();
+
+                const TextureSource& source = sources[item->index];
+                Image& texture = images[item->index].emplace(
+                    *context, vk::Extent2D{ image.width, image.height }, image.format,
+                    vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eTransferDst, image.mipLevels);
+                texture.createImageView();
+                vk::SamplerCreateInfo samplerInfo = source.samplerInfo;
+                if (image.mipLevels > 1) {
+                    samplerInfo.setMaxLod(static_cast<float>(image.mipLevels));
+                }
+                texture.createSampler(samplerInfo);
+                texture.upload(staging->commandBuffer, staging->buffer.get(), staging->used);
+                staging->used = alignUp(staging->used + size, 16);
+            }
+        } catch (...) {
+            encodedQueue.cancel();
+            decodedQueue.cancel();
+            for (Staging& staging : stagings) {
+                if (staging.recording) {
+                    staging.commandBuffer.end();
+                    staging.recording = false;
+                }
+                wait(staging);
+            }
+            throw;
+        }
+
+        flush(stagings[current]);
+        for (Staging& staging : stagings) {
+            wait(staging);
+        }
+        for (std::future<void>& stage : stages) {
+            stage.get();
+        }
+        peakDecodedBytes = peakBytes.load();
+
+        std::vector<Image> textures;
+        textures.reserve(images.size());
+        for (std::optional<Image>& image : images) {
+            textures.push_back(std::move(*image));
+        }
+        return textures;
+    }
+}
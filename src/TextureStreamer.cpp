@@ -0,0 +1,350 @@
+#include "vktiny/TextureStreamer.hpp"
+#include "vktiny/ResidencyPlanner.hpp"
+#include "vktiny/SceneCache.hpp"
+#include "vktiny/CommandBuffer.hpp"
+#include "vktiny/Trace.hpp"
+#include "vktiny/DriverStats.hpp"
+#include "vktiny/Log.hpp"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+namespace vkt
+{
+    namespace
+    {
+        vk::Extent2D getMipExtent(vk::Extent2D extent, uint32_t level)
+        {
+            return { std::max(extent.width >> level, 1u), std::max(extent.height >> level, 1u) };
+        }
+    }
+
+    std::vector<StreamedTextureSource> getStreamedTextureSources(const SceneCache& cache)
+    {
+        std::vector<StreamedTextureSource> sources;
+        for (const SceneCacheTexture& texture : cache.getTextures()) {
+            StreamedTextureSource& source = sources.emplace_back();
+            source.data = cache.getTextureData(texture).data();
+            source.extent = { texture.width, texture.height };
+            source.format = texture.format;
+            source.mipLevels = texture.mipLevels;
+            source.samplerInfo = getSamplerInfo(texture.sampler);
+        }
+        return sources;
+    }
+
+    // Plans on its own thread and copies the texels of planned loads into staging buffers
+    struct TextureStreamer::Worker
+    {
+        struct Load
+        {
+            uint32_t texture;
+            uint32_t baseMip;
+            Buffer staging;
+        };
+
+        Worker(const Context& context, std::span<const StreamedTextureSource> sources,
+               const TextureStreamerCreateInfo& info)
+            : context(&context)
+            , sources(sources)
+            , planner(sources, info)
+            , residentSize(planner.getResidentSize())
+        {
+            thread = std::thread([this]() { run(); });
+        }
+
+        ~Worker()
+        {
+            {
+                std::lock_guard lock{ mutex };
+                stopping = true;
+            }
+            condition.notify_all();
+            thread.join();
+        }
+
+        void push(std::vector<uint32_t> requested)
+        {
+            {
+                std::lock_guard lock{ mutex };
+                requests.push_back(std::move(requested));
+            }
+            condition.notify_all();
+        }
+
+        std::deque<Load> takeLoads()
+        {
+            std::lock_guard lock{ mutex };
+            return std::exchange(loads, {});
+        }
+
+        void run()
+        {
+            while (true) {
+                std::vector<uint32_t> requested;
+                {
+                    std::unique_lock lock{ mutex };
+                    condition.wait(lock, [this] { return stopping || !requests.empty(); });
+                    if (stopping) {
+                        return;
+                    }
+
+                    // Feedback of frames that queued up while planning is merged
+                    requested = std::move(requests.front());
+                    requests.pop_front();
+                    for (const std::vector<uint32_t>& frame : requests) {
+                        for (size_t i = 0; i < requested.size(); i++) {
+                            requested[i] = std::min(requested[i], frame[i]);
+                        }
+                    }
+                    requests.clear();
+                }
+
+                VKT_TRACE_SCOPE("TextureStreamer::plan");
+                try {
+                    std::vector<ResidencyJob> jobs = planner.plan(requested);
+                    residentSize = planner.getResidentSize();
+                    for (const ResidencyJob& job : jobs) {
+                        const StreamedTextureSource& source = sources[job.texture];
+                        vk::DeviceSize offset = getImageSize(source.extent, source.format, job.baseMip);
+                        vk::DeviceSize size = getMipChainSize(source, job.baseMip);
+
+                        using vkMP = vk::MemoryPropertyFlagBits;
+                        Load load{ job.texture, job.baseMip,
+                                   Buffer{ *context, size, vk::BufferUsageFlagBits::eTransferSrc,
+                                           vkMP::eHostVisible | vkMP::eHostCoherent } };
+                        std::memcpy(load.staging.map(), source.data + offset, static_cast<size_t>(size));
+
+                        std::lock_guard lock{ mutex };
+                        loads.push_back(std::move(load));
+                    }
+                } catch (const std::exception& e) {
+                    log::warn("texture streaming stopped: {}", e.what());
+                    return;
+                }
+            }
+        }
+
+        const Context* context;
+        std::span<const StreamedTextureSource> sources;
+        ResidencyPlanner planner;
+        std::atomic<vk::DeviceSize> residentSize;
+
+        std::mutex mutex;
+        std::condition_variable condition;
+        std::deque<std::vector<uint32_t>> requests;
+        std::deque<Load> loads;
+        bool stopping = false;
+        std::thread thread;
+    };
+
+    namespace
+    {
+        std::vector<vk::DescriptorSetLayoutBinding> getBindings(uint32_t textureCount, vk::ShaderStageFlags stages)
+        {
+            using vkDT = vk::DescriptorType;
+            return {
+                { 0, vkDT::eCombinedImageSampler, textureCount, stages },
+                { 1, vkDT::eStorageBuffer, 1, stages },
+                { 2, vkDT::eStorageBuffer, 1, stages },
+            };
+        }
+    }
+
+    TextureStreamer::TextureStreamer(const Context& context, std::vector<StreamedTextureSource> sources,
+                                     const TextureStreamerCreateInfo& info)
+        : context(&context)
+        , info(info)
+        , sources(std::move(sources))
+        , textures(this->sources.size())
+        , descSetLayout(context, getBindings(getTextureCount(), info.stages))
+        , descPool(context, info.frameCount,
+                   { { vk::DescriptorType::eCombinedImageSampler, std::max(getTextureCount(), 1u) * info.frameCount },
+                     { vk::DescriptorType::eStorageBuffer, 2 * info.frameCount } })
+    {
+        VKT_TRACE_SCOPE("TextureStreamer");
+        worker = std::make_unique<Worker>(context, this->sources, info);
+
+        using vkBU = vk::BufferUsageFlagBits;
+        using vkMP = vk::MemoryPropertyFlagBits;
+        vk::DeviceSize feedbackSize = sizeof(uint32_t) * vk::DeviceSize{ std::max(getTextureCount(), 1u) };
+        for (uint32_t i = 0; i < info.frameCount; i++) {
+            Frame& frame = frames.emplace_back(Frame{
+                DescriptorSet{ context, descPool, descSetLayout },
+                Buffer{ context, feedbackSize, vkBU::eStorageBuffer | vkBU::eTransferSrc | vkBU::eTransferDst,
+                        vkMP::eDeviceLocal },
+                Buffer{ context, feedbackSize, vkBU::eTransferDst, context.getHostReadbackMemoryProperties() },
+                Buffer{ context, feedbackSize, vkBU::eStorageBuffer, vkMP::eHostVisible | vkMP::eHostCoherent },
+            });
+            frame.readbackBuffer.map();
+            frame.baseMipBuffer.map();
+            frame.descSet.update(frame.feedbackBuffer, { 1, vk::DescriptorType::eStorageBuffer, 1, info.stages });
+            frame.descSet.update(frame.baseMipBuffer, { 2, vk::DescriptorType::eStorageBuffer, 1, info.stages });
+            for (uint32_t texture = 0; texture < getTextureCount(); texture++) {
+                frame.pendingWrites.push_back(texture);
+            }
+        }
+
+        // The tails are small, so they go through one staging buffer
+        std::vector<vk::DeviceSize> offsets;
+        vk::DeviceSize stagingSize = 0;
+        for (uint32_t texture = 0; texture < getTextureCount(); texture++) {
+            offsets.push_back(stagingSize);
+            stagingSize += (getMipChainSize(this->sources[texture], worker->planner.getTailMip(texture)) + 15) / 16 * 16;
+        }
+        std::optional<Buffer> stagingBuffer;
+        if (stagingSize > 0) {
+            stagingBuffer.emplace(context, stagingSize, vkBU::eTransferSrc, vkMP::eHostVisible | vkMP::eHostCoherent);
+            auto* mapped = static_cast<uint8_t*>(stagingBuffer->map());
+            for (uint32_t texture = 0; texture < getTextureCount(); texture++) {
+                const StreamedTextureSource& source = this->sources[texture];
+                uint32_t tailMip = worker->planner.getTailMip(texture);
+                vk::DeviceSize offset = getImageSize(source.extent, source.format, tailMip);
+                std::memcpy(mapped + offsets[texture], source.data + offset,
+                            static_cast<size_t>(getMipChainSize(source, tailMip)));
+            }
+        }
+        context.OneTimeSubmitGraphics([&](const CommandBuffer& cmdBuf) {
+            for (uint32_t texture = 0; texture < getTextureCount(); texture++) {
+                uint32_t tailMip = worker->planner.getTailMip(texture);
+                textures[texture].image = createImage(texture, tailMip);
+                textures[texture].image->upload(cmdBuf, stagingBuffer->get(), offsets[texture]);
+                textures[texture].baseMip = tailMip;
+            }
+            for (Frame& frame : frames) {
+                cmdBuf.fillBuffer(frame.feedbackBuffer.get(), 0, VK_WHOLE_SIZE, ResidencyPlanner::notRequested);
+            }
+        });
+        log::info("streaming {} textures, {} KiB resident up front", getTextureCount(), getResidentSize() / 1024);
+    }
+
+    TextureStreamer::TextureStreamer(TextureStreamer&&) = default;
+
+    // The worker is stopped before the images and buffers it refers to are destroyed
+    TextureStreamer::~TextureStreamer()
+    {
+        worker.reset();
+    }
+
+    Image TextureStreamer::createImage(uint32_t texture, uint32_t baseMip) const
+    {
+        const StreamedTextureSource& source = sources[texture];
+        uint32_t mipLevels = source.mipLevels - baseMip;
+        Image image{ *context, getMipExtent(source.extent, baseMip), source.format,
+                     vk::ImageUsageFlagBits::eSampled | vk::ImageUsageFlagBits::eTransferDst, mipLevels };
+        image.createImageView();
+        vk::SamplerCreateInfo samplerInfo = source.samplerInfo;
+        samplerInfo.setMaxLod(static_cast<float>(mipLevels));
+        image.createSampler(samplerInfo);
+        return image;
+    }
+
+    void TextureStreamer::update(const CommandBuffer& cmdBuf, uint32_t frameIndex)
+    {
+        VKT_TRACE_SCOPE("TextureStreamer::update");
+        frameCounter++;
+        while (!retired.empty() && retired.front().frame <= frameCounter) {
+            retired.pop_front();
+        }
+
+        // The frame's previous feedback has arrived since its command buffer finished
+        Frame& frame = frames[frameIndex];
+        if (frame.feedbackPending) {
+            const auto* requested = static_cast<const uint32_t*>(frame.readbackBuffer.map());
+            worker->push({ requested, requested + getTextureCount() });
+            frame.feedbackPending = false;
+        }
+
+        for (Worker::Load& load : worker->takeLoads()) {
+            ResidentTexture& texture = textures[load.texture];
+            Image image = createImage(load.texture, load.baseMip);
+            image.upload(cmdBuf, load.staging.get());
+            retired.push_back({ frameCounter + frames.size(), std::move(texture.image), std::move(load.staging) });
+            texture.image = std::move(image);
+            texture.baseMip = load.baseMip;
+            for (Frame& other : frames) {
+                other.pendingWrites.push_back(load.texture);
+            }
+        }
+        writeDescriptors(frame);
+    }
+
+    void TextureStreamer::writeDescriptors(Frame& frame)
+    {
+        if (frame.pendingWrites.empty()) {
+            return;
+        }
+        std::sort(frame.pendingWrites.begin(), frame.pendingWrites.end());
+        frame.pendingWrites.erase(std::unique(frame.pendingWrites.begin(), frame.pendingWrites.end()),
+                                  frame.pendingWrites.end());
+
+        // The image infos must not move while the writes refer to them
+        std::vector<vk::DescriptorImageInfo> imageInfos;
+        imageInfos.reserve(frame.pendingWrites.size());
+        std::vector<vk::WriteDescriptorSet> writes;
+        auto* baseMips = static_cast<uint32_t*>(frame.baseMipBuffer.map());
+        for (uint32_t index : frame.pendingWrites) {
+            const ResidentTexture& texture = textures[index];
+            imageInfos.push_back({ texture.image->getSampler(), texture.image->getView(), texture.image->getLayout() });
+            vk::WriteDescriptorSet& write = writes.emplace_back();
+            write.setDstSet(frame.descSet.get());
+            write.setDstBinding(0);
+            write.setDstArrayElement(index);
+            write.setDescriptorType(vk::DescriptorType::eCombinedImageSampler);
+            write.setImageInfo(imageInfos.back());
+            baseMips[index] = texture.baseMip;
+        }
+        context->getDevice().updateDescriptorSets(writes, nullptr, context->getDispatcher());
+        stats::increment(stats::Counter::UpdateDescriptorSets);
+        frame.pendingWrites.clear();
+    }
+
+    void TextureStreamer::recordFeedback(const CommandBuffer& cmdBuf, uint32_t frameIndex)
+    {
+        using vkPS = vk::PipelineStageFlagBits;
+        using vkAF = vk::AccessFlagBits;
+        Frame& frame = frames[frameIndex];
+        vk::DeviceSize size = frame.feedbackBuffer.getSize();
+        cmdBuf.memoryBarrier(vkPS::eAllCommands, vkAF::eShaderWrite, vkPS::eTransfer, vkAF::eTransferRead);
+        cmdBuf.copyBuffer(frame.feedbackBuffer.get(), frame.readbackBuffer.get(), { 0, 0, size });
+        cmdBuf.memoryBarrier(vkPS::eTransfer, vkAF::eTransferWrite, vkPS::eHost, vkAF::eHostRead);
+
+        // Reset for the frame's next use once the copy has read it
+        cmdBuf.memoryBarrier(vkPS::eTransfer, vkAF::eTransferRead, vkPS::eTransfer, vkAF::eTransferWrite);
+        cmdBuf.fillBuffer(frame.feedbackBuffer.get(), 0, size, ResidencyPlanner::notRequested);
+        cmdBuf.memoryBarrier(vkPS::eTransfer, vkAF::eTransferWrite, vkPS::eAllCommands,
+                             vkAF::eShaderRead | vkAF::eShaderWrite);
+        frame.feedbackPending = true;
+    }
+
+    vk::DeviceSize TextureStreamer::getResidentSize() const
+    {
+        return worker->residentSize;
+    }
+
+    std::string TextureStreamer::getGlsl(uint32_t set) const
+    {
+        std::string prefix = "layout(set = " + std::to_string(set) + ", binding = ";
+        std::string glsl;
+        glsl += prefix + "0) uniform sampler2D vktTextures[" + std::to_string(std::max(getTextureCount(), 1u)) + "];\n";
+        glsl += prefix + "1) buffer VktTextureFeedback { uint vktRequestedMips[]; };\n";
+        glsl += prefix + "2) readonly buffer VktTextureBaseMips { uint vktBaseMips[]; };\n";
+        glsl += "\n";
+        glsl += "// The LOD is relative to the resident base level and negative when magnifying,\n";
+        glsl += "// which requests the finer levels that aren't resident yet\n";
+        glsl += "vec4 vktSampleStreamed(uint index, vec2 uv)\n";
+        glsl += "{\n";
+        glsl += "    vec2 lod = textureQueryLod(vktTextures[index], uv);\n";
+        glsl += "    uint mip = uint(max(int(vktBaseMips[index]) + int(floor(lod.y)), 0));\n";
+        glsl += "    if (vktRequestedMips[index] > mip) {\n";
+        glsl += "        atomicMin(vktRequestedMips[index], mip);\n";
+        glsl += "    }\n";
+        glsl += "    return texture(vktTextures[index], uv);\n";
+        glsl += "}\n";
+        return glsl;
+    }
+}
@@ -0,0 +1,103 @@
+#include "vktiny/ThreadPool.hpp"
+#include <algorithm>
+#include <atomic>
+
+namespace vkt
+{
+    ThreadPool::ThreadPool(uint32_t threadCount)
+    {
+        if (threadCount == 0) {
+            threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+        }
+        for (uint32_t i = 0; i < threadCount; i++) {
+            threads.emplace_back([this] { run(); });
+        }
+    }
+
+    ThreadPool::~ThreadPool()
+    {
+        {
+            std::lock_guard lock{ mutex };
+            stopping = true;
+        }
+        condition.notify_all();
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+    }
+
+    void ThreadPool::push(std::function<void()> task)
+    {
+        {
+            std::lock_guard lock{ mutex };
+            tasks.push_back(std::move(task));
+        }
+        condition.notify_one();
+    }
+
+    void ThreadPool::run()
+    {
+        while (true) {
+            std::function<void()> task;
+            {
+                std::unique_lock lock{ mutex };
+                condition.wait(lock, [this] { return stopping || !tasks.empty(); });
+                if (tasks.empty()) {
+                    return;
+                }
+                task = std::move(tasks.front());
+                tasks.pop_front();
+            }
+            task();
+        }
+    }
+
+    void ThreadPool::parallelFor(size_t count, const std::function<void(size_t)>& func)
+    {
+        if (count == 0) {
+            return;
+        }
+
+        struct State
+        {
+            std::atomic<size_t> next{ 0 };
+            std::atomic<size_t> done{ 0 };
+            std::mutex mutex;
+            std::exception_ptr exception;
+        };
+        auto state = std::make_shared<State>();
+
+        // Workers and the caller pull indices until none are left
+        auto work = [state, count, &func]() {
+            size_t index;
+            while ((index = state->next.fetch_add(1, std::memory_order_relaxed)) < count) {
+                try {
+                    func(index);
+                } catch (...) {
+                    std::lock_guard lock{ state->mutex };
+                    if (!state->exception) {
+                        state->exception = std::current_exception();
+                    }
+                }
+                if (state->done.fetch_add(1, std::memory_order_acq_rel) + 1 == count) {
+                    state->done.notify_all();
+                }
+            }
+        };
+
+        size_t helperCount = std::min(count - 1, threads.size());
+        for (size_t i = 0; i < helperCount; i++) {
+            push(work);
+        }
+        work();
+
+        size_t done = state->done.load(std::memory_order_acquire);
+        while (done < count) {
+            state->done.wait(done, std::memory_order_acquire);
+            done = state->done.load(std::memory_order_acquire);
+        }
+        if (state->exception) {
+            std::rethrow_exception(state->exception);
+        }
+    }
+}
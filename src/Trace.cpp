@@ -0,0 +1,178 @@
+#include "vktiny/Trace.hpp"
+#include <algorithm>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <unordered_set>
+#include <vector>
+
+namespace vkt::trace
+{
+    namespace
+    {
+        struct Event
+        {
+            const char* name;
+            int64_t begin;
+            int64_t end;
+            Track track;
+        };
+
+        // Fields are atomic so that export can read slots the owning thread is overwriting.
+        // Relaxed accesses compile to plain loads and stores.
+        struct EventSlot
+        {
+            std::atomic<const char*> name;
+            std::atomic<int64_t> begin;
+            std::atomic<int64_t> end;
+            std::atomic<Track> track;
+        };
+
+        constexpr uint64_t ringCapacity = 1 << 16;
+
+        // Seqlock over the ring: claimIndex is advanced before a slot is written and
+        // writeIndex after, so a reader detects slots that were overwritten while it copied them
+        struct ThreadRing
+        {
+            uint32_t threadId;
+            std::unique_ptr<EventSlot[]> events{ new EventSlot[ringCapacity] };
+            std::atomic<uint64_t> claimIndex{ 0 };
+            std::atomic<uint64_t> writeIndex{ 0 };
+            std::atomic<uint64_t> clearIndex{ 0 };
+        };
+
+        struct Registry
+        {
+            std::mutex mutex;
+            std::vector<std::shared_ptr<ThreadRing>> rings;
+            std::unordered_set<std::string> names;
+            uint32_t nextThreadId = 1;
+        };
+
+        Registry& getRegistry()
+        {
+            static Registry registry;
+            return registry;
+        }
+
+        // The registry keeps rings of exited threads alive for export
+        ThreadRing& getThreadRing()
+        {
+            thread_local std::shared_ptr<ThreadRing> ring = [] {
+                auto newRing = std::make_shared<ThreadRing>();
+                Registry& registry = getRegistry();
+                std::lock_guard lock{ registry.mutex };
+                newRing->threadId = registry.nextThreadId++;
+                registry.rings.push_back(newRing);
+                return newRing;
+            }();
+            return *ring;
+        }
+
+        void writeEscaped(std::ostream& out, const char* text)
+        {
+            for (const char* c = text; *c; ++c) {
+                if (*c == '"' || *c == '\\') {
+                    out << '\\';
+                }
+                out << *c;
+            }
+        }
+    }
+
+    void setEnabled(bool enabled)
+    {
+        enabledFlag.store(enabled, std::memory_order_relaxed);
+    }
+
+    void record(const char* name, int64_t beginNs, int64_t endNs, Track track)
+    {
+        if (!isEnabled()) {
+            return;
+        }
+        ThreadRing& ring = getThreadRing();
+        uint64_t index = ring.writeIndex.load(std::memory_order_relaxed);
+        ring.claimIndex.store(index + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        EventSlot& slot = ring.events[index & (ringCapacity - 1)];
+        slot.name.store(name, std::memory_order_relaxed);
+        slot.begin.store(beginNs, std::memory_order_relaxed);
+        slot.end.store(endNs, std::memory_order_relaxed);
+        slot.track.store(track, std::memory_order_relaxed);
+        ring.writeIndex.store(index + 1, std::memory_order_release);
+    }
+
+    const char* intern(const std::string& name)
+    {
+        Registry& registry = getRegistry();
+        std::lock_guard lock{ registry.mutex };
+        return registry.names.insert(name).first->c_str();
+    }
+
+    std::string exportChromeTrace()
+    {
+        Registry& registry = getRegistry();
+        std::lock_guard lock{ registry.mutex };
+
+        std::ostringstream out;
+        out.precision(3);
+        out << std::fixed;
+        out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+        out << R"({"name":"thread_name","ph":"M","pid":1,"tid":0,"args":{"name":"GPU"}})";
+        for (const auto& ring : registry.rings) {
+            out << ",\n" << R"({"name":"thread_name","ph":"M","pid":1,"tid":)" << ring->threadId
+                << R"(,"args":{"name":"CPU )" << ring->threadId << "\"}}";
+
+            // The owning thread may keep recording, so copy first and then drop the
+            // slots it has started to overwrite in the meantime
+            uint64_t end = ring->writeIndex.load(std::memory_order_acquire);
+            uint64_t begin = end > ringCapacity ? end - ringCapacity : 0;
+            begin = std::max(begin, ring->clearIndex.load(std::memory_order_relaxed));
+            std::vector<Event> events;
+            events.reserve(end - begin);
+            for (uint64_t i = begin; i < end; i++) {
+                const EventSlot& slot = ring->events[i & (ringCapacity - 1)];
+                events.push_back({ slot.name.load(std::memory_order_relaxed),
+                                   slot.begin.load(std::memory_order_relaxed),
+                                   slot.end.load(std::memory_order_relaxed),
+                                   slot.track.load(std::memory_order_relaxed) });
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            uint64_t claimed = ring->claimIndex.load(std::memory_order_relaxed);
+            uint64_t firstIntact = claimed > ringCapacity ? claimed - ringCapacity : 0;
+            for (uint64_t i = std::max(begin, firstIntact); i < end; i++) {
+                const Event& event = events[i - begin];
+                uint32_t tid = event.track == Track::Gpu ? 0 : ring->threadId;
+                out << ",\n{\"name\":\"";
+                writeEscaped(out, event.name);
+                out << "\",\"cat\":\"" << (event.track == Track::Gpu ? "gpu" : "cpu") << "\""
+                    << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << tid
+                    << ",\"ts\":" << event.begin / 1000.0
+                    << ",\"dur\":" << (event.end - event.begin) / 1000.0 << "}";
+            }
+        }
+        out << "\n]}\n";
+        return out.str();
+    }
+
+    void exportChromeTrace(const std::string& filepath)
+    {
+        std::ofstream file(filepath, std::ios::binary);
+        if (!file.is_open()) {
+            throw std::runtime_error("failed to open file!: " + filepath);
+        }
+        file << exportChromeTrace();
+    }
+
+    void clear()
+    {
+        Registry& registry = getRegistry();
+        std::lock_guard lock{ registry.mutex };
+        for (const auto& ring : registry.rings) {
+            ring->clearIndex.store(ring->writeIndex.load(std::memory_order_acquire),
+                                   std::memory_order_relaxed);
+        }
+    }
+}
@@ -0,0 +1,409 @@
+#include "vktiny/VertexFormat.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define VKT_VERTEX_SSE2
+#include <emmintrin.h>
+#if defined(__F16C__)
+#include <immintrin.h>
+#endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define VKT_VERTEX_NEON
+#include <arm_neon.h>
+#endif
+
+namespace vkt
+{
+    namespace
+    {
+        constexpr float snorm16Max = 32767.0f;
+
+        // Rounds half to even like the SIMD conversions in the default rounding mode
+        int16_t encodeSnorm16(float value)
+        {
+            return static_cast<int16_t>(std::nearbyint(std::clamp(value, -1.0f, 1.0f) * snorm16Max));
+        }
+
+#ifdef VKT_VERTEX_SSE2
+        // Round to nearest even with correct handling of denormals, infinity and NaN.
+        // Returns the four halves in the low 64 bits.
+        __m128i encodeHalf4(__m128 value)
+        {
+#ifdef __F16C__
+            return _mm_cvtps_ph(value, _MM_FROUND_TO_NEAREST_INT);
+#else
+            const __m128i maxHalf = _mm_set1_epi32((127 + 16) << 23);
+            const __m128i minNormal = _mm_set1_epi32((127 - 14) << 23);
+            const __m128i subnormalMagic = _mm_set1_epi32(((127 - 15) + (23 - 10) + 1) << 23);
+            const __m128i normalBias = _mm_set1_epi32(0xfff - ((127 - 15) << 23));
+
+            __m128 sign = _mm_and_ps(value, _mm_castsi128_ps(_mm_set1_epi32(static_cast<int>(0x80000000u))));
+            __m128 absValue = _mm_xor_ps(value, sign);
+            __m128i absBits = _mm_castps_si128(absValue);
+            __m128i isNan = _mm_castps_si128(_mm_cmpunord_ps(absValue, absValue));
+            __m128i isRegular = _mm_cmpgt_epi32(maxHalf, absBits);
+            __m128i special = _mm_or_si128(_mm_and_si128(isNan, _mm_set1_epi32(0x200)), _mm_set1_epi32(0x7c00));
+
+            __m128i isSubnormal = _mm_cmpgt_epi32(minNormal, absBits);
+            __m128i subnormal = _mm_sub_epi32(_mm_castps_si128(_mm_add_ps(absValue, _mm_castsi128_ps(subnormalMagic))),
+                                              subnormalMagic);
+            __m128i mantissaOdd = _mm_srai_epi32(_mm_slli_epi32(absBits, 31 - 13), 31);
+            __m128i normal = _mm_srli_epi32(_mm_sub_epi32(_mm_add_epi32(absBits, normalBias), mantissaOdd), 13);
+
+            __m128i finite = _mm_or_si128(_mm_and_si128(isSubnormal, subnormal), _mm_andnot_si128(isSubnormal, normal));
+            __m128i result = _mm_or_si128(_mm_and_si128(isRegular, finite), _mm_andnot_si128(isRegular, special));
+            result = _mm_or_si128(result, _mm_srai_epi32(_mm_castps_si128(sign), 16));
+
+            // Lanes are sign extended, so the saturating pack keeps the low 16 bits
+            return _mm_packs_epi32(result, result);
+#endif
+        }
+#endif
+
+        void encodePositions(const Vertex* vertices, uint32_t vertexCount, const VertexQuantization& quantization,
+                             uint8_t* out, uint32_t stride)
+        {
+            std::array<float, 3> inverseScale;
+            for (int axis = 0; axis < 3; axis++) {
+                float scale = quantization.scale[axis];
+                inverseScale[axis] = scale > 0.0f ? snorm16Max / scale : 0.0f;
+            }
+            uint32_t i = 0;
+#if defined(VKT_VERTEX_SSE2)
+            // The fourth lane reads normal.x and is masked to zero
+            const __m128 offset = _mm_setr_ps(quantization.offset[0], quantization.offset[1], quantization.offset[2], 0.0f);
+            const __m128 factor = _mm_setr_ps(inverseScale[0], inverseScale[1], inverseScale[2], 0.0f);
+            const __m128 mask = _mm_castsi128_ps(_mm_setr_epi32(-1, -1, -1, 0));
+            const __m128 minValue = _mm_set1_ps(-snorm16Max);
+            const __m128 maxValue = _mm_set1_ps(snorm16Max);
+            for (; i < vertexCount; i++) {
+                __m128 position = _mm_loadu_ps(vertices[i].position.data());
+                __m128 scaled = _mm_and_ps(_mm_mul_ps(_mm_sub_ps(position, offset), factor), mask);
+                scaled = _mm_min_ps(_mm_max_ps(scaled, minValue), maxValue);
+                __m128i packed = _mm_packs_epi32(_mm_cvtps_epi32(scaled), _mm_setzero_si128());
+                _mm_storel_epi64(reinterpret_cast<__m128i*>(out + size_t{ i } * stride), packed);
+            }
+#elif defined(VKT_VERTEX_NEON)
+            const float offsetValues[4] = { quantization.offset[0], quantization.offset[1], quantization.offset[2], 0.0f };
+            const float factorValues[4] = { inverseScale[0], inverseScale[1], inverseScale[2], 0.0f };
+            const float32x4_t offset = vld1q_f32(offsetValues);
+            const float32x4_t factor = vld1q_f32(factorValues);
+            const uint32_t maskValues[4] = { ~0u, ~0u, ~0u, 0u };
+            const uint32x4_t mask = vld1q_u32(maskValues);
+            for (; i < vertexCount; i++) {
+                float32x4_t position = vld1q_f32(vertices[i].position.data());
+                float32x4_t scaled = vmulq_f32(vsubq_f32(position, offset), factor);
+                scaled = vreinterpretq_f32_u32(vandq_u32(vreinterpretq_u32_f32(scaled), mask));
+                scaled = vminq_f32(vmaxq_f32(scaled, vdupq_n_f32(-snorm16Max)), vdupq_n_f32(snorm16Max));
+                vst1_s16(reinterpret_cast<int16_t*>(out + size_t{ i } * stride), vqmovn_s32(vcvtnq_s32_f32(scaled)));
+            }
+#endif
+            for (; i < vertexCount; i++) {
+                int16_t packed[4] = {};
+                for (int axis = 0; axis < 3; axis++) {
+                    float scaled = (vertices[i].position[axis] - quantization.offset[axis]) * inverseScale[axis];
+                    packed[axis] = static_cast<int16_t>(std::nearbyint(std::clamp(scaled, -snorm16Max, snorm16Max)));
+                }
+                std::memcpy(out + size_t{ i } * stride, packed, sizeof(packed));
+            }
+        }
+
+        void encodeNormals(const Vertex* vertices, uint32_t vertexCount, uint8_t* out, uint32_t stride)
+        {
+            uint32_t i = 0;
+#if defined(VKT_VERTEX_SSE2)
+            // Four normals at a time in structure-of-arrays form
+            const __m128 signMask = _mm_castsi128_ps(_mm_set1_epi32(static_cast<int>(0x80000000u)));
+            const __m128 one = _mm_set1_ps(1.0f);
+            for (; i + 4 <= vertexCount; i += 4) {
+                const Vertex* v = vertices + i;
+                __m128 x = _mm_setr_ps(v[0].normal[0], v[1].normal[0], v[2].normal[0], v[3].normal[0]);
+                __m128 y = _mm_setr_ps(v[0].normal[1], v[1].normal[1], v[2].normal[1], v[3].normal[1]);
+                __m128 z = _mm_setr_ps(v[0].normal[2], v[1].normal[2], v[2].normal[2], v[3].normal[2]);
+
+                __m128 absX = _mm_andnot_ps(signMask, x);
+                __m128 absY = _mm_andnot_ps(signMask, y);
+                __m128 absZ = _mm_andnot_ps(signMask, z);
+                __m128 length = _mm_max_ps(_mm_add_ps(_mm_add_ps(absX, absY), absZ), _mm_set1_ps(1e-30f));
+                __m128 px = _mm_div_ps(x, length);
+                __m128 py = _mm_div_ps(y, length);
+
+                // Fold the lower hemisphere over the diagonals
+                __m128 signX = _mm_or_ps(_mm_and_ps(px, signMask), one);
+                __m128 signY = _mm_or_ps(_mm_and_ps(py, signMask), one);
+                __m128 foldedX = _mm_mul_ps(_mm_sub_ps(one, _mm_andnot_ps(signMask, py)), signX);
+                __m128 foldedY = _mm_mul_ps(_mm_sub_ps(one, _mm_andnot_ps(signMask, px)), signY);
+                __m128 lower = _mm_cmplt_ps(z, _mm_setzero_ps());
+                px = _mm_or_ps(_mm_and_ps(lower, foldedX), _mm_andnot_ps(lower, px));
+                py = _mm_or_ps(_mm_and_ps(lower, foldedY), _mm_andnot_ps(lower, py));
+
+                __m128i ix = _mm_cvtps_epi32(_mm_mul_ps(px, _mm_set1_ps(snorm16Max)));
+                __m128i iy = _mm_cvtps_epi32(_mm_mul_ps(py, _mm_set1_ps(snorm16Max)));
+                __m128i packed = _mm_unpacklo_epi16(_mm_packs_epi32(ix, ix), _mm_packs_epi32(iy, iy));
+                alignas(16) uint32_t words[4];
+                _mm_store_si128(reinterpret_cast<__m128i*>(words), packed);
+                for (uint32_t j = 0; j < 4; j++) {
+                    std::memcpy(out + size_t{ i + j } * stride, &words[j], sizeof(uint32_t));
+                }
+            }
+#endif
+            for (; i < vertexCount; i++) {
+                std::array<int16_t, 2> packed = encodeOctahedral(vertices[i].normal);
+                std::memcpy(out + size_t{ i } * stride, packed.data(), sizeof(packed));
+            }
+        }
+
+        void encodeTexCoords(const Vertex* vertices, uint32_t vertexCount, uint8_t* out, uint32_t stride)
+        {
+            uint32_t i = 0;
+#if defined(VKT_VERTEX_SSE2)
+            // Two texture coordinates per vector
+            for (; i + 2 <= vertexCount; i += 2) {
+                __m128 first = _mm_castpd_ps(_mm_load_sd(reinterpret_cast<const double*>(vertices[i].texCoord.data())));
+                __m128 second = _mm_castpd_ps(_mm_load_sd(reinterpret_cast<const double*>(vertices[i + 1].texCoord.data())));
+                uint32_t words[2];
+                _mm_storel_epi64(reinterpret_cast<__m128i*>(words), encodeHalf4(_mm_movelh_ps(first, second)));
+                std::memcpy(out + size_t{ i } * stride, &words[0], sizeof(uint32_t));
+                std::memcpy(out + size_t{ i + 1 } * stride, &words[1], sizeof(uint32_t));
+            }
+#elif defined(VKT_VERTEX_NEON)
+            for (; i + 2 <= vertexCount; i += 2) {
+                float32x4_t texCoords = vcombine_f32(vld1_f32(vertices[i].texCoord.data()),
+                                                     vld1_f32(vertices[i + 1].texCoord.data()));
+                uint16_t halves[4];
+                vst1_u16(halves, vreinterpret_u16_f16(vcvt_f16_f32(texCoords)));
+                std::memcpy(out + size_t{ i } * stride, &halves[0], sizeof(uint32_t));
+                std::memcpy(out + size_t{ i + 1 } * stride, &halves[2], sizeof(uint32_t));
+            }
+#endif
+            for (; i < vertexCount; i++) {
+                uint16_t halves[2] = { encodeHalf(vertices[i].texCoord[0]), encodeHalf(vertices[i].texCoord[1]) };
+                std::memcpy(out + size_t{ i } * stride, halves, sizeof(halves));
+            }
+        }
+
+        void encodeIndices16(const uint32_t* indices, uint32_t indexCount, uint16_t* out)
+        {
+            uint32_t i = 0;
+#if defined(VKT_VERTEX_SSE2)
+            // SSE2 only has a signed saturating pack, so shift into the signed range and back
+            const __m128i bias32 = _mm_set1_epi32(0x8000);
+            const __m128i bias16 = _mm_set1_epi16(static_cast<short>(0x8000));
+            for (; i + 8 <= indexCount; i += 8) {
+                __m128i low = _mm_sub_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(indices + i)), bias32);
+                __m128i high = _mm_sub_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(indices + i + 4)), bias32);
+                __m128i packed = _mm_add_epi16(_mm_packs_epi32(low, high), bias16);
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), packed);
+            }
+#elif defined(VKT_VERTEX_NEON)
+            for (; i + 8 <= indexCount; i += 8) {
+                uint16x4_t low = vmovn_u32(vld1q_u32(indices + i));
+                uint16x4_t high = vmovn_u32(vld1q_u32(indices + i + 4));
+                vst1q_u16(out + i, vcombine_u16(low, high));
+            }
+#endif
+            for (; i < indexCount; i++) {
+                out[i] = static_cast<uint16_t>(indices[i]);
+            }
+        }
+
+        uint32_t getPositionSize(PositionFormat format)
+        {
+            return format == PositionFormat::Float32 ? 12 : 8;
+        }
+
+        uint32_t getNormalSize(NormalFormat format)
+        {
+            return format == NormalFormat::Float32 ? 12 : 4;
+        }
+
+        uint32_t getTexCoordSize(TexCoordFormat format)
+        {
+            return format == TexCoordFormat::Float32 ? 8 : 4;
+        }
+    }
+
+    uint32_t VertexLayout::getStride() const
+    {
+        return getTexCoordOffset() + getTexCoordSize(texCoord);
+    }
+
+    uint32_t VertexLayout::getNormalOffset() const
+    {
+        return getPositionSize(position);
+    }
+
+    uint32_t VertexLayout::getTexCoordOffset() const
+    {
+        return getNormalOffset() + getNormalSize(normal);
+    }
+
+    vk::Format VertexLayout::getPositionFormat() const
+    {
+        return position == PositionFormat::Float32 ? vk::Format::eR32G32B32Sfloat : vk::Format::eR16G16B16A16Snorm;
+    }
+
+    std::vector<vk::VertexInputAttributeDescription> VertexLayout::getAttributes(uint32_t binding) const
+    {
+        vk::Format normalFormat = normal == NormalFormat::Float32 ? vk::Format::eR32G32B32Sfloat : vk::Format::eR16G16Snorm;
+        vk::Format texCoordFormat = texCoord == TexCoordFormat::Float32 ? vk::Format::eR32G32Sfloat : vk::Format::eR16G16Sfloat;
+        return {
+            { 0, binding, getPositionFormat(), 0 },
+            { 1, binding, normalFormat, getNormalOffset() },
+            { 2, binding, texCoordFormat, getTexCoordOffset() },
+        };
+    }
+
+    uint16_t encodeHalf(float value)
+    {
+        uint32_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        uint32_t sign = bits & 0x80000000u;
+        bits ^= sign;
+
+        uint32_t half;
+        if (bits >= 0x47800000u) {
+            // Too large for a half, or infinity or NaN
+            half = bits > 0x7f800000u ? 0x7e00 : 0x7c00;
+        } else if (bits < 0x38800000u) {
+            // Subnormal, let the FPU round by adding 0.5
+            float magic = 0.5f;
+            float shifted;
+            std::memcpy(&shifted, &bits, sizeof(shifted));
+            shifted += magic;
+            std::memcpy(&half, &shifted, sizeof(half));
+            half -= 0x3f000000u;
+        } else {
+            uint32_t mantissaOdd = (bits >> 13) & 1;
+            bits += ((15u - 127u) << 23) + 0xfff;
+            bits += mantissaOdd;
+            half = bits >> 13;
+        }
+        return static_cast<uint16_t>(half | (sign >> 16));
+    }
+
+    std::array<int16_t, 2> encodeOctahedral(const std::array<float, 3>& normal)
+    {
+        float length = std::abs(normal[0]) + std::abs(normal[1]) + std::abs(normal[2]);
+        if (length <= 0.0f) {
+            return { 0, 0 };
+        }
+        float x = normal[0] / length;
+        float y = normal[1] / length;
+        if (normal[2] < 0.0f) {
+            float foldedX = std::copysign(1.0f - std::abs(y), x);
+            float foldedY = std::copysign(1.0f - std::abs(x), y);
+            x = foldedX;
+            y = foldedY;
+        }
+        return { encodeSnorm16(x), encodeSnorm16(y) };
+    }
+
+    QuantizedMesh quantizeMesh(const Vertex* vertices, uint32_t vertexCount,
+                               const uint32_t* indices, uint32_t indexCount,
+                               const VertexLayout& layout, vk::IndexType indexType)
+    {
+        if (indexType == vk::IndexType::eUint16 && vertexCount > 65536) {
+            throw std::runtime_error("16-bit indices need at most 65536 vertices, got " + std::to_string(vertexCount));
+        }
+        if (indexType != vk::IndexType::eUint16 && indexType != vk::IndexType::eUint32) {
+            throw std::runtime_error("unsupported index type " + vk::to_string(indexType));
+        }
+
+        QuantizedMesh mesh;
+        uint32_t stride = layout.getStride();
+        mesh.vertexData.resize(size_t{ vertexCount } * stride);
+        uint8_t* out = mesh.vertexData.data();
+
+        if (layout.position == PositionFormat::Float32) {
+            for (uint32_t i = 0; i < vertexCount; i++) {
+                std::memcpy(out + size_t{ i } * stride, vertices[i].position.data(), 12);
+            }
+        } else if (vertexCount > 0) {
+            // Map the bounds to [-1, 1] on every axis
+            std::array<float, 3> boundsMin = vertices[0].position;
+            std::array<float, 3> boundsMax = boundsMin;
+            for (uint32_t i = 1; i < vertexCount; i++) {
+                for (int axis = 0; axis < 3; axis++) {
+                    boundsMin[axis] = std::min(boundsMin[axis], vertices[i].position[axis]);
+                    boundsMax[axis] = std::max(boundsMax[axis], vertices[i].position[axis]);
+                }
+            }
+            for (int axis = 0; axis < 3; axis++) {
+                mesh.quantization.offset[axis] = (boundsMin[axis] + boundsMax[axis]) * 0.5f;
+                mesh.quantization.scale[axis] = (boundsMax[axis] - boundsMin[axis]) * 0.5f;
+            }
+            encodePositions(vertices, vertexCount, mesh.quantization, out, stride);
+        }
+
+        if (layout.normal == NormalFormat::Float32) {
+            for (uint32_t i = 0; i < vertexCount; i++) {
+                std::memcpy(out + size_t{ i } * stride + layout.getNormalOffset(), vertices[i].normal.data(), 12);
+            }
+        } else {
+            encodeNormals(vertices, vertexCount, out + layout.getNormalOffset(), stride);
+        }
+
+        if (layout.texCoord == TexCoordFormat::Float32) {
+            for (uint32_t i = 0; i < vertexCount; i++) {
+                std::memcpy(out + size_t{ i } * stride + layout.getTexCoordOffset(), vertices[i].texCoord.data(), 8);
+            }
+        } else {
+            encodeTexCoords(vertices, vertexCount, out + layout.getTexCoordOffset(), stride);
+        }
+
+        if (indexType == vk::IndexType::eUint16) {
+            mesh.indexData.resize(size_t{ indexCount } * sizeof(uint16_t));
+            encodeIndices16(indices, indexCount, reinterpret_cast<uint16_t*>(mesh.indexData.data()));
+        } else {
+            mesh.indexData.resize(size_t{ indexCount } * sizeof(uint32_t));
+            std::memcpy(mesh.indexData.data(), indices, mesh.indexData.size());
+        }
+        return mesh;
+    }
+
+    std::string getVertexDecodeGlsl(const VertexLayout& layout)
+    {
+        auto word = [](uint32_t offset) { return "v.words[" + std::to_string(offset / 4) + "]"; };
+        auto floatWord = [&](uint32_t offset) { return "uintBitsToFloat(" + word(offset) + ")"; };
+
+        std::string glsl;
+        glsl += "struct VktPackedVertex\n{\n    uint words[" + std::to_string(layout.getStride() / 4) + "];\n};\n\n";
+
+        glsl += "vec3 vktDecodePosition(VktPackedVertex v, vec3 offset, vec3 scale)\n{\n";
+        if (layout.position == PositionFormat::Float32) {
+            glsl += "    vec3 p = vec3(" + floatWord(0) + ", " + floatWord(4) + ", " + floatWord(8) + ");\n";
+        } else {
+            glsl += "    vec3 p = vec3(unpackSnorm2x16(" + word(0) + "), unpackSnorm2x16(" + word(4) + ").x);\n";
+        }
+        glsl += "    return offset + scale * p;\n}\n\n";
+
+        glsl += "vec3 vktDecodeOctahedral(vec2 e)\n{\n"
+                "    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));\n"
+                "    float t = max(-n.z, 0.0);\n"
+                "    n.x += n.x >= 0.0 ? -t : t;\n"
+                "    n.y += n.y >= 0.0 ? -t : t;\n"
+                "    return normalize(n);\n}\n\n";
+
+        uint32_t normalOffset = layout.getNormalOffset();
+        glsl += "vec3 vktDecodeNormal(VktPackedVertex v)\n{\n";
+        if (layout.normal == NormalFormat::Float32) {
+            glsl += "    return vec3(" + floatWord(normalOffset) + ", " + floatWord(normalOffset + 4) + ", " +
+                    floatWord(normalOffset + 8) + ");\n}\n\n";
+        } else {
+            glsl += "    return vktDecodeOctahedral(unpackSnorm2x16(" + word(normalOffset) + "));\n}\n\n";
+        }
+
+        uint32_t texCoordOffset = layout.getTexCoordOffset();
+        glsl += "vec2 vktDecodeTexCoord(VktPackedVertex v)\n{\n";
+        if (layout.texCoord == TexCoordFormat::Float32) {
+            glsl += "    return vec2(" + floatWord(texCoordOffset) + ", " + floatWord(texCoordOffset + 4) + ");\n}\n";
+        } else {
+            glsl += "    return unpackHalf2x16(" + word(texCoordOffset) + ");\n}\n";
+        }
+        return glsl;
+    }
+}
@@ -0,0 +1,48 @@
+#pragma once
+#include <cstdio>
+#include <exception>
+#include <source_location>
+#include <string>
+
+// Checks for the test executables. Failures are printed and counted, and
+// main returns test::report() so that ctest sees them.
+namespace test
+{
+    inline int failureCount = 0;
+
+    inline void check(bool condition, const char* expression,
+                      std::source_location location = std::source_location::current())
+    {
+        if (!condition) {
+            std::fprintf(stderr, "%s:%u: check failed: %s\n", location.file_name(),
+                         static_cast<unsigned>(location.line()), expression);
+            failureCount++;
+        }
+    }
+
+    // The message of the expected exception has to contain the given text
+    template <typename Func>
+    void checkThrows(Func&& func, const char* expression, const std::string& message,
+                     std::source_location location = std::source_location::current())
+    {
+        try {
+            func();
+        } catch (const std::exception& error) {
+            check(std::string{ error.what() }.find(message) != std::string::npos, expression, location);
+            return;
+        }
+        check(false, expression, location);
+    }
+
+    inline int report()
+    {
+        if (failureCount > 0) {
+            std::fprintf(stderr, "%d checks failed\n", failureCount);
+            return 1;
+        }
+        return 0;
+    }
+}
+
+#define VKT_CHECK(condition) test::check(static_cast<bool>(condition), #condition)
+#define VKT_CHECK_THROWS(expression, message) test::checkThrows([&] { expression; }, #expression, message)
@@ -0,0 +1,304 @@
+#include "vktiny/GltfLoader.hpp"
+#include "vktiny/Json.hpp"
+#include "vktiny/ThreadPool.hpp"
+#include "Check.hpp"
+#include <cmath>
+#include <cstring>
+#include <fstream>
+
+namespace
+{
+    namespace fs = std::filesystem;
+
+    const fs::path directory = fs::temp_directory_path() / "vktiny_test_gltf";
+
+    void writeFile(const fs::path& path, const std::vector<uint8_t>& bytes)
+    {
+        std::ofstream file{ path, std::ios::binary };
+        file.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+    }
+
+    void writeFile(const fs::path& path, const std::string& text)
+    {
+        writeFile(path, std::vector<uint8_t>{ text.begin(), text.end() });
+    }
+
+    template <typename T>
+    void append(std::vector<uint8_t>& bytes, const T& value)
+    {
+        const auto* data = reinterpret_cast<const uint8_t*>(&value);
+        bytes.insert(bytes.end(), data, data + sizeof(T));
+    }
+
+    std::vector<uint8_t> makeGlb(std::string json, std::vector<uint8_t> bin)
+    {
+        while (json.size() % 4 != 0) {
+            json += ' ';
+        }
+        while (bin.size() % 4 != 0) {
+            bin.push_back(0);
+        }
+        std::vector<uint8_t> glb;
+        append(glb, uint32_t{ 0x46546C67 });
+        append(glb, uint32_t{ 2 });
+        append(glb, static_cast<uint32_t>(12 + 8 + json.size() + (bin.empty() ? 0 : 8 + bin.size())));
+        append(glb, static_cast<uint32_t>(json.size()));
+        append(glb, uint32_t{ 0x4E4F534A });
+        glb.insert(glb.end(), json.begin(), json.end());
+        if (!bin.empty()) {
+            append(glb, static_cast<uint32_t>(bin.size()));
+            append(glb, uint32_t{ 0x004E4942 });
+            glb.insert(glb.end(), bin.begin(), bin.end());
+        }
+        return glb;
+    }
+
+    std::string encodeBase64(const std::vector<uint8_t>& bytes)
+    {
+        const char* alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+        std::string text;
+        for (size_t i = 0; i < bytes.size(); i += 3) {
+            uint32_t bits = uint32_t{ bytes[i] } << 16;
+            bits |= i + 1 < bytes.size() ? uint32_t{ bytes[i + 1] } << 8 : 0;
+            bits |= i + 2 < bytes.size() ? uint32_t{ bytes[i + 2] } : 0;
+            text += alphabet[(bits >> 18) & 63];
+            text += alphabet[(bits >> 12) & 63];
+            text += i + 1 < bytes.size() ? alphabet[(bits >> 6) & 63] : '=';
+            text += i + 2 < bytes.size() ? alphabet[bits & 63] : '=';
+        }
+        return text;
+    }
+
+    // One triangle as float positions followed by 16-bit indices
+    std::vector<uint8_t> getTriangleBuffer()
+    {
+        std::vector<uint8_t> bytes;
+        for (float value : { 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f }) {
+            append(bytes, value);
+        }
+        for (uint16_t index : { 0, 1, 2 }) {
+            append(bytes, index);
+        }
+        return bytes;
+    }
+
+    std::string getTriangleJson(const std::string& buffer, const std::string& extra = "")
+    {
+        return R"({
+            "asset": { "version": "2.0" },
+            "buffers": [ )" + buffer + R"( ],
+            "bufferViews": [
+                { "buffer": 0, "byteOffset": 0, "byteLength": 36 },
+                { "buffer": 0, "byteOffset": 36, "byteLength": 6 }
+            ],
+            "accessors": [
+                { "bufferView": 0, "componentType": 5126, "count": 3, "type": "VEC3" },
+                { "bufferView": 1, "componentType": 5123, "count": 3, "type": "SCALAR" }
+            ],
+            "meshes": [ { "name": "triangle", "primitives": [ { "attributes": { "POSITION": 0 }, "indices": 1 } ] } ])" +
+               extra + "}";
+    }
+
+    void checkTriangle(const vkt::GltfLoader& loader)
+    {
+        VKT_CHECK(loader.getMeshes().size() == 1);
+        VKT_CHECK(loader.getVertexCount() == 3);
+        VKT_CHECK(loader.getIndexCount() == 3);
+
+        std::vector<vkt::Vertex> vertices(3);
+        std::vector<uint32_t> indices(3);
+        loader.decodeMesh(0, vertices.data(), indices.data());
+        VKT_CHECK(vertices[1].position[0] == 1.0f);
+        VKT_CHECK(vertices[2].position[1] == 1.0f);
+        VKT_CHECK(vertices[2].normal[2] == 0.0f);
+        VKT_CHECK(indices[0] == 0 && indices[1] == 1 && indices[2] == 2);
+    }
+
+    bool isNear(float a, float b)
+    {
+        return std::abs(a - b) < 1e-5f;
+    }
+
+    void testJson()
+    {
+        using vkt::json::Value;
+        Value value = vkt::json::parse(R"( { "a": [1, -2.5e2, true, null], "b": { "c": "x\"\n\u00e9\ud83d\ude00" } } )");
+        VKT_CHECK(value.isObject());
+        VKT_CHECK(value["a"].size() == 4);
+        VKT_CHECK(value["a"][0].asInt() == 1);
+        VKT_CHECK(value["a"][1].asNumber() == -250.0);
+        VKT_CHECK(value["a"][2].asBool());
+        VKT_CHECK(value["a"][3].isNull());
+        VKT_CHECK(value["b"]["c"].asString() == "x\"\n\xC3\xA9\xF0\x9F\x98\x80");
+
+        // Missing members and elements, and other types, fall back
+        VKT_CHECK(value["missing"].isNull());
+        VKT_CHECK(value["a"][10].isNull());
+        VKT_CHECK(value["b"].asNumber(7.0) == 7.0);
+        VKT_CHECK(!value.contains("c"));
+
+        VKT_CHECK_THROWS(vkt::json::parse("[1, 2"), "json:");
+        VKT_CHECK_THROWS(vkt::json::parse("[1.2.3]"), "invalid number");
+        VKT_CHECK_THROWS(vkt::json::parse("{} x"), "trailing");
+        VKT_CHECK_THROWS(vkt::json::parse("\"\\q\""), "invalid escape");
+        VKT_CHECK_THROWS(vkt::json::parse(std::string(1000, '[')), "json:");
+    }
+
+    void testGlb()
+    {
+        fs::path path = directory / "triangle.glb";
+        writeFile(path, makeGlb(getTriangleJson(R"({ "byteLength": 42 })"), getTriangleBuffer()));
+        checkTriangle(vkt::GltfLoader{ path });
+
+        // A chunk larger than the file
+        std::vector<uint8_t> truncated = makeGlb(getTriangleJson(R"({ "byteLength": 42 })"), getTriangleBuffer());
+        truncated.resize(truncated.size() - 8);
+        writeFile(path, truncated);
+        VKT_CHECK_THROWS(vkt::GltfLoader{ path }, "truncated chunk");
+
+        // The binary chunk is shorter than the buffer's byteLength
+        writeFile(path, makeGlb(getTriangleJson(R"({ "byteLength": 400 })"), getTriangleBuffer()));
+        VKT_CHECK_THROWS(vkt::GltfLoader{ path }, "smaller than its byteLength");
+    }
+
+    void testAccessors()
+    {
+        // Interleaved float positions and normalized unsigned byte texture coordinates
+        std::vector<uint8_t> bin;
+        for (int i = 0; i < 3; i++) {
+            append(bin, static_cast<float>(i));
+            append(bin, 0.0f);
+            append(bin, 0.0f);
+            append(bin, uint8_t{ 255 });
+            append(bin, static_cast<uint8_t>(i * 51));
+            append(bin, uint16_t{ 0 });
+        }
+        std::string json = R"({
+            "buffers": [ { "byteLength": 48 } ],
+            "bufferViews": [ { "buffer": 0, "byteLength": 48, "byteStride": 16 } ],
+            "accessors": [
+                { "bufferView": 0, "componentType": 5126, "count": 3, "type": "VEC3" },
+                { "bufferView": 0, "byteOffset": 12, "componentType": 5121, "normalized": true, "count": 3, "type": "VEC2" }
+            ],
+            "meshes": [ { "primitives": [ { "attributes": { "POSITION": 0, "TEXCOORD_0": 1 } } ] } ]
+        })";
+        fs::path path = directory / "interleaved.glb";
+        writeFile(path, makeGlb(json, bin));
+        vkt::GltfLoader loader{ path };
+        VKT_CHECK(loader.getIndexCount() == 3);
+
+        std::vector<vkt::Vertex> vertices(3);
+        std::vector<uint32_t> indices(3);
+        loader.decodeMesh(0, vertices.data(), indices.data());
+        VKT_CHECK(vertices[2].position[0] == 2.0f);
+        VKT_CHECK(vertices[1].texCoord[0] == 1.0f);
+        VKT_CHECK(isNear(vertices[1].texCoord[1], 0.2f));
+        VKT_CHECK(vertices[1].normal[0] == 0.0f);
+        VKT_CHECK(indices[0] == 0 && indices[1] == 1 && indices[2] == 2);
+
+        // The last element would end past the view
+        std::string outOfRange = json;
+        outOfRange.replace(outOfRange.find(R"("count": 3, "type": "VEC3")"), 10, R"("count": 4)");
+        writeFile(path, makeGlb(outOfRange, bin));
+        VKT_CHECK_THROWS(vkt::GltfLoader{ path }, "accessor out of range");
+
+        // Indices past the vertices are rejected when decoding
+        std::vector<uint8_t> badIndices = getTriangleBuffer();
+        badIndices[badIndices.size() - 2] = 3;
+        writeFile(path, makeGlb(getTriangleJson(R"({ "byteLength": 42 })"), badIndices));
+        vkt::GltfLoader badLoader{ path };
+        VKT_CHECK_THROWS(badLoader.decodeMesh(0, vertices.data(), indices.data()), "index out of range");
+    }
+
+    void testDataUris()
+    {
+        std::string buffer = R"({ "byteLength": 42, "uri": "data:application/octet-stream;base64,)" +
+                             encodeBase64(getTriangleBuffer()) + R"(" })";
+        std::string images = R"(,
+            "images": [
+                { "uri": "data:image/png;base64,)" + encodeBase64({ 1, 2, 3, 4, 5 }) + R"(" },
+                { "uri": "missing%20image.png" }
+            ])";
+        fs::path path = directory / "data_uri.gltf";
+        writeFile(path, getTriangleJson(buffer, images));
+
+        vkt::ThreadPool pool{ 2 };
+        vkt::GltfLoader loader{ path, &pool };
+        checkTriangle(loader);
+
+        const std::vector<vkt::ImageSource>& sources = loader.getImages();
+        VKT_CHECK(sources.size() == 2);
+        VKT_CHECK(sources[0].mimeType == "image/png");
+        VKT_CHECK(sources[0].size == 5);
+        VKT_CHECK(sources[0].data && sources[0].data[0] == 1 && sources[0].data[4] == 5);
+
+        // Missing files are skipped with a warning, and percent escapes are decoded
+        VKT_CHECK(sources[1].data == nullptr);
+        VKT_CHECK(sources[1].path.filename() == "missing image.png");
+
+        // Only files referenced by URI are dependencies of the scene
+        VKT_CHECK(loader.getExternalFiles().size() == 1);
+        VKT_CHECK(loader.getExternalFiles()[0] == sources[1].path);
+
+        std::string invalid = R"({ "byteLength": 42, "uri": "data:application/octet-stream,abc" })";
+        writeFile(path, getTriangleJson(invalid));
+        VKT_CHECK_THROWS(vkt::GltfLoader{ path }, "only base64");
+    }
+
+    void testNodes()
+    {
+        // The root translates, its child scales and rotates 90 degrees about z,
+        // and node 2 isn't part of the scene
+        std::string nodes = R"(,
+            "scene": 0,
+            "scenes": [ { "nodes": [ 0 ] } ],
+            "nodes": [
+                { "translation": [ 1, 2, 3 ], "children": [ 1, 3 ] },
+                { "scale": [ 2, 2, 2 ], "rotation": [ 0, 0, 0.70710678, 0.70710678 ], "mesh": 0 },
+                { "mesh": 0 },
+                { "matrix": [ 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 5, 0, 0, 1 ], "mesh": 0 }
+            ])";
+        fs::path path = directory / "nodes.glb";
+        writeFile(path, makeGlb(getTriangleJson(R"({ "byteLength": 42 })", nodes), getTriangleBuffer()));
+        vkt::GltfLoader loader{ path };
+
+        const std::vector<vkt::MeshInstance>& instances = loader.getInstances();
+        VKT_CHECK(instances.size() == 2);
+        if (instances.size() == 2) {
+            // Column-major, x maps to 2y and the translation is the parent's
+            const auto& child = instances[0].transform;
+            VKT_CHECK(isNear(child[0], 0.0f) && isNear(child[1], 2.0f));
+            VKT_CHECK(isNear(child[4], -2.0f) && isNear(child[5], 0.0f));
+            VKT_CHECK(isNear(child[10], 2.0f));
+            VKT_CHECK(child[12] == 1.0f && child[13] == 2.0f && child[14] == 3.0f);
+
+            const auto& matrix = instances[1].transform;
+            VKT_CHECK(matrix[0] == 1.0f && matrix[12] == 6.0f && matrix[13] == 2.0f);
+        }
+
+        // A cycle is caught by the depth limit
+        std::string cycle = R"(,
+            "scenes": [ { "nodes": [ 0 ] } ],
+            "nodes": [ { "children": [ 1 ] }, { "children": [ 0 ], "mesh": 0 } ])";
+        writeFile(path, makeGlb(getTriangleJson(R"({ "byteLength": 42 })", cycle), getTriangleBuffer()));
+        VKT_CHECK_THROWS(vkt::GltfLoader{ path }, "invalid node hierarchy");
+
+        // Without scenes every mesh is placed once
+        writeFile(path, makeGlb(getTriangleJson(R"({ "byteLength": 42 })"), getTriangleBuffer()));
+        vkt::GltfLoader flat{ path };
+        VKT_CHECK(flat.getInstances().size() == 1);
+        VKT_CHECK(flat.getInstances()[0].transform[0] == 1.0f && flat.getInstances()[0].transform[12] == 0.0f);
+    }
+}
+
+int main()
+{
+    fs::create_directories(directory);
+    testJson();
+    testGlb();
+    testAccessors();
+    testDataUris();
+    testNodes();
+    fs::remove_all(directory);
+    return test::report();
+}
@@ -0,0 +1,166 @@
+#include "vktiny/GltfLoader.hpp"
+#include "vktiny/MeshOptimizer.hpp"
+#include "vktiny/ThreadPool.hpp"
+#include "Check.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <set>
+
+namespace
+{
+    using Triangle = std::array<uint32_t, 3>;
+
+    // Triangles rotated to start with their smallest index, in sorted order
+    std::multiset<Triangle> getTriangles(const std::vector<uint32_t>& indices)
+    {
+        std::multiset<Triangle> triangles;
+        for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+            Triangle triangle{ indices[i], indices[i + 1], indices[i + 2] };
+            std::rotate(triangle.begin(), std::min_element(triangle.begin(), triangle.end()), triangle.end());
+            triangles.insert(triangle);
+        }
+        return triangles;
+    }
+
+    // size x size quads in the xy plane, with the triangles in a scattered order
+    void makeGrid(uint32_t size, std::vector<vkt::Vertex>& vertices, std::vector<uint32_t>& indices)
+    {
+        for (uint32_t y = 0; y <= size; y++) {
+            for (uint32_t x = 0; x <= size; x++) {
+                vkt::Vertex& vertex = vertices.emplace_back();
+                vertex.position = { static_cast<float>(x), static_cast<float>(y), 0.0f };
+                vertex.normal = { 0.0f, 0.0f, 1.0f };
+            }
+        }
+        uint32_t quadCount = size * size;
+        for (uint32_t i = 0; i < quadCount; i++) {
+            uint32_t quad = (i * 7919) % quadCount;
+            uint32_t v = quad / size * (size + 1) + quad % size;
+            indices.insert(indices.end(), { v, v + 1, v + size + 1, v + 1, v + size + 2, v + size + 1 });
+        }
+    }
+
+    void testAnalyze()
+    {
+        vkt::meshopt::VertexCacheStats stats = vkt::meshopt::analyzeVertexCache({ 0, 1, 2, 2, 1, 3 }, 4);
+        VKT_CHECK(stats.verticesTransformed == 4);
+        VKT_CHECK(stats.acmr == 2.0f);
+        VKT_CHECK(stats.atvr == 1.0f);
+
+        // With a cache of three, vertex 0 is evicted before it is used again
+        stats = vkt::meshopt::analyzeVertexCache({ 0, 1, 2, 1, 2, 3, 3, 2, 0 }, 4, 3);
+        VKT_CHECK(stats.verticesTransformed == 5);
+    }
+
+    void testOptimize()
+    {
+        std::vector<vkt::Vertex> vertices;
+        std::vector<uint32_t> indices;
+        makeGrid(32, vertices, indices);
+
+        // Duplicates of every vertex are merged again
+        std::vector<vkt::Vertex> duplicated = vertices;
+        duplicated.insert(duplicated.end(), vertices.begin(), vertices.end());
+        std::vector<uint32_t> shifted = indices;
+        for (size_t i = 0; i < shifted.size(); i += 2) {
+            shifted[i] += static_cast<uint32_t>(vertices.size());
+        }
+        vkt::meshopt::deduplicateVertices(duplicated, shifted);
+        VKT_CHECK(duplicated.size() == vertices.size());
+        VKT_CHECK(getTriangles(shifted) == getTriangles(indices));
+
+        // Reordering keeps every triangle and its winding
+        auto uint32Count = static_cast<uint32_t>(vertices.size());
+        float acmrBefore = vkt::meshopt::analyzeVertexCache(indices, uint32Count).acmr;
+        std::vector<uint32_t> reordered = indices;
+        vkt::meshopt::optimizeVertexCache(reordered, uint32Count);
+        VKT_CHECK(getTriangles(reordered) == getTriangles(indices));
+        VKT_CHECK(vkt::meshopt::analyzeVertexCache(reordered, uint32Count).acmr < acmrBefore * 0.5f);
+
+        std::vector<vkt::Vertex> fetched = vertices;
+        std::vector<uint32_t> fetchIndices = reordered;
+        vkt::meshopt::optimizeVertexFetch(fetched, fetchIndices);
+        VKT_CHECK(fetchIndices[0] == 0);
+        for (size_t i = 0; i < fetchIndices.size(); i++) {
+            VKT_CHECK(std::memcmp(&fetched[fetchIndices[i]], &vertices[reordered[i]], sizeof(vkt::Vertex)) == 0);
+        }
+    }
+
+    void testSimplify()
+    {
+        std::vector<vkt::Vertex> vertices;
+        std::vector<uint32_t> indices;
+        makeGrid(32, vertices, indices);
+
+        // Both sides of double-sided geometry
+        size_t frontCount = indices.size();
+        for (size_t i = 0; i < frontCount; i += 3) {
+            indices.insert(indices.end(), { indices[i], indices[i + 2], indices[i + 1] });
+        }
+
+        std::vector<uint32_t> simplified = vkt::meshopt::simplify(indices, vertices, static_cast<uint32_t>(indices.size() / 8));
+        VKT_CHECK(!simplified.empty());
+        VKT_CHECK(simplified.size() <= indices.size() / 8);
+
+        // Every triangle is emitted once, and each has its reversed twin
+        std::multiset<Triangle> triangles = getTriangles(simplified);
+        std::set<Triangle> unique{ triangles.begin(), triangles.end() };
+        VKT_CHECK(unique.size() == triangles.size());
+        for (const Triangle& triangle : unique) {
+            Triangle reversed{ triangle[0], triangle[2], triangle[1] };
+            VKT_CHECK(unique.count(reversed) == 1);
+        }
+    }
+
+    // The totals Scene reports for optimizeMeshes, over every mesh of the file
+    void testScene(const std::filesystem::path& path, float acmrBefore, float acmrAfter,
+                   uint32_t vertexCountBefore, uint32_t vertexCountAfter)
+    {
+        vkt::ThreadPool pool;
+        vkt::GltfLoader loader{ path, &pool };
+        const std::vector<vkt::MeshInfo>& meshes = loader.getMeshes();
+        std::vector<vkt::meshopt::OptimizeStats> stats(meshes.size());
+        std::vector<uint32_t> triangleCounts(meshes.size());
+        pool.parallelFor(meshes.size(), [&](size_t i) {
+            std::vector<vkt::Vertex> vertices(meshes[i].vertexCount);
+            std::vector<uint32_t> indices(meshes[i].indexCount);
+            std::vector<vkt::meshopt::Lod> lods;
+            loader.decodeMesh(static_cast<uint32_t>(i), vertices.data(), indices.data());
+            triangleCounts[i] = meshes[i].indexCount / 3;
+            stats[i] = vkt::meshopt::optimizeMesh(vertices, indices, lods);
+        });
+
+        vkt::meshopt::OptimizeStats total;
+        uint64_t triangleCount = 0;
+        for (size_t i = 0; i < meshes.size(); i++) {
+            total.vertexCountBefore += stats[i].vertexCountBefore;
+            total.vertexCountAfter += stats[i].vertexCountAfter;
+            total.before.verticesTransformed += stats[i].before.verticesTransformed;
+            total.after.verticesTransformed += stats[i].after.verticesTransformed;
+            triangleCount += triangleCounts[i];
+        }
+        float before = static_cast<float>(total.before.verticesTransformed) / triangleCount;
+        float after = static_cast<float>(total.after.verticesTransformed) / triangleCount;
+        std::printf("%s: ACMR %.3f -> %.3f, %u -> %u vertices\n", path.filename().string().c_str(),
+                    before, after, total.vertexCountBefore, total.vertexCountAfter);
+
+        VKT_CHECK(std::abs(before - acmrBefore) < 0.0005f);
+        VKT_CHECK(std::abs(after - acmrAfter) < 0.0005f);
+        VKT_CHECK(total.vertexCountBefore == vertexCountBefore);
+        VKT_CHECK(total.vertexCountAfter == vertexCountAfter);
+    }
+}
+
+// Optionally takes the path of the sponza scene
+int main(int argc, char** argv)
+{
+    testAnalyze();
+    testOptimize();
+    testSimplify();
+    if (argc > 1) {
+        testScene(argv[1], 1.425f, 0.782f, 61390, 47117);
+    }
+    return test::report();
+}
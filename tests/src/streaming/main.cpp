@@ -0,0 +1,140 @@
+#include "vktiny/ResidencyPlanner.hpp"
+#include "Check.hpp"
+
+namespace
+{
+    constexpr uint32_t unused = vkt::ResidencyPlanner::notRequested;
+
+    // RGBA8 textures of 256x256 with all 9 levels. The default tail extent of 64 keeps
+    // levels 2 and coarser resident.
+    std::vector<vkt::StreamedTextureSource> makeSources(uint32_t count)
+    {
+        std::vector<vkt::StreamedTextureSource> sources(count);
+        for (vkt::StreamedTextureSource& source : sources) {
+            source.extent = vk::Extent2D{ 256, 256 };
+            source.mipLevels = 9;
+        }
+        return sources;
+    }
+
+    bool hasJob(const std::vector<vkt::ResidencyJob>& jobs, uint32_t texture, uint32_t baseMip)
+    {
+        for (const vkt::ResidencyJob& job : jobs) {
+            if (job.texture == texture && job.baseMip == baseMip) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    const vk::DeviceSize chain0 = 349524; // levels 0 to 8
+    const vk::DeviceSize chain1 = 87380;
+    const vk::DeviceSize chain2 = 21844;
+
+    void testLoad()
+    {
+        std::vector<vkt::StreamedTextureSource> sources = makeSources(3);
+        VKT_CHECK(vkt::getMipChainSize(sources[0], 0) == chain0);
+        VKT_CHECK(vkt::getMipChainSize(sources[0], 1) == chain1);
+        VKT_CHECK(vkt::getMipChainSize(sources[0], 2) == chain2);
+
+        vkt::ResidencyPlanner planner{ sources, {} };
+        VKT_CHECK(planner.getTailMip(0) == 2);
+        VKT_CHECK(planner.getBaseMip(0) == 2);
+        VKT_CHECK(planner.getResidentSize() == 3 * chain2);
+
+        // Requests coarser than the tail are already satisfied
+        VKT_CHECK(planner.plan({ 5, unused, unused }).empty());
+
+        std::vector<vkt::ResidencyJob> jobs = planner.plan({ 0, unused, 1 });
+        VKT_CHECK(jobs.size() == 2);
+        VKT_CHECK(hasJob(jobs, 0, 0));
+        VKT_CHECK(hasJob(jobs, 2, 1));
+        VKT_CHECK(planner.getBaseMip(0) == 0);
+        VKT_CHECK(planner.getBaseMip(1) == 2);
+        VKT_CHECK(planner.getBaseMip(2) == 1);
+        VKT_CHECK(planner.getResidentSize() == chain0 + chain1 + chain2);
+
+        // Nothing changes while the levels stay resident
+        VKT_CHECK(planner.plan({ 0, unused, 1 }).empty());
+    }
+
+    void testLruEviction()
+    {
+        std::vector<vkt::StreamedTextureSource> sources = makeSources(3);
+        vkt::TextureStreamerCreateInfo info;
+        info.budget = 2 * chain1 + chain2;
+        vkt::ResidencyPlanner planner{ sources, info };
+
+        VKT_CHECK(planner.plan({ 1, unused, unused }).size() == 1);
+        VKT_CHECK(planner.plan({ unused, 1, unused }).size() == 1);
+        VKT_CHECK(planner.getResidentSize() == info.budget);
+
+        // Texture 0 was used longest ago, so it drops back to its tail for texture 2
+        std::vector<vkt::ResidencyJob> jobs = planner.plan({ unused, unused, 1 });
+        VKT_CHECK(jobs.size() == 2);
+        VKT_CHECK(hasJob(jobs, 0, 2));
+        VKT_CHECK(hasJob(jobs, 2, 1));
+        VKT_CHECK(planner.getBaseMip(0) == 2);
+        VKT_CHECK(planner.getBaseMip(1) == 1);
+        VKT_CHECK(planner.getBaseMip(2) == 1);
+        VKT_CHECK(planner.getResidentSize() == info.budget);
+
+        // A texture used this frame only gives up the levels finer than its request
+        jobs = planner.plan({ 1, 2, 1 });
+        VKT_CHECK(jobs.size() == 2);
+        VKT_CHECK(hasJob(jobs, 1, 2));
+        VKT_CHECK(hasJob(jobs, 0, 1));
+        VKT_CHECK(planner.getBaseMip(2) == 1);
+    }
+
+    void testBudget()
+    {
+        std::vector<vkt::StreamedTextureSource> sources = makeSources(3);
+        vkt::TextureStreamerCreateInfo info;
+        info.budget = chain1 + 2 * chain2;
+        vkt::ResidencyPlanner planner{ sources, info };
+
+        // Level 0 doesn't fit next to the tails of the other used textures, level 1 does
+        std::vector<vkt::ResidencyJob> jobs = planner.plan({ 0, 2, 2 });
+        VKT_CHECK(jobs.size() == 1);
+        VKT_CHECK(hasJob(jobs, 0, 1));
+        VKT_CHECK(planner.getResidentSize() == info.budget);
+
+        // Retrying doesn't go over the budget
+        VKT_CHECK(planner.plan({ 0, 2, 2 }).empty());
+        VKT_CHECK(planner.plan({ 0, 0, 0 }).empty());
+        VKT_CHECK(planner.getResidentSize() <= info.budget);
+
+        // The tails stay resident even when they alone exceed the budget
+        info.budget = chain2;
+        vkt::ResidencyPlanner small{ sources, info };
+        VKT_CHECK(small.getResidentSize() == 3 * chain2);
+        VKT_CHECK(small.plan({ 0, 0, 0 }).empty());
+    }
+
+    void testUploadLimit()
+    {
+        std::vector<vkt::StreamedTextureSource> sources = makeSources(2);
+        vkt::TextureStreamerCreateInfo info;
+        info.maxUploadSize = chain0;
+        vkt::ResidencyPlanner planner{ sources, info };
+
+        // The first load may use the whole limit, so the second waits for the next plan
+        std::vector<vkt::ResidencyJob> jobs = planner.plan({ 0, 0 });
+        VKT_CHECK(jobs.size() == 1);
+        VKT_CHECK(hasJob(jobs, 0, 0));
+        jobs = planner.plan({ 0, 0 });
+        VKT_CHECK(jobs.size() == 1);
+        VKT_CHECK(hasJob(jobs, 1, 0));
+    }
+}
+
+int main()
+{
+    testLoad();
+    testLruEviction();
+    testBudget();
+    testUploadLimit();
+    return test::report();
+}
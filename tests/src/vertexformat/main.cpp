@@ -0,0 +1,152 @@
+#include "vktiny/VertexFormat.hpp"
+#include "vktiny/ShaderModule.hpp"
+#include "Check.hpp"
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+    constexpr float snorm16Max = 32767.0f;
+
+    template <typename T>
+    T read(const vkt::QuantizedMesh& mesh, uint32_t vertex, uint32_t offset, uint32_t stride)
+    {
+        T value;
+        std::memcpy(&value, mesh.vertexData.data() + size_t{ vertex } * stride + offset, sizeof(T));
+        return value;
+    }
+
+    // x with x * 32767 exactly halfway between two integers, so rounding is a tie
+    float getSnormTie(int whole)
+    {
+        float value = (whole + 0.5f) / snorm16Max;
+        VKT_CHECK(value * snorm16Max == whole + 0.5f);
+        return value;
+    }
+
+    void testScalarTies()
+    {
+        // Ties round to the even neighbor
+        VKT_CHECK(vkt::encodeOctahedral({ getSnormTie(2), 0.0f, 1.0f - getSnormTie(2) })[0] == 2);
+        VKT_CHECK(vkt::encodeOctahedral({ getSnormTie(3), 0.0f, 1.0f - getSnormTie(3) })[0] == 4);
+        VKT_CHECK(vkt::encodeOctahedral({ -getSnormTie(2), 0.0f, 1.0f - getSnormTie(2) })[0] == -2);
+
+        // Halfway between 1.0 and the next half, and between that half and the one after
+        VKT_CHECK(vkt::encodeHalf(1.0f + 1.0f / 2048.0f) == 0x3c00);
+        VKT_CHECK(vkt::encodeHalf(1.0f + 3.0f / 2048.0f) == 0x3c02);
+        VKT_CHECK(vkt::encodeHalf(-1.0f - 1.0f / 2048.0f) == 0xbc00);
+        VKT_CHECK(vkt::encodeHalf(0.0f) == 0);
+        VKT_CHECK(vkt::encodeHalf(65520.0f) == 0x7c00);
+    }
+
+    // quantizeMesh encodes groups of vertices with SIMD and the remainder with the scalar
+    // encoders, so an odd count puts the same values through both
+    void testSimdMatchesScalar()
+    {
+        const float halfTies[] = { 1.0f + 1.0f / 2048.0f, 1.0f + 3.0f / 2048.0f, 0.5f + 1.0f / 4096.0f, -2.0f - 1.0f / 1024.0f };
+        const int snormTies[] = { 2, 3, 100, 32765 };
+
+        std::vector<vkt::Vertex> vertices;
+        for (int round = 0; round < 2; round++) {
+            for (int i = 0; i < 4; i++) {
+                vkt::Vertex& vertex = vertices.emplace_back();
+                float tie = getSnormTie(snormTies[i]);
+                vertex.position = { i % 2 ? tie : -tie, i % 2 ? -tie : tie, tie };
+                vertex.normal = { i % 2 ? tie : -tie, 0.0f, 1.0f - tie };
+                vertex.texCoord = { halfTies[i], halfTies[3 - i] };
+            }
+        }
+        // Fix the bounds to [-1, 1] so positions scale by exactly 32767
+        vkt::Vertex& low = vertices.emplace_back();
+        low.position = { -1.0f, -1.0f, -1.0f };
+        vkt::Vertex& high = vertices.emplace_back();
+        high.position = { 1.0f, 1.0f, 1.0f };
+        vertices.emplace_back(vertices[0]);
+
+        vkt::VertexLayout layout;
+        uint32_t stride = layout.getStride();
+        auto vertexCount = static_cast<uint32_t>(vertices.size());
+        vkt::QuantizedMesh mesh = vkt::quantizeMesh(vertices.data(), vertexCount, nullptr, 0, layout);
+        VKT_CHECK(mesh.quantization.offset == (std::array<float, 3>{ 0.0f, 0.0f, 0.0f }));
+        VKT_CHECK(mesh.quantization.scale == (std::array<float, 3>{ 1.0f, 1.0f, 1.0f }));
+
+        for (uint32_t i = 0; i < vertexCount; i++) {
+            auto position = read<std::array<int16_t, 4>>(mesh, i, 0, stride);
+            for (int axis = 0; axis < 3; axis++) {
+                float expected = std::nearbyint(vertices[i].position[axis] * snorm16Max);
+                VKT_CHECK(position[axis] == static_cast<int16_t>(expected));
+            }
+            VKT_CHECK(position[3] == 0);
+
+            auto normal = read<std::array<int16_t, 2>>(mesh, i, layout.getNormalOffset(), stride);
+            VKT_CHECK(normal == vkt::encodeOctahedral(vertices[i].normal));
+
+            auto texCoord = read<std::array<uint16_t, 2>>(mesh, i, layout.getTexCoordOffset(), stride);
+            VKT_CHECK(texCoord[0] == vkt::encodeHalf(vertices[i].texCoord[0]));
+            VKT_CHECK(texCoord[1] == vkt::encodeHalf(vertices[i].texCoord[1]));
+        }
+
+        // The last vertex went through the scalar encoders
+        VKT_CHECK(std::memcmp(mesh.vertexData.data(), mesh.vertexData.data() + size_t{ vertexCount - 1 } * stride, stride) == 0);
+    }
+
+    void testIndices()
+    {
+        std::vector<uint32_t> indices = { 0, 1, 2, 65535, 32768, 32767, 3, 4, 5, 65534, 1 };
+        std::vector<vkt::Vertex> vertices(65536);
+        vkt::QuantizedMesh mesh = vkt::quantizeMesh(vertices.data(), 65536, indices.data(),
+                                                    static_cast<uint32_t>(indices.size()), {}, vk::IndexType::eUint16);
+        VKT_CHECK(mesh.indexData.size() == indices.size() * 2);
+        for (size_t i = 0; i < indices.size(); i++) {
+            uint16_t index;
+            std::memcpy(&index, mesh.indexData.data() + i * 2, sizeof(index));
+            VKT_CHECK(index == indices[i]);
+        }
+
+        vertices.emplace_back();
+        VKT_CHECK_THROWS(vkt::quantizeMesh(vertices.data(), 65537, indices.data(), 3, {}, vk::IndexType::eUint16),
+                         "16-bit indices need at most 65536 vertices");
+    }
+
+    // The decode functions of every layout compile in a shader that uses them
+    void testDecodeGlsl()
+    {
+        for (uint32_t combination = 0; combination < 8; combination++) {
+            vkt::VertexLayout layout;
+            layout.position = combination & 1 ? vkt::PositionFormat::Float32 : vkt::PositionFormat::Snorm16;
+            layout.normal = combination & 2 ? vkt::NormalFormat::Float32 : vkt::NormalFormat::Octahedral16;
+            layout.texCoord = combination & 4 ? vkt::TexCoordFormat::Float32 : vkt::TexCoordFormat::Float16;
+
+            std::string glsl = "#version 460\n"
+                               "layout(local_size_x = 64) in;\n" +
+                               vkt::getVertexDecodeGlsl(layout) +
+                               "layout(binding = 0) readonly buffer Vertices { VktPackedVertex vertices[]; };\n"
+                               "layout(binding = 1) writeonly buffer Outputs { vec4 outputs[]; };\n"
+                               "void main()\n"
+                               "{\n"
+                               "    uint i = gl_GlobalInvocationID.x;\n"
+                               "    VktPackedVertex v = vertices[i];\n"
+                               "    vec3 position = vktDecodePosition(v, vec3(0.0), vec3(1.0));\n"
+                               "    vec3 normal = vktDecodeNormal(v);\n"
+                               "    vec2 texCoord = vktDecodeTexCoord(v);\n"
+                               "    outputs[i] = vec4(position + normal, texCoord.x + texCoord.y);\n"
+                               "}\n";
+            bool compiled = false;
+            try {
+                compiled = !vkt::compileToSPV(vk::ShaderStageFlagBits::eCompute, glsl).empty();
+            } catch (const std::exception& e) {
+                std::printf("layout %u:\n%s\n%s\n", combination, glsl.c_str(), e.what());
+            }
+            VKT_CHECK(compiled);
+        }
+    }
+}
+
+int main()
+{
+    testScalarTies();
+    testSimdMatchesScalar();
+    testIndices();
+    testDecodeGlsl();
+    return test::report();
+}
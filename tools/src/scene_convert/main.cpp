@@ -0,0 +1,51 @@
+#include "vktiny/SceneCache.hpp"
+#include "vktiny/Log.hpp"
+#include <iostream>
+
+// Converts a glTF file to a scene cache. Scenes load the cache when SceneCreateInfo::cachePath
+// points to it and the geometry settings match the ones given here.
+// Usage: vktiny_scene_convert input.gltf output.vktscene
+//                             [--optimize] [--lods N] [--quantize] [--no-small-indices]
+
+int main(int argc, char* argv[])
+{
+    std::string inputPath = "";
+    std::string outputPath = "";
+    vkt::SceneCreateInfo info;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--optimize") {
+            info.optimizeMeshes = true;
+        } else if (arg == "--lods" && hasValue) {
+            info.optimizeMeshes = true;
+            info.optimizeInfo.lodCount = std::stoul(argv[++i]);
+        } else if (arg == "--quantize") {
+            info.quantizeVertices = true;
+        } else if (arg == "--no-small-indices") {
+            info.smallIndices = false;
+        } else if (inputPath.empty()) {
+            inputPath = arg;
+        } else if (outputPath.empty()) {
+            outputPath = arg;
+        } else {
+            std::cerr << "unknown argument: " << arg << '\n';
+            return 1;
+        }
+    }
+    if (inputPath.empty() || outputPath.empty()) {
+        std::cerr << "usage: vktiny_scene_convert input.gltf output.vktscene "
+                     "[--optimize] [--lods N] [--quantize] [--no-small-indices]\n";
+        return 1;
+    }
+
+    try {
+        vkt::SceneCache::write(outputPath, inputPath, info);
+    } catch (const std::exception& e) {
+        vkt::log::flush();
+        std::cerr << e.what() << '\n';
+        return 1;
+    }
+    vkt::log::flush();
+    return 0;
+}